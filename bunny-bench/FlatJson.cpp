@@ -0,0 +1,200 @@
+#include "FlatJson.h"
+
+#include "Error.h"
+#include "JsonHelpers.h"
+
+#include <fmt/core.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace Bunny::Bench
+{
+namespace
+{
+class FlatJsonParser
+{
+  public:
+    FlatJsonParser(std::string_view text, std::map<std::string, double>& outValues)
+        : mText(text),
+          mValues(outValues)
+    {
+    }
+
+    bool parse() { return parseObject("") && (skipWhitespace(), mPos == mText.size()); }
+
+  private:
+    void skipWhitespace()
+    {
+        while (mPos < mText.size() && std::isspace(static_cast<unsigned char>(mText[mPos])))
+        {
+            mPos++;
+        }
+    }
+
+    bool consume(char expected)
+    {
+        skipWhitespace();
+        if (mPos < mText.size() && mText[mPos] == expected)
+        {
+            mPos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& outString)
+    {
+        if (!consume('"'))
+        {
+            return false;
+        }
+        outString.clear();
+        while (mPos < mText.size() && mText[mPos] != '"')
+        {
+            if (mText[mPos] != '\\')
+            {
+                outString.push_back(mText[mPos++]);
+                continue;
+            }
+
+            //  the escapes of Base::escapeJsonString, the names are ascii so the unicode escapes are control characters
+            if (++mPos >= mText.size())
+            {
+                return false;
+            }
+            const char escaped = mText[mPos++];
+            if (escaped == 'u')
+            {
+                if (mPos + 4 > mText.size())
+                {
+                    return false;
+                }
+                std::string code(mText.substr(mPos, 4));
+                outString.push_back(static_cast<char>(std::strtol(code.c_str(), nullptr, 16)));
+                mPos += 4;
+            }
+            else
+            {
+                outString.push_back(escaped == 'n' ? '\n' : escaped == 'r' ? '\r' : escaped == 't' ? '\t' : escaped);
+            }
+        }
+        return consume('"');
+    }
+
+    bool parseValue(const std::string& key)
+    {
+        skipWhitespace();
+        if (mPos >= mText.size())
+        {
+            return false;
+        }
+
+        const char first = mText[mPos];
+        if (first == '{')
+        {
+            return parseObject(key);
+        }
+        if (first == '"')
+        {
+            std::string ignored;
+            return parseString(ignored);
+        }
+        for (std::string_view literal : {"true", "false", "null"})
+        {
+            if (mText.substr(mPos, literal.size()) == literal)
+            {
+                mPos += literal.size();
+                return true;
+            }
+        }
+
+        //  the text is not null terminated at the value, so copy the number out before converting
+        size_t end = mPos;
+        while (end < mText.size() && (std::isdigit(static_cast<unsigned char>(mText[end])) || mText[end] == '-' ||
+                                         mText[end] == '+' || mText[end] == '.' || mText[end] == 'e' ||
+                                         mText[end] == 'E'))
+        {
+            end++;
+        }
+        if (end == mPos)
+        {
+            return false;
+        }
+        std::string number(mText.substr(mPos, end - mPos));
+        char* numberEnd = nullptr;
+        mValues[key] = std::strtod(number.c_str(), &numberEnd);
+        mPos = end;
+        return numberEnd == number.c_str() + number.size();
+    }
+
+    bool parseObject(const std::string& prefix)
+    {
+        if (!consume('{'))
+        {
+            return false;
+        }
+        if (consume('}'))
+        {
+            return true;
+        }
+
+        std::string name;
+        do
+        {
+            if (!parseString(name) || !consume(':') || !parseValue(prefix.empty() ? name : prefix + "/" + name))
+            {
+                return false;
+            }
+        } while (consume(','));
+
+        return consume('}');
+    }
+
+    std::string_view mText;
+    size_t mPos = 0;
+    std::map<std::string, double>& mValues;
+};
+} // namespace
+
+BunnyResult readFlatJson(std::string_view filePath, std::map<std::string, double>& outValues)
+{
+    std::ifstream file{std::string(filePath)};
+    if (!file.is_open())
+    {
+        PRINT_AND_RETURN_VALUE(fmt::format("Can not open {}\n", filePath), BUNNY_SAD)
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string text = content.str();
+
+    FlatJsonParser parser(text, outValues);
+    if (!parser.parse())
+    {
+        PRINT_AND_RETURN_VALUE(fmt::format("Fail to parse {}\n", filePath), BUNNY_SAD)
+    }
+    return BUNNY_HAPPY;
+}
+
+BunnyResult writeFlatJson(std::string_view filePath, const std::map<std::string, double>& values)
+{
+    std::ofstream file{std::string(filePath), std::ios::trunc};
+    if (!file.is_open())
+    {
+        PRINT_AND_RETURN_VALUE(fmt::format("Can not open {}\n", filePath), BUNNY_SAD)
+    }
+
+    file << "{";
+    bool isFirst = true;
+    for (const auto& [key, value] : values)
+    {
+        file << fmt::format("{}\n  \"{}\": {:.4f}", isFirst ? "" : ",", Base::escapeJsonString(key), value);
+        isFirst = false;
+    }
+    file << "\n}\n";
+
+    return file.good() ? BUNNY_HAPPY : BUNNY_SAD;
+}
+} // namespace Bunny::Bench
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "BunnyResult.h"
+
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace Bunny::Bench
+{
+//  reads the numbers of a json file of nested objects into one map, the keys of the enclosing objects are
+//  joined with '/', e.g. {"metrics": {"gpu/sky": {"mean": 1.5}}} gives "metrics/gpu/sky/mean" = 1.5
+//  strings, booleans and nulls are skipped, arrays are not supported since the benchmark files have none
+BunnyResult readFlatJson(std::string_view filePath, std::map<std::string, double>& outValues);
+BunnyResult writeFlatJson(std::string_view filePath, const std::map<std::string, double>& values);
+} // namespace Bunny::Bench
@@ -0,0 +1,226 @@
+#include "FlatJson.h"
+#include "Error.h"
+
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using Bunny::Bench::readFlatJson;
+using Bunny::Bench::writeFlatJson;
+
+//  runs the engine headless on the generated benchmark scenes and compares the timings with a baseline
+//  run it from the repository root so the engine finds its assets
+//  exit code: 0 all good, 1 regressions found, 2 a run failed
+
+#ifndef BUNNY_ENGINE_PATH
+#define BUNNY_ENGINE_PATH "EngineNext"
+#endif
+
+//  differences below this are noise no matter the percentage, e.g. a tiny pass going from 0.01 to 0.02 ms
+static constexpr double NOISE_FLOOR_MS = 0.05;
+
+struct BenchScene
+{
+    std::string mName;
+    int mScale = 0; //  0 for the default scale of the scene
+};
+
+struct BenchOptions
+{
+    std::string mEnginePath = BUNNY_ENGINE_PATH;
+    std::string mBaselinePath = "./bunny-bench/baseline.json";
+    std::string mOutputPath = "./bench_output";
+    double mThreshold = 0.1; //  relative, 10% slower is a regression
+    int mFrameCount = 360;
+    bool mShouldUpdateBaseline = false;
+    std::vector<BenchScene> mScenes;
+};
+
+static void printUsage()
+{
+    fmt::print("Usage: bunny-bench [--engine path] [--baseline file] [--output dir] [--threshold percent]\n"
+               "                   [--frames count] [--scene name[:scale]]... [--update-baseline]\n"
+               "Scenes: instanced, hierarchy, materials, lights. All of them when none is given.\n");
+}
+
+static bool parseArguments(int argc, char** argv, BenchOptions& outOptions)
+{
+    for (int idx = 1; idx < argc; idx++)
+    {
+        std::string_view arg(argv[idx]);
+        const bool hasValue = idx + 1 < argc;
+        if (arg == "--engine" && hasValue)
+        {
+            outOptions.mEnginePath = argv[++idx];
+        }
+        else if (arg == "--baseline" && hasValue)
+        {
+            outOptions.mBaselinePath = argv[++idx];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outOptions.mOutputPath = argv[++idx];
+        }
+        else if (arg == "--threshold" && hasValue)
+        {
+            outOptions.mThreshold = std::atof(argv[++idx]) / 100.0;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            outOptions.mFrameCount = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--scene" && hasValue)
+        {
+            std::string_view scene(argv[++idx]);
+            size_t colon = scene.find(':');
+            BenchScene benchScene{std::string(scene.substr(0, colon))};
+            if (colon != std::string_view::npos)
+            {
+                benchScene.mScale = std::atoi(std::string(scene.substr(colon + 1)).c_str());
+            }
+            outOptions.mScenes.push_back(benchScene);
+        }
+        else if (arg == "--update-baseline")
+        {
+            outOptions.mShouldUpdateBaseline = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (outOptions.mScenes.empty())
+    {
+        outOptions.mScenes = {{"instanced"}, {"hierarchy"}, {"materials"}, {"lights"}};
+    }
+    return true;
+}
+
+//  run the engine on one scene and add the mean of every metric to the results, keyed by scene and metric
+static bool runScene(const BenchOptions& options, const BenchScene& scene, std::map<std::string, double>& outResults)
+{
+    const std::filesystem::path sceneOutputPath = std::filesystem::path(options.mOutputPath) / scene.mName;
+    std::filesystem::create_directories(sceneOutputPath);
+    const std::filesystem::path reportPath = sceneOutputPath / "benchmark.json";
+    std::filesystem::remove(reportPath);
+
+    std::string command = fmt::format("\"{}\" --benchmark --scene {} --scene-scale {} --frames {} --output \"{}\"",
+        options.mEnginePath, scene.mName, scene.mScale, options.mFrameCount, sceneOutputPath.string());
+    fmt::print("Running {}\n", command);
+    if (std::system(command.c_str()) != 0)
+    {
+        fmt::print("Benchmark run of scene {} failed.\n", scene.mName);
+        return false;
+    }
+
+    std::map<std::string, double> report;
+    if (!BUNNY_SUCCESS(readFlatJson(reportPath.string(), report)))
+    {
+        return false;
+    }
+
+    constexpr std::string_view metricPrefix = "metrics/";
+    constexpr std::string_view meanSuffix = "/mean";
+    for (const auto& [key, value] : report)
+    {
+        if (key.starts_with(metricPrefix) && key.ends_with(meanSuffix))
+        {
+            std::string_view metric(key);
+            metric = metric.substr(metricPrefix.size(), metric.size() - metricPrefix.size() - meanSuffix.size());
+            outResults[fmt::format("{}/{}", scene.mName, metric)] = value;
+        }
+    }
+    return true;
+}
+
+//  returns the number of regressions
+static uint32_t compareWithBaseline(const std::map<std::string, double>& results,
+    const std::map<std::string, double>& baseline, double threshold)
+{
+    uint32_t regressionCount = 0;
+    fmt::print("\n{:<48} {:>10} {:>10} {:>8}\n", "metric (ms)", "baseline", "current", "change");
+    for (const auto& [key, baselineValue] : baseline)
+    {
+        auto iter = results.find(key);
+        if (iter == results.end())
+        {
+            fmt::print("{:<48} {:>10.3f} {:>10} {:>8}\n", key, baselineValue, "missing", "");
+            continue;
+        }
+
+        const double value = iter->second;
+        const double change = baselineValue > 0 ? (value - baselineValue) / baselineValue : 0;
+        const bool isRegression = change > threshold && value - baselineValue > NOISE_FLOOR_MS;
+        regressionCount += isRegression ? 1 : 0;
+        fmt::print("{:<48} {:>10.3f} {:>10.3f} {:>+7.1f}%{}\n", key, baselineValue, value, change * 100.0,
+            isRegression ? "  REGRESSION" : "");
+    }
+    for (const auto& [key, value] : results)
+    {
+        if (!baseline.contains(key))
+        {
+            fmt::print("{:<48} {:>10} {:>10.3f} {:>8}\n", key, "new", value, "");
+        }
+    }
+    return regressionCount;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::map<std::string, double> results;
+    for (const BenchScene& scene : options.mScenes)
+    {
+        if (!runScene(options, scene, results))
+        {
+            return 2;
+        }
+    }
+
+    const std::string resultsPath = (std::filesystem::path(options.mOutputPath) / "bench_results.json").string();
+    writeFlatJson(resultsPath, results);
+    fmt::print("Results written to {}\n", resultsPath);
+
+    if (options.mShouldUpdateBaseline)
+    {
+        if (!BUNNY_SUCCESS(writeFlatJson(options.mBaselinePath, results)))
+        {
+            return 2;
+        }
+        fmt::print("Baseline {} updated.\n", options.mBaselinePath);
+        return 0;
+    }
+
+    if (!std::filesystem::exists(options.mBaselinePath))
+    {
+        fmt::print("No baseline at {}, run with --update-baseline to store one.\n", options.mBaselinePath);
+        return 0;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!BUNNY_SUCCESS(readFlatJson(options.mBaselinePath, baseline)))
+    {
+        return 2;
+    }
+
+    uint32_t regressionCount = compareWithBaseline(results, baseline, options.mThreshold);
+    if (regressionCount > 0)
+    {
+        fmt::print("\n{} metrics regressed by more than {:.0f}%.\n", regressionCount, options.mThreshold * 100.0);
+        return 1;
+    }
+    fmt::print("\nNo regressions.\n");
+    return 0;
+}
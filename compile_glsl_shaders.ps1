@@ -1,5 +1,6 @@
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/culling.comp             -o ./build/engine-next/Debug/culling_comp.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/reduceDepth.comp         -o ./build/engine-next/Debug/reduce_depth_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/lightCluster.comp        -o ./build/engine-next/Debug/light_cluster_comp.spv
 
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicUpdated.frag        -o ./build/engine-next/Debug/basic_updated_frag.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicInstanced.vert      -o ./build/engine-next/Debug/basic_instanced_vert.spv
@@ -19,8 +20,15 @@ glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rgen
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rmiss            -o ./build/engine-next/Debug/rtbasic_rmiss.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rmiss           -o ./build/engine-next/Debug/rtshadow_rmiss.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rchit           -o ./build/engine-next/Debug/rtshadow_rchit.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtShadowResolve.comp     -o ./build/engine-next/Debug/rtshadow_resolve_comp.spv
 
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudMarch.comp          -o ./build/engine-next/Debug/cloud_march_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudReproject.comp      -o ./build/engine-next/Debug/cloud_reproject_comp.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/sky.comp                 -o ./build/engine-next/Debug/sky_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudShapeNoise.comp     -o ./build/engine-next/Debug/cloud_shape_noise_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudDetailNoise.comp    -o ./build/engine-next/Debug/cloud_detail_noise_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudWeather.comp        -o ./build/engine-next/Debug/cloud_weather_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/temporalUpscale.comp     -o ./build/engine-next/Debug/temporal_upscale_comp.spv
 
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/texturePreview.frag      -o ./build/engine-next/Debug/texture_preview_frag.spv
 
@@ -28,13 +36,35 @@ glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/finalOutput.frag
 
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrum.comp        -o ./build/engine-next/Debug/wave_spectrum_comp.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveTimeSpectrum.comp    -o ./build/engine-next/Debug/wave_time_spectrum_comp.spv
-glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftBitReverse.comp       -o ./build/engine-next/Debug/fft_bit_reverse_comp.spv
-glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftPingPong.comp         -o ./build/engine-next/Debug/fft_ping_pong_comp.spv
+glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftStockham.comp         -o ./build/engine-next/Debug/fft_stockham_comp.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrumTransform.comp   -o ./build/engine-next/Debug/wave_spectrum_transform_comp.spv
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveConstruct.comp       -o ./build/engine-next/Debug/wave_construct_comp.spv
 
 glslc.exe --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.mesh                   -o ./build/engine-next/Debug/wave_mesh.spv
+glslc.exe --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.task                   -o ./build/engine-next/Debug/wave_task.spv
 glslc.exe --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wavefft.mesh                -o ./build/engine-next/Debug/wave_fft_mesh.spv
 glslc.exe --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.frag                   -o ./build/engine-next/Debug/wave_frag.spv
 
 glslc.exe --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/transparentAccum.frag    -o ./build/engine-next/Debug/transparent_accum_frag.spv
+
+# pack all compiled shaders into one bundle which the engine memory maps at startup, same layout as in compile_glsl_shaders.sh
+$shaderOutDir = Resolve-Path "./build/engine-next/Debug"
+$spvFiles = Get-ChildItem -Path $shaderOutDir -Filter *.spv | Sort-Object -Property Name -CaseSensitive
+
+$tableOfContents = "BUNNY_SPIRV_BUNDLE 1`n"
+$offset = 0
+foreach ($spv in $spvFiles) {
+    $tableOfContents += "$($spv.Name) $offset $($spv.Length)`n"
+    $offset += $spv.Length
+}
+$tableOfContents += "END`n"
+
+$headerBytes = [System.Text.Encoding]::ASCII.GetBytes($tableOfContents)
+$bundle = [System.IO.File]::Create((Join-Path $shaderOutDir "shaders.spvbundle"))
+$bundle.Write($headerBytes, 0, $headerBytes.Length)
+$bundle.Write((New-Object byte[] ((4 - $headerBytes.Length % 4) % 4)), 0, (4 - $headerBytes.Length % 4) % 4)
+foreach ($spv in $spvFiles) {
+    $code = [System.IO.File]::ReadAllBytes($spv.FullName)
+    $bundle.Write($code, 0, $code.Length)
+}
+$bundle.Close()
@@ -1,41 +1,80 @@
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/culling.comp             -o ./build/engine-next/Debug/culling_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/reduceDepth.comp         -o ./build/engine-next/Debug/reduce_depth_comp.spv
+SHADER_OUT_DIR=./build/engine-next/Debug
+COMPILED_SHADERS=""
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicUpdated.frag        -o ./build/engine-next/Debug/basic_updated_frag.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicInstanced.vert      -o ./build/engine-next/Debug/basic_instanced_vert.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/culledInstanced.vert     -o ./build/engine-next/Debug/culled_instanced_vert.spv
+# compile one shader and remember its output, only the shaders compiled by this run go into the bundle
+# so the stale .spv files of removed shaders are left out
+compile_shader() {
+    for arg; do out=$arg; done
+    glslc "$@" && COMPILED_SHADERS="$COMPILED_SHADERS $out"
+}
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/screenQuad.vert          -o ./build/engine-next/Debug/screen_quad_vert.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/gbuffer.frag             -o ./build/engine-next/Debug/gbuffer_frag.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicDeferred.frag       -o ./build/engine-next/Debug/basic_deferred_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/culling.comp             -o ./build/engine-next/Debug/culling_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/reduceDepth.comp         -o ./build/engine-next/Debug/reduce_depth_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/lightCluster.comp        -o ./build/engine-next/Debug/light_cluster_comp.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrCulledInstanced.vert  -o ./build/engine-next/Debug/pbr_culled_instanced_vert.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrScreenQuad.vert       -o ./build/engine-next/Debug/pbr_screen_quad_vert.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrGBuffer.frag          -o ./build/engine-next/Debug/pbr_gbuffer_frag.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrForward.frag          -o ./build/engine-next/Debug/pbr_forward_frag.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrDeferred.frag         -o ./build/engine-next/Debug/pbr_deferred_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicUpdated.frag        -o ./build/engine-next/Debug/basic_updated_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicInstanced.vert      -o ./build/engine-next/Debug/basic_instanced_vert.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/culledInstanced.vert     -o ./build/engine-next/Debug/culled_instanced_vert.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rgen             -o ./build/engine-next/Debug/rtbasic_rgen.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rmiss            -o ./build/engine-next/Debug/rtbasic_rmiss.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rmiss           -o ./build/engine-next/Debug/rtshadow_rmiss.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rchit           -o ./build/engine-next/Debug/rtshadow_rchit.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/screenQuad.vert          -o ./build/engine-next/Debug/screen_quad_vert.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/gbuffer.frag             -o ./build/engine-next/Debug/gbuffer_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/basicDeferred.frag       -o ./build/engine-next/Debug/basic_deferred_frag.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/sky.comp                 -o ./build/engine-next/Debug/sky_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrCulledInstanced.vert  -o ./build/engine-next/Debug/pbr_culled_instanced_vert.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrScreenQuad.vert       -o ./build/engine-next/Debug/pbr_screen_quad_vert.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrGBuffer.frag          -o ./build/engine-next/Debug/pbr_gbuffer_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrForward.frag          -o ./build/engine-next/Debug/pbr_forward_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/pbrDeferred.frag         -o ./build/engine-next/Debug/pbr_deferred_frag.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/texturePreview.frag      -o ./build/engine-next/Debug/texture_preview_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rgen             -o ./build/engine-next/Debug/rtbasic_rgen.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtbasic.rmiss            -o ./build/engine-next/Debug/rtbasic_rmiss.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rmiss           -o ./build/engine-next/Debug/rtshadow_rmiss.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtshadow.rchit           -o ./build/engine-next/Debug/rtshadow_rchit.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/rtShadowResolve.comp     -o ./build/engine-next/Debug/rtshadow_resolve_comp.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/finalOutput.frag         -o ./build/engine-next/Debug/final_output_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudMarch.comp          -o ./build/engine-next/Debug/cloud_march_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudReproject.comp      -o ./build/engine-next/Debug/cloud_reproject_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/sky.comp                 -o ./build/engine-next/Debug/sky_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudShapeNoise.comp     -o ./build/engine-next/Debug/cloud_shape_noise_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudDetailNoise.comp    -o ./build/engine-next/Debug/cloud_detail_noise_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/cloudWeather.comp        -o ./build/engine-next/Debug/cloud_weather_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/temporalUpscale.comp     -o ./build/engine-next/Debug/temporal_upscale_comp.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrum.comp        -o ./build/engine-next/Debug/wave_spectrum_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveTimeSpectrum.comp    -o ./build/engine-next/Debug/wave_time_spectrum_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftBitReverse.comp       -o ./build/engine-next/Debug/fft_bit_reverse_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftPingPong.comp         -o ./build/engine-next/Debug/fft_ping_pong_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrumTransform.comp   -o ./build/engine-next/Debug/wave_spectrum_transform_comp.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveConstruct.comp       -o ./build/engine-next/Debug/wave_construct_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/texturePreview.frag      -o ./build/engine-next/Debug/texture_preview_frag.spv
 
-glslc --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.mesh                   -o ./build/engine-next/Debug/wave_mesh.spv
-glslc --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wavefft.mesh                -o ./build/engine-next/Debug/wave_fft_mesh.spv
-glslc --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.frag                   -o ./build/engine-next/Debug/wave_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/finalOutput.frag         -o ./build/engine-next/Debug/final_output_frag.spv
 
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/transparentAccum.frag    -o ./build/engine-next/Debug/transparent_accum_frag.spv
-glslc --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/transparentComp.frag     -o ./build/engine-next/Debug/transparent_comp_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrum.comp        -o ./build/engine-next/Debug/wave_spectrum_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveTimeSpectrum.comp    -o ./build/engine-next/Debug/wave_time_spectrum_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/fftStockham.comp         -o ./build/engine-next/Debug/fft_stockham_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveSpectrumTransform.comp   -o ./build/engine-next/Debug/wave_spectrum_transform_comp.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/waveConstruct.comp       -o ./build/engine-next/Debug/wave_construct_comp.spv
+
+compile_shader --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.mesh                   -o ./build/engine-next/Debug/wave_mesh.spv
+compile_shader --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.task                   -o ./build/engine-next/Debug/wave_task.spv
+compile_shader --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wavefft.mesh                -o ./build/engine-next/Debug/wave_fft_mesh.spv
+compile_shader --target-spv=spv1.5 ./lib/rendering/vulkan/shader/wave.frag                   -o ./build/engine-next/Debug/wave_frag.spv
+
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/transparentAccum.frag    -o ./build/engine-next/Debug/transparent_accum_frag.spv
+compile_shader --target-env=vulkan1.3 ./lib/rendering/vulkan/shader/transparentComp.frag     -o ./build/engine-next/Debug/transparent_comp_frag.spv
+
+# pack all compiled shaders into one bundle which the engine memory maps at startup
+# layout: text table of contents ("<name> <offset> <size>" per shader, offsets relative to the data section),
+# terminated by "END", zero padded to 4 bytes, followed by the SPIR-V code of all shaders
+SHADER_BUNDLE=$SHADER_OUT_DIR/shaders.spvbundle
+
+{
+    echo "BUNNY_SPIRV_BUNDLE 1"
+    offset=0
+    for spv in $COMPILED_SHADERS; do
+        size=$(wc -c < "$spv" | tr -d ' ')
+        echo "$(basename "$spv") $offset $size"
+        offset=$((offset + size))
+    done
+    echo "END"
+} > "$SHADER_BUNDLE.tmp"
+
+header_size=$(wc -c < "$SHADER_BUNDLE.tmp" | tr -d ' ')
+head -c $(((4 - header_size % 4) % 4)) /dev/zero >> "$SHADER_BUNDLE.tmp"
+cat $COMPILED_SHADERS >> "$SHADER_BUNDLE.tmp"
+mv "$SHADER_BUNDLE.tmp" "$SHADER_BUNDLE"
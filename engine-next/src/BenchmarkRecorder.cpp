@@ -0,0 +1,125 @@
+#include "BenchmarkRecorder.h"
+
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "Error.h"
+#include "JsonHelpers.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+namespace Bunny::Engine
+{
+void BenchmarkRecorder::recordFrame(uint64_t frameNumber, double frameTime)
+{
+    if (frameNumber >= WARMUP_FRAME_COUNT)
+    {
+        mFrameTimesMs.push_back(frameTime * 1000.0);
+    }
+}
+
+BunnyResult BenchmarkRecorder::writeReport(const std::string& filePath, std::string_view sceneName,
+    uint32_t sceneScale, const Render::GpuProfiler& gpuProfiler) const
+{
+    std::map<std::string, std::vector<double>> samples;
+    //  wall time between frame starts, the cpu profiler "Frame" zone leaves out the waits
+    samples["cpu/total frame"] = mFrameTimesMs;
+    collectCpuStages(samples);
+    collectGpuPasses(gpuProfiler, samples);
+
+    std::ofstream file{filePath, std::ios::trunc};
+    if (!file.is_open())
+    {
+        std::string errMsg = fmt::format("Can not open {} to write the benchmark report.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+
+    file << fmt::format("{{\n  \"scene\": \"{}\",\n  \"scale\": {},\n  \"frameCount\": {},\n  \"metrics\": {{",
+        Base::escapeJsonString(sceneName), sceneScale, mFrameTimesMs.size());
+    bool isFirst = true;
+    for (auto& [name, values] : samples)
+    {
+        if (values.empty())
+        {
+            continue;
+        }
+
+        double sum = 0;
+        for (double value : values)
+        {
+            sum += value;
+        }
+        std::sort(values.begin(), values.end());
+        const double p95 = values[std::min(values.size() - 1, values.size() * 95 / 100)];
+
+        file << fmt::format("{}\n    \"{}\": {{\"mean\": {:.4f}, \"p95\": {:.4f}, \"max\": {:.4f}}}",
+            isFirst ? "" : ",", Base::escapeJsonString(name), sum / values.size(), p95, values.back());
+        isFirst = false;
+    }
+    file << "\n  }\n}\n";
+
+    if (!file.good())
+    {
+        std::string errMsg = fmt::format("Fail to write the benchmark report to {}.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+    return BUNNY_HAPPY;
+}
+
+void BenchmarkRecorder::collectCpuStages(std::map<std::string, std::vector<double>>& outSamples) const
+{
+#ifdef BUNNY_ENABLE_PROFILER
+    //  zones of the same name within a frame add up, e.g. one per frame graph pass
+    std::unordered_map<std::string, double> frameStages;
+    for (const auto& frame : Base::CpuProfiler::get().getCapturedFrames())
+    {
+        if (frame.mFrameNumber < WARMUP_FRAME_COUNT)
+        {
+            continue;
+        }
+
+        frameStages.clear();
+        for (const auto& captured : frame.mEvents)
+        {
+            if (captured.mEvent.mType == Base::CpuProfileEventType::Zone)
+            {
+                frameStages[fmt::format("cpu/{}", captured.mEvent.mName)] +=
+                    static_cast<double>(captured.mEvent.mEnd - captured.mEvent.mStart) / 1e6;
+            }
+        }
+        for (const auto& [name, duration] : frameStages)
+        {
+            outSamples[name].push_back(duration);
+        }
+    }
+#endif
+}
+
+void BenchmarkRecorder::collectGpuPasses(
+    const Render::GpuProfiler& gpuProfiler, std::map<std::string, std::vector<double>>& outSamples) const
+{
+    std::unordered_map<std::string, double> framePasses;
+    for (const auto& frame : gpuProfiler.getCapturedFrames())
+    {
+        if (frame.mFrameNumber < WARMUP_FRAME_COUNT)
+        {
+            continue;
+        }
+
+        outSamples["gpu/frame"].push_back(frame.mDurationMs);
+        framePasses.clear();
+        for (const auto& zone : frame.mZones)
+        {
+            framePasses[fmt::format("gpu/{}", zone.mName)] += zone.mDurationMs;
+        }
+        for (const auto& [name, duration] : framePasses)
+        {
+            outSamples[name].push_back(duration);
+        }
+    }
+}
+
+} // namespace Bunny::Engine
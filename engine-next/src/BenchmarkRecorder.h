@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BunnyResult.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Bunny::Render
+{
+class GpuProfiler;
+} // namespace Bunny::Render
+
+namespace Bunny::Engine
+{
+//  collects the timings of a benchmark run and writes them as json, read by bunny-bench
+//  cpu stages come from the cpu profiler zones (only with BUNNY_ENABLE_PROFILER), gpu passes from the gpu profiler
+class BenchmarkRecorder
+{
+  public:
+    //  frames before this are ignored, pipelines and caches are still warming up
+    static constexpr uint64_t WARMUP_FRAME_COUNT = 60;
+
+    //  frame time in seconds
+    void recordFrame(uint64_t frameNumber, double frameTime);
+
+    //  one entry per metric with mean, 95th percentile and max in milliseconds
+    BunnyResult writeReport(const std::string& filePath, std::string_view sceneName, uint32_t sceneScale,
+        const Render::GpuProfiler& gpuProfiler) const;
+
+  private:
+    void collectCpuStages(std::map<std::string, std::vector<double>>& outSamples) const;
+    void collectGpuPasses(
+        const Render::GpuProfiler& gpuProfiler, std::map<std::string, std::vector<double>>& outSamples) const;
+
+    std::vector<double> mFrameTimesMs;
+};
+} // namespace Bunny::Engine
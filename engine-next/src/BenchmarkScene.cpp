@@ -0,0 +1,309 @@
+#include "BenchmarkScene.h"
+
+#include "MaterialBank.h"
+#include "ShaderData.h"
+#include "Transform.h"
+#include "WorldComponents.h"
+#include "WorldLoaderHelper.h"
+#include "Error.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Bunny::Engine
+{
+namespace
+{
+constexpr uint32_t RANDOM_SEED = 20240601;
+constexpr float GRID_SPACING = 2.5f;
+constexpr uint32_t HIERARCHY_CHAIN_SIDE = 8; //  8 x 8 chains
+constexpr float HIERARCHY_CHAIN_SPACING = 8.0f;
+constexpr uint32_t INSTANCES_PER_MATERIAL = 16;
+constexpr uint32_t LIGHT_SCENE_OBJECT_SIDE = 32;
+
+//  xorshift, std distributions are implementation defined and would give other scenes on other platforms
+class SceneRandom
+{
+  public:
+    explicit SceneRandom(uint32_t seed)
+        : mState(seed)
+    {
+    }
+
+    //  in [0, 1)
+    float next()
+    {
+        mState ^= mState << 13;
+        mState ^= mState >> 17;
+        mState ^= mState << 5;
+        return static_cast<float>(mState >> 8) / 16777216.0f;
+    }
+    float next(float min, float max) { return min + (max - min) * next(); }
+
+  private:
+    uint32_t mState;
+};
+
+uint32_t getGridSide(uint32_t objectCount)
+{
+    return std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount)))));
+}
+
+//  position of the idx-th cell of a square grid centered at the origin
+glm::vec3 getGridPosition(uint32_t idx, uint32_t side, float spacing)
+{
+    const float offset = (side - 1) * spacing * 0.5f;
+    return glm::vec3((idx % side) * spacing - offset, 0, (idx / side) * spacing - offset);
+}
+
+float getSceneRadius(BenchmarkSceneType type, uint32_t scale)
+{
+    switch (type)
+    {
+    case BenchmarkSceneType::Instanced:
+        return getGridSide(scale) * GRID_SPACING * 0.5f;
+    case BenchmarkSceneType::Hierarchy:
+        return HIERARCHY_CHAIN_SIDE * HIERARCHY_CHAIN_SPACING * 0.5f;
+    case BenchmarkSceneType::Materials:
+        return getGridSide(scale * INSTANCES_PER_MATERIAL) * GRID_SPACING * 0.5f;
+    case BenchmarkSceneType::Lights:
+        return LIGHT_SCENE_OBJECT_SIDE * GRID_SPACING * 0.5f;
+    }
+    return 1;
+}
+
+entt::entity addObject(World& world, Render::IdType meshId, Render::IdType materialId,
+    const Base::Transform& transform, entt::entity parent = entt::null)
+{
+    const auto entity = world.mEntityRegistry.create();
+    world.mEntityRegistry.emplace<TransformComponent>(entity, transform);
+    world.mEntityRegistry.emplace<MeshComponent>(entity, meshId, materialId);
+    if (parent != entt::null)
+    {
+        world.mEntityRegistry.emplace<HierarchyComponent>(entity, parent);
+    }
+    return entity;
+}
+
+//  a flat box under the whole scene, so that there is something to cast shadows on
+void addGround(World& world, Render::IdType meshId, Render::IdType materialId, float radius)
+{
+    addObject(world, meshId, materialId,
+        Base::Transform(glm::vec3(0, -1, 0), glm::quat(1, 0, 0, 0), glm::vec3(radius * 2 + 4, 0.2f, radius * 2 + 4)));
+}
+
+Base::Transform getRandomTransform(SceneRandom& random, const glm::vec3& position)
+{
+    const glm::quat rotation = glm::angleAxis(random.next(0, glm::two_pi<float>()), glm::vec3(0, 1, 0));
+    const float scale = random.next(0.5f, 1.5f);
+    return Base::Transform(position + glm::vec3(0, random.next(0, 2), 0), rotation, glm::vec3(scale));
+}
+
+Render::PbrMaterialParameters getRandomMaterial(SceneRandom& random)
+{
+    Render::PbrMaterialParameters material;
+    material.mBaseColor = glm::vec4(random.next(0.1f, 1), random.next(0.1f, 1), random.next(0.1f, 1), 1);
+    material.mMetallic = random.next() < 0.3f ? 1.0f : 0.0f;
+    material.mRoughness = random.next(0.2f, 1);
+    return material;
+}
+
+void generateInstancedScene(uint32_t objectCount, Render::MeshBank<Render::NormalVertex>* meshBank,
+    Render::PbrMaterialBank* materialBank, World& outWorld, SceneRandom& random)
+{
+    Render::IdType materialId;
+    materialBank->addMaterialInstance(getRandomMaterial(random), materialId);
+    const Render::IdType meshId = createCubeMeshToBank(meshBank, materialId, materialId);
+
+    const uint32_t side = getGridSide(objectCount);
+    for (uint32_t idx = 0; idx < objectCount; idx++)
+    {
+        addObject(outWorld, meshId, materialId, getRandomTransform(random, getGridPosition(idx, side, GRID_SPACING)));
+    }
+    addGround(outWorld, meshId, materialId, getSceneRadius(BenchmarkSceneType::Instanced, objectCount));
+}
+
+void generateHierarchyScene(uint32_t depth, Render::MeshBank<Render::NormalVertex>* meshBank,
+    Render::PbrMaterialBank* materialBank, World& outWorld, SceneRandom& random)
+{
+    Render::IdType materialId;
+    materialBank->addMaterialInstance(getRandomMaterial(random), materialId);
+    const Render::IdType meshId = createCubeMeshToBank(meshBank, materialId, materialId);
+
+    //  every chain is a spiral, each node is placed relative to its parent
+    constexpr uint32_t chainCount = HIERARCHY_CHAIN_SIDE * HIERARCHY_CHAIN_SIDE;
+    for (uint32_t chainIdx = 0; chainIdx < chainCount; chainIdx++)
+    {
+        const glm::vec3 rootPosition = getGridPosition(chainIdx, HIERARCHY_CHAIN_SIDE, HIERARCHY_CHAIN_SPACING);
+        const float twist = random.next(0.2f, 0.4f);
+
+        entt::entity parent = entt::null;
+        for (uint32_t level = 0; level < depth; level++)
+        {
+            const Base::Transform transform = level == 0
+                                                  ? Base::Transform(rootPosition, glm::quat(1, 0, 0, 0), glm::vec3(1))
+                                                  : Base::Transform(glm::vec3(0.6f, 0.8f, 0),
+                                                        glm::angleAxis(twist, glm::vec3(0, 1, 0)), glm::vec3(0.97f));
+            parent = addObject(outWorld, meshId, materialId, transform, parent);
+        }
+    }
+    addGround(outWorld, meshId, materialId, getSceneRadius(BenchmarkSceneType::Hierarchy, depth));
+}
+
+void generateMaterialsScene(uint32_t materialCount, Render::MeshBank<Render::NormalVertex>* meshBank,
+    Render::PbrMaterialBank* materialBank, World& outWorld, SceneRandom& random)
+{
+    //  surfaces carry their material, so every material needs its own mesh and draw
+    std::vector<std::pair<Render::IdType, Render::IdType>> meshMaterials;
+    for (uint32_t idx = 0; idx < materialCount; idx++)
+    {
+        Render::IdType materialId;
+        materialBank->addMaterialInstance(getRandomMaterial(random), materialId);
+        meshMaterials.emplace_back(createCubeMeshToBank(meshBank, materialId, materialId), materialId);
+    }
+
+    const uint32_t objectCount = materialCount * INSTANCES_PER_MATERIAL;
+    const uint32_t side = getGridSide(objectCount);
+    for (uint32_t idx = 0; idx < objectCount; idx++)
+    {
+        const auto& [meshId, materialId] = meshMaterials[idx % materialCount];
+        addObject(outWorld, meshId, materialId, getRandomTransform(random, getGridPosition(idx, side, GRID_SPACING)));
+    }
+    addGround(outWorld, meshMaterials[0].first, meshMaterials[0].second,
+        getSceneRadius(BenchmarkSceneType::Materials, materialCount));
+}
+
+void generateLightsScene(uint32_t lightCount, Render::MeshBank<Render::NormalVertex>* meshBank,
+    Render::PbrMaterialBank* materialBank, World& outWorld, SceneRandom& random)
+{
+    Render::IdType materialId;
+    materialBank->addMaterialInstance(getRandomMaterial(random), materialId);
+    const Render::IdType meshId = createCubeMeshToBank(meshBank, materialId, materialId);
+
+    constexpr uint32_t objectCount = LIGHT_SCENE_OBJECT_SIDE * LIGHT_SCENE_OBJECT_SIDE;
+    for (uint32_t idx = 0; idx < objectCount; idx++)
+    {
+        addObject(outWorld, meshId, materialId,
+            getRandomTransform(random, getGridPosition(idx, LIGHT_SCENE_OBJECT_SIDE, GRID_SPACING)));
+    }
+    const float radius = getSceneRadius(BenchmarkSceneType::Lights, lightCount);
+    addGround(outWorld, meshId, materialId, radius);
+
+    //  every fourth light is a spot light pointing down at the objects
+    for (uint32_t idx = 0; idx < lightCount; idx++)
+    {
+        const auto lightEntity = outWorld.mEntityRegistry.create();
+        const bool isSpot = idx % 4 == 3;
+        Render::PbrLight light{
+            .mDirOrPos = glm::vec3(random.next(-radius, radius), random.next(2, 6), random.next(-radius, radius)),
+            .mIntensity = 20000,
+            .mColor = {random.next(0.3f, 1), random.next(0.3f, 1), random.next(0.3f, 1)},
+            .mInfluenceRadius = isSpot ? 30.0f : 20.0f,
+            .mInnerAngle = glm::radians(20.0f),
+            .mOuterAngle = glm::radians(35.0f),
+            .mType = isSpot ? Render::LightType::Spot : Render::LightType::Point,
+            .mSpotDirection =
+                glm::normalize(glm::vec3(random.next(-0.5f, 0.5f), -1.0f, random.next(-0.5f, 0.5f))),
+        };
+        outWorld.mEntityRegistry.emplace<PbrLightComponent>(lightEntity, light);
+    }
+}
+} // namespace
+
+std::optional<BenchmarkSceneType> parseBenchmarkSceneType(std::string_view name)
+{
+    for (BenchmarkSceneType type : {BenchmarkSceneType::Instanced, BenchmarkSceneType::Hierarchy,
+             BenchmarkSceneType::Materials, BenchmarkSceneType::Lights})
+    {
+        if (getBenchmarkSceneName(type) == name)
+        {
+            return type;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view getBenchmarkSceneName(BenchmarkSceneType type)
+{
+    switch (type)
+    {
+    case BenchmarkSceneType::Instanced:
+        return "instanced";
+    case BenchmarkSceneType::Hierarchy:
+        return "hierarchy";
+    case BenchmarkSceneType::Materials:
+        return "materials";
+    case BenchmarkSceneType::Lights:
+        return "lights";
+    }
+    return "";
+}
+
+uint32_t getBenchmarkSceneDefaultScale(BenchmarkSceneType type)
+{
+    switch (type)
+    {
+    case BenchmarkSceneType::Instanced:
+        return 10000;
+    case BenchmarkSceneType::Hierarchy:
+        return 32;
+    case BenchmarkSceneType::Materials:
+        return 256;
+    case BenchmarkSceneType::Lights:
+        return 1024;
+    }
+    return 1;
+}
+
+BunnyResult generateBenchmarkScene(BenchmarkSceneType type, uint32_t scale,
+    Render::MeshBank<Render::NormalVertex>* meshBank, Render::PbrMaterialBank* materialBank, World& outWorld)
+{
+    if (scale == 0)
+    {
+        PRINT_AND_RETURN_VALUE("Benchmark scene scale must be positive.", BUNNY_SAD)
+    }
+
+    SceneRandom random(RANDOM_SEED);
+    switch (type)
+    {
+    case BenchmarkSceneType::Instanced:
+        generateInstancedScene(scale, meshBank, materialBank, outWorld, random);
+        break;
+    case BenchmarkSceneType::Hierarchy:
+        generateHierarchyScene(scale, meshBank, materialBank, outWorld, random);
+        break;
+    case BenchmarkSceneType::Materials:
+        generateMaterialsScene(scale, meshBank, materialBank, outWorld, random);
+        break;
+    case BenchmarkSceneType::Lights:
+        if (scale > Render::MAX_CLUSTERED_LIGHT_COUNT)
+        {
+            PRINT_WARNING(fmt::format("Light count {} clamped to {}.", scale, Render::MAX_CLUSTERED_LIGHT_COUNT))
+            scale = Render::MAX_CLUSTERED_LIGHT_COUNT;
+        }
+        generateLightsScene(scale, meshBank, materialBank, outWorld, random);
+        break;
+    }
+
+    return BUNNY_HAPPY;
+}
+
+std::vector<CameraPathSystem::Keyframe> getBenchmarkCameraPath(BenchmarkSceneType type, uint32_t scale)
+{
+    constexpr float duration = 10.0f;
+    const float distance = getSceneRadius(type, scale) + 10.0f;
+    const float height = distance * 0.5f;
+
+    //  yaw 0 looks at -z, yaw 90 at -x
+    return {
+        {0,               {0, height, distance},  {-25, 0, 0}  },
+        {duration * 0.5f, {distance, height, 0},  {-25, 90, 0} },
+        {duration,        {0, height, -distance}, {-25, 180, 0}},
+    };
+}
+
+} // namespace Bunny::Engine
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "MeshBank.h"
+#include "Vertex.h"
+#include "World.h"
+#include "WorldSystems.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace Bunny::Render
+{
+class PbrMaterialBank;
+} // namespace Bunny::Render
+
+namespace Bunny::Engine
+{
+//  procedurally generated scenes that stress one part of the engine each, the scale sets how hard
+//  the same type and scale always generate the same scene, on every platform
+enum class BenchmarkSceneType
+{
+    Instanced, //  scale: object count, all sharing one mesh
+    Hierarchy, //  scale: depth of the transform chains
+    Materials, //  scale: material count, one mesh per material
+    Lights     //  scale: point and spot light count, clamped to what the clustered light buffer holds
+};
+
+std::optional<BenchmarkSceneType> parseBenchmarkSceneType(std::string_view name);
+std::string_view getBenchmarkSceneName(BenchmarkSceneType type);
+uint32_t getBenchmarkSceneDefaultScale(BenchmarkSceneType type);
+
+//  adds meshes, materials, objects and lights, the camera and the sun are left to the caller
+BunnyResult generateBenchmarkScene(BenchmarkSceneType type, uint32_t scale,
+    Render::MeshBank<Render::NormalVertex>* meshBank, Render::PbrMaterialBank* materialBank, World& outWorld);
+
+//  a half orbit around the scene, looking at its center
+std::vector<CameraPathSystem::Keyframe> getBenchmarkCameraPath(BenchmarkSceneType type, uint32_t scale);
+
+} // namespace Bunny::Engine
@@ -1,6 +1,12 @@
 #include "Config.h"
 
+#include "Error.h"
+
 #include <inicpp.h>
+#include <fmt/core.h>
+
+#include <cstdlib>
+#include <string_view>
 
 namespace Bunny::Base
 {
@@ -22,6 +28,97 @@ void Config::loadConfigFile(const std::string& path)
     mWindowWidth = basicSection["windowWidth"].as<int>();
     mModelFilePath = basicSection["modelFilePath"].as<std::string>();
     mMultiSampleCount = basicSection["multiSampleCount"].as<int>();
+    mSceneName = basicSection["sceneName"].as<std::string>();
+    mSceneScale = basicSection["sceneScale"].as<int>();
+    mFrameRateLimit = basicSection["frameRateLimit"].as<double>();
+    mRecordingThreadCount = basicSection["recordingThreadCount"].as<int>();
+    mShouldValidateLightClusters = basicSection["validateLightClusters"].as<bool>();
+    mRenderScale = basicSection["renderScale"].as<float>();
+    mIsTemporalUpscalingEnabled = basicSection["temporalUpscaling"].as<bool>();
+    mIsCloudNoiseGenerated = basicSection["generateCloudNoise"].as<bool>();
+    mIsWeatherEvolving = basicSection["evolvingWeather"].as<bool>();
+
+    auto& headlessSection = loadedIni["headless"];
+    mIsHeadless = headlessSection["isHeadless"].as<bool>();
+    mHeadlessFrameCount = headlessSection["frameCount"].as<int>();
+    mHeadlessOutputPath = headlessSection["outputPath"].as<std::string>();
+    mShouldDumpHeadlessImages = headlessSection["dumpImages"].as<bool>();
+    mCameraPathFilePath = headlessSection["cameraPathFilePath"].as<std::string>();
+}
+
+void Config::parseCommandLine(int argc, char** argv)
+{
+    for (int idx = 1; idx < argc; idx++)
+    {
+        std::string_view arg(argv[idx]);
+        const bool hasValue = idx + 1 < argc;
+        if (arg == "--headless")
+        {
+            mIsHeadless = true;
+        }
+        else if (arg == "--benchmark")
+        {
+            mIsHeadless = true;
+            mIsBenchmark = true;
+        }
+        else if (arg == "--scene" && hasValue)
+        {
+            mSceneName = argv[++idx];
+        }
+        else if (arg == "--scene-scale" && hasValue)
+        {
+            mSceneScale = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            mHeadlessFrameCount = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            mHeadlessOutputPath = argv[++idx];
+        }
+        else if (arg == "--camera-path" && hasValue)
+        {
+            mCameraPathFilePath = argv[++idx];
+        }
+        else if (arg == "--recording-threads" && hasValue)
+        {
+            mRecordingThreadCount = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--validate-light-clusters")
+        {
+            mShouldValidateLightClusters = true;
+        }
+        else if (arg == "--validate-ocean")
+        {
+            mShouldValidateOcean = true;
+        }
+        else if (arg == "--validate-frame-graph")
+        {
+            mShouldValidateFrameGraph = true;
+        }
+        else if (arg == "--render-scale" && hasValue)
+        {
+            mRenderScale = static_cast<float>(std::atof(argv[++idx]));
+        }
+        else if (arg == "--temporal-upscaling")
+        {
+            mIsTemporalUpscalingEnabled = true;
+        }
+        else if (arg == "--generate-cloud-noise")
+        {
+            mIsCloudNoiseGenerated = true;
+        }
+        else if (arg == "--evolving-weather")
+        {
+            mIsCloudNoiseGenerated = true;
+            mIsWeatherEvolving = true;
+        }
+        else
+        {
+            PRINT_WARNING(fmt::format("Unknown command line argument {}", arg))
+        }
+    }
 }
 
 } // namespace Bunny::Engine
@@ -10,6 +10,8 @@ class Config : public Base::Singleton<Config>
 {
   public:
     void loadConfigFile(const std::string& path);
+    //  command line arguments override the config file
+    void parseCommandLine(int argc, char** argv);
 
     std::string mWindowName = "Bunny Engine";
     bool mIsFullScreen = false;
@@ -17,6 +19,37 @@ class Config : public Base::Singleton<Config>
     int mWindowHeight = 720;
     std::string mModelFilePath = "./assets/model/both_smooth.glb";
     int mMultiSampleCount = 1;
+    //  a generated benchmark scene (instanced, hierarchy, materials or lights) instead of the model file
+    std::string mSceneName = "";
+    int mSceneScale = 0; //  0 for the default scale of the scene
+    //  0 for no limit, the present mode still limits it with vsync
+    double mFrameRateLimit = 0;
+    //  threads recording the graphics passes of the frame graph, 1 records everything on the main thread
+    int mRecordingThreadCount = 1;
+    //  compare the gpu light clusters with a cpu binning every frame, slow, for debugging
+    bool mShouldValidateLightClusters = false;
+    //  compare the gpu wave displacement with the cpu ocean simulation every frame, slow, for debugging
+    bool mShouldValidateOcean = false;
+    //  compile a small frame graph at startup and compare its barrier and aliasing counts with the expected ones
+    bool mShouldValidateFrameGraph = false;
+    //  the scene is rendered at this fraction of the window size, in [0.25, 1]
+    float mRenderScale = 1.0f;
+    //  accumulate the jittered frames into the window size, needed for a render scale below 1 to not look blurry
+    bool mIsTemporalUpscalingEnabled = false;
+    //  generate the cloud noise volumes and the weather map on the gpu at startup instead of loading the textures
+    bool mIsCloudNoiseGenerated = false;
+    //  keep regenerating the weather map over the frames, turns on the generated cloud noise
+    bool mIsWeatherEvolving = false;
+
+    //  headless mode renders offscreen without a window, for automated benchmarks and image comparison
+    bool mIsHeadless = false;
+    int mHeadlessFrameCount = 300;
+    std::string mHeadlessOutputPath = "./headless_output";
+    bool mShouldDumpHeadlessImages = false;
+    //  empty for turning around at the initial camera position
+    std::string mCameraPathFilePath = "";
+    //  headless without frame readback, writes the timings to benchmark.json in the output path
+    bool mIsBenchmark = false;
 };
 
 } // namespace Bunny::Engine
@@ -4,9 +4,14 @@
 #include "VulkanRenderResources.h"
 #include "VulkanGraphicsRenderer.h"
 #include "ImguiHelper.h"
+#include "CpuProfiler.h"
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
 namespace Bunny::Engine
 {
 
@@ -20,27 +25,23 @@ WorldRenderDataTranslator::WorldRenderDataTranslator(const Render::VulkanRenderR
 
 BunnyResult WorldRenderDataTranslator::initialize()
 {
-    //  PBR
-    mPbrCameraBuffer = mVulkanResources->createBuffer(sizeof(Render::PbrCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        VMA_MEMORY_USAGE_AUTO);
-
-    mPbrLightBuffer = mVulkanResources->createBuffer(sizeof(Render::PbrLightData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        VMA_MEMORY_USAGE_AUTO);
+    //  PBR, the camera and light data is rewritten every frame, so it lives in the frame buffer arena
+    const Render::FrameBufferArena& frameArena = mRenderer->getFrameArena();
+    mPbrCameraSlice = frameArena.makeSlice(sizeof(Render::PbrCameraData));
+    mPbrLightSlice = frameArena.makeSlice(sizeof(Render::PbrLightData));
+    mClusteredLightSlice = frameArena.makeSlice(
+        sizeof(Render::ClusteredLightHeader) + sizeof(Render::ClusteredLight) * Render::MAX_CLUSTERED_LIGHT_COUNT);
+    mClusteredLights.reserve(Render::MAX_CLUSTERED_LIGHT_COUNT);
 
     return BUNNY_HAPPY;
 }
 
 BunnyResult WorldRenderDataTranslator::updatePbrWorldData(const World* world)
 {
+    BUNNY_PROFILE_FUNCTION();
+    //  the data is written every frame even without a camera or lights, the slices of the frame buffer arena
+    //  only point to valid data in the frame they are written in
     const auto camComps = world->mEntityRegistry.view<PbrCameraComponent>();
-
-    if (camComps.empty())
-    {
-        return BUNNY_SAD;
-    }
-
     for (auto [entity, cam] : camComps.each())
     {
         mPbrCameraData.mPosition = cam.mCamera.getPosition();
@@ -48,41 +49,56 @@ BunnyResult WorldRenderDataTranslator::updatePbrWorldData(const World* world)
         mPbrCameraData.mExposure = cam.mCamera.getExposure();
         mPbrCameraData.mInverseView = cam.mCamera.getInverseViewMatrix();
         mPbrCameraData.mInverseProj = cam.mCamera.getInverseProjMatrix();
-        VkExtent2D renderExtent = mRenderer->getSwapChainExtent();
+        VkExtent2D renderExtent = mRenderer->getRenderExtent();
         mPbrCameraData.mResolution = glm::vec2(renderExtent.width, renderExtent.height);
 
         break;
     }
 
-    {
-        void* mappedCameraData = mPbrCameraBuffer.mAllocationInfo.pMappedData;
-        memcpy(mappedCameraData, &mPbrCameraData, sizeof(Render::PbrCameraData));
-    }
+    Render::FrameBufferArena& frameArena = mRenderer->getFrameArena();
+    frameArena.write(mPbrCameraData, mPbrCameraSlice);
 
     const auto lightComps = world->mEntityRegistry.view<PbrLightComponent>();
-    if (lightComps.empty())
-    {
-        return BUNNY_SAD;
-    }
 
+    //  the first lights go to the light buffer, which the raytraced shadows, sky and ocean use
+    //  the point and spot lights also go to the clustered light buffer
     size_t idx = 0;
+    mClusteredLights.clear();
     for (auto [entity, light] : lightComps.each())
     {
-        mPbrLightData.mLights[idx] = light.mLight;
+        if (idx < Render::MAX_LIGHT_COUNT)
+        {
+            mPbrLightData.mLights[idx] = light.mLight;
+        }
+
+        if (light.mLight.mType != Render::LightType::Directional &&
+            mClusteredLights.size() < Render::MAX_CLUSTERED_LIGHT_COUNT)
+        {
+            mClusteredLights.push_back(makeClusteredLight(
+                light.mLight, idx < Render::MAX_LIGHT_COUNT ? static_cast<uint32_t>(idx) : Render::INVALID_SHADOW_IDX));
+        }
         idx++;
     }
-    mPbrLightData.mLightCount = idx;
+    mPbrLightData.mLightCount = std::min(idx, Render::MAX_LIGHT_COUNT);
 
-    {
-        void* mappedLightData = mPbrLightBuffer.mAllocationInfo.pMappedData;
-        memcpy(mappedLightData, &mPbrLightData, sizeof(Render::PbrLightData));
-    }
+    frameArena.write(mPbrLightData, mPbrLightSlice);
 
-    return BUNNY_HAPPY;
+    //  only the lights in use are copied, the rest of the slice is not read
+    const size_t clusteredLightSize =
+        sizeof(Render::ClusteredLightHeader) + mClusteredLights.size() * sizeof(Render::ClusteredLight);
+    auto* mappedClusteredLightData =
+        static_cast<std::byte*>(frameArena.allocate(clusteredLightSize, mClusteredLightSlice));
+    Render::ClusteredLightHeader header{.mLightCount = static_cast<uint32_t>(mClusteredLights.size())};
+    memcpy(mappedClusteredLightData, &header, sizeof(Render::ClusteredLightHeader));
+    memcpy(mappedClusteredLightData + sizeof(Render::ClusteredLightHeader), mClusteredLights.data(),
+        mClusteredLights.size() * sizeof(Render::ClusteredLight));
+
+    return camComps.empty() || lightComps.empty() ? BUNNY_SAD : BUNNY_HAPPY;
 }
 
 BunnyResult WorldRenderDataTranslator::updateObjectData(const World* world)
 {
+    BUNNY_PROFILE_FUNCTION();
     auto meshTransComp = world->mEntityRegistry.view<MeshComponent, TransformComponent>();
     size_t idx = 0;
     for (auto [entity, mesh, transform] : meshTransComp.each())
@@ -103,6 +119,7 @@ BunnyResult WorldRenderDataTranslator::updateObjectData(const World* world)
         obj.firstIndex = meshLite.mSurfaces[0].mFirstIndex; //  for now just take the first index of the first surface
         idx++;
     }
+    BUNNY_PROFILE_COUNTER("Objects", idx);
 
     {
         void* mappedObjectData = mObjectDataBuffer.mAllocationInfo.pMappedData;
@@ -154,8 +171,6 @@ BunnyResult WorldRenderDataTranslator::initObjectDataBuffer(const World* world)
 void WorldRenderDataTranslator::cleanup()
 {
     mVulkanResources->destroyBuffer(mObjectDataBuffer);
-    mVulkanResources->destroyBuffer(mPbrCameraBuffer);
-    mVulkanResources->destroyBuffer(mPbrLightBuffer);
 }
 
 void WorldRenderDataTranslator::showImguiControlPanel(World* world)
@@ -185,6 +200,12 @@ void WorldRenderDataTranslator::showImguiControlPanel(World* world)
         size_t idx = 0;
         for (auto [entity, light] : lightComps.each())
         {
+            //  the benchmark scenes can have thousands of lights
+            if (idx >= Render::MAX_LIGHT_COUNT)
+            {
+                ImGui::Text("%zu more lights", lightComps.size() - idx);
+                break;
+            }
             auto& pbrLight = light.mLight;
             ImGui::PushID(idx);
             //  add control for position or direction
@@ -200,6 +221,11 @@ void WorldRenderDataTranslator::showImguiControlPanel(World* world)
             {
                 ImGui::DragFloat3("Position", &pbrLight.mDirOrPos.x, 0.1f);
             }
+            if (pbrLight.mType == Render::LightType::Spot)
+            {
+                ImGui::DragFloat3("Spot Direction", &pbrLight.mSpotDirection.x, 0.01f);
+                pbrLight.mSpotDirection = glm::normalize(pbrLight.mSpotDirection);
+            }
             ImGui::Separator();
             ImGui::PopID();
             idx++;
@@ -209,6 +235,32 @@ void WorldRenderDataTranslator::showImguiControlPanel(World* world)
     ImGui::End();
 }
 
+Render::ClusteredLight WorldRenderDataTranslator::makeClusteredLight(const Render::PbrLight& light, uint32_t shadowIdx)
+{
+    Render::ClusteredLight clusteredLight{
+        .mPosition = light.mDirOrPos,
+        .mInfluenceRadius = light.mInfluenceRadius,
+        .mColor = light.mColor,
+        .mIntensity = light.mIntensity,
+        .mSpotDirection = glm::vec3(0, -1, 0),
+        .mSpotScale = 1,
+        .mSpotOffset = 1, //  no angle attenuation for point lights
+        .mType = light.mType,
+        .mShadowIdx = shadowIdx,
+    };
+
+    if (light.mType == Render::LightType::Spot)
+    {
+        //  https://google.github.io/filament/Filament.html#lighting/directlighting/punctuallights
+        const float cosOuter = std::cos(light.mOuterAngle);
+        const float cosInner = std::cos(std::min(light.mInnerAngle, light.mOuterAngle));
+        clusteredLight.mSpotDirection = glm::normalize(light.mSpotDirection);
+        clusteredLight.mSpotScale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+        clusteredLight.mSpotOffset = -cosOuter * clusteredLight.mSpotScale;
+    }
+    return clusteredLight;
+}
+
 void WorldRenderDataTranslator::getEntityGlobalTransform(const entt::registry& registry, entt::entity entity,
     const glm::mat4x4& transform, const glm::vec3& scale, glm::mat4x4& outTransform, glm::vec3& outScale)
 {
@@ -8,6 +8,7 @@
 #include "World.h"
 
 #include <unordered_map>
+#include <vector>
 
 namespace Bunny::Render
 {
@@ -24,14 +25,18 @@ class WorldRenderDataTranslator
         const Render::VulkanGraphicsRenderer* renderer, const Render::MeshBank<Render::NormalVertex>* meshBank);
 
     BunnyResult initialize();
-    BunnyResult updatePbrWorldData(const World* world); //  update camera and light data
+    //  update camera and light data, into the frame buffer arena so call it after the frame begins
+    BunnyResult updatePbrWorldData(const World* world);
     BunnyResult updateObjectData(const World* world);
     BunnyResult initObjectDataBuffer(const World* world);
     void cleanup();
 
     const Render::AllocatedBuffer& getObjectBuffer() const { return mObjectDataBuffer; }
-    const Render::AllocatedBuffer& getPbrCameraBuffer() const { return mPbrCameraBuffer; }
-    const Render::AllocatedBuffer& getPbrLightBuffer() const { return mPbrLightBuffer; }
+    //  slices of the frame buffer arena, bound with the dynamic offsets of the current frame
+    const Render::FrameBufferSlice& getPbrCameraSlice() const { return mPbrCameraSlice; }
+    const Render::FrameBufferSlice& getPbrLightSlice() const { return mPbrLightSlice; }
+    const Render::FrameBufferSlice& getClusteredLightSlice() const { return mClusteredLightSlice; }
+    const std::vector<Render::ClusteredLight>& getClusteredLights() const { return mClusteredLights; }
     const size_t getObjectBufferSize() const { return mObjectData.size() * sizeof(Render::ObjectData); }
     const uint32_t getObjectCount() const { return mObjectData.size(); }
     const std::vector<Render::ObjectData>& getObjectData() const { return mObjectData; }
@@ -41,6 +46,7 @@ class WorldRenderDataTranslator
     void showImguiControlPanel(World* world);
 
   private:
+    static Render::ClusteredLight makeClusteredLight(const Render::PbrLight& light, uint32_t shadowIdx);
     static void getEntityGlobalTransform(const entt::registry& registry, entt::entity entity,
         const glm::mat4x4& transform, const glm::vec3& scale, glm::mat4x4& outTransform, glm::vec3& outScale);
 
@@ -54,9 +60,13 @@ class WorldRenderDataTranslator
     std::unordered_map<Render::IdType, size_t> mMeshInstanceCounts;
 
     //  PBR
-    Render::AllocatedBuffer mPbrCameraBuffer;
-    Render::AllocatedBuffer mPbrLightBuffer;
+    Render::FrameBufferSlice mPbrCameraSlice;
+    Render::FrameBufferSlice mPbrLightSlice;
     Render::PbrCameraData mPbrCameraData;
     Render::PbrLightData mPbrLightData;
+
+    //  all point and spot lights for the clustered shading, the light buffer above only holds the first few
+    Render::FrameBufferSlice mClusteredLightSlice;
+    std::vector<Render::ClusteredLight> mClusteredLights;
 };
 } // namespace Bunny::Engine
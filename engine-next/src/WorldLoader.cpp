@@ -6,6 +6,7 @@
 #include "WorldComponents.h"
 #include "WorldLoaderHelper.h"
 #include "TextureBank.h"
+#include "CpuProfiler.h"
 
 #include <glm/mat4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -33,6 +34,7 @@ WorldLoader::WorldLoader(const Render::VulkanRenderResources* vulkanResources, R
 
 BunnyResult WorldLoader::loadPbrTestWorldWithGltfMeshes(std::string_view filePath, World& outWorld)
 {
+    BUNNY_PROFILE_FUNCTION();
     assert(mPbrMaterialBank != nullptr);
 
     std::filesystem::path path(filePath);
@@ -60,6 +62,29 @@ BunnyResult WorldLoader::loadPbrTestWorldWithGltfMeshes(std::string_view filePat
     //  load node transforms and scene structures
     loadWorldStructure(gltf, outWorld);
 
+    addDefaultCameraAndLight(outWorld);
+    postLoad(outWorld);
+
+    return BUNNY_HAPPY;
+}
+
+BunnyResult WorldLoader::loadBenchmarkWorld(BenchmarkSceneType sceneType, uint32_t scale, World& outWorld)
+{
+    BUNNY_PROFILE_FUNCTION();
+    assert(mPbrMaterialBank != nullptr);
+
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(
+        generateBenchmarkScene(sceneType, scale, mMeshBank, mPbrMaterialBank, outWorld))
+    mMeshBank->buildMeshBuffers();
+
+    addDefaultCameraAndLight(outWorld);
+    postLoad(outWorld);
+
+    return BUNNY_HAPPY;
+}
+
+void WorldLoader::addDefaultCameraAndLight(World& outWorld)
+{
     //  if no camera defined in the scene, create one
     {
         const auto camComps = outWorld.mEntityRegistry.view<PbrCameraComponent>();
@@ -85,10 +110,6 @@ BunnyResult WorldLoader::loadPbrTestWorldWithGltfMeshes(std::string_view filePat
         };
         outWorld.mEntityRegistry.emplace<PbrLightComponent>(lightEntity, light);
     }
-
-    postLoad(outWorld);
-
-    return BUNNY_HAPPY;
 }
 
 void Engine::WorldLoader::postLoad(World& outWorld)
@@ -102,6 +123,7 @@ void Engine::WorldLoader::postLoad(World& outWorld)
 
 void WorldLoader::loadWorldStructure(fastgltf::Asset& gltfAsset, World& outWorld)
 {
+    BUNNY_PROFILE_FUNCTION();
     //  first iterate all nodes and create entity for them with transform
     size_t nodeCount = gltfAsset.nodes.size();
     //  build a map of node idx -> entity id
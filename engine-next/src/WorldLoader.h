@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BunnyResult.h"
+#include "BenchmarkScene.h"
 #include "MeshBank.h"
 #include "Vertex.h"
 #include "World.h"
@@ -23,8 +24,10 @@ class WorldLoader
         Render::MeshBank<Render::NormalVertex>* meshBank, Render::TextureBank* textureBank);
 
     BunnyResult loadPbrTestWorldWithGltfMeshes(std::string_view filePath, World& outWorld);
+    BunnyResult loadBenchmarkWorld(BenchmarkSceneType sceneType, uint32_t scale, World& outWorld);
 
   private:
+    void addDefaultCameraAndLight(World& outWorld);
     void postLoad(World& outWorld);
     void loadWorldStructure(fastgltf::Asset& gltfAsset, World& outWorld);
 
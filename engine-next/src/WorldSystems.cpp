@@ -4,9 +4,14 @@
 #include "Camera.h"
 #include "WorldComponents.h"
 #include "ImguiHelper.h"
+#include "Error.h"
 
 #include <imgui.h>
 #include <entt/entt.hpp>
+#include <fmt/core.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 
 namespace Bunny::Engine
 {
@@ -114,6 +119,82 @@ void CameraSystem::showImguiControlPanel()
     ImGui::End();
 }
 
+BunnyResult CameraPathSystem::loadPathFile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        PRINT_AND_RETURN_VALUE(fmt::format("Can not open camera path file {}", path), BUNNY_SAD)
+    }
+
+    std::vector<Keyframe> keyframes;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream lineStream(line);
+        Keyframe keyframe;
+        lineStream >> keyframe.mTime >> keyframe.mPosition.x >> keyframe.mPosition.y >> keyframe.mPosition.z >>
+            keyframe.mPitchYawRoll.x >> keyframe.mPitchYawRoll.y >> keyframe.mPitchYawRoll.z;
+        if (lineStream.fail())
+        {
+            PRINT_AND_RETURN_VALUE(fmt::format("Invalid camera path keyframe: {}", line), BUNNY_SAD)
+        }
+        keyframes.push_back(keyframe);
+    }
+
+    setKeyframes(std::move(keyframes));
+
+    return BUNNY_HAPPY;
+}
+
+void CameraPathSystem::setKeyframes(std::vector<Keyframe> keyframes)
+{
+    mKeyframes = std::move(keyframes);
+    std::sort(mKeyframes.begin(), mKeyframes.end(),
+        [](const Keyframe& a, const Keyframe& b) { return a.mTime < b.mTime; });
+}
+
+void CameraPathSystem::update(World* world, float time)
+{
+    const auto camComps = world->mEntityRegistry.view<PbrCameraComponent>();
+    if (camComps.empty())
+    {
+        return;
+    }
+
+    Render::Camera& camera = world->mEntityRegistry.get<PbrCameraComponent>(camComps.front()).mCamera;
+    camera.recordPrevViewProjMatrix();
+
+    if (mKeyframes.empty())
+    {
+        if (!mHasInitialTransform)
+        {
+            mInitialPosition = camera.getPosition();
+            mInitialPitchYawRoll = camera.getRotation();
+            mHasInitialTransform = true;
+        }
+        camera.setPosition(mInitialPosition);
+        camera.setRotation(mInitialPitchYawRoll + glm::vec3(0, glm::radians(DEFAULT_YAW_VELOCITY) * time, 0));
+        return;
+    }
+
+    //  linear interpolation between the keyframes around the time, clamped at both ends
+    auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), time,
+        [](float t, const Keyframe& keyframe) { return t < keyframe.mTime; });
+    const Keyframe& to = next == mKeyframes.end() ? mKeyframes.back() : *next;
+    const Keyframe& from = next == mKeyframes.begin() ? mKeyframes.front() : *(next - 1);
+
+    const float duration = to.mTime - from.mTime;
+    const float alpha = duration > 0 ? glm::clamp((time - from.mTime) / duration, 0.0f, 1.0f) : 0.0f;
+    camera.setPosition(glm::mix(from.mPosition, to.mPosition, alpha));
+    camera.setRotation(glm::radians(glm::mix(from.mPitchYawRoll, to.mPitchYawRoll, alpha)));
+}
+
 void Engine::ObjectRandomMovementSystem::update(World* world, float deltaTime, float time)
 {
     static constexpr glm::vec3 maxTranslateVelocity{0, 3, 0};
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "Input.h"
+#include "BunnyResult.h"
 
 #include "glm/common.hpp"
 #include "glm/trigonometric.hpp"
 #include "glm/vec3.hpp"
 
 #include <string>
+#include <vector>
 
 namespace Bunny::Engine
 {
@@ -30,6 +32,32 @@ class CameraSystem
     glm::vec3 mRotateVector{0, 0, 0};
 };
 
+//  moves the camera along keyframes by time, so that headless runs render the same frames every time
+//  without keyframes the camera turns around at its initial position
+class CameraPathSystem
+{
+  public:
+    struct Keyframe
+    {
+        float mTime;
+        glm::vec3 mPosition;
+        glm::vec3 mPitchYawRoll; //  in degrees
+    };
+
+    //  one keyframe per line: time px py pz pitch yaw roll, lines starting with # are skipped
+    BunnyResult loadPathFile(const std::string& path);
+    void setKeyframes(std::vector<Keyframe> keyframes);
+    void update(World* world, float time);
+
+  private:
+    static constexpr float DEFAULT_YAW_VELOCITY = 20.0f; //  degrees per second
+
+    std::vector<Keyframe> mKeyframes;
+    bool mHasInitialTransform = false;
+    glm::vec3 mInitialPosition{0, 0, 0};
+    glm::vec3 mInitialPitchYawRoll{0, 0, 0};
+};
+
 class ObjectRandomMovementSystem
 {
   public:
@@ -19,12 +19,14 @@
 #include "DepthReducePass.h"
 #include "GBufferPass.h"
 #include "DeferredShadingPass.h"
+#include "LightClusterPass.h"
 #include "TextureBank.h"
 #include "PbrForwardPass.h"
 #include "AccelerationStructureBuilder.h"
 #include "RaytracingShadowPass.h"
 #include "TexturePreviewPass.h"
 #include "SkyPass.h"
+#include "CloudNoisePass.h"
 #include "FinalOutputPass.h"
 #include "ImguiHelper.h"
 #include "OceanPass.h"
@@ -32,21 +34,55 @@
 #include "WaveSpectrumTransformPass.h"
 #include "TransparencyAccumulatePass.h"
 #include "TransparencyCompositePass.h"
+#include "TemporalUpscalePass.h"
+#include "PipelineCompileQueue.h"
+#include "FrameGraph.h"
+#include "FrameGraphValidation.h"
+#include "CpuProfiler.h"
+#include "HashHelpers.h"
+#include "BenchmarkScene.h"
+#include "BenchmarkRecorder.h"
 
 #include <imgui.h>
 #include <fmt/core.h>
 #include <inicpp.h>
 #include <entt/entt.hpp>
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <optional>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
 
 using namespace Bunny::Engine;
 using namespace Bunny::Render;
 using Bunny::Base::ImguiHelper;
 using Bunny::Base::BasicTimer;
+using Bunny::Base::FramePacer;
 
 using PbrMaterialParameters = Bunny::Render::PbrMaterialParameters;
 
-int main(void)
+//  write the frame as binary ppm, the readback is in the bgra8 layout of the offscreen image
+static void writePpmImage(
+    const std::string& path, const std::vector<std::byte>& pixels, uint32_t width, uint32_t height)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << fmt::format("P6\n{} {}\n255\n", width, height);
+    std::vector<char> rgb(static_cast<size_t>(width) * height * 3);
+    for (size_t idx = 0; idx < static_cast<size_t>(width) * height; idx++)
+    {
+        rgb[idx * 3 + 0] = static_cast<char>(pixels[idx * 4 + 2]);
+        rgb[idx * 3 + 1] = static_cast<char>(pixels[idx * 4 + 1]);
+        rgb[idx * 3 + 2] = static_cast<char>(pixels[idx * 4 + 0]);
+    }
+    file.write(rgb.data(), rgb.size());
+}
+
+int main(int argc, char** argv)
 {
     fmt::print("Welcome to Bunny Engine!\n");
 
@@ -56,33 +92,54 @@ int main(void)
     fmt::print("This is RELEASE build.\n");
 #endif
 
+#ifdef BUNNY_ENABLE_PROFILER
+    Bunny::Base::CpuProfiler::setup();
+#endif
+    BUNNY_PROFILE_THREAD("Main");
+
     Config::setup();
     Config::get().loadConfigFile("./assets/config.ini");
+    Config::get().parseCommandLine(argc, argv);
+    const bool isHeadless = Config::get().mIsHeadless;
+    const bool isTemporalUpscalingEnabled = Config::get().mIsTemporalUpscalingEnabled;
+    const bool isBenchmark = Config::get().mIsBenchmark;
+    const bool isWeatherEvolving = Config::get().mIsWeatherEvolving;
+    const bool isCloudNoiseGenerated = Config::get().mIsCloudNoiseGenerated || isWeatherEvolving;
 
     Bunny::Base::Window window;
-    window.initialize(Config::get().mWindowWidth, Config::get().mWindowHeight, Config::get().mIsFullScreen,
-        Config::get().mWindowName);
-
     Bunny::Base::InputManager inputManager;
-    inputManager.setupWithWindow(window);
+    if (!isHeadless)
+    {
+        window.initialize(Config::get().mWindowWidth, Config::get().mWindowHeight, Config::get().mIsFullScreen,
+            Config::get().mWindowName);
+        inputManager.setupWithWindow(window);
+    }
 
     VulkanRenderResources renderResources;
 
-    if (!BUNNY_SUCCESS(renderResources.initialize(&window)))
+    if (!BUNNY_SUCCESS(renderResources.initialize(isHeadless ? nullptr : &window)))
     {
         PRINT_AND_ABORT("Fail to initialize render resources.")
     }
 
     VulkanGraphicsRenderer renderer(&renderResources);
 
-    if (!BUNNY_SUCCESS(renderer.initialize(Config::get().mMultiSampleCount)))
+    const VkExtent2D headlessExtent{
+        static_cast<uint32_t>(Config::get().mWindowWidth), static_cast<uint32_t>(Config::get().mWindowHeight)};
+    if (!BUNNY_SUCCESS(
+            renderer.initialize(Config::get().mMultiSampleCount, headlessExtent, Config::get().mRenderScale)))
     {
         PRINT_AND_ABORT("Fail to initialize graphics renderer.")
     }
+    //  benchmarks measure the frames in flight overlapping, reading them back would serialize them
+    const bool isFrameReadbackEnabled = isHeadless && !isBenchmark;
+    renderer.setFrameReadbackEnabled(isFrameReadbackEnabled);
 
     ImguiHelper::setup();
 
     BasicTimer timer;
+    FramePacer framePacer;
+    framePacer.setTargetFrameRate(Config::get().mFrameRateLimit);
 
     TextureBank textureBank(&renderResources, &renderer);
     MeshBank<NormalVertex> meshBank(&renderResources);
@@ -93,7 +150,26 @@ int main(void)
 
     World bunnyWorld;
     WorldLoader worldLoader(&renderResources, &pbrMaterialBank, &meshBank, &textureBank);
-    worldLoader.loadPbrTestWorldWithGltfMeshes(Config::get().mModelFilePath, bunnyWorld);
+    std::optional<BenchmarkSceneType> benchmarkScene;
+    uint32_t benchmarkSceneScale = 0;
+    if (!Config::get().mSceneName.empty())
+    {
+        benchmarkScene = parseBenchmarkSceneType(Config::get().mSceneName);
+        if (!benchmarkScene.has_value())
+        {
+            PRINT_AND_ABORT(fmt::format("Unknown benchmark scene {}", Config::get().mSceneName))
+        }
+        benchmarkSceneScale = Config::get().mSceneScale > 0 ? static_cast<uint32_t>(Config::get().mSceneScale)
+                                                            : getBenchmarkSceneDefaultScale(benchmarkScene.value());
+        if (!BUNNY_SUCCESS(worldLoader.loadBenchmarkWorld(benchmarkScene.value(), benchmarkSceneScale, bunnyWorld)))
+        {
+            PRINT_AND_ABORT("Fail to generate benchmark scene.")
+        }
+    }
+    else
+    {
+        worldLoader.loadPbrTestWorldWithGltfMeshes(Config::get().mModelFilePath, bunnyWorld);
+    }
 
     AccelerationStructureBuilder acceStructBuilder(&renderResources, &renderer);
     acceStructBuilder.buildBottomLevelAccelerationStructures(
@@ -101,27 +177,48 @@ int main(void)
 
     WaveSpectrumPrePass waveSpectrumPrePass(&renderResources, &renderer);
     WaveSpectrumTransformPass waveTransformPass(
-        &renderResources, &renderer, waveSpectrumPrePass.getGridN(), waveSpectrumPrePass.getWidth());
+        &renderResources, &renderer, waveSpectrumPrePass.getGridN(), waveSpectrumPrePass.getCascadeWidths());
     RaytracingShadowPass rtShadowPass(&renderResources, &renderer, &pbrMaterialBank, &meshBank);
     PbrForwardPass pbrForwardPass(&renderResources, &renderer, &pbrMaterialBank, &meshBank,
         "pbr_culled_instanced_vert.spv", "pbr_forward_frag.spv");
     CullingPass cullingPass(&renderResources, &renderer, &meshBank);
-    SkyPass skyPass(&renderResources, &renderer, &textureBank);
+    LightClusterPass lightClusterPass(&renderResources, &renderer);
+    CloudNoisePass cloudNoisePass(&renderResources, &renderer);
+    SkyPass skyPass(&renderResources, &renderer, &textureBank, isCloudNoiseGenerated ? &cloudNoisePass : nullptr);
     FinalOutputPass finalOutputPass(&renderResources, &renderer, &textureBank);
     DepthReducePass depthReducePass(&renderResources, &renderer);
     TexturePreviewPass texturePreviewPass(&renderResources, &renderer, &pbrMaterialBank, &meshBank, &textureBank);
     OceanPass oceanPass(&renderResources, &renderer, &textureBank, &pbrMaterialBank, &meshBank,
-        waveSpectrumPrePass.getWidth(), 512, 4096);
+        waveSpectrumPrePass.getCascadeWidths(), waveSpectrumPrePass.getWidth(), 512, 65536);
     TransparencyAccumulatePass transAccumPass(&renderResources, &renderer, &pbrMaterialBank, &meshBank);
     TransparencyCompositePass transCompPass(&renderResources, &renderer, &pbrMaterialBank, &meshBank);
+    TemporalUpscalePass temporalUpscalePass(&renderResources, &renderer, &textureBank);
 
     pbrMaterialBank.recreateMaterialBuffer();
+    pbrMaterialBank.updateMaterialDescriptorSet(&meshBank);
+
+    //  measure pass initialization, mostly pipeline compilation, to compare cold and warm pipeline cache
+    auto passInitStartTime = std::chrono::steady_clock::now();
+
+    //  passes hand their pipeline compilation to worker threads, wait for all of them before the first frame
+    PipelineCompileQueue::setup();
 
     waveSpectrumPrePass.initializePass();
     waveTransformPass.initializePass();
+    if (Config::get().mShouldValidateOcean)
+    {
+        waveTransformPass.enableValidation(waveSpectrumPrePass.getCascadeParams());
+    }
     rtShadowPass.initializePass();
     pbrForwardPass.initializePass();
     cullingPass.initializePass();
+    lightClusterPass.initializePass();
+    lightClusterPass.setValidationEnabled(Config::get().mShouldValidateLightClusters);
+    if (isCloudNoiseGenerated)
+    {
+        //  the sky pass binds the noise images, so they have to exist before it
+        cloudNoisePass.initializePass();
+    }
     skyPass.initializePass();
     finalOutputPass.initializePass();
     depthReducePass.initializePass();
@@ -132,6 +229,416 @@ int main(void)
     }
     transAccumPass.initializePass();
     transCompPass.initializePass();
+    if (isTemporalUpscalingEnabled)
+    {
+        temporalUpscalePass.initializePass();
+    }
+    if (!BUNNY_SUCCESS(PipelineCompileQueue::waitForAll()))
+    {
+        PRINT_WARNING("Some render pass pipelines failed to compile")
+    }
+
+    std::chrono::duration<double, std::milli> passInitDuration = std::chrono::steady_clock::now() - passInitStartTime;
+    fmt::print("Render passes initialized in {:.1f} ms.\n", passInitDuration.count());
+
+    if (isCloudNoiseGenerated)
+    {
+        auto noiseStartTime = std::chrono::steady_clock::now();
+        if (!BUNNY_SUCCESS(cloudNoisePass.generateNoise()))
+        {
+            PRINT_WARNING("Failed to generate the cloud noise")
+        }
+        std::chrono::duration<double, std::milli> noiseDuration = std::chrono::steady_clock::now() - noiseStartTime;
+        fmt::print("Cloud noise generated in {:.1f} ms.\n", noiseDuration.count());
+    }
+
+    //  build the frame graph, the passes only declare what they read and write
+    //  and the graph records the barriers between them
+    bool shouldGenerateSpectrum = true;
+    const bool isMultiSampled = renderer.isMultiSampleEnabled();
+    const bool supportMeshShader = renderResources.getSupportMeshShader();
+    const VkExtent3D renderExtent{renderer.getRenderExtent().width, renderer.getRenderExtent().height, 1};
+
+    //  the exit code reports a failed validation, so a headless run can be used as a check
+    bool isFrameGraphValid = true;
+    if (Config::get().mShouldValidateFrameGraph)
+    {
+        const uint32_t mismatchCount = validateFrameGraph(&renderResources, &renderer);
+        isFrameGraphValid = mismatchCount == 0;
+        fmt::print("Frame graph validation {}, {} statistics do not match.\n", isFrameGraphValid ? "passed" : "failed",
+            mismatchCount);
+    }
+
+    FrameGraph frameGraph(&renderResources, &renderer);
+
+    //  imported resources, owned by the renderer and the passes
+    auto colorResolved =
+        frameGraph.importImage("color resolved", [&renderer]() { return &renderer.getColorImageResolved(); });
+    auto depthResolved = frameGraph.importImage(
+        "depth resolved", [&renderer]() { return &renderer.getDepthImageResolved(); }, VK_IMAGE_ASPECT_DEPTH_BIT);
+    //  without multi sample the scene is rendered to the resolved images directly
+    auto sceneColor = isMultiSampled ? frameGraph.importImage("scene color multi sampled",
+                                           [&renderer]() { return &renderer.getMultiSampledColorImage(); })
+                                     : colorResolved;
+    auto sceneDepth = isMultiSampled ? frameGraph.importImage("scene depth multi sampled",
+                                           [&renderer]() { return &renderer.getMultiSampledDepthImage(); },
+                                           VK_IMAGE_ASPECT_DEPTH_BIT)
+                                     : depthResolved;
+    auto drawCommands = frameGraph.importBuffer(
+        "draw commands", [&pbrForwardPass]() { return &pbrForwardPass.getDrawCommandBuffer(); });
+    auto instanceObjects = frameGraph.importBuffer(
+        "instance objects", [&pbrForwardPass]() { return &pbrForwardPass.getInstanceObjectBuffer(); });
+    auto lightClusters = frameGraph.importBuffer(
+        "light clusters", [&lightClusterPass]() { return &lightClusterPass.getCurrentClusterBuffer(); });
+    auto depthHierarchy = frameGraph.importImage(
+        "depth hierarchy",
+        [&depthReducePass, &renderer]() {
+            return depthReducePass.getDepthHierarchyImages()[renderer.getCurrentFrameIdx()];
+        },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    //  culling of the next frame reads the depth hierarchy
+    frameGraph.markOutput(depthHierarchy);
+    auto shadowImage = frameGraph.importImage(
+        "raytraced shadow", [&rtShadowPass]() { return &rtShadowPass.getCurrentOutImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    auto shadowPrevious = frameGraph.importImage(
+        "raytraced shadow previous", [&rtShadowPass]() { return &rtShadowPass.getPreviousOutImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    frameGraph.markHistory(shadowImage, shadowPrevious);
+    auto shadowGeometry = frameGraph.importImage(
+        "raytraced shadow geometry", [&rtShadowPass]() { return &rtShadowPass.getCurrentGeometryImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    auto shadowGeometryPrevious = frameGraph.importImage(
+        "raytraced shadow geometry previous", [&rtShadowPass]() { return &rtShadowPass.getPreviousGeometryImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    frameGraph.markHistory(shadowGeometry, shadowGeometryPrevious);
+    auto shadowSamples = frameGraph.importImage(
+        "raytraced shadow samples", [&rtShadowPass]() { return &rtShadowPass.getCurrentSampleImage(); });
+    auto waveSpectrum = frameGraph.importImage(
+        "wave spectrum", [&waveSpectrumPrePass]() { return &waveSpectrumPrePass.getSpectrumImage(); });
+    auto waveDisplacement = frameGraph.importImage(
+        "wave displacement", [&waveTransformPass]() { return &waveTransformPass.getWaveDisplacementImage(); });
+    auto waveSlope = frameGraph.importImage(
+        "wave slope", [&waveTransformPass]() { return &waveTransformPass.getWaveSlopeImage(); });
+    auto cloudCurrent = frameGraph.importImage(
+        "cloud", [&skyPass]() { return &skyPass.getCurrentCloudTexture(); }, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_GENERAL);
+    auto cloudHistory = frameGraph.importImage(
+        "cloud history", [&skyPass]() { return &skyPass.getCurrentCloudHistoryImage(); }, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_GENERAL);
+    auto cloudHistoryPrevious = frameGraph.importImage(
+        "cloud history previous", [&skyPass]() { return &skyPass.getPreviousCloudHistoryImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    frameGraph.markHistory(cloudHistory, cloudHistoryPrevious);
+    auto cloudSamples =
+        frameGraph.importImage("cloud samples", [&skyPass]() { return &skyPass.getCurrentCloudSampleImage(); });
+    auto fogShadow = frameGraph.importImage(
+        "fog shadow", [&skyPass]() { return &skyPass.getCurrentFogShadowTexture(); }, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_GENERAL);
+    auto upscaledColor = frameGraph.importImage(
+        "temporal upscale", [&temporalUpscalePass]() { return &temporalUpscalePass.getCurrentOutputImage(); },
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+    auto upscaledColorPrevious = frameGraph.importImage(
+        "temporal upscale previous",
+        [&temporalUpscalePass]() { return &temporalUpscalePass.getPreviousOutputImage(); }, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_GENERAL);
+    frameGraph.markHistory(upscaledColor, upscaledColorPrevious);
+
+    //  transient images, only used within a frame and aliased when their lifetimes do not overlap
+    const uint32_t waveGridN = waveSpectrumPrePass.getGridN();
+    const FrameGraph::TransientImageDesc timedSpectrumDesc{.mExtent = {waveGridN, waveGridN, 1},
+        .mFormat = VK_FORMAT_R32G32_SFLOAT,
+        .mUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .mArrayLayers = WaveSpectrumTransformPass::CASCADE_SPECTRUM_LAYER_COUNT};
+    auto timedSpectrum = frameGraph.createTransientImage("timed spectrum", timedSpectrumDesc);
+
+    FrameGraph::TransientImageDesc accumImageDesc{.mExtent = renderExtent,
+        .mFormat = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .mUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT};
+    FrameGraph::TransientImageDesc revealImageDesc{.mExtent = renderExtent,
+        .mFormat = VK_FORMAT_R16_SFLOAT,
+        .mUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT};
+    auto accumImage = frameGraph.createTransientImage("transparency accumulate", accumImageDesc);
+    auto revealImage = frameGraph.createTransientImage("transparency revealage", revealImageDesc);
+    auto accumImageMS = accumImage;
+    auto revealImageMS = revealImage;
+    if (isMultiSampled)
+    {
+        accumImageDesc.mSampleCount = renderer.getRenderMultiSampleCount();
+        revealImageDesc.mSampleCount = renderer.getRenderMultiSampleCount();
+        accumImageMS = frameGraph.createTransientImage("transparency accumulate multi sampled", accumImageDesc);
+        revealImageMS = frameGraph.createTransientImage("transparency revealage multi sampled", revealImageDesc);
+    }
+
+    //  passes, in execution order
+    constexpr VkPipelineStageFlags depthTestStages =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    constexpr VkAccessFlags depthReadWrite =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    frameGraph.addPass("draw command reset")
+        .write(drawCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT)
+        .setExecute([&pbrForwardPass]() { pbrForwardPass.prepareDrawCommandsForFrame(); });
+
+    //  the ocean waves only depend on time, they are computed on the compute queue next to the opaque scene
+    frameGraph.addPass("wave spectrum")
+        .write(waveSpectrum, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .setAsyncCompute()
+        .setExecute([&waveSpectrumPrePass, &shouldGenerateSpectrum]() {
+            if (shouldGenerateSpectrum)
+            {
+                shouldGenerateSpectrum = false;
+                waveSpectrumPrePass.draw();
+            }
+        });
+
+    frameGraph.addPass("wave transform")
+        .read(waveSpectrum, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .write(timedSpectrum, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .write(
+            waveDisplacement, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .write(waveSlope, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .setAsyncCompute()
+        .setExecute([&waveTransformPass]() { waveTransformPass.draw(); });
+
+    frameGraph.addPass("culling")
+        .read(depthHierarchy, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(drawCommands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+        .write(drawCommands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+        .write(instanceObjects, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+        .setExecute([&cullingPass]() { cullingPass.dispatch(); });
+
+    frameGraph.addPass("light clustering")
+        .write(lightClusters, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT)
+        .setExecute([&lightClusterPass]() { lightClusterPass.dispatch(); });
+
+    //  traces half of the pixels and reprojects the shadow of the last frame for the others
+    frameGraph.addPass("raytraced shadow")
+        .read(shadowPrevious, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL)
+        .read(shadowGeometryPrevious, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL)
+        .write(shadowSamples, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL)
+        .write(shadowGeometry, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL)
+        .setExecute([&rtShadowPass]() { rtShadowPass.draw(); });
+
+    frameGraph.addPass("raytraced shadow resolve")
+        .read(shadowSamples, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(shadowGeometry, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .write(shadowImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .setExecute([&rtShadowPass]() { rtShadowPass.resolve(); });
+
+    frameGraph.addPass("pbr forward")
+        .read(drawCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+        .read(instanceObjects, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+        .read(shadowImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(lightClusters, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+        .write(sceneColor, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .write(sceneDepth, depthTestStages, depthReadWrite, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+        .setExecute([&pbrForwardPass, &renderer, isMultiSampled]() {
+            pbrForwardPass.updateRenderTarget(
+                isMultiSampled ? &renderer.getMultiSampledColorImage() : &renderer.getColorImageResolved());
+            pbrForwardPass.draw();
+        });
+
+    if (supportMeshShader)
+    {
+        auto ocean = frameGraph.addPass("ocean");
+        ocean
+            .read(waveDisplacement, VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .read(waveSlope, VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            //  draws on top of the opaque scene, so it reads and writes the render targets
+            .read(sceneColor, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+            .write(sceneColor, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+            .read(sceneDepth, depthTestStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+            .write(sceneDepth, depthTestStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        if (isMultiSampled)
+        {
+            //  resolves happen in the color attachment output stage, also for depth
+            ocean
+                .write(colorResolved, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                .write(depthResolved,
+                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        }
+        ocean.setExecute([&oceanPass, &waveTransformPass, &renderer, isMultiSampled]() {
+            oceanPass.updateWaveTextures(
+                &waveTransformPass.getWaveDisplacementImage(), &waveTransformPass.getWaveSlopeImage());
+            oceanPass.updateRenderTarget(
+                isMultiSampled ? &renderer.getMultiSampledColorImage() : &renderer.getColorImageResolved());
+            oceanPass.prepareFrameDescriptors();
+            oceanPass.draw();
+        });
+    }
+
+    //  a band of rows of the weather map is regenerated every frame right before the clouds read it
+    //  each frame in flight has its own map, so it is carried over from the last frame like a history
+    FrameGraph::ResourceHandle weather = 0;
+    if (isWeatherEvolving)
+    {
+        weather = frameGraph.importImage(
+            "weather", [&cloudNoisePass]() { return &cloudNoisePass.getCurrentWeatherImage(); },
+            VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+        auto weatherPrevious = frameGraph.importImage(
+            "weather previous", [&cloudNoisePass]() { return &cloudNoisePass.getPreviousWeatherImage(); },
+            VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL);
+        frameGraph.markHistory(weather, weatherPrevious);
+        frameGraph.addPass("weather")
+            .read(weatherPrevious, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL)
+            .write(weather, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+            .setAsyncCompute()
+            .setExecute([&cloudNoisePass]() { cloudNoisePass.draw(); });
+    }
+
+    //  the clouds only need the final depth, so they are ray marched on the compute queue
+    //  while the transparent objects are drawn
+    //  one pixel of every 4 x 4 block of the half resolution history is marched, the others are reprojected
+    {
+        auto cloudMarch = frameGraph.addPass("cloud march");
+        cloudMarch
+            .read(depthResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .write(cloudSamples, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL);
+        if (isWeatherEvolving)
+        {
+            cloudMarch.read(weather, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL);
+        }
+        cloudMarch.setAsyncCompute().setExecute([&skyPass]() { skyPass.marchClouds(); });
+    }
+
+    frameGraph.addPass("cloud reproject")
+        .read(cloudSamples, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(cloudHistoryPrevious, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL)
+        .write(cloudHistory, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .setAsyncCompute()
+        .setExecute([&skyPass]() { skyPass.reprojectClouds(); });
+
+    //  upsamples the clouds to the render resolution and composes them with the sky
+    {
+        auto sky = frameGraph.addPass("sky");
+        sky.read(depthResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .read(cloudHistory, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL)
+            .write(cloudCurrent, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL)
+            .write(fogShadow, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL);
+        if (isWeatherEvolving)
+        {
+            //  the cloud shadow on the scene samples the cloud density, and with it the weather map
+            sky.read(weather, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL);
+        }
+        sky.setAsyncCompute().setExecute([&skyPass]() { skyPass.draw(); });
+    }
+
+    {
+        auto transAccum = frameGraph.addPass("transparency accumulate");
+        transAccum.read(drawCommands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT)
+            .read(instanceObjects, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+            .read(shadowImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+            .read(lightClusters, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+            .read(sceneDepth, depthTestStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+            .write(accumImage, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+            .write(revealImage, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        if (isMultiSampled)
+        {
+            transAccum
+                .write(accumImageMS, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+                .write(revealImageMS, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        }
+        transAccum.setExecute([&transAccumPass]() { transAccumPass.draw(); });
+    }
+
+    frameGraph.addPass("transparency composite")
+        .read(accumImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .read(revealImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .read(colorResolved, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .write(colorResolved, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
+        .setExecute([&transCompPass, &renderer]() {
+            transCompPass.setSceneRenderTarget(&renderer.getColorImageResolved());
+            transCompPass.draw();
+        });
+
+    //  accumulates the jittered scene of the render extent into the swap chain extent
+    //  the clouds have their own temporal reprojection, they are composited on top in the final output
+    if (isTemporalUpscalingEnabled)
+    {
+        frameGraph.addPass("temporal upscale")
+            .read(colorResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .read(depthResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .read(upscaledColorPrevious, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL)
+            .write(upscaledColor, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL)
+            .setExecute([&temporalUpscalePass]() { temporalUpscalePass.dispatch(); });
+    }
+
+    const auto finalSceneColor = isTemporalUpscalingEnabled ? upscaledColor : colorResolved;
+    frameGraph.addPass("final output")
+        .read(cloudCurrent, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(fogShadow, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .read(finalSceneColor, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .setSideEffect()
+        .setExecute([&finalOutputPass, &skyPass, &renderer, &temporalUpscalePass, isTemporalUpscalingEnabled]() {
+            finalOutputPass.updateInputTextures(&skyPass.getCurrentCloudTexture(),
+                &skyPass.getCurrentFogShadowTexture(),
+                isTemporalUpscalingEnabled ? &temporalUpscalePass.getCurrentOutputImage()
+                                           : &renderer.getColorImageResolved());
+            finalOutputPass.draw();
+        });
+
+    frameGraph.addPass("depth reduce")
+        .read(depthResolved, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .write(depthHierarchy, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL)
+        .setExecute([&depthReducePass]() { depthReducePass.dispatch(); });
+
+    frameGraph.addPass("texture preview").setSideEffect().setExecute([&texturePreviewPass]() {
+        texturePreviewPass.draw();
+    });
+
+    const uint32_t recordingThreadCount = static_cast<uint32_t>(std::max(Config::get().mRecordingThreadCount, 1));
+    if (!BUNNY_SUCCESS(frameGraph.setRecordingThreadCount(recordingThreadCount)))
+    {
+        PRINT_AND_ABORT("Fail to set up parallel command recording.")
+    }
+    if (!BUNNY_SUCCESS(frameGraph.compile()))
+    {
+        PRINT_AND_ABORT("Fail to compile frame graph.")
+    }
+    frameGraph.printStatistics();
 
     pbrForwardPass.buildDrawCommands();
 
@@ -145,12 +652,14 @@ int main(void)
                                              VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR);
 
     rtShadowPass.updateVertIdxBufferData(meshBank.getVertexBufferAddress(), meshBank.getIndexBufferAddress());
-    rtShadowPass.linkWorldData(worldTranslator.getPbrLightBuffer(), worldTranslator.getPbrCameraBuffer());
+    rtShadowPass.linkWorldData(worldTranslator.getPbrLightSlice(), worldTranslator.getPbrCameraSlice());
     rtShadowPass.linkObjectData(worldTranslator.getObjectBuffer(), worldTranslator.getObjectBufferSize());
     rtShadowPass.linkTopLevelAccelerationStructure(acceStructBuilder.getTopLevelAccelerationStructure().mAcceStruct);
 
     pbrForwardPass.updateDrawInstanceCounts(worldTranslator.getMeshInstanceCounts());
-    pbrForwardPass.linkWorldData(worldTranslator.getPbrLightBuffer(), worldTranslator.getPbrCameraBuffer());
+    pbrForwardPass.linkWorldData(worldTranslator.getPbrLightSlice(), worldTranslator.getPbrCameraSlice());
+    pbrForwardPass.linkLightClusterData(
+        worldTranslator.getClusteredLightSlice(), lightClusterPass.getClusterBuffers());
     pbrForwardPass.linkObjectData(worldTranslator.getObjectBuffer(), worldTranslator.getObjectBufferSize());
     pbrForwardPass.linkShadowData(rtShadowPass.getOutImageViews());
 
@@ -164,24 +673,64 @@ int main(void)
     cullingPass.setDepthImageSizes(depthReducePass.getDepthImageWidth(), depthReducePass.getDepthImageHeight(),
         depthReducePass.getDepthHierarchyLevels());
 
-    skyPass.linkLightData(worldTranslator.getPbrLightBuffer());
+    lightClusterPass.linkLightData(worldTranslator.getClusteredLightSlice());
+
+    skyPass.linkLightData(worldTranslator.getPbrLightSlice());
 
     waveTransformPass.updateSpectrumImage(&waveSpectrumPrePass.getSpectrumImage());
+    for (uint32_t frameIdx = 0; frameIdx < MAX_FRAMES_IN_FLIGHT; frameIdx++)
+    {
+        waveTransformPass.linkSpectrumImage(frameIdx, frameGraph.getTransientImage(timedSpectrum, frameIdx));
+    }
 
     if (renderResources.getSupportMeshShader())
     {
-        oceanPass.linkLightAndCameraData(worldTranslator.getPbrLightBuffer(), worldTranslator.getPbrCameraBuffer());
+        oceanPass.linkLightAndCameraData(worldTranslator.getPbrLightSlice(), worldTranslator.getPbrCameraSlice());
         oceanPass.linkSceneAccelerationStructure(acceStructBuilder.getTopLevelAccelerationStructure().mAcceStruct);
     }
 
-    transAccumPass.linkWorldData(worldTranslator.getPbrLightBuffer(), worldTranslator.getPbrCameraBuffer());
+    transAccumPass.linkWorldData(worldTranslator.getPbrLightSlice(), worldTranslator.getPbrCameraSlice());
+    transAccumPass.linkLightClusterData(
+        worldTranslator.getClusteredLightSlice(), lightClusterPass.getClusterBuffers());
     transAccumPass.linkObjectData(worldTranslator.getObjectBuffer(), pbrForwardPass.getInstanceObjectBuffer());
     transAccumPass.linkShadowData(rtShadowPass.getOutImageViews());
     transAccumPass.setDrawCommandsBuffer(pbrForwardPass.getDrawCommandBuffer());
+    transAccumPass.linkRenderTargets(frameGraph.getTransientImages(accumImage),
+        frameGraph.getTransientImages(revealImage), frameGraph.getTransientImages(accumImageMS),
+        frameGraph.getTransientImages(revealImageMS));
 
     transCompPass.linkTransparentImages(transAccumPass.getAccumulateImages(), transAccumPass.getRevealImages());
 
     CameraSystem cameraSystem(&inputManager);
+    CameraPathSystem cameraPathSystem;
+    if (isHeadless && !Config::get().mCameraPathFilePath.empty())
+    {
+        if (!BUNNY_SUCCESS(cameraPathSystem.loadPathFile(Config::get().mCameraPathFilePath)))
+        {
+            PRINT_AND_ABORT("Fail to load camera path.")
+        }
+    }
+    else if (benchmarkScene.has_value())
+    {
+        cameraPathSystem.setKeyframes(getBenchmarkCameraPath(benchmarkScene.value(), benchmarkSceneScale));
+    }
+    BenchmarkRecorder benchmarkRecorder;
+
+    //  headless runs advance time by a fixed step, so every run renders the same frames
+    constexpr float headlessDeltaTime = 1.0f / 60.0f;
+    const std::filesystem::path headlessOutputPath(Config::get().mHeadlessOutputPath);
+    std::ofstream checksumFile;
+    std::vector<std::byte> framePixels;
+    if (isHeadless)
+    {
+        std::filesystem::create_directories(headlessOutputPath);
+    }
+    if (isFrameReadbackEnabled)
+    {
+        checksumFile.open(headlessOutputPath / "checksums.txt");
+        fmt::print("Rendering {} frames headless to {}.\n", Config::get().mHeadlessFrameCount,
+            headlessOutputPath.string());
+    }
 
     float accumulatedTime = 0;
     constexpr float interval = 0.5f;
@@ -189,9 +738,10 @@ int main(void)
     float fps = 0;
     uint64_t totalFrames = 0;
 
-    auto showBasicInfo = [&fps]() {
+    auto showBasicInfo = [&fps, &framePacer]() {
         ImGui::Begin("Game Stats");
         ImGui::Text(fmt::format("FPS: {}", fps).c_str());
+        ImGui::Text(fmt::format("Frame time jitter: {:.3f} ms", framePacer.getFrameTimeJitter() * 1000.0).c_str());
         ImGui::Separator();
         ImGui::Text("Movement: W: forward S: backward A: left D: right E: up C: down");
         ImGui::Text("Look: I: down K: up J: left L: right");
@@ -204,14 +754,30 @@ int main(void)
     ImguiHelper::get().registerCommand(showCamAndLightControl);
     auto showTexturePreviewControl = [&texturePreviewPass]() { texturePreviewPass.showImguiControls(); };
     ImguiHelper::get().registerCommand(showTexturePreviewControl);
-
-    IdType spectrumImageDebugId = BUNNY_INVALID_ID;
-    bool shouldGenerateSpectrum = true;
+    auto showGpuProfiler = [&renderer]() { renderer.getGpuProfiler().showImguiPanel(); };
+    ImguiHelper::get().registerCommand(showGpuProfiler);
+#ifdef BUNNY_ENABLE_PROFILER
+    auto showCpuProfiler = []() { Bunny::Base::CpuProfiler::get().showImguiPanel(); };
+    ImguiHelper::get().registerCommand(showCpuProfiler);
+#endif
 
     timer.start();
     while (true)
     {
+        if (!isHeadless)
+        {
+            framePacer.waitForNextFrame();
+        }
         timer.tick();
+        BUNNY_PROFILE_FRAME();
+
+        const float deltaTime = isHeadless ? headlessDeltaTime : timer.getDeltaTime();
+        const float time = isHeadless ? totalFrames * headlessDeltaTime : timer.getTime();
+
+        if (isBenchmark && totalFrames > 0)
+        {
+            benchmarkRecorder.recordFrame(totalFrames - 1, timer.getDeltaTime());
+        }
 
         accumulatedTime += timer.getDeltaTime();
         accumulatedFrames++;
@@ -223,105 +789,132 @@ int main(void)
             accumulatedTime = 0;
         }
 
-        if (window.processWindowEvent())
+        if (isHeadless ? totalFrames > static_cast<uint64_t>(Config::get().mHeadlessFrameCount)
+                       : window.processWindowEvent())
         {
             break;
         }
 
-        cameraSystem.update(&bunnyWorld, timer.getDeltaTime());
+        BUNNY_PROFILE_ZONE("Frame");
+
+        if (isHeadless)
+        {
+            cameraPathSystem.update(&bunnyWorld, time);
+        }
+        else
+        {
+            cameraSystem.update(&bunnyWorld, deltaTime);
+        }
 
         //  update object data buffer
         worldTranslator.updateObjectData(&bunnyWorld);
 
         //  update acceleration structures
-        acceStructBuilder.buildTopLevelAccelerationStructures(worldTranslator.getObjectData(),
-            VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
-                VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR,
-            true);
+        {
+            BUNNY_PROFILE_ZONE("Build TLAS");
+            acceStructBuilder.buildTopLevelAccelerationStructures(worldTranslator.getObjectData(),
+                VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                    VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR,
+                true);
+        }
+
+        const auto camComps = bunnyWorld.mEntityRegistry.view<PbrCameraComponent>();
+        if (isTemporalUpscalingEnabled && !camComps.empty())
+        {
+            //  the jitter is part of the projection, so it has to be set before the camera data is uploaded
+            auto& cam = bunnyWorld.mEntityRegistry.get<PbrCameraComponent>(camComps.front());
+            cam.mCamera.setJitter(temporalUpscalePass.advanceJitter());
+        }
+
+        texturePreviewPass.updateTextureForPreview();
+
+        //  the drawings begin
+        renderer.beginRenderFrame();
 
+        //  the frame data goes into the frame arena, whose region of this frame is free only after the fence wait
         worldTranslator.updatePbrWorldData(&bunnyWorld);
         pbrMaterialBank.updateMaterialBuffer();
-        const auto camComps = bunnyWorld.mEntityRegistry.view<PbrCameraComponent>();
         if (!camComps.empty())
         {
             const auto& cam = bunnyWorld.mEntityRegistry.get<PbrCameraComponent>(camComps.front());
             cullingPass.updateCullingData(cam.mCamera);
-            skyPass.updateRenderParams(cam.mCamera, timer.getTime());
-            waveTransformPass.updateWaveTime(timer.getTime());
+            lightClusterPass.updateClusterParams(cam.mCamera, worldTranslator.getClusteredLights());
+            rtShadowPass.updateRenderParams(cam.mCamera);
+            skyPass.updateRenderParams(cam.mCamera, time);
+            if (isWeatherEvolving)
+            {
+                cloudNoisePass.updateWeather(time);
+            }
+            if (isTemporalUpscalingEnabled)
+            {
+                temporalUpscalePass.updateRenderParams(cam.mCamera);
+            }
+            waveTransformPass.updateWaveTime(time);
             if (renderResources.getSupportMeshShader())
             {
-                oceanPass.updateWorldParams(cam.mCamera.getViewProjMatrix(), timer.getTime(), timer.getDeltaTime());
+                oceanPass.updateWorldParams(cam.mCamera, time, deltaTime);
             }
         }
 
-        texturePreviewPass.updateTextureForPreview();
-
-        //  the drawings begin
-        renderer.beginRenderFrame();
+        pbrMaterialBank.updateTextureDescriptors();
 
-        pbrForwardPass.prepareDrawCommandsForFrame();
+        frameGraph.execute();
 
-        if (shouldGenerateSpectrum)
+        if (!isHeadless)
         {
-            shouldGenerateSpectrum = false;
-            waveSpectrumPrePass.draw();
+            BUNNY_PROFILE_ZONE("Imgui");
+            renderer.beginImguiFrame();
+            ImguiHelper::get().render();
+            renderer.finishImguiFrame();
         }
 
-        waveTransformPass.draw();
-
-        cullingPass.dispatch();
-        rtShadowPass.draw();
-
-        pbrForwardPass.updateRenderTarget(renderer.isMultiSampleEnabled() ? &renderer.getMultiSampledColorImage()
-                                                                          : &renderer.getColorImageResolved());
-        pbrForwardPass.draw();
-
-        if (spectrumImageDebugId == BUNNY_INVALID_ID)
         {
-            IdType texId;
-            textureBank.addAllocatedTexture(waveTransformPass.getWaveDisplacementImage(), spectrumImageDebugId);
-            textureBank.addAllocatedTexture(waveTransformPass.getWaveNormalImage(), texId);
+            BUNNY_PROFILE_ZONE("Submit frame");
+            renderer.finishRenderFrame();
         }
 
-        if (renderResources.getSupportMeshShader())
+        //  waiting for the frame serializes cpu and gpu, fine for checking images but not for timing
+        if (isFrameReadbackEnabled && BUNNY_SUCCESS(renderer.readbackLastFrame(framePixels)))
         {
-            oceanPass.updateWaveTextures(
-                &waveTransformPass.getWaveDisplacementImage(), &waveTransformPass.getWaveNormalImage());
-            oceanPass.updateRenderTarget(renderer.isMultiSampleEnabled() ? &renderer.getMultiSampledColorImage()
-                                                                         : &renderer.getColorImageResolved());
-            oceanPass.prepareFrameDescriptors();
-            oceanPass.draw();
+            const uint64_t frameIdx = totalFrames - 1;
+            checksumFile << fmt::format(
+                "{} {:016x}\n", frameIdx, Bunny::Base::fnv1aHash(framePixels.data(), framePixels.size()));
+            if (Config::get().mShouldDumpHeadlessImages)
+            {
+                writePpmImage((headlessOutputPath / fmt::format("frame_{:04}.ppm", frameIdx)).string(), framePixels,
+                    headlessExtent.width, headlessExtent.height);
+            }
         }
-
-        transAccumPass.draw();
-
-        transCompPass.setSceneRenderTarget(&renderer.getColorImageResolved());
-        transCompPass.draw();
-
-        skyPass.updateFrameData();
-        skyPass.draw();
-
-        finalOutputPass.updateInputTextures(&skyPass.getCurrentCloudTexture(), &skyPass.getCurrentFogShadowTexture(),
-            &renderer.getColorImageResolved());
-        finalOutputPass.draw();
-
-        depthReducePass.dispatch();
-        texturePreviewPass.draw();
-
-        renderer.beginImguiFrame();
-        ImguiHelper::get().render();
-        renderer.finishImguiFrame();
-
-        renderer.finishRenderFrame();
     }
 
     renderer.waitForRenderFinish();
 
+    if (isHeadless)
+    {
+        renderer.getGpuProfiler().exportCsv((headlessOutputPath / "gpu_profile.csv").string());
+        renderer.getGpuProfiler().exportChromeTrace((headlessOutputPath / "gpu_trace.json").string());
+#ifdef BUNNY_ENABLE_PROFILER
+        Bunny::Base::CpuProfiler::get().exportChromeTrace((headlessOutputPath / "cpu_trace.json").string());
+#endif
+        if (isBenchmark)
+        {
+            std::string_view sceneName = benchmarkScene.has_value() ? getBenchmarkSceneName(benchmarkScene.value())
+                                                                    : std::string_view("model");
+            benchmarkRecorder.writeReport((headlessOutputPath / "benchmark.json").string(), sceneName,
+                benchmarkSceneScale, renderer.getGpuProfiler());
+        }
+        fmt::print("Headless run finished, rendered {} frames.\n", totalFrames - 1);
+    }
+
+    frameGraph.cleanup();
     cullingPass.cleanup();
+    lightClusterPass.cleanup();
     depthReducePass.cleanup();
     finalOutputPass.cleanup();
     skyPass.cleanup();
+    cloudNoisePass.cleanup();
     transCompPass.cleanup();
+    temporalUpscalePass.cleanup();
     transAccumPass.cleanup();
     oceanPass.cleanup();
     pbrForwardPass.cleanup();
@@ -341,5 +934,5 @@ int main(void)
 
     window.destroyAndTerminate();
 
-    return 0;
+    return isFrameGraphValid ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+//  cpu instrumentation, everything compiles to nothing unless BUNNY_ENABLE_PROFILER is defined
+//  zone and counter names are not copied, they have to stay valid while the profiler runs (e.g. string literals)
+#ifdef BUNNY_ENABLE_PROFILER
+
+#include "BunnyResult.h"
+#include "Singleton.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define BUNNY_PROFILE_CONCAT_INNER(a, b) a##b
+#define BUNNY_PROFILE_CONCAT(a, b) BUNNY_PROFILE_CONCAT_INNER(a, b)
+
+//  time the rest of the enclosing scope
+#define BUNNY_PROFILE_ZONE(name) Bunny::Base::CpuProfileZone BUNNY_PROFILE_CONCAT(bunnyProfileZone, __LINE__)(name)
+#define BUNNY_PROFILE_FUNCTION() BUNNY_PROFILE_ZONE(__func__)
+//  call once per frame on the main thread, the events recorded since the last mark become one frame
+#define BUNNY_PROFILE_FRAME() Bunny::Base::CpuProfiler::markFrame()
+#define BUNNY_PROFILE_COUNTER(name, value) Bunny::Base::CpuProfiler::recordCounter(name, static_cast<double>(value))
+#define BUNNY_PROFILE_THREAD(name) Bunny::Base::CpuProfiler::setThreadName(name)
+
+namespace Bunny::Base
+{
+enum class CpuProfileEventType : uint32_t
+{
+    Zone,
+    Counter
+};
+
+struct CpuProfileEvent
+{
+    const char* mName;
+    uint64_t mStart; //  nanoseconds of the steady clock
+    uint64_t mEnd;   //  same as start for counters
+    double mValue;   //  counters only
+    uint32_t mDepth; //  zones only, nesting level within the thread
+    CpuProfileEventType mType;
+};
+
+class CpuProfiler : public Singleton<CpuProfiler>
+{
+  public:
+    static constexpr uint32_t MAX_CAPTURED_FRAME_COUNT = 300;
+
+    struct CapturedEvent
+    {
+        CpuProfileEvent mEvent;
+        uint32_t mThreadIdx;
+    };
+
+    struct Frame
+    {
+        uint64_t mFrameNumber = 0;
+        uint64_t mStart = 0;
+        uint64_t mEnd = 0;
+        std::vector<CapturedEvent> mEvents;
+    };
+
+    static uint64_t getTimestamp();
+
+    //  all of them do nothing before setup()
+    static void recordZone(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+    static void recordCounter(const char* name, double value);
+    static void setThreadName(std::string_view name);
+    static void markFrame();
+
+    //  nesting level of the zones open on the calling thread
+    static uint32_t& getThreadZoneDepth();
+
+    const std::deque<Frame>& getCapturedFrames() const { return mFrames; }
+    //  json trace for chrome://tracing or perfetto, with one track per thread
+    BunnyResult exportChromeTrace(std::string_view filePath) const;
+    void showImguiPanel();
+
+  private:
+    //  single producer ring buffer owned by one thread, read by the main thread when a frame is marked
+    //  the producer never waits, events older than the capacity are overwritten and dropped by the reader
+    struct ThreadBuffer
+    {
+        static constexpr uint64_t CAPACITY = 8192;
+
+        std::array<CpuProfileEvent, CAPACITY> mEvents;
+        std::atomic<uint64_t> mWriteCount{0};
+        uint64_t mReadCount = 0;
+        uint32_t mThreadIdx = 0;
+        std::string mName;
+    };
+
+    static ThreadBuffer* getThreadBuffer();
+    static void pushEvent(const CpuProfileEvent& event);
+
+    ThreadBuffer* registerThread();
+    void collectEvents(Frame& frame);
+    std::vector<std::string> getThreadNames() const;
+    void drawFlameGraph(const Frame& frame, uint32_t threadIdx, float width);
+
+    mutable std::mutex mThreadBufferMutex; //  guards the list of buffers and their names
+    std::vector<std::unique_ptr<ThreadBuffer>> mThreadBuffers;
+
+    std::deque<Frame> mFrames;
+    uint64_t mFrameNumber = 0;
+    uint64_t mFrameStart = 0;
+    uint64_t mDroppedEventCount = 0;
+    bool mIsPaused = false;
+    int mSelectedFrameIdx = 0; //  in the captured frames while paused
+};
+
+class CpuProfileZone
+{
+  public:
+    explicit CpuProfileZone(const char* name)
+        : mName(name),
+          mStart(CpuProfiler::getTimestamp()),
+          mDepth(CpuProfiler::getThreadZoneDepth()++)
+    {
+    }
+    ~CpuProfileZone()
+    {
+        CpuProfiler::getThreadZoneDepth()--;
+        CpuProfiler::recordZone(mName, mStart, CpuProfiler::getTimestamp(), mDepth);
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+  private:
+    const char* mName;
+    uint64_t mStart;
+    uint32_t mDepth;
+};
+} // namespace Bunny::Base
+
+#else
+
+#define BUNNY_PROFILE_ZONE(name)
+#define BUNNY_PROFILE_FUNCTION()
+#define BUNNY_PROFILE_FRAME()
+#define BUNNY_PROFILE_COUNTER(name, value)
+#define BUNNY_PROFILE_THREAD(name)
+
+#endif
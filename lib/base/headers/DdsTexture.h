@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Bunny::Base
+{
+//  texel formats of the dds textures, the values are the dxgi formats of the dx10 header
+enum class DdsFormat : uint32_t
+{
+    R8G8Unorm = 49,
+    R8Unorm = 61,
+};
+
+//  2d or 3d texture with its mip chain, saved as a dds file with the dx10 header so texture tools can open it
+struct DdsTexture
+{
+    DdsFormat mFormat = DdsFormat::R8Unorm;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    uint32_t mDepth = 1; //  1 for 2d textures
+    uint32_t mMipCount = 1;
+    //  the mip levels one after another from the largest, every level is tightly packed slice after slice
+    std::vector<uint8_t> mData;
+
+    uint32_t getTexelSize() const;
+    uint32_t getMipWidth(uint32_t mip) const;
+    uint32_t getMipHeight(uint32_t mip) const;
+    uint32_t getMipDepth(uint32_t mip) const;
+    size_t getMipSize(uint32_t mip) const;
+    size_t getMipOffset(uint32_t mip) const;
+
+    //  resize the data for the mip count and fill the levels below the first one with a box filter
+    //  the first level is kept, the texture is treated as tiling
+    void generateMips(uint32_t mipCount);
+};
+
+//  number of levels of a full mip chain down to 1 x 1 x 1
+uint32_t getFullMipCount(uint32_t width, uint32_t height, uint32_t depth = 1);
+
+bool writeDdsTexture(std::string_view path, const DdsTexture& texture);
+//  only files with the formats of DdsFormat can be read
+bool readDdsTexture(std::string_view path, DdsTexture& outTexture);
+} // namespace Bunny::Base
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Bunny::Base
+{
+//  64 bit FNV-1a, fast enough for hashing file contents like shader code or pipeline cache data
+//  not meant to be used for anything security related
+constexpr uint64_t fnv1aHash(const std::byte* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t idx = 0; idx < size; idx++)
+    {
+        hash ^= static_cast<uint64_t>(data[idx]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace Bunny::Base
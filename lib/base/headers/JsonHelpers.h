@@ -0,0 +1,65 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <string>
+#include <string_view>
+
+namespace Bunny::Base
+{
+//  escapes a string to be written between the quotes of a json string,
+//  quotes, backslashes and control characters would break the file otherwise
+inline std::string escapeJsonString(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char character : text)
+    {
+        switch (character)
+        {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        case '\r':
+            escaped += "\\r";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20)
+            {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned int>(character));
+            }
+            else
+            {
+                escaped += character;
+            }
+        }
+    }
+    return escaped;
+}
+
+//  escapes a string to be written between the quotes of a csv field, the profile exports write csv next to json
+inline std::string escapeCsvField(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char character : text)
+    {
+        //  a quote inside a quoted field is doubled
+        if (character == '"')
+        {
+            escaped += '"';
+        }
+        escaped += character;
+    }
+    return escaped;
+}
+} // namespace Bunny::Base
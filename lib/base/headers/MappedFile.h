@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace Bunny::Base
+{
+//  read only memory mapped file
+//  the mapped content stays valid until close() is called or the object is destroyed
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    bool open(std::string_view path);
+    void close();
+
+    bool isOpen() const { return mData != nullptr; }
+    std::span<const std::byte> getContent() const { return {mData, mSize}; }
+
+  private:
+    const std::byte* mData = nullptr;
+    size_t mSize = 0;
+
+#ifdef _WIN32
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+};
+} // namespace Bunny::Base
@@ -3,13 +3,22 @@
 #include <type_traits>
 #include <cassert>
 #include <chrono>
-
-//  may need to handle cross platform in the future
-#include <windows.h>
+#include <array>
+#include <cstdint>
 
 namespace Bunny::Base
 {
 
+//  monotonic clock not affected by system time changes, in nanoseconds
+//  uses CLOCK_MONOTONIC_RAW on linux so that ntp slewing does not stretch frame times, steady_clock elsewhere
+class Clock
+{
+  public:
+    static uint64_t now();
+    //  may return later than asked, by up to the scheduler granularity of the platform
+    static void sleepFor(uint64_t nanoseconds);
+};
+
 template <typename TimeUnit = double>
     requires std::is_floating_point_v<TimeUnit>
 class ITTimer
@@ -28,24 +37,91 @@ class BasicTimer : public ITTimer<TimeUnit>
   public:
     void start()
     {
-        mStartTimePoint = std::chrono::high_resolution_clock::now();
-        mLastTimePoint = mStartTimePoint;
+        mStartTime = Clock::now();
+        mLastTime = mStartTime;
     }
     virtual void tick() override
     {
-        const auto currentTimePoint = std::chrono::high_resolution_clock::now();
-        mDeltaTime = currentTimePoint - mLastTimePoint;
-        mTime = currentTimePoint - mStartTimePoint;
-        mLastTimePoint = currentTimePoint;
+        const uint64_t currentTime = Clock::now();
+        mDeltaTime = static_cast<TimeUnit>(currentTime - mLastTime) / static_cast<TimeUnit>(1e9);
+        mTime = static_cast<TimeUnit>(currentTime - mStartTime) / static_cast<TimeUnit>(1e9);
+        mLastTime = currentTime;
+
+        //  exponential moving average, the first tick starts it at the measured delta
+        mSmoothedDeltaTime = mSmoothedDeltaTime == 0 ? mDeltaTime
+                                                     : mSmoothedDeltaTime + (mDeltaTime - mSmoothedDeltaTime) *
+                                                                                static_cast<TimeUnit>(SMOOTHING_WEIGHT);
     }
-    virtual TimeUnit getTime() const override { return mTime.count(); }
-    virtual TimeUnit getDeltaTime() const override { return mDeltaTime.count(); }
+    virtual TimeUnit getTime() const override { return mTime; }
+    virtual TimeUnit getDeltaTime() const override { return mDeltaTime; }
+    //  delta time with the spikes of single frames filtered out, for camera movement and animations
+    TimeUnit getSmoothedDeltaTime() const { return mSmoothedDeltaTime; }
+
+  private:
+    static constexpr double SMOOTHING_WEIGHT = 0.1;
+
+    uint64_t mStartTime = 0;
+    uint64_t mLastTime = 0;
+    TimeUnit mTime = 0;
+    TimeUnit mDeltaTime = 0;
+    TimeUnit mSmoothedDeltaTime = 0;
+};
+
+//  accumulates frame time and hands it out in steps of fixed length, for simulations that need a stable step
+class FixedTimestep
+{
+  public:
+    //  maxStepCount limits the steps of one frame, so a long frame does not make the next frames even longer
+    explicit FixedTimestep(double stepTime, uint32_t maxStepCount = 8);
+
+    //  add the time of a frame, returns how many steps to simulate
+    uint32_t advance(double deltaTime);
+
+    double getStepTime() const { return mStepTime; }
+    //  how far the current time is between the last simulated step and the next one, for interpolating
+    double getAlpha() const { return mAccumulatedTime / mStepTime; }
 
   private:
-    std::chrono::time_point<std::chrono::high_resolution_clock> mStartTimePoint;
-    std::chrono::time_point<std::chrono::high_resolution_clock> mLastTimePoint;
-    std::chrono::duration<TimeUnit> mTime{0};
-    std::chrono::duration<TimeUnit> mDeltaTime{0};
+    double mStepTime;
+    uint32_t mMaxStepCount;
+    double mAccumulatedTime = 0;
+};
+
+//  limits the frame rate by waiting until the next frame is due
+//  sleeps while there is enough time left and spins for the rest, the spin time adapts to how much the
+//  sleeps of the platform overshoot, so frames start on time without burning a core for the whole wait
+class FramePacer
+{
+  public:
+    static constexpr uint32_t STATISTICS_FRAME_COUNT = 120;
+
+    //  0 disables the limit
+    void setTargetFrameRate(double frameRate);
+    double getTargetFrameRate() const;
+
+    //  call once per frame before the frame starts
+    void waitForNextFrame();
+
+    //  over the last STATISTICS_FRAME_COUNT frames, in seconds
+    double getAverageFrameTime() const;
+    //  standard deviation of the frame time
+    double getFrameTimeJitter() const;
+    double getSpinTime() const { return static_cast<double>(mSpinTime) / 1e9; }
+
+  private:
+    void recordFrame(uint64_t frameStartTime);
+    void updateSpinTime(double overshoot);
+
+    uint64_t mFrameInterval = 0;
+    uint64_t mNextFrameTime = 0;
+    uint64_t mSpinTime = 1000000; //  starts at 1ms and adapts
+    double mOvershootAverage = 0; //  of the sleeps, in nanoseconds
+    double mOvershootDeviation = 250000;
+
+    uint64_t mLastFrameStartTime = 0;
+    std::array<double, STATISTICS_FRAME_COUNT> mFrameTimes{};
+    uint32_t mFrameTimeCount = 0;
+    uint32_t mNextFrameTimeIdx = 0;
 };
 
-} // namespace Bunny::Base
\ No newline at end of file
+} // namespace Bunny::Base
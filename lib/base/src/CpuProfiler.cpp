@@ -0,0 +1,370 @@
+#include "CpuProfiler.h"
+
+#ifdef BUNNY_ENABLE_PROFILER
+
+#include "Error.h"
+#include "JsonHelpers.h"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <functional>
+#include <fstream>
+
+namespace Bunny::Base
+{
+static constexpr float FLAME_GRAPH_ROW_HEIGHT = 18.0f;
+
+std::unique_ptr<CpuProfiler> CpuProfiler::msInstance = nullptr;
+
+uint64_t CpuProfiler::getTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void CpuProfiler::recordZone(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+{
+    pushEvent(CpuProfileEvent{.mName = name,
+        .mStart = start,
+        .mEnd = end,
+        .mValue = 0,
+        .mDepth = depth,
+        .mType = CpuProfileEventType::Zone});
+}
+
+void CpuProfiler::recordCounter(const char* name, double value)
+{
+    uint64_t timestamp = getTimestamp();
+    pushEvent(CpuProfileEvent{.mName = name,
+        .mStart = timestamp,
+        .mEnd = timestamp,
+        .mValue = value,
+        .mDepth = 0,
+        .mType = CpuProfileEventType::Counter});
+}
+
+void CpuProfiler::setThreadName(std::string_view name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    if (buffer == nullptr)
+    {
+        return;
+    }
+
+    std::lock_guard lock(msInstance->mThreadBufferMutex);
+    buffer->mName = name;
+}
+
+void CpuProfiler::markFrame()
+{
+    if (msInstance == nullptr)
+    {
+        return;
+    }
+
+    CpuProfiler& profiler = get();
+    uint64_t timestamp = getTimestamp();
+    if (profiler.mFrameStart != 0)
+    {
+        Frame frame{.mFrameNumber = profiler.mFrameNumber, .mStart = profiler.mFrameStart, .mEnd = timestamp};
+        profiler.collectEvents(frame);
+
+        //  keep draining the buffers while paused so they do not overflow, but keep showing the same frames
+        if (!profiler.mIsPaused)
+        {
+            profiler.mFrames.push_back(std::move(frame));
+            if (profiler.mFrames.size() > MAX_CAPTURED_FRAME_COUNT)
+            {
+                profiler.mFrames.pop_front();
+            }
+        }
+    }
+
+    profiler.mFrameStart = timestamp;
+    profiler.mFrameNumber++;
+}
+
+uint32_t& CpuProfiler::getThreadZoneDepth()
+{
+    thread_local uint32_t depth = 0;
+    return depth;
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::getThreadBuffer()
+{
+    if (msInstance == nullptr)
+    {
+        return nullptr;
+    }
+
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        buffer = msInstance->registerThread();
+    }
+    return buffer;
+}
+
+void CpuProfiler::pushEvent(const CpuProfileEvent& event)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    if (buffer == nullptr)
+    {
+        return;
+    }
+
+    //  only this thread writes, so the slot can be filled before the event is published to the reader
+    uint64_t writeCount = buffer->mWriteCount.load(std::memory_order_relaxed);
+    buffer->mEvents[writeCount % ThreadBuffer::CAPACITY] = event;
+    buffer->mWriteCount.store(writeCount + 1, std::memory_order_release);
+}
+
+CpuProfiler::ThreadBuffer* CpuProfiler::registerThread()
+{
+    std::lock_guard lock(mThreadBufferMutex);
+
+    ThreadBuffer* buffer = mThreadBuffers.emplace_back(std::make_unique<ThreadBuffer>()).get();
+    buffer->mThreadIdx = static_cast<uint32_t>(mThreadBuffers.size() - 1);
+    buffer->mName = fmt::format("Thread {}", buffer->mThreadIdx);
+    return buffer;
+}
+
+void CpuProfiler::collectEvents(Frame& frame)
+{
+    std::lock_guard lock(mThreadBufferMutex);
+
+    for (const std::unique_ptr<ThreadBuffer>& buffer : mThreadBuffers)
+    {
+        uint64_t writeCount = buffer->mWriteCount.load(std::memory_order_acquire);
+        uint64_t readCount = writeCount > ThreadBuffer::CAPACITY ? writeCount - ThreadBuffer::CAPACITY : 0;
+        readCount = std::max(readCount, buffer->mReadCount);
+        mDroppedEventCount += readCount - buffer->mReadCount;
+
+        size_t firstEventIdx = frame.mEvents.size();
+        for (uint64_t eventIdx = readCount; eventIdx < writeCount; eventIdx++)
+        {
+            frame.mEvents.push_back(CapturedEvent{
+                .mEvent = buffer->mEvents[eventIdx % ThreadBuffer::CAPACITY], .mThreadIdx = buffer->mThreadIdx});
+        }
+
+        //  the producer may have started overwriting the oldest events while they were copied, drop those
+        uint64_t newWriteCount = buffer->mWriteCount.load(std::memory_order_acquire);
+        if (newWriteCount + 1 > readCount + ThreadBuffer::CAPACITY)
+        {
+            uint64_t overwrittenCount =
+                std::min(newWriteCount + 1 - ThreadBuffer::CAPACITY - readCount, writeCount - readCount);
+            frame.mEvents.erase(frame.mEvents.begin() + firstEventIdx,
+                frame.mEvents.begin() + firstEventIdx + overwrittenCount);
+            mDroppedEventCount += overwrittenCount;
+        }
+
+        buffer->mReadCount = writeCount;
+    }
+}
+
+std::vector<std::string> CpuProfiler::getThreadNames() const
+{
+    std::lock_guard lock(mThreadBufferMutex);
+
+    std::vector<std::string> names;
+    names.reserve(mThreadBuffers.size());
+    for (const std::unique_ptr<ThreadBuffer>& buffer : mThreadBuffers)
+    {
+        names.push_back(buffer->mName);
+    }
+    return names;
+}
+
+BunnyResult CpuProfiler::exportChromeTrace(std::string_view filePath) const
+{
+    std::ofstream file{std::string(filePath), std::ios::trunc};
+    if (!file.is_open())
+    {
+        std::string errMsg = fmt::format("Can not open {} to export cpu trace.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << R"({"name":"process_name","ph":"M","pid":0,"args":{"name":"Bunny Engine"}})";
+
+    std::vector<std::string> threadNames = getThreadNames();
+    for (uint32_t threadIdx = 0; threadIdx < threadNames.size(); threadIdx++)
+    {
+        file << fmt::format(
+            ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", threadIdx,
+            escapeJsonString(threadNames[threadIdx]));
+    }
+
+    uint64_t traceStart = mFrames.empty() ? 0 : mFrames.front().mStart;
+    auto toUs = [traceStart](uint64_t timestamp) {
+        return timestamp > traceStart ? static_cast<double>(timestamp - traceStart) / 1000.0 : 0.0;
+    };
+
+    for (const Frame& frame : mFrames)
+    {
+        file << fmt::format(",\n{{\"name\":\"Frame {}\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":{:.3f}}}",
+            frame.mFrameNumber, toUs(frame.mStart));
+
+        for (const CapturedEvent& captured : frame.mEvents)
+        {
+            const CpuProfileEvent& event = captured.mEvent;
+            if (event.mType == CpuProfileEventType::Zone)
+            {
+                file << fmt::format(",\n{{\"name\":\"{}\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+                                    "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                    escapeJsonString(event.mName), captured.mThreadIdx, toUs(event.mStart),
+                    static_cast<double>(event.mEnd - event.mStart) / 1000.0);
+            }
+            else
+            {
+                file << fmt::format(
+                    ",\n{{\"name\":\"{}\",\"ph\":\"C\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"args\":{{\"value\":{}}}}}",
+                    escapeJsonString(event.mName), captured.mThreadIdx, toUs(event.mStart), event.mValue);
+            }
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file.good())
+    {
+        std::string errMsg = fmt::format("Fail to export cpu trace to {}.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+    return BUNNY_HAPPY;
+}
+
+void CpuProfiler::showImguiPanel()
+{
+    if (!ImGui::Begin("CPU Profiler"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Paused", &mIsPaused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace"))
+    {
+        exportChromeTrace("./cpu_trace.json");
+    }
+    ImGui::SameLine();
+    ImGui::Text(fmt::format("Dropped events: {}", mDroppedEventCount).c_str());
+
+    if (mFrames.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(mFrames.size());
+    for (const Frame& frame : mFrames)
+    {
+        frameTimes.push_back(static_cast<float>(frame.mEnd - frame.mStart) / 1000000.0f);
+    }
+    ImGui::PlotLines("Frame (ms)", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0f,
+        FLT_MAX, ImVec2(0, 60.0f));
+
+    int lastFrameIdx = static_cast<int>(mFrames.size()) - 1;
+    if (mIsPaused)
+    {
+        ImGui::SliderInt("Frame", &mSelectedFrameIdx, 0, lastFrameIdx);
+    }
+    else
+    {
+        mSelectedFrameIdx = lastFrameIdx;
+    }
+    mSelectedFrameIdx = std::clamp(mSelectedFrameIdx, 0, lastFrameIdx);
+
+    const Frame& frame = mFrames[mSelectedFrameIdx];
+    ImGui::Text(fmt::format("Frame {}: {:.3f} ms", frame.mFrameNumber, frameTimes[mSelectedFrameIdx]).c_str());
+
+    std::vector<std::string> threadNames = getThreadNames();
+    float width = ImGui::GetContentRegionAvail().x;
+    for (uint32_t threadIdx = 0; threadIdx < threadNames.size(); threadIdx++)
+    {
+        bool hasZones = std::any_of(frame.mEvents.begin(), frame.mEvents.end(), [threadIdx](const CapturedEvent& e) {
+            return e.mThreadIdx == threadIdx && e.mEvent.mType == CpuProfileEventType::Zone;
+        });
+        if (hasZones && ImGui::CollapsingHeader(threadNames[threadIdx].c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            drawFlameGraph(frame, threadIdx, width);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Counters"))
+    {
+        for (const CapturedEvent& captured : frame.mEvents)
+        {
+            if (captured.mEvent.mType == CpuProfileEventType::Counter)
+            {
+                ImGui::Text(fmt::format("{}: {}", captured.mEvent.mName, captured.mEvent.mValue).c_str());
+            }
+        }
+    }
+
+    ImGui::End();
+}
+
+void CpuProfiler::drawFlameGraph(const Frame& frame, uint32_t threadIdx, float width)
+{
+    uint32_t maxDepth = 0;
+    for (const CapturedEvent& captured : frame.mEvents)
+    {
+        if (captured.mThreadIdx == threadIdx && captured.mEvent.mType == CpuProfileEventType::Zone)
+        {
+            maxDepth = std::max(maxDepth, captured.mEvent.mDepth);
+        }
+    }
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size(width, (maxDepth + 1) * FLAME_GRAPH_ROW_HEIGHT);
+    ImGui::Dummy(size);
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+
+    double frameDuration = static_cast<double>(std::max<uint64_t>(frame.mEnd - frame.mStart, 1));
+    auto toX = [&](uint64_t timestamp) {
+        //  zones of other threads may have started before the frame
+        double offset = timestamp > frame.mStart ? static_cast<double>(timestamp - frame.mStart) : 0.0;
+        return origin.x + static_cast<float>(std::min(offset / frameDuration, 1.0)) * width;
+    };
+
+    for (const CapturedEvent& captured : frame.mEvents)
+    {
+        const CpuProfileEvent& event = captured.mEvent;
+        if (captured.mThreadIdx != threadIdx || event.mType != CpuProfileEventType::Zone)
+        {
+            continue;
+        }
+
+        ImVec2 min(toX(event.mStart), origin.y + event.mDepth * FLAME_GRAPH_ROW_HEIGHT);
+        ImVec2 max(std::max(toX(event.mEnd), min.x + 1.0f), min.y + FLAME_GRAPH_ROW_HEIGHT - 1.0f);
+
+        //  the same zone keeps its color across frames
+        float hue = static_cast<float>(std::hash<std::string_view>{}(event.mName) % 360) / 360.0f;
+        drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.75f));
+
+        ImVec2 textSize = ImGui::CalcTextSize(event.mName);
+        if (max.x - min.x > textSize.x + 4.0f)
+        {
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32_WHITE, event.mName);
+        }
+
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s: %.3f ms", event.mName, static_cast<double>(event.mEnd - event.mStart) / 1000000.0);
+        }
+    }
+
+    drawList->PopClipRect();
+}
+} // namespace Bunny::Base
+
+#endif
@@ -0,0 +1,281 @@
+#include "DdsTexture.h"
+
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace Bunny::Base
+{
+namespace
+{
+//  https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+constexpr uint32_t DDS_MAGIC = 0x20534444; //  "DDS "
+constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844; //  "DX10"
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PITCH = 0x8;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_DEPTH = 0x800000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+constexpr uint32_t DDS_DIMENSION_TEXTURE3D = 4;
+
+struct DdsPixelFormat
+{
+    uint32_t mSize;
+    uint32_t mFlags;
+    uint32_t mFourCC;
+    uint32_t mRgbBitCount;
+    uint32_t mRBitMask;
+    uint32_t mGBitMask;
+    uint32_t mBBitMask;
+    uint32_t mABitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t mSize;
+    uint32_t mFlags;
+    uint32_t mHeight;
+    uint32_t mWidth;
+    uint32_t mPitchOrLinearSize;
+    uint32_t mDepth;
+    uint32_t mMipMapCount;
+    uint32_t mReserved1[11];
+    DdsPixelFormat mPixelFormat;
+    uint32_t mCaps;
+    uint32_t mCaps2;
+    uint32_t mCaps3;
+    uint32_t mCaps4;
+    uint32_t mReserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t mDxgiFormat;
+    uint32_t mResourceDimension;
+    uint32_t mMiscFlag;
+    uint32_t mArraySize;
+    uint32_t mMiscFlags2;
+};
+
+static_assert(sizeof(DdsPixelFormat) == 32);
+static_assert(sizeof(DdsHeader) == 124);
+static_assert(sizeof(DdsHeaderDx10) == 20);
+
+constexpr size_t DDS_DATA_OFFSET = sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+bool isSupportedFormat(uint32_t dxgiFormat)
+{
+    return dxgiFormat == static_cast<uint32_t>(DdsFormat::R8Unorm) ||
+           dxgiFormat == static_cast<uint32_t>(DdsFormat::R8G8Unorm);
+}
+} // namespace
+
+uint32_t DdsTexture::getTexelSize() const
+{
+    return mFormat == DdsFormat::R8G8Unorm ? 2 : 1;
+}
+
+uint32_t DdsTexture::getMipWidth(uint32_t mip) const
+{
+    return (std::max)(mWidth >> mip, 1u);
+}
+
+uint32_t DdsTexture::getMipHeight(uint32_t mip) const
+{
+    return (std::max)(mHeight >> mip, 1u);
+}
+
+uint32_t DdsTexture::getMipDepth(uint32_t mip) const
+{
+    return (std::max)(mDepth >> mip, 1u);
+}
+
+size_t DdsTexture::getMipSize(uint32_t mip) const
+{
+    return size_t(getMipWidth(mip)) * getMipHeight(mip) * getMipDepth(mip) * getTexelSize();
+}
+
+size_t DdsTexture::getMipOffset(uint32_t mip) const
+{
+    size_t offset = 0;
+    for (uint32_t level = 0; level < mip; level++)
+    {
+        offset += getMipSize(level);
+    }
+    return offset;
+}
+
+void DdsTexture::generateMips(uint32_t mipCount)
+{
+    mMipCount = mipCount;
+    mData.resize(getMipOffset(mMipCount));
+
+    const uint32_t texelSize = getTexelSize();
+    for (uint32_t mip = 1; mip < mMipCount; mip++)
+    {
+        const uint8_t* src = mData.data() + getMipOffset(mip - 1);
+        uint8_t* dst = mData.data() + getMipOffset(mip);
+        const uint32_t srcWidth = getMipWidth(mip - 1);
+        const uint32_t srcHeight = getMipHeight(mip - 1);
+        const uint32_t srcDepth = getMipDepth(mip - 1);
+
+        //  an axis already down to 1 texel is not filtered any more
+        const uint32_t stepX = srcWidth > 1 ? 2 : 1;
+        const uint32_t stepY = srcHeight > 1 ? 2 : 1;
+        const uint32_t stepZ = srcDepth > 1 ? 2 : 1;
+        const uint32_t sampleCount = stepX * stepY * stepZ;
+
+        for (uint32_t z = 0; z < getMipDepth(mip); z++)
+        {
+            for (uint32_t y = 0; y < getMipHeight(mip); y++)
+            {
+                for (uint32_t x = 0; x < getMipWidth(mip); x++)
+                {
+                    for (uint32_t channel = 0; channel < texelSize; channel++)
+                    {
+                        uint32_t sum = 0;
+                        for (uint32_t dz = 0; dz < stepZ; dz++)
+                        {
+                            for (uint32_t dy = 0; dy < stepY; dy++)
+                            {
+                                for (uint32_t dx = 0; dx < stepX; dx++)
+                                {
+                                    //  odd sizes wrap around, the noise textures tile
+                                    size_t sx = (x * stepX + dx) % srcWidth;
+                                    size_t sy = (y * stepY + dy) % srcHeight;
+                                    size_t sz = (z * stepZ + dz) % srcDepth;
+                                    sum += src[((sz * srcHeight + sy) * srcWidth + sx) * texelSize + channel];
+                                }
+                            }
+                        }
+                        *dst++ = static_cast<uint8_t>((sum + sampleCount / 2) / sampleCount);
+                    }
+                }
+            }
+        }
+    }
+}
+
+uint32_t getFullMipCount(uint32_t width, uint32_t height, uint32_t depth)
+{
+    uint32_t largest = (std::max)({width, height, depth});
+    uint32_t mipCount = 1;
+    while (largest > 1)
+    {
+        largest >>= 1;
+        mipCount++;
+    }
+    return mipCount;
+}
+
+bool writeDdsTexture(std::string_view path, const DdsTexture& texture)
+{
+    if (texture.mData.size() != texture.getMipOffset(texture.mMipCount))
+    {
+        return false;
+    }
+
+    const bool is3d = texture.mDepth > 1;
+
+    DdsHeader header{};
+    header.mSize = sizeof(DdsHeader);
+    header.mFlags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+    header.mHeight = texture.mHeight;
+    header.mWidth = texture.mWidth;
+    header.mPitchOrLinearSize = texture.mWidth * texture.getTexelSize();
+    header.mDepth = texture.mDepth;
+    header.mMipMapCount = texture.mMipCount;
+    header.mPixelFormat.mSize = sizeof(DdsPixelFormat);
+    header.mPixelFormat.mFlags = DDPF_FOURCC;
+    header.mPixelFormat.mFourCC = DDS_FOURCC_DX10;
+    header.mCaps = DDSCAPS_TEXTURE | (texture.mMipCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+    if (is3d)
+    {
+        header.mFlags |= DDSD_DEPTH;
+        header.mCaps |= DDSCAPS_COMPLEX;
+        header.mCaps2 = DDSCAPS2_VOLUME;
+    }
+
+    DdsHeaderDx10 headerDx10{};
+    headerDx10.mDxgiFormat = static_cast<uint32_t>(texture.mFormat);
+    headerDx10.mResourceDimension = is3d ? DDS_DIMENSION_TEXTURE3D : DDS_DIMENSION_TEXTURE2D;
+    headerDx10.mArraySize = 1;
+
+    std::ofstream file(std::string(path), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&headerDx10), sizeof(headerDx10));
+    file.write(reinterpret_cast<const char*>(texture.mData.data()), texture.mData.size());
+
+    return file.good();
+}
+
+bool readDdsTexture(std::string_view path, DdsTexture& outTexture)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    std::span<const std::byte> content = file.getContent();
+    if (content.size() < DDS_DATA_OFFSET)
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    DdsHeader header;
+    DdsHeaderDx10 headerDx10;
+    std::memcpy(&magic, content.data(), sizeof(magic));
+    std::memcpy(&header, content.data() + sizeof(magic), sizeof(header));
+    std::memcpy(&headerDx10, content.data() + sizeof(magic) + sizeof(header), sizeof(headerDx10));
+
+    if (magic != DDS_MAGIC || header.mSize != sizeof(DdsHeader) || header.mPixelFormat.mFourCC != DDS_FOURCC_DX10 ||
+        !isSupportedFormat(headerDx10.mDxgiFormat) || headerDx10.mArraySize > 1)
+    {
+        return false;
+    }
+
+    DdsTexture texture;
+    texture.mFormat = static_cast<DdsFormat>(headerDx10.mDxgiFormat);
+    texture.mWidth = header.mWidth;
+    texture.mHeight = header.mHeight;
+    texture.mDepth = headerDx10.mResourceDimension == DDS_DIMENSION_TEXTURE3D ? (std::max)(header.mDepth, 1u) : 1;
+    texture.mMipCount = (header.mFlags & DDSD_MIPMAPCOUNT) != 0 ? (std::max)(header.mMipMapCount, 1u) : 1;
+    if (texture.mWidth == 0 || texture.mHeight == 0 ||
+        texture.mMipCount > getFullMipCount(texture.mWidth, texture.mHeight, texture.mDepth))
+    {
+        return false;
+    }
+
+    size_t dataSize = texture.getMipOffset(texture.mMipCount);
+    if (content.size() - DDS_DATA_OFFSET < dataSize)
+    {
+        return false;
+    }
+
+    const auto* data = reinterpret_cast<const uint8_t*>(content.data() + DDS_DATA_OFFSET);
+    texture.mData.assign(data, data + dataSize);
+    outTexture = std::move(texture);
+    return true;
+}
+} // namespace Bunny::Base
@@ -1 +1,171 @@
-#include "Timer.h"
\ No newline at end of file
+#include "Timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+namespace Bunny::Base
+{
+//  never spin shorter than this, and never longer than half a frame
+static constexpr uint64_t MIN_SPIN_TIME = 200000;
+//  weights of a new sleep overshoot in its running average and deviation
+static constexpr double OVERSHOOT_AVERAGE_WEIGHT = 1.0 / 8.0;
+static constexpr double OVERSHOOT_DEVIATION_WEIGHT = 1.0 / 4.0;
+
+uint64_t Clock::now()
+{
+#ifdef __linux__
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ull + static_cast<uint64_t>(time.tv_nsec);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+void Clock::sleepFor(uint64_t nanoseconds)
+{
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+}
+
+FixedTimestep::FixedTimestep(double stepTime, uint32_t maxStepCount)
+    : mStepTime(stepTime),
+      mMaxStepCount(maxStepCount)
+{
+    assert(stepTime > 0);
+}
+
+uint32_t FixedTimestep::advance(double deltaTime)
+{
+    mAccumulatedTime += deltaTime;
+
+    uint32_t stepCount = static_cast<uint32_t>(mAccumulatedTime / mStepTime);
+    if (stepCount > mMaxStepCount)
+    {
+        //  drop the time that can not be caught up with instead of falling further behind every frame
+        stepCount = mMaxStepCount;
+        mAccumulatedTime = std::fmod(mAccumulatedTime, mStepTime);
+    }
+    else
+    {
+        mAccumulatedTime -= stepCount * mStepTime;
+    }
+
+    return stepCount;
+}
+
+void FramePacer::setTargetFrameRate(double frameRate)
+{
+    mFrameInterval = frameRate > 0 ? static_cast<uint64_t>(1e9 / frameRate) : 0;
+    mNextFrameTime = 0;
+}
+
+double FramePacer::getTargetFrameRate() const
+{
+    return mFrameInterval > 0 ? 1e9 / static_cast<double>(mFrameInterval) : 0;
+}
+
+void FramePacer::waitForNextFrame()
+{
+    uint64_t currentTime = Clock::now();
+    if (mFrameInterval == 0)
+    {
+        recordFrame(currentTime);
+        return;
+    }
+
+    if (mNextFrameTime == 0)
+    {
+        mNextFrameTime = currentTime;
+    }
+    else if (currentTime > mNextFrameTime + mFrameInterval)
+    {
+        //  more than a whole frame late: skip the missed frames instead of rushing them,
+        //  but by whole intervals, so the frames after it stay on the same cadence
+        mNextFrameTime += (currentTime - mNextFrameTime) / mFrameInterval * mFrameInterval;
+    }
+
+    while (currentTime < mNextFrameTime)
+    {
+        uint64_t remainingTime = mNextFrameTime - currentTime;
+        if (remainingTime > mSpinTime)
+        {
+            uint64_t sleepTime = remainingTime - mSpinTime;
+            Clock::sleepFor(sleepTime);
+
+            uint64_t wakeUpTime = Clock::now();
+            uint64_t overshoot = wakeUpTime - currentTime > sleepTime ? wakeUpTime - currentTime - sleepTime : 0;
+            updateSpinTime(static_cast<double>(overshoot));
+            currentTime = wakeUpTime;
+        }
+        else
+        {
+            //  no yield here, the thread may not be scheduled again before the deadline
+            currentTime = Clock::now();
+        }
+    }
+
+    recordFrame(currentTime);
+    mNextFrameTime += mFrameInterval;
+}
+
+void FramePacer::updateSpinTime(double overshoot)
+{
+    //  spin for the usual overshoot plus a few deviations, like a round trip time estimate
+    //  a single long overshoot, e.g. the thread being preempted, only raises the spin time for a few frames,
+    //  spinning for most of the frame after it would get the thread preempted again right before the deadline
+    const double difference = overshoot - mOvershootAverage;
+    mOvershootAverage += difference * OVERSHOOT_AVERAGE_WEIGHT;
+    mOvershootDeviation += (std::abs(difference) - mOvershootDeviation) * OVERSHOOT_DEVIATION_WEIGHT;
+    uint64_t spinTime = static_cast<uint64_t>(mOvershootAverage + 4.0 * mOvershootDeviation);
+    mSpinTime = std::clamp(spinTime, MIN_SPIN_TIME, std::max(mFrameInterval / 2, MIN_SPIN_TIME));
+}
+
+double FramePacer::getAverageFrameTime() const
+{
+    if (mFrameTimeCount == 0)
+    {
+        return 0;
+    }
+
+    double sum = 0;
+    for (uint32_t idx = 0; idx < mFrameTimeCount; idx++)
+    {
+        sum += mFrameTimes[idx];
+    }
+    return sum / mFrameTimeCount;
+}
+
+double FramePacer::getFrameTimeJitter() const
+{
+    if (mFrameTimeCount < 2)
+    {
+        return 0;
+    }
+
+    double average = getAverageFrameTime();
+    double variance = 0;
+    for (uint32_t idx = 0; idx < mFrameTimeCount; idx++)
+    {
+        variance += (mFrameTimes[idx] - average) * (mFrameTimes[idx] - average);
+    }
+    return std::sqrt(variance / (mFrameTimeCount - 1));
+}
+
+void FramePacer::recordFrame(uint64_t frameStartTime)
+{
+    if (mLastFrameStartTime != 0)
+    {
+        mFrameTimes[mNextFrameTimeIdx] = static_cast<double>(frameStartTime - mLastFrameStartTime) / 1e9;
+        mNextFrameTimeIdx = (mNextFrameTimeIdx + 1) % STATISTICS_FRAME_COUNT;
+        mFrameTimeCount = std::min(mFrameTimeCount + 1, STATISTICS_FRAME_COUNT);
+    }
+    mLastFrameStartTime = frameStartTime;
+}
+
+} // namespace Bunny::Base
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace Bunny::Physics
+{
+//  phillips spectrum of the fft ocean, the gpu ocean is built from the same parameters
+struct OceanSpectrumParams
+{
+    glm::vec2 mWind{5.0f, 3.0f};
+    float mAreaWidth = 102.4f;  //  the horizontal dimension of the whole wave grid area, in meters
+    int mGridN = 256;           //  size of the spectrum (in one dimension), a power of 2
+    float mAmplitude = 0.02f;   //  Phillips spectrum magnitude coefficient
+    uint32_t mSeed = 20240229;  //  seed of the random values of the initial spectrum
+    //  band of wavenumbers |k| kept in the spectrum, so cascades of different widths do not add the same waves twice
+    float mMinWavenumber = 0.0f;
+    float mMaxWavenumber = std::numeric_limits<float>::max();
+};
+
+//  4 standard normal random values per grid point, the gpu and the cpu ocean draw the initial spectrum from these
+std::vector<glm::vec4> generateOceanRandomValues(const OceanSpectrumParams& params);
+
+//  cpu copy of the fft ocean for gameplay and physics queries, the same math as the wave compute shaders
+//  every cascade tiles every mAreaWidth meters starting from the world origin, like the wave textures of the ocean
+//  the cascades are always summed in full, the ocean pass fades the small ones out in the distance
+class OceanSimulation
+{
+  public:
+    explicit OceanSimulation(const OceanSpectrumParams& params);
+    //  all cascades must have the same grid size
+    explicit OceanSimulation(std::span<const OceanSpectrumParams> cascades);
+
+    //  evaluate the spectrum at the time and transform it into the displacement grid
+    //  use the same time as the gpu ocean to get the same waves
+    void update(float time);
+    //  scale of the horizontal displacement, same as the displacement factor of the gpu ocean
+    void setDisplacementScale(float scale) { mDisplacementScale = scale; }
+
+    //  displacement of the points of the undisplaced water plane at the positions (x, z), bilinear filtered
+    void sampleDisplacement(std::span<const glm::vec2> positions, std::span<glm::vec3> outDisplacements) const;
+    //  water height at the positions (x, z), the horizontal displacement is undone by a few fixed point iterations
+    void sampleHeight(std::span<const glm::vec2> positions, std::span<float> outHeights) const;
+
+    uint32_t getCascadeCount() const { return static_cast<uint32_t>(mCascades.size()); }
+    const OceanSpectrumParams& getSpectrumParams(uint32_t cascade = 0) const { return mCascades[cascade].mParams; }
+    int getGridN() const { return mGridN; }
+    //  result of the last update, row after row like the layer of the cascade in the wave displacement image
+    //  x: displacement x, y: height, z: displacement z, before the displacement scale
+    std::span<const glm::vec3> getDisplacementGrid(uint32_t cascade = 0) const
+    {
+        return mCascades[cascade].mDisplacements;
+    }
+
+    //  the same as the grid point (x, y) of getDisplacementGrid() after update(time), but summed directly over the
+    //  whole spectrum in double precision instead of with the fft, O(N^2) per point, only for checking the fft
+    glm::vec3 computeReferenceDisplacement(uint32_t cascade, int x, int y, float time) const;
+
+  private:
+    //  real and imaginary parts in separate arrays so the butterflies on whole rows vectorize
+    struct ComplexGrid
+    {
+        std::vector<float> mReal;
+        std::vector<float> mImaginary;
+    };
+
+    struct Cascade
+    {
+        OceanSpectrumParams mParams;
+        //  h0(k) and h0(-k) for every grid point, in the layout of the spectrum image of the gpu ocean
+        std::vector<glm::vec4> mInitialSpectrum;
+        //  x: displacement x, y: height, z: displacement z, before the displacement scale
+        std::vector<glm::vec3> mDisplacements;
+    };
+
+    //  the height spectrum and the displacement spectra of x plus i times z at one point of the grid at the time
+    struct TimedSpectrum
+    {
+        float mHeightReal;
+        float mHeightImaginary;
+        float mHorizontalReal;
+        float mHorizontalImaginary;
+    };
+
+    void createInitialSpectrum(Cascade& cascade);
+    TimedSpectrum evaluateSpectrum(const Cascade& cascade, int x, int y, float time) const;
+    void createTwiddles();
+    void updateCascade(Cascade& cascade, float time);
+    //  unnormalized inverse fft of every column, a butterfly works on a whole row at once
+    void inverseTransformColumns(ComplexGrid& grid);
+    void inverseTransform(ComplexGrid& grid);
+    void transpose(ComplexGrid& grid);
+    //  sum of the cascades
+    glm::vec3 sampleGrid(const glm::vec2& position) const;
+
+    std::vector<Cascade> mCascades;
+    int mGridN = 0;
+    uint32_t mLog2N = 0;
+    float mDisplacementScale = 1.0f;
+
+    //  e^(2 pi i t / N) for t in 0 ~ N/2-1
+    std::vector<float> mTwiddleReal;
+    std::vector<float> mTwiddleImaginary;
+
+    //  shared by the cascades, which are transformed one after another
+    ComplexGrid mHeightGrid;
+    ComplexGrid mHorizontalGrid; //  real: displacement x, imaginary: displacement z
+    ComplexGrid mScratchGrid;
+
+    static constexpr uint32_t HEIGHT_ITERATION_COUNT = 3;
+};
+} // namespace Bunny::Physics
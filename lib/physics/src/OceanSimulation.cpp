@@ -0,0 +1,376 @@
+#include "OceanSimulation.h"
+
+#include <glm/geometric.hpp>
+
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <utility>
+
+namespace Bunny::Physics
+{
+namespace
+{
+//  same constants as the wave shaders
+constexpr float PI = 3.14159265359f;
+constexpr float GRAVITY = 9.8f;
+
+float dispersion(float k)
+{
+    return std::sqrt(GRAVITY * k);
+}
+} // namespace
+
+std::vector<glm::vec4> generateOceanRandomValues(const OceanSpectrumParams& params)
+{
+    size_t size = static_cast<size_t>(params.mGridN) * params.mGridN;
+    std::vector<glm::vec4> values;
+    values.reserve(size);
+
+    std::mt19937 gen(params.mSeed);
+    std::normal_distribution<float> stdNormal(0, 1);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        //  draw one by one, the evaluation order of constructor arguments is unspecified
+        float x = stdNormal(gen);
+        float y = stdNormal(gen);
+        float z = stdNormal(gen);
+        float w = stdNormal(gen);
+        values.emplace_back(x, y, z, w);
+    }
+
+    return values;
+}
+
+OceanSimulation::OceanSimulation(const OceanSpectrumParams& params)
+    : OceanSimulation(std::span<const OceanSpectrumParams>(&params, 1))
+{
+}
+
+OceanSimulation::OceanSimulation(std::span<const OceanSpectrumParams> cascades)
+{
+    assert(!cascades.empty());
+    mGridN = cascades[0].mGridN;
+    assert(std::has_single_bit(static_cast<uint32_t>(mGridN)));
+    mLog2N = std::countr_zero(static_cast<uint32_t>(mGridN));
+
+    size_t size = static_cast<size_t>(mGridN) * mGridN;
+    for (ComplexGrid* grid : {&mHeightGrid, &mHorizontalGrid, &mScratchGrid})
+    {
+        grid->mReal.resize(size);
+        grid->mImaginary.resize(size);
+    }
+
+    mCascades.resize(cascades.size());
+    for (size_t idx = 0; idx < cascades.size(); idx++)
+    {
+        assert(cascades[idx].mGridN == mGridN);
+        Cascade& cascade = mCascades[idx];
+        cascade.mParams = cascades[idx];
+        cascade.mDisplacements.resize(size, glm::vec3(0));
+        createInitialSpectrum(cascade);
+    }
+
+    createTwiddles();
+}
+
+void OceanSimulation::update(float time)
+{
+    for (Cascade& cascade : mCascades)
+    {
+        updateCascade(cascade, time);
+    }
+}
+
+void OceanSimulation::updateCascade(Cascade& cascade, float time)
+{
+    const int N = mGridN;
+    const int halfN = N / 2;
+
+    for (int y = 0; y < N; y++)
+    {
+        for (int x = 0; x < N; x++)
+        {
+            TimedSpectrum spectrum = evaluateSpectrum(cascade, x, y, time);
+
+            //  shift from -N/2 ~ N/2-1 to 0 ~ N-1
+            size_t shiftedIdx = static_cast<size_t>((y + halfN) % N) * N + (x + halfN) % N;
+            mHeightGrid.mReal[shiftedIdx] = spectrum.mHeightReal;
+            mHeightGrid.mImaginary[shiftedIdx] = spectrum.mHeightImaginary;
+            mHorizontalGrid.mReal[shiftedIdx] = spectrum.mHorizontalReal;
+            mHorizontalGrid.mImaginary[shiftedIdx] = spectrum.mHorizontalImaginary;
+        }
+    }
+
+    inverseTransform(mHeightGrid);
+    inverseTransform(mHorizontalGrid);
+
+    for (size_t idx = 0; idx < cascade.mDisplacements.size(); idx++)
+    {
+        cascade.mDisplacements[idx] = glm::vec3(mHorizontalGrid.mReal[idx], mHeightGrid.mReal[idx],
+            mHorizontalGrid.mImaginary[idx]);
+    }
+}
+
+OceanSimulation::TimedSpectrum OceanSimulation::evaluateSpectrum(
+    const Cascade& cascade, int x, int y, float time) const
+{
+    //  same as waveTimeSpectrum.comp
+    const int N = mGridN;
+    const int halfN = N / 2;
+    glm::vec2 kIdx(x - halfN, y - halfN);
+    glm::vec2 kvec = 2 * PI * kIdx / cascade.mParams.mAreaWidth;
+    float k = glm::length(kvec);
+    float omega = dispersion(k);
+
+    const glm::vec4& h0 = cascade.mInitialSpectrum[y * N + x];
+    float cosOmegaT = std::cos(omega * time);
+    float sinOmegaT = std::sin(omega * time);
+    //  h0(k) * e^(-i omega t) / 2 + h0(-k) * e^(i omega t) / 2
+    float hReal = 0.5f * (h0.x * cosOmegaT + h0.y * sinOmegaT + h0.z * cosOmegaT - h0.w * sinOmegaT);
+    float hImaginary = 0.5f * (h0.y * cosOmegaT - h0.x * sinOmegaT + h0.w * cosOmegaT + h0.z * sinOmegaT);
+
+    //  the displacement spectrum of x plus i times the one of z, -i * k / |k| * h each
+    float dkx = (x == 0 || kIdx.x == 0) ? 0 : -kvec.x / k;
+    float dkz = (y == 0 || kIdx.y == 0) ? 0 : -kvec.y / k;
+
+    return TimedSpectrum{.mHeightReal = hReal,
+        .mHeightImaginary = hImaginary,
+        .mHorizontalReal = -dkx * hImaginary - dkz * hReal,
+        .mHorizontalImaginary = dkx * hReal - dkz * hImaginary};
+}
+
+glm::vec3 OceanSimulation::computeReferenceDisplacement(uint32_t cascade, int x, int y, float time) const
+{
+    //  the inverse dft the fft computes, sum of spectrum(k) * e^(2 pi i (kx * x + ky * y) / N)
+    //  with k shifted to 0 ~ N-1 like the fft input
+    const int N = mGridN;
+    const int halfN = N / 2;
+    double heightReal = 0;
+    double horizontalReal = 0;
+    double horizontalImaginary = 0;
+    for (int ky = 0; ky < N; ky++)
+    {
+        for (int kx = 0; kx < N; kx++)
+        {
+            TimedSpectrum spectrum = evaluateSpectrum(mCascades[cascade], kx, ky, time);
+            const int shiftedX = (kx + halfN) % N;
+            const int shiftedY = (ky + halfN) % N;
+            //  reduce the product modulo N first, so the angle stays small and exact
+            const int phase = (shiftedX * x + shiftedY * y) % N;
+            const double angle = 2.0 * 3.14159265358979323846 * phase / N;
+            const double cosAngle = std::cos(angle);
+            const double sinAngle = std::sin(angle);
+            heightReal += spectrum.mHeightReal * cosAngle - spectrum.mHeightImaginary * sinAngle;
+            horizontalReal += spectrum.mHorizontalReal * cosAngle - spectrum.mHorizontalImaginary * sinAngle;
+            horizontalImaginary += spectrum.mHorizontalReal * sinAngle + spectrum.mHorizontalImaginary * cosAngle;
+        }
+    }
+
+    return glm::vec3(horizontalReal, heightReal, horizontalImaginary);
+}
+
+void OceanSimulation::sampleDisplacement(
+    std::span<const glm::vec2> positions, std::span<glm::vec3> outDisplacements) const
+{
+    assert(outDisplacements.size() >= positions.size());
+
+    for (size_t idx = 0; idx < positions.size(); idx++)
+    {
+        glm::vec3 displacement = sampleGrid(positions[idx]);
+        //  same as waveConstruct.comp
+        outDisplacements[idx] = glm::vec3(
+            -mDisplacementScale * displacement.x, displacement.y, -mDisplacementScale * displacement.z);
+    }
+}
+
+void OceanSimulation::sampleHeight(std::span<const glm::vec2> positions, std::span<float> outHeights) const
+{
+    assert(outHeights.size() >= positions.size());
+
+    for (size_t idx = 0; idx < positions.size(); idx++)
+    {
+        //  find the point of the undisplaced plane that is moved onto the position
+        //  the horizontal displacement is small and smooth compared to the waves, so this converges quickly
+        const glm::vec2& position = positions[idx];
+        glm::vec2 planePosition = position;
+        glm::vec3 displacement{};
+        for (uint32_t iteration = 0; iteration < HEIGHT_ITERATION_COUNT; iteration++)
+        {
+            displacement = sampleGrid(planePosition);
+            planePosition = position + mDisplacementScale * glm::vec2(displacement.x, displacement.z);
+        }
+
+        outHeights[idx] = sampleGrid(planePosition).y;
+    }
+}
+
+void OceanSimulation::createInitialSpectrum(Cascade& cascade)
+{
+    //  same as waveSpectrum.comp
+    const OceanSpectrumParams& params = cascade.mParams;
+    const int N = params.mGridN;
+    const int halfN = N / 2;
+    std::vector<glm::vec4> randomValues = generateOceanRandomValues(params);
+
+    float dk = 2 * PI / params.mAreaWidth;
+    float windSpeed = glm::length(params.mWind);
+    float L = windSpeed * windSpeed / GRAVITY;
+    float l = L / 1000; //  small wave threshold
+    float hc = 1 / std::sqrt(2.0f);
+
+    cascade.mInitialSpectrum.resize(static_cast<size_t>(N) * N);
+    for (int y = 0; y < N; y++)
+    {
+        for (int x = 0; x < N; x++)
+        {
+            glm::vec4& h0 = cascade.mInitialSpectrum[y * N + x];
+            if (x == halfN && y == halfN)
+            {
+                h0 = glm::vec4(0);
+                continue;
+            }
+
+            glm::vec2 kvec = 2 * PI * glm::vec2(x - halfN, y - halfN) / params.mAreaWidth;
+            float k = glm::length(kvec);
+            if (k < params.mMinWavenumber || k >= params.mMaxWavenumber)
+            {
+                h0 = glm::vec4(0);
+                continue;
+            }
+
+            float kdotw = glm::dot(kvec / k, params.mWind / windSpeed);
+            float windFactor = kdotw * kdotw;
+            float k2 = k * k;
+
+            //  Phillips spectrum
+            float Ph = params.mAmplitude * std::exp(-1 / (k2 * L * L) - (k2 * l * l)) / (k2 * k2) * windFactor;
+            float amplitude = hc * std::sqrt(2 * Ph * dk * dk);
+
+            //  the gpu reads the random values of -k at N - pos, which is outside of the image and zero for 0
+            const glm::vec4& random = randomValues[y * N + x];
+            glm::vec4 randomMinus{0};
+            if (x != 0 && y != 0)
+            {
+                randomMinus = randomValues[(N - y) * N + (N - x)];
+            }
+
+            h0 = glm::vec4(random.x, random.y, randomMinus.x, randomMinus.y) * amplitude;
+        }
+    }
+}
+
+void OceanSimulation::createTwiddles()
+{
+    const uint32_t halfN = mGridN / 2;
+    mTwiddleReal.resize(halfN);
+    mTwiddleImaginary.resize(halfN);
+    for (uint32_t t = 0; t < halfN; t++)
+    {
+        double angle = 2.0 * 3.14159265358979323846 * t / mGridN;
+        mTwiddleReal[t] = static_cast<float>(std::cos(angle));
+        mTwiddleImaginary[t] = static_cast<float>(std::sin(angle));
+    }
+}
+
+void OceanSimulation::inverseTransformColumns(ComplexGrid& grid)
+{
+    //  radix 2 stockham autosort fft on the rows as a whole, same ordering as fftStockham.comp
+    const size_t N = mGridN;
+    const size_t halfN = N / 2;
+
+    ComplexGrid* src = &grid;
+    ComplexGrid* dst = &mScratchGrid;
+    size_t subSize = 1;
+    for (uint32_t stage = 0; stage < mLog2N; stage++)
+    {
+        const size_t twiddleStride = N / (subSize * 2);
+        for (size_t j = 0; j < halfN; j++)
+        {
+            const size_t k = j % subSize;
+            const float wReal = mTwiddleReal[k * twiddleStride];
+            const float wImaginary = mTwiddleImaginary[k * twiddleStride];
+
+            const float* aReal = &src->mReal[j * N];
+            const float* aImaginary = &src->mImaginary[j * N];
+            const float* bReal = &src->mReal[(j + halfN) * N];
+            const float* bImaginary = &src->mImaginary[(j + halfN) * N];
+
+            const size_t dstRow = (j / subSize) * subSize * 2 + k;
+            float* outReal0 = &dst->mReal[dstRow * N];
+            float* outImaginary0 = &dst->mImaginary[dstRow * N];
+            float* outReal1 = &dst->mReal[(dstRow + subSize) * N];
+            float* outImaginary1 = &dst->mImaginary[(dstRow + subSize) * N];
+
+            for (size_t col = 0; col < N; col++)
+            {
+                float wbReal = bReal[col] * wReal - bImaginary[col] * wImaginary;
+                float wbImaginary = bReal[col] * wImaginary + bImaginary[col] * wReal;
+                outReal0[col] = aReal[col] + wbReal;
+                outImaginary0[col] = aImaginary[col] + wbImaginary;
+                outReal1[col] = aReal[col] - wbReal;
+                outImaginary1[col] = aImaginary[col] - wbImaginary;
+            }
+        }
+
+        std::swap(src, dst);
+        subSize *= 2;
+    }
+
+    //  the result is in the scratch grid after an odd number of stages
+    if (src != &grid)
+    {
+        std::swap(grid, mScratchGrid);
+    }
+}
+
+void OceanSimulation::inverseTransform(ComplexGrid& grid)
+{
+    inverseTransformColumns(grid);
+    transpose(grid);
+    inverseTransformColumns(grid);
+    transpose(grid);
+}
+
+void OceanSimulation::transpose(ComplexGrid& grid)
+{
+    const size_t N = mGridN;
+    for (size_t y = 0; y < N; y++)
+    {
+        for (size_t x = y + 1; x < N; x++)
+        {
+            std::swap(grid.mReal[y * N + x], grid.mReal[x * N + y]);
+            std::swap(grid.mImaginary[y * N + x], grid.mImaginary[x * N + y]);
+        }
+    }
+}
+
+glm::vec3 OceanSimulation::sampleGrid(const glm::vec2& position) const
+{
+    //  the same lookup as the linear repeat sampler of the wave displacement texture
+    const int N = mGridN;
+    glm::vec3 displacement{0};
+    for (const Cascade& cascade : mCascades)
+    {
+        glm::vec2 texelPos = position / cascade.mParams.mAreaWidth * static_cast<float>(N) - 0.5f;
+        glm::vec2 texelFloor = glm::floor(texelPos);
+        glm::vec2 weight = texelPos - texelFloor;
+
+        //  wrap with a mask, N is a power of 2
+        int x0 = static_cast<int>(texelFloor.x) & (N - 1);
+        int y0 = static_cast<int>(texelFloor.y) & (N - 1);
+        int x1 = (x0 + 1) & (N - 1);
+        int y1 = (y0 + 1) & (N - 1);
+
+        const std::vector<glm::vec3>& grid = cascade.mDisplacements;
+        glm::vec3 top = glm::mix(grid[y0 * N + x0], grid[y0 * N + x1], weight.x);
+        glm::vec3 bottom = glm::mix(grid[y1 * N + x0], grid[y1 * N + x1], weight.x);
+        displacement += glm::mix(top, bottom, weight.y);
+    }
+
+    return displacement;
+}
+
+} // namespace Bunny::Physics
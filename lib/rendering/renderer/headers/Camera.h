@@ -42,15 +42,19 @@ class Camera
     void setDeltaRotation(const glm::vec3& deltaPitchYawRoll);
 
     void setAspectRatio(float ratio);
+    //  sub-pixel offset of the projection in normalized device coordinates, for temporal upscaling
+    void setJitter(const glm::vec2& ndcJitter);
 
     //  record the current view and projection matrix as previous view proj matrix
-    //  so that the next frame can use it
+    //  so that the next frame can use it, without the jitter
     void recordPrevViewProjMatrix();
 
     glm::mat4 getViewMatrix() const { return mViewMatrix; }
     glm::mat4 getProjMatrix() const { return mProjMatrix; }
     glm::mat4 getPrevViewProjMatrix() const { return mPrevViewProjMatrix; }
     [[nodiscard]] glm::mat4 getViewProjMatrix() const { return mProjMatrix * mViewMatrix; }
+    [[nodiscard]] glm::mat4 getUnjitteredViewProjMatrix() const { return mUnjitteredProjMatrix * mViewMatrix; }
+    glm::vec2 getJitter() const { return mJitter; }
     [[nodiscard]] glm::mat4 getInverseViewMatrix() const { return glm::inverse(mViewMatrix); }
     [[nodiscard]] glm::mat4 getInverseProjMatrix() const { return glm::inverse(mProjMatrix); }
     glm::vec3 getPosition() const { return mPosition; }
@@ -73,6 +77,7 @@ class Camera
 
     glm::mat4 mViewMatrix;
     glm::mat4 mProjMatrix;
+    glm::mat4 mUnjitteredProjMatrix;
     glm::mat4 mPrevViewProjMatrix;
     glm::vec3 mPosition;
     glm::vec3 mPitchYawRoll;
@@ -81,6 +86,7 @@ class Camera
     glm::vec3 mRightVec = StaticRight;
     float mFov;
     float mAspectRatio; //  width/height
+    glm::vec2 mJitter{0, 0};
 };
 
 class PhysicalCamera : public Camera
@@ -8,7 +8,8 @@ namespace Bunny::Render
 enum class LightType : uint32_t
 {
     Directional = 0,
-    Point = 1
+    Point = 1,
+    Spot = 2
 };
 
 struct DirectionalLight
@@ -25,9 +26,11 @@ struct PbrLight
     float mIntensity; //  dir light - illuminance (lux or lumen/m2); point/spot light - luminous power (lumen)
     glm::vec3 mColor;
     float mInfluenceRadius;
-    float mInnerAngle;
-    float mOuterAngle;
+    float mInnerAngle; //  spot light - half angle of the full intensity cone, radians
+    float mOuterAngle; //  spot light - half angle where the intensity falls to 0, radians
     LightType mType = LightType::Directional;
     float mPadding;
+    glm::vec3 mSpotDirection{0, -1, 0};
+    float mPadding2;
 };
 } // namespace Bunny::Render
@@ -45,9 +45,15 @@ void Camera::setAspectRatio(float ratio)
     updateMatrices();
 }
 
+void Camera::setJitter(const glm::vec2& ndcJitter)
+{
+    mJitter = ndcJitter;
+    updateMatrices();
+}
+
 void Camera::recordPrevViewProjMatrix()
 {
-    mPrevViewProjMatrix = getViewProjMatrix();
+    mPrevViewProjMatrix = getUnjitteredViewProjMatrix();
 }
 
 void Camera::getViewFrustum(ViewFrustum& outFrustum) const
@@ -109,6 +115,11 @@ void Camera::updateMatrices()
     //  https://matthewwellings.com/blog/the-new-vulkan-coordinate-system/
     mProjMatrix[1][1] *= -1;
 
+    //  offset the clip space x and y by the jitter times w, so it moves the whole image by the jitter after division
+    mUnjitteredProjMatrix = mProjMatrix;
+    mProjMatrix[2][0] -= mJitter.x;
+    mProjMatrix[2][1] -= mJitter.y;
+
     mForwardVec = rm * StaticForward;
     mUpVec = rm * StaticUp;
     mRightVec = rm * StaticRight;
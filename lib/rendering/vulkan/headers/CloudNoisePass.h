@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Descriptor.h"
+#include "Fundamentals.h"
+#include "PbrGraphicsPass.h"
+
+#include <array>
+#include <string_view>
+
+namespace Bunny::Render
+{
+
+class VulkanRenderResources;
+class VulkanGraphicsRenderer;
+
+//  generates the cloud noise volumes and the weather map on the gpu instead of loading the baked textures
+//  generateNoise() fills every image once at startup, draw() regenerates a band of rows of the weather map
+//  so the weather evolves over the frames
+//  every frame in flight has its own weather map, draw() copies the one of the last frame before writing the band,
+//  so a frame never writes the map an earlier frame is still sampling
+//  the resolutions, frequencies and seeds are the ones of noise-generator, but the noise is a tiling
+//  perlin-worley / worley basis in the shaders instead of the FastNoise node trees
+class CloudNoisePass : public PbrGraphicsPass
+{
+  public:
+    struct NoiseSettings
+    {
+        uint32_t mResolution;
+        float mFrequency; //  the frequency per texel of noise-generator
+        uint32_t mSeed;
+        uint32_t mOctaveCount;
+    };
+
+    static constexpr NoiseSettings MAIN_NOISE_SETTINGS{
+        .mResolution = 128, .mFrequency = 0.025f, .mSeed = 114514, .mOctaveCount = 4};
+    static constexpr NoiseSettings DETAIL_NOISE_SETTINGS{
+        .mResolution = 32, .mFrequency = 0.05f, .mSeed = 394056, .mOctaveCount = 3};
+    static constexpr NoiseSettings WEATHER_SETTINGS{
+        .mResolution = 256, .mFrequency = 0.002f, .mSeed = 8451, .mOctaveCount = 4};
+
+    CloudNoisePass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
+        std::string_view shapeShaderPath = "cloud_shape_noise_comp.spv",
+        std::string_view detailShaderPath = "cloud_detail_noise_comp.spv",
+        std::string_view weatherShaderPath = "cloud_weather_comp.spv");
+
+    //  fill the noise volumes with their mips and the whole weather maps, blocks until the gpu is done
+    //  call after the pipelines are compiled
+    BunnyResult generateNoise();
+    //  copy the weather map of the last frame into the one of this frame and regenerate its next band of rows
+    void draw() const override;
+    void updateWeather(float elapsedTime);
+
+    //  in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    const AllocatedImage& getMainNoiseImage() const { return mMainNoiseImage; }
+    const AllocatedImage& getDetailNoiseImage() const { return mDetailNoiseImage; }
+    //  in VK_IMAGE_LAYOUT_GENERAL, they are written while the engine runs
+    const AllocatedImage& getWeatherImage(uint32_t frameIdx) const { return mWeatherImages[frameIdx]; }
+    const AllocatedImage& getCurrentWeatherImage() const;
+    //  the weather map of the last frame, copied into the current one by draw()
+    const AllocatedImage& getPreviousWeatherImage() const;
+
+  protected:
+    BunnyResult initPipeline() override;
+    BunnyResult initDescriptors() override;
+    BunnyResult initDataAndResources() override;
+
+  private:
+    using super = PbrGraphicsPass;
+
+    //  push constants, keep in sync with cloudNoise.glsl
+    struct NoiseParams
+    {
+        uint32_t mResolution;
+        uint32_t mPeriod; //  cells of the lowest octave across the tile
+        uint32_t mSeed;
+        uint32_t mOctaveCount;
+        uint32_t mRowOffset;
+        float mEvolveTime;
+    };
+
+    BunnyResult initDescriptorLayout();
+    static NoiseParams makeNoiseParams(const NoiseSettings& settings);
+    //  first mip from the shader, the others blitted down from it
+    void recordVolume(VkCommandBuffer cmd, VkPipeline pipeline, VkDescriptorSet descSet, const NoiseSettings& settings,
+        const AllocatedImage& image) const;
+
+    std::string_view mShapeShaderPath;
+    std::string_view mDetailShaderPath;
+    std::string_view mWeatherShaderPath;
+
+    VkPipeline mDetailPipeline = nullptr;
+    VkPipeline mWeatherPipeline = nullptr;
+
+    AllocatedImage mMainNoiseImage;
+    AllocatedImage mDetailNoiseImage;
+    std::array<AllocatedImage, MAX_FRAMES_IN_FLIGHT> mWeatherImages;
+    //  storage views of the first mips of the volumes
+    VkImageView mMainNoiseMip0View = nullptr;
+    VkImageView mDetailNoiseMip0View = nullptr;
+
+    VkDescriptorSetLayout mDescSetLayout = nullptr;
+    DescriptorAllocator mDescriptorAllocator;
+    VkDescriptorSet mMainNoiseDescSet = nullptr;
+    VkDescriptorSet mDetailNoiseDescSet = nullptr;
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> mWeatherDescSets{};
+
+    NoiseParams mWeatherParams{};
+    uint32_t mWeatherFrameCount = 0;
+
+    //  the whole map is regenerated every 256 / 16 frames
+    static constexpr uint32_t WEATHER_ROWS_PER_FRAME = 16;
+    //  in tiles of the lowest octave per second, slow enough that the bands do not show
+    static constexpr float WEATHER_EVOLVE_SPEED = 0.005f;
+};
+
+} // namespace Bunny::Render
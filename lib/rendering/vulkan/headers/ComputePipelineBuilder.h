@@ -9,10 +9,12 @@ class ComputePipelineBuilder
   public:
     void setShader(VkShaderModule computeShader);
     void setPipelineLayout(VkPipelineLayout layout);
+    void setPipelineCache(VkPipelineCache pipelineCache);
     VkPipeline build(VkDevice device);
 
   private:
     VkPipelineLayout mPipelineLayout;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     VkPipelineShaderStageCreateInfo mShaderStage;
 };
 } // namespace Bunny::Render
@@ -46,7 +46,6 @@ class CullingPass
   private:
     void initDescriptorSets();
     BunnyResult initPipeline();
-    void createBuffers();
 
     VkPipeline mPipeline;
     VkPipelineLayout mPipelineLayout;
@@ -66,7 +65,8 @@ class CullingPass
     VkDescriptorSetLayout mCullDataLayout;
     VkDescriptorSetLayout mDrawDataLayout;
 
-    AllocatedBuffer mCullingDataBuffer;
+    //  the view frustum, in the frame buffer arena
+    FrameBufferSlice mCullingDataSlice;
     const AllocatedBuffer* mDrawCommandBuffer = nullptr;
     const AllocatedBuffer* mInstanceObjectBuffer = nullptr;
     const AllocatedBuffer* mSurfaceToCommandMapBuffer = nullptr;
@@ -2,7 +2,10 @@
 
 #include <volk.h>
 
+#include <atomic>
+#include <cstdint>
 #include <span>
+#include <unordered_map>
 #include <vector>
 #include <deque>
 
@@ -32,7 +35,8 @@ class DescriptorAllocator
         uint32_t mRatio;
     };
 
-    void init(VkDevice device, uint32_t maxSets, std::span<PoolSize> poolSizes);
+    void init(VkDevice device, uint32_t maxSets, std::span<PoolSize> poolSizes,
+        VkDescriptorPoolCreateFlags poolCreateFlags = 0);
     void allocate(VkDevice device, const VkDescriptorSetLayout* pLayout, VkDescriptorSet* pDescSet, uint32_t count = 1,
         void* pNext = nullptr);
     void clearPools(VkDevice device);
@@ -45,11 +49,33 @@ class DescriptorAllocator
     std::vector<VkDescriptorPool> mFullPools;
     std::vector<VkDescriptorPool> mReadyPools;
     std::vector<PoolSize> mPoolSizes;
+    VkDescriptorPoolCreateFlags mPoolCreateFlags = 0;
 
     uint32_t mMaxSets;
     constexpr static uint32_t msMaxSetsLimit = 4096;
 };
 
+//  a single pool for the sets that live for one frame, reset() frees all of them with one call
+//  when the pool runs out the sets go to overflow pools, and the next reset() replaces all of them
+//  with one pool large enough for the whole frame
+class DescriptorArena
+{
+  public:
+    void init(VkDevice device, uint32_t maxSets, std::span<DescriptorAllocator::PoolSize> poolSizes);
+    VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
+    //  only after the gpu is done with the sets, e.g. after the fence of the frame is waited for
+    void reset(VkDevice device);
+    void destroy(VkDevice device);
+
+  private:
+    VkDescriptorPool createPool(VkDevice device) const;
+
+    VkDescriptorPool mPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> mOverflowPools;
+    std::vector<DescriptorAllocator::PoolSize> mPoolSizes;
+    uint32_t mMaxSets = 0;
+};
+
 //  Helper to write the actual resources to descriptors
 class DescriptorWriter
 {
@@ -61,17 +87,60 @@ class DescriptorWriter
         uint32_t binding, VkImageView imageView, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
     void writeBuffer(uint32_t binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type);
     void writeAccelerationStructure(uint32_t binding, VkAccelerationStructureKHR acceStruct);
-    void writeImages(uint32_t binding, std::vector<VkDescriptorImageInfo> imageInfos, VkDescriptorType type);
+    void writeImages(uint32_t binding, std::vector<VkDescriptorImageInfo> imageInfos, VkDescriptorType type,
+        uint32_t firstArrayElement = 0);
     void writeBuffers(uint32_t binding, std::vector<VkDescriptorBufferInfo> bufferInfos, VkDescriptorType type);
 
     void updateSet(VkDevice device, VkDescriptorSet descriptorSet);
+    //  record the writes into the command buffer instead of a set, VK_KHR_push_descriptor
+    //  the set layout has to be created with VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR
+    void pushSet(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set) const;
+
+    //  everything the writes point to, two writers with the same key write the same descriptors
+    void appendKey(std::vector<uint64_t>& key) const;
+
+    //  descriptors written or pushed by all writers since the last call, for profiling
+    static uint32_t takeWriteCount() { return msWriteCount.exchange(0, std::memory_order_relaxed); }
 
   private:
+    uint32_t getDescriptorCount() const;
+
     std::deque<std::vector<VkDescriptorImageInfo>> mImageInfos;
     std::deque<std::vector<VkDescriptorBufferInfo>> mBufferInfos;
     std::deque<VkAccelerationStructureKHR> mAcceStructs;
     std::deque<VkWriteDescriptorSetAccelerationStructureKHR> mAcceStructWrites;
 
     std::vector<VkWriteDescriptorSet> mWrites;
+
+    inline static std::atomic<uint32_t> msWriteCount = 0;
+};
+
+//  reuses the set written with the same layout and resources before instead of allocating and writing a new one,
+//  so the sets that only change with the frame in flight are written once per frame in flight
+//  the cached sets are never updated, so they are shared by the frames in flight
+//  not thread safe, the renderer locks it while the passes are recorded on several threads
+class DescriptorSetCache
+{
+  public:
+    static constexpr uint32_t MAX_CACHED_SET_COUNT = 1024;
+
+    void init(VkDevice device, uint32_t maxSets, std::span<DescriptorAllocator::PoolSize> poolSizes);
+    //  VK_NULL_HANDLE when the set is not cached and the cache is full
+    VkDescriptorSet getSet(VkDevice device, VkDescriptorSetLayout layout, DescriptorWriter& writer);
+    //  only when the gpu is idle, must be called when the resources in the sets are destroyed
+    //  since a new resource can get the handle of a destroyed one
+    void clear(VkDevice device);
+    void destroy(VkDevice device);
+
+    uint32_t getSetCount() const { return static_cast<uint32_t>(mSets.size()); }
+
+  private:
+    struct KeyHash
+    {
+        size_t operator()(const std::vector<uint64_t>& key) const;
+    };
+
+    DescriptorAllocator mAllocator;
+    std::unordered_map<std::vector<uint64_t>, VkDescriptorSet, KeyHash> mSets;
 };
 } // namespace Bunny::Render
@@ -34,8 +34,9 @@ class FinalOutputPass : public PbrGraphicsPass
 
     struct FrameData
     {
-        VkDescriptorSet mTextureDescSet;
-        DescriptorAllocator mDescriptorAllocator;
+        //  the writes are pushed in draw() with VK_KHR_push_descriptor, otherwise the set is a cached one
+        DescriptorWriter mTextureWriter;
+        VkDescriptorSet mTextureDescSet = VK_NULL_HANDLE;
 
         const AllocatedImage* mCloudTexture = nullptr;
         const AllocatedImage* mFogShadowTexture = nullptr;
@@ -62,6 +63,7 @@ class FinalOutputPass : public PbrGraphicsPass
     std::array<uint32_t, 6> mIndexData{0, 3, 1, 1, 3, 2};
 
     VkDescriptorSetLayout mTextureDescSetLayout = nullptr;
+    bool mIsPushDescriptorUsed = false;
 
     std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
 };
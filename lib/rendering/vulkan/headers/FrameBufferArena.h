@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "Fundamentals.h"
+
+#include <volk.h>
+
+#include <cstring>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+
+//  one persistently mapped buffer with a region per frame in flight, the data that is rewritten every frame
+//  is allocated linearly from the region of the current frame and bound with dynamic offsets
+//  a region is reset only after the fence of its frame is waited for, so the data the gpu still reads
+//  is never overwritten and the descriptor sets never need to be updated for it
+class FrameBufferArena
+{
+  public:
+    static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 1024 * 1024;
+
+    FrameBufferArena(const VulkanRenderResources* vulkanResources);
+    ~FrameBufferArena();
+
+    BunnyResult initialize(VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+    void cleanup();
+
+    //  call after the fence of the frame is waited for, frees everything allocated in the frame before
+    void beginFrame(uint32_t frameIdx);
+
+    //  a slice of the arena buffer to write into the descriptor sets, the offset is set by every allocation
+    FrameBufferSlice makeSlice(VkDeviceSize range) const;
+    //  aborts when the region of the frame is full, the capacity has to fit everything written in a frame
+    void* allocate(VkDeviceSize size, FrameBufferSlice& slice);
+
+    template <typename T>
+    void write(const T& data, FrameBufferSlice& slice)
+    {
+        memcpy(allocate(sizeof(T), slice), &data, sizeof(T));
+    }
+
+    const AllocatedBuffer& getBuffer() const { return mBuffer; }
+    VkDeviceSize getFrameCapacity() const { return mFrameCapacity; }
+    VkDeviceSize getFrameUsedSize() const { return mFrameUsedSize; }
+
+  private:
+    const VulkanRenderResources* mVulkanResources = nullptr;
+
+    AllocatedBuffer mBuffer;
+    VkDeviceSize mFrameCapacity = 0;
+    //  the larger of the uniform and storage buffer offset alignments
+    VkDeviceSize mAlignment = 1;
+
+    VkDeviceSize mFrameBegin = 0;
+    VkDeviceSize mFrameUsedSize = 0;
+};
+} // namespace Bunny::Render
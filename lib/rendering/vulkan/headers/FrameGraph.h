@@ -0,0 +1,277 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "Fundamentals.h"
+#include "FunctionStack.h"
+#include "TaskManager.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+class VulkanGraphicsRenderer;
+
+//  passes declare which resources they read and write, the graph then
+//  - culls the passes whose results are never used
+//  - records the barriers between passes, only where there is a hazard or a layout change
+//  - creates the transient images and lets the ones with non overlapping lifetimes share memory
+//  - runs the async compute passes on the compute queue, with semaphores and queue ownership transfers
+//    where a resource moves between the queues
+//  barriers inside a pass (e.g. between fft iterations) are still recorded by the pass itself
+//  resources used on both queues should be per frame in flight, across frames only the frame fence orders them
+//  with several recording threads the graphics passes of a batch are split into chunks recorded in parallel,
+//  so their execute functions must not share state that is written during recording
+class FrameGraph
+{
+  public:
+    using ResourceHandle = IdType;
+    using ImageGetter = std::function<const AllocatedImage*()>;
+    using BufferGetter = std::function<const AllocatedBuffer*()>;
+    using ExecuteFunction = std::function<void()>;
+
+    struct TransientImageDesc
+    {
+        VkExtent3D mExtent;
+        VkFormat mFormat;
+        VkImageUsageFlags mUsage;
+        VkImageAspectFlags mAspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        VkSampleCountFlagBits mSampleCount = VK_SAMPLE_COUNT_1_BIT;
+        uint32_t mArrayLayers = 1; //  more than 1 gets a 2d array view
+    };
+
+    struct Statistics
+    {
+        uint32_t mPassCount = 0;
+        uint32_t mCulledPassCount = 0;
+        uint32_t mBarrierCount = 0;      //  image and buffer barriers recorded in a frame
+        uint32_t mBarrierBatchCount = 0; //  vkCmdPipelineBarrier calls in a frame
+        uint32_t mNaiveBarrierCount = 0; //  one barrier before every access of every pass that is not culled
+        uint32_t mAsyncComputePassCount = 0;
+        uint32_t mBatchCount = 0;         //  parts of the frame submitted separately to the two queues
+        uint32_t mQueueTransferCount = 0; //  queue family ownership transfers in a frame
+        uint32_t mRecordingThreadCount = 1;
+        VkDeviceSize mTransientMemorySize = 0; //  per frame in flight
+        VkDeviceSize mUnaliasedTransientMemorySize = 0;
+    };
+
+    class PassBuilder
+    {
+      public:
+        //  layout is ignored for buffers
+        PassBuilder& read(ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        PassBuilder& write(ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+        //  the pass writes to something outside the graph, e.g. the swapchain, so it is never culled
+        PassBuilder& setSideEffect();
+        //  the pass only records compute work and can overlap with the graphics work on the async compute queue,
+        //  it stays on the graphics queue if the device has no separate compute queue family
+        PassBuilder& setAsyncCompute();
+        PassBuilder& setExecute(ExecuteFunction execute);
+
+      private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph* graph, uint32_t passIdx);
+
+        PassBuilder& addAccess(ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access,
+            VkImageLayout layout, bool isWrite);
+
+        FrameGraph* mGraph;
+        uint32_t mPassIdx;
+    };
+
+    FrameGraph(const VulkanRenderResources* vulkanResources, VulkanGraphicsRenderer* renderer);
+    ~FrameGraph();
+
+    //  images and buffers owned by passes or the renderer, the getter returns the one for the current frame
+    //  initialLayout is the layout an image is in when the graph sees it for the first time,
+    //  use VK_IMAGE_LAYOUT_UNDEFINED if the content at that point does not matter
+    ResourceHandle importImage(std::string_view name, ImageGetter getter,
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    ResourceHandle importBuffer(std::string_view name, BufferGetter getter);
+    //  images that only live within one frame, created by the graph in compile()
+    ResourceHandle createTransientImage(std::string_view name, const TransientImageDesc& desc);
+    //  the resource is used after the frame (e.g. read by the next frame), keep the passes writing it
+    void markOutput(ResourceHandle resource);
+    //  ping pong images, previous is what current was in an earlier frame,
+    //  so each starts a frame in the state the other one ended the last frame in
+    void markHistory(ResourceHandle current, ResourceHandle previous);
+
+    PassBuilder addPass(std::string_view name);
+
+    //  record the graphics passes on up to threadCount threads, the calling one included,
+    //  each additional thread gets a recording slot in the renderer. call before the first execute()
+    BunnyResult setRecordingThreadCount(uint32_t threadCount);
+
+    BunnyResult compile();
+    //  record barriers and run the passes into the current command buffer of the renderer,
+    //  the frame is split into several submits when there are async compute passes
+    void execute();
+    void cleanup();
+
+    //  only valid after compile()
+    const AllocatedImage* getTransientImage(ResourceHandle resource, uint32_t frameIdx) const;
+    std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> getTransientImages(ResourceHandle resource) const;
+    const Statistics& getStatistics() const { return mStatistics; }
+    void printStatistics() const;
+
+  private:
+    enum class ResourceType
+    {
+        Image,
+        Buffer,
+        TransientImage
+    };
+
+    struct Resource
+    {
+        std::string mName;
+        ResourceType mType;
+        VkImageAspectFlags mAspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        VkImageLayout mInitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        ImageGetter mImageGetter;
+        BufferGetter mBufferGetter;
+        bool mIsOutput = false;
+        //  the resource whose state at the end of a frame this one starts the next frame with
+        ResourceHandle mCarriedFrom = 0;
+
+        //  imported images the graph has already transitioned at least once
+        std::vector<VkImage> mKnownImages;
+
+        //  transient image data
+        TransientImageDesc mTransientDesc;
+        std::array<AllocatedImage, MAX_FRAMES_IN_FLIGHT> mTransientImages{};
+        VkMemoryRequirements mMemoryRequirements{};
+        uint32_t mMemoryBlockIdx = 0;
+        VkDeviceSize mMemoryOffset = 0;
+        uint32_t mFirstPassIdx = UINT32_MAX; //  lifetime in the passes that are not culled
+        uint32_t mLastPassIdx = 0;
+        bool mIsUsedOnGraphics = false; //  images used on different queues can not share memory
+        bool mIsUsedOnAsyncCompute = false;
+        VkPipelineStageFlags mLastStages = 0; //  stages and access of the last pass using it,
+        VkAccessFlags mLastAccess = 0;        //  to hand the memory over to the next image aliasing it
+        VkPipelineStageFlags mAliasSrcStages = 0;
+        VkAccessFlags mAliasSrcAccess = 0;
+    };
+
+    struct Access
+    {
+        ResourceHandle mResource;
+        VkPipelineStageFlags mStages;
+        VkAccessFlags mAccess;
+        VkImageLayout mLayout;
+        bool mIsRead;
+        bool mIsWrite;
+    };
+
+    struct Barrier
+    {
+        ResourceHandle mResource;
+        VkPipelineStageFlags mSrcStages;
+        VkAccessFlags mSrcAccess;
+        VkPipelineStageFlags mDstStages;
+        VkAccessFlags mDstAccess;
+        VkImageLayout mOldLayout;
+        VkImageLayout mNewLayout;
+        bool mIsFirstAccess;
+        //  not needed in a steady frame, only when an imported image is new to the graph and in a different layout
+        bool mIsOptional;
+        //  both are VK_QUEUE_FAMILY_IGNORED unless the barrier is one half of a queue ownership transfer
+        uint32_t mSrcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t mDstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    };
+
+    struct Pass
+    {
+        std::string mName;
+        std::vector<Access> mAccesses;
+        ExecuteFunction mExecute;
+        bool mHasSideEffect = false;
+        bool mIsAsyncCompute = false;
+        bool mIsOnAsyncCompute = false; //  async compute and the device has a compute queue for it
+        bool mIsCulled = false;
+        std::vector<Barrier> mBarriers;
+        //  recorded after the pass, hand the resources over to the queue that uses them next
+        std::vector<Barrier> mReleaseBarriers;
+        //  passes on the other queue this pass has to wait for
+        std::vector<uint32_t> mWaitPasses;
+    };
+
+    //  consecutive passes submitted together to one queue
+    struct Batch
+    {
+        bool mIsOnAsyncCompute = false;
+        std::vector<uint32_t> mPasses;
+        //  batches on the other queue to wait for, with one semaphore per frame in flight for each of them
+        std::vector<uint32_t> mWaitBatches;
+        std::vector<std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT>> mWaitSemaphores;
+        //  compute work nothing else waits for, the last graphics submit of the frame waits for it instead
+        std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> mFrameEndSemaphores{};
+    };
+
+    //  state of a resource while walking through the passes
+    struct ResourceState
+    {
+        VkPipelineStageFlags mWriteStages = 0;
+        VkAccessFlags mWriteAccess = 0;
+        VkPipelineStageFlags mReadStages = 0;   //  reads since the last write
+        VkPipelineStageFlags mVisibleStages = 0; //  stages the last write is already made visible to
+        VkAccessFlags mVisibleAccess = 0;
+        VkImageLayout mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool mIsAccessed = false;
+        bool mIsOnAsyncCompute = false;    //  queue owning the resource
+        uint32_t mLastPassIdx = UINT32_MAX; //  where it is released if the next access is on the other queue
+    };
+
+    struct MemoryBlock
+    {
+        uint32_t mMemoryTypeBits;
+        VkDeviceSize mSize = 0;
+        VkDeviceSize mAlignment = 1;
+        std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> mAllocations{};
+    };
+
+    void cullPasses();
+    void assignQueues();
+    void computeTransientLifetimes();
+    BunnyResult createTransientImages();
+    void placeTransientImages();
+    void computeBarriers();
+    //  walk through the passes once, optionally recording the barriers into the passes
+    void simulateAccesses(std::vector<ResourceState>& states, bool recordBarriers);
+    BunnyResult buildBatches();
+    void recordBatch(const Batch& batch, uint32_t frameIdx);
+    void recordPasses(std::span<const uint32_t> passes, uint32_t frameIdx);
+    void recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers, uint32_t frameIdx);
+    std::vector<VkSemaphore> getSignalSemaphores(uint32_t batchIdx, uint32_t frameIdx) const;
+    bool isImageKnown(const Resource& resource, VkImage image) const;
+
+    const VulkanRenderResources* mVulkanResources;
+    VulkanGraphicsRenderer* mRenderer;
+
+    std::vector<Resource> mResources;
+    std::vector<Pass> mPasses;
+    std::vector<Batch> mBatches;
+    std::vector<MemoryBlock> mMemoryBlocks;
+
+    Statistics mStatistics;
+    bool mIsCompiled = false;
+
+    Utils::TaskDispatcher mRecordingDispatcher;
+    uint32_t mRecordingThreadCount = 1;
+    //  the known images are updated while recording barriers, possibly on several threads
+    std::mutex mKnownImagesMutex;
+
+    Base::FunctionStack<> mDeletionStack;
+};
+} // namespace Bunny::Render
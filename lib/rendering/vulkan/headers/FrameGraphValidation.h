@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+class VulkanGraphicsRenderer;
+
+//  compiles a small fixed frame graph and compares its statistics with the counts worked out by hand,
+//  the culling, the barriers left after removing the redundant ones and the memory shared by transient images
+//  all passes are on the graphics queue so the expected counts do not depend on the device
+//  returns the number of statistics that do not match
+uint32_t validateFrameGraph(const VulkanRenderResources* vulkanResources, VulkanGraphicsRenderer* renderer);
+} // namespace Bunny::Render
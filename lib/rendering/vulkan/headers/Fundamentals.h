@@ -25,6 +25,15 @@ struct AllocatedBuffer
     VkDeviceSize mSize;
 };
 
+//  a range of the frame buffer arena that is allocated again every frame
+//  bound once as a dynamic uniform or storage buffer of mRange, mOffset is the dynamic offset of the current frame
+struct FrameBufferSlice
+{
+    VkBuffer mBuffer = VK_NULL_HANDLE;
+    VkDeviceSize mRange = 0;
+    uint32_t mOffset = 0;
+};
+
 //  frame
 static constexpr size_t MAX_FRAMES_IN_FLIGHT = 2;
 
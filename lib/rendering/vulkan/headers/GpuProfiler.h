@@ -0,0 +1,129 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "Fundamentals.h"
+#include "FunctionStack.h"
+
+#include <volk.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+
+//  gpu time of zones within a frame, e.g. one zone per render pass
+//  every zone writes a timestamp at its begin and end, zones on the graphics queue can also collect
+//  pipeline statistics. the queries of a frame are read back when its frame resources are used again,
+//  MAX_FRAMES_IN_FLIGHT frames later and after the frame fence, so reading them never stalls
+//  zones can be recorded from several threads at once as long as each thread records its own command buffer
+class GpuProfiler
+{
+  public:
+    static constexpr uint32_t MAX_ZONE_COUNT = 64; //  per frame
+    static constexpr uint32_t MAX_CAPTURED_FRAME_COUNT = 300;
+    static constexpr uint32_t PIPELINE_STATISTIC_COUNT = 5;
+    static constexpr std::array<const char*, PIPELINE_STATISTIC_COUNT> PIPELINE_STATISTIC_NAMES = {
+        "Input primitives", "Vertex invocations", "Clipped primitives", "Fragment invocations", "Compute invocations"};
+
+    struct ZoneResult
+    {
+        std::string mName;
+        bool mIsOnAsyncCompute = false;
+        double mStartMs = 0; //  from the start of the frame
+        double mDurationMs = 0;
+        bool mHasStatistics = false;
+        std::array<uint64_t, PIPELINE_STATISTIC_COUNT> mStatistics{};
+    };
+
+    struct FrameResult
+    {
+        uint64_t mFrameNumber = 0;
+        uint64_t mStartTimestamp = 0; //  in ticks of the device clock
+        double mDurationMs = 0;       //  from the first zone begin to the last zone end
+        std::vector<ZoneResult> mZones;
+    };
+
+    GpuProfiler(const VulkanRenderResources* vulkanResources);
+    ~GpuProfiler();
+
+    BunnyResult initialize();
+    void cleanup();
+
+    //  read back the results of the last frame using the same frame resources and reset its queries,
+    //  the fence of that frame must have been waited for
+    void beginFrame(uint32_t frameIdx);
+    //  zones can be nested within a command buffer, only the outermost graphics zone collects pipeline statistics
+    void beginZone(VkCommandBuffer cmd, std::string_view name, bool isOnAsyncCompute);
+    void endZone(VkCommandBuffer cmd);
+
+    bool isSupported() const { return mIsSupported; }
+    bool isEnabled() const { return mIsEnabled; }
+    void setEnabled(bool enabled) { mIsEnabled = enabled; }
+    bool isPipelineStatisticsSupported() const { return mStatisticsPools[0] != VK_NULL_HANDLE; }
+    void setPipelineStatisticsEnabled(bool enabled) { mIsStatisticsEnabled = enabled; }
+
+    //  the most recent frames with results, oldest first
+    const std::deque<FrameResult>& getCapturedFrames() const { return mCapturedFrames; }
+
+    //  one row per zone of the captured frames
+    BunnyResult exportCsv(std::string_view filePath) const;
+    //  json trace for chrome://tracing or perfetto, with one track per queue
+    BunnyResult exportChromeTrace(std::string_view filePath) const;
+
+    void showImguiPanel();
+
+  private:
+    struct Zone
+    {
+        std::string mName;
+        bool mIsOnAsyncCompute;
+        bool mHasStatistics;
+    };
+
+    struct FrameZones
+    {
+        std::vector<Zone> mZones;
+        uint64_t mFrameNumber = 0;
+    };
+
+    void readResults(uint32_t frameIdx);
+    double ticksToMs(uint64_t ticks) const;
+
+    const VulkanRenderResources* mVulkanResources;
+
+    std::array<VkQueryPool, MAX_FRAMES_IN_FLIGHT> mTimestampPools{};
+    std::array<VkQueryPool, MAX_FRAMES_IN_FLIGHT> mStatisticsPools{};
+    std::array<FrameZones, MAX_FRAMES_IN_FLIGHT> mFrameZones;
+    uint32_t mCurrentFrameIdx = 0;
+    uint64_t mFrameNumber = 0;
+
+    //  zones begun but not ended yet, UINT32_MAX for the ones not recorded
+    struct OpenZones
+    {
+        std::vector<uint32_t> mZones;
+        bool mIsStatisticsQueryActive = false;
+    };
+
+    //  per command buffer, zones recorded in parallel do not nest into each other
+    std::unordered_map<VkCommandBuffer, OpenZones> mOpenZones;
+    std::mutex mZoneMutex;
+
+    double mTimestampPeriod = 1.0; //  nanoseconds per tick
+    bool mIsSupported = false;
+    bool mIsEnabled = true;
+    bool mIsStatisticsEnabled = false;
+
+    std::deque<FrameResult> mCapturedFrames;
+    std::unordered_map<std::string, double> mAverageDurationsMs;
+
+    Base::FunctionStack<> mDeletionStack;
+};
+} // namespace Bunny::Render
@@ -34,6 +34,7 @@ class GraphicsPipelineBuilder
     void disableDepthTest();
     void enableDepthTest(bool depthWriteEnable, VkCompareOp op);
     void setPipelineLayout(VkPipelineLayout layout);
+    void setPipelineCache(VkPipelineCache pipelineCache);
     void addColorAttachmentNoBlend(VkFormat format);
     void addColorAttachmentWithBlend(VkFormat format, const VkPipelineColorBlendAttachmentState& blendState);
 
@@ -44,6 +45,7 @@ class GraphicsPipelineBuilder
     VkPipelineRasterizationStateCreateInfo mRasterizer;
     VkPipelineMultisampleStateCreateInfo mMultisampling;
     VkPipelineLayout mPipelineLayout;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     VkPipelineDepthStencilStateCreateInfo mDepthStencil;
     VkPipelineRenderingCreateInfo mRenderInfo;
     std::vector<VkFormat> mColorAttachmentFormats;
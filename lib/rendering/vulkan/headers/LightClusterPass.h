@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Fundamentals.h"
+#include "Descriptor.h"
+#include "BunnyResult.h"
+#include "ShaderData.h"
+
+#include <volk.h>
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+class VulkanGraphicsRenderer;
+class Camera;
+
+//  bins the point and spot lights into view space clusters (froxels)
+//  the forward, deferred and transparency shading read the per cluster light lists
+class LightClusterPass
+{
+  public:
+    LightClusterPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer);
+
+    BunnyResult initializePass();
+    void cleanup();
+    void linkLightData(const FrameBufferSlice& clusteredLightData);
+    //  the lights are only needed when the results are validated
+    void updateClusterParams(const Camera& camera, std::span<const ClusteredLight> lights);
+    void dispatch();
+
+    //  reads the clusters back and compares them with the cpu binning, slow, for debugging only
+    void setValidationEnabled(bool isEnabled) { mIsValidationEnabled = isEnabled; }
+
+    const AllocatedBuffer& getCurrentClusterBuffer() const;
+    const std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT>& getClusterBuffers() const { return mClusterBuffers; }
+
+    ~LightClusterPass();
+
+  private:
+    void initDescriptorSets();
+    BunnyResult initPipeline();
+    void createBuffers();
+    void validateClusters(uint32_t frameIdx);
+
+    VkPipeline mPipeline = nullptr;
+    VkPipelineLayout mPipelineLayout = nullptr;
+
+    DescriptorAllocator mDescriptorAllocator;
+    VkDescriptorSetLayout mDescSetLayout = nullptr;
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> mDescSets;
+    //  in the frame buffer arena, bound with a dynamic offset
+    const FrameBufferSlice* mClusteredLightData = nullptr;
+
+    //  written by the gpu, one per frame in flight
+    std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT> mClusterBuffers;
+
+    LightClusterParams mParams;
+
+    //  validation
+    struct ValidationFrame
+    {
+        AllocatedBuffer mReadbackBuffer;
+        LightClusterParams mParams;
+        std::vector<ClusteredLight> mLights;
+        bool mHasResult = false;
+    };
+    bool mIsValidationEnabled = false;
+    std::vector<ClusteredLight> mValidationLights;
+    std::array<ValidationFrame, MAX_FRAMES_IN_FLIGHT> mValidationFrames;
+
+    const VulkanRenderResources* mVulkanResources = nullptr;
+    const VulkanGraphicsRenderer* mRenderer = nullptr;
+
+    std::string mLightClusterShaderPath{"./light_cluster_comp.spv"};
+};
+} // namespace Bunny::Render
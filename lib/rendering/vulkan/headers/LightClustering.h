@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ShaderData.h"
+#include "BoundingBox.h"
+
+#include <glm/vec3.hpp>
+
+#include <span>
+#include <vector>
+
+namespace Bunny::Render
+{
+class Camera;
+
+//  cpu side of the clustered light culling, the same math as lightCluster.comp
+//  used to validate the gpu results and to fill the pass parameters
+
+struct LightClusterBounds
+{
+    glm::vec3 mMin; //  view space
+    glm::vec3 mMax;
+};
+
+LightClusterParams makeLightClusterParams(const Camera& camera);
+
+//  view space aabb of a cluster, the camera looks at -z
+LightClusterBounds getLightClusterBounds(const LightClusterParams& params, uint32_t clusterIdx);
+
+//  view space sphere containing the lit volume of a point or spot light
+Base::BoundingSphere getLightCullingSphere(const ClusteredLight& light, const glm::mat4& viewMat);
+
+bool isSphereInLightCluster(const LightClusterBounds& bounds, const Base::BoundingSphere& sphere);
+
+//  reference binning, the light indices of each cluster in ascending order, not capped at MAX_LIGHTS_PER_CLUSTER
+//  radiusScale grows or shrinks the culling spheres to tolerate float differences to the gpu
+void binLightsToClusters(const LightClusterParams& params, std::span<const ClusteredLight> lights,
+    std::vector<std::vector<uint32_t>>& outClusterLights, float radiusScale = 1.0f);
+
+//  compares the gpu binning with the reference, returns the number of clusters that do not match
+uint32_t validateLightClusters(
+    const LightClusterParams& params, std::span<const ClusteredLight> lights, const LightClusterData& gpuClusters);
+} // namespace Bunny::Render
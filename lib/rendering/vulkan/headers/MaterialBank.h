@@ -4,6 +4,7 @@
 #include "Material.h"
 #include "BunnyResult.h"
 #include "FunctionStack.h"
+#include "Descriptor.h"
 #include "MeshBank.h"
 #include "Vertex.h"
 
@@ -20,11 +21,10 @@ class TextureBank;
 class PbrMaterialBank
 {
   public:
-    //  Size of the array containing all textures in the shader
-    //  This value is needed when creating the descriptor set
-    //  For now this is fixed, try to make it growable when necessary
-    //  In this case need to rebuild the whole rendering pipeline
-    static constexpr uint32_t TEXTURE_ARRAY_SIZE = 64;
+    //  Binding of the bindless array containing all textures in the material descriptor set
+    static constexpr uint32_t TEXTURE_ARRAY_BINDING = 3;
+    //  dynamic offsets when binding the world descriptor set: light, camera and clustered lights
+    static constexpr uint32_t WORLD_DYNAMIC_OFFSET_COUNT = 3;
 
     PbrMaterialBank(
         const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer, TextureBank* textureBank);
@@ -40,7 +40,9 @@ class PbrMaterialBank
     BunnyResult addMaterialInstance(const PbrMaterialParameters& materialParams, IdType& outId);
     //  temp solution, include mesh bank as parameter
     //  maybe order the descriptors better to avoid this
-    void updateMaterialDescriptorSet(VkDescriptorSet descriptorSet, const MeshBank<NormalVertex>* meshBank) const;
+    void updateMaterialDescriptorSet(const MeshBank<NormalVertex>* meshBank);
+    //  write the textures added since last frame to the bindless texture array
+    void updateTextureDescriptors();
     BunnyResult recreateMaterialBuffer();
     void updateMaterialBuffer();
 
@@ -50,6 +52,9 @@ class PbrMaterialBank
     VkDescriptorSetLayout getMaterialDescSetLayout() const { return mMaterialDescSetLayout; }
     VkDescriptorSetLayout getEffectDescSetLayout() const { return mEffectDescSetLayout; }
 
+    //  the material descriptor set is shared by all passes
+    VkDescriptorSet getMaterialDescSet() const { return mMaterialDescSet; }
+
     VkPipelineLayout getPbrForwardPipelineLayout() const { return mPbrForwardPipelineLayout; }
     VkPipelineLayout getPbrGBufferPipelineLayout() const { return mPbrGBufferPipelineLayout; }
     VkPipelineLayout getPbrDeferredPipelineLayout() const { return mPbrDeferredPipelineLayout; }
@@ -57,6 +62,7 @@ class PbrMaterialBank
   private:
     BunnyResult buildDescriptorSetLayouts();
     BunnyResult buildPipelineLayouts();
+    BunnyResult allocateMaterialDescriptorSet();
 
     void showImguiControlPanel();
 
@@ -74,6 +80,9 @@ class PbrMaterialBank
     VkPipelineLayout mPbrGBufferPipelineLayout;
     VkPipelineLayout mPbrDeferredPipelineLayout;
 
+    DescriptorAllocator mDescriptorAllocator;
+    VkDescriptorSet mMaterialDescSet;
+
     std::vector<PbrMaterialParameters> mMaterialInstances;
     AllocatedBuffer mMaterialBuffer;
     bool mMaterialBufferNeedUpdate = false;
@@ -4,11 +4,13 @@
 #include "Fundamentals.h"
 #include "PbrGraphicsPass.h"
 #include "ShaderData.h"
+#include "Camera.h"
 
 #include <glm/matrix.hpp>
 #include <glm/vec2.hpp>
 
 #include <array>
+#include <span>
 #include <string_view>
 
 namespace Bunny::Render
@@ -17,25 +19,42 @@ namespace Bunny::Render
 class VulkanRenderResources;
 class VulkanGraphicsRenderer;
 class TextureBank;
-class Camera;
 
 class OceanPass : public PbrGraphicsPass
 {
   public:
+    //  keep these in sync with waveMesh.glsl
     static constexpr uint32_t MESH_THREAD_COUNT_X = 8;
     static constexpr uint32_t MESH_THREAD_COUNT_Y = 8;
+    //  the ocean is drawn as a cdlod quad tree of patches, a node of any level has the cell count of a mesh work group
+    static constexpr uint32_t PATCH_CELL_COUNT = MESH_THREAD_COUNT_X - 1;
+    static constexpr uint32_t LOD_COUNT = 8;
+    //  nodes per axis of each level around the camera that the task shader looks at
+    static constexpr uint32_t LOD_WINDOW_SIZE = 16;
+    static constexpr uint32_t TASK_THREAD_COUNT_X = 8;
+    static constexpr uint32_t TASK_THREAD_COUNT_Y = 8;
+    //  range of a level in its node widths, the window above and the morphing need it to be 4
+    static constexpr float LOD_RANGE_SCALE = 4.0f;
+    //  max distance a vertex is moved by the waves, pads the bounding boxes for the frustum culling
+    static constexpr float WAVE_DISPLACEMENT_BOUND = 5.0f;
 
     struct WaveFieldParams
     {
         glm::vec2 mGridOrigin;
         float mGridCellWidth;
-        float mGridAreaWidth;
+        float mDisplacementBound;
+        uint32_t mPatchCount;
+        uint32_t mPadding[3];
+        glm::vec4 mCascadeWidths; //  up to 4 cascades
     };
 
     struct WorldParams
     {
         glm::mat4 mMvpMatrix;
+        FrustumPlane mFrustumPlanes[6];
+        glm::vec3 mCameraPosition;
         float mElapsedTime;
+        glm::vec4 mLodRanges[LOD_COUNT / 4];
         float mDeltaTime;
     };
 
@@ -46,18 +65,21 @@ class OceanPass : public PbrGraphicsPass
 
     OceanPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
         const TextureBank* textureBank, PbrMaterialBank* materialBank, const MeshBank<NormalVertex>* meshBank,
-        float waveAreaWidth, uint32_t patternAreaGridCount, uint32_t totalGridCount,
-        std::string_view meshShaderPath = "wave_fft_mesh.spv", std::string_view fragShaderPath = "wave_frag.spv");
+        std::span<const float, WAVE_CASCADE_COUNT> cascadeWidths, float waveAreaWidth, uint32_t patternAreaGridCount,
+        uint32_t totalGridCount,
+        std::string_view taskShaderPath = "wave_task.spv", std::string_view meshShaderPath = "wave_fft_mesh.spv",
+        std::string_view fragShaderPath = "wave_frag.spv");
 
     void draw() const override;
 
     void prepareFrameDescriptors();
 
-    void updateWorldParams(const glm::mat4& mvpMatrix, float elapsedTime, float deltaTime);
-    void linkLightAndCameraData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData);
+    void updateWorldParams(const Camera& camera, float elapsedTime, float deltaTime);
+    void linkLightAndCameraData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData);
     void linkSceneAccelerationStructure(VkAccelerationStructureKHR acceStruct);
     void updateRenderTarget(const AllocatedImage* renderTarget);
-    void updateWaveTextures(const AllocatedImage* vertexDisplacementTex, const AllocatedImage* vertexNormalTex);
+    //  2d arrays with one layer per cascade
+    void updateWaveTextures(const AllocatedImage* vertexDisplacementTex, const AllocatedImage* waveSlopeTex);
 
   protected:
     BunnyResult initPipeline() override;
@@ -77,15 +99,14 @@ class OceanPass : public PbrGraphicsPass
 
         const AllocatedImage* mRenderTarget;
         const AllocatedImage* mVertexDisplacementImage;
-        const AllocatedImage* mVertexNormalImage;
-
-        DescriptorAllocator mDescriptorAllocator;
+        const AllocatedImage* mWaveSlopeImage;
     };
 
     BunnyResult initDescriptorLayouts();
 
     const TextureBank* mTextureBank;
 
+    std::string_view mTaskShaderPath;
     std::string_view mMeshShaderPath;
     std::string_view mFragShaderPath;
 
@@ -100,9 +121,10 @@ class OceanPass : public PbrGraphicsPass
     WavePushParams mWavePushParams;
     uint32_t mTotalWaveGridCount;
     AllocatedBuffer mWaveParamsBuffer;
-    AllocatedBuffer mWorldParamsBuffer;
-    const AllocatedBuffer* mLightDataBuffer;
-    const AllocatedBuffer* mCameraDataBuffer;
+    //  the world params, lights and camera change every frame, they are in the frame buffer arena
+    FrameBufferSlice mWorldParamsSlice;
+    const FrameBufferSlice* mLightData = nullptr;
+    const FrameBufferSlice* mCameraData = nullptr;
     VkAccelerationStructureKHR mSceneAcceStruct;
 };
 } // namespace Bunny::Render
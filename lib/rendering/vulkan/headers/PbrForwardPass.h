@@ -24,7 +24,10 @@ class PbrForwardPass : public PbrGraphicsPass
     void buildDrawCommands();
     void updateDrawInstanceCounts(std::unordered_map<IdType, size_t> meshInstanceCounts);
     void prepareDrawCommandsForFrame();
-    void linkWorldData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData);
+    void linkWorldData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData);
+    //  the cluster buffers are written by the light cluster pass, one per frame in flight
+    void linkLightClusterData(const FrameBufferSlice& clusteredLightData,
+        const std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT>& clusterBuffers);
     void linkObjectData(const AllocatedBuffer& objectBuffer, size_t bufferSize);
     void linkShadowData(std::array<VkImageView, MAX_FRAMES_IN_FLIGHT> shadowImageViews);
     void updateRenderTarget(const AllocatedImage* renderTarget);
@@ -66,5 +69,10 @@ class PbrForwardPass : public PbrGraphicsPass
 
     DescriptorAllocator mDescriptorAllocator;
     std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
+
+    //  in the frame buffer arena, their offsets change every frame
+    const FrameBufferSlice* mLightData = nullptr;
+    const FrameBufferSlice* mCameraData = nullptr;
+    const FrameBufferSlice* mClusteredLightData = nullptr;
 };
 } // namespace Bunny::Render
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "Singleton.h"
+#include "Task.h"
+#include "TaskManager.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Bunny::Render
+{
+//  compiles pipelines on worker threads during startup
+//  passes enqueue the shader loading and vkCreate*Pipelines part of their initPipeline() as a job,
+//  all other vulkan objects (layouts, descriptors) are still created on the calling thread
+class PipelineCompileQueue : public Base::Singleton<PipelineCompileQueue>
+{
+  public:
+    using CompileJob = std::function<BunnyResult()>;
+
+    PipelineCompileQueue();
+    ~PipelineCompileQueue();
+
+    //  run the job on a worker thread, or right away if the queue is not set up
+    static BunnyResult enqueue(CompileJob job);
+
+    //  block until every enqueued job is done, return BUNNY_SAD if any of them failed
+    static BunnyResult waitForAll();
+
+  private:
+    Utils::TaskDispatcher mDispatcher;
+    std::vector<std::shared_ptr<Utils::FunctionTask>> mTasks;
+    std::atomic_bool mHasFailedJob{false};
+};
+} // namespace Bunny::Render
@@ -22,11 +22,13 @@ class RaytracingPipelineBuilder
     void addIntersectionShaderGroup(uint32_t index);
     void setMaxRecursionDepth(uint32_t depth);
     void setPipelineLayout(VkPipelineLayout pipelineLayout);
+    void setPipelineCache(VkPipelineCache pipelineCache);
 
   private:
     std::vector<VkPipelineShaderStageCreateInfo> mShaderStages;
     std::vector<VkRayTracingShaderGroupCreateInfoKHR> mShaderGroups;
     VkPipelineLayout mPipelineLayout = nullptr;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     uint32_t mMaxRecursionDepth = 1;
 };
 } // namespace Bunny::Render
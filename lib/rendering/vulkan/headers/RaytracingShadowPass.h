@@ -7,10 +7,16 @@
 
 #include <volk.h>
 
+#include <glm/mat4x4.hpp>
+
 #include <array>
 
 namespace Bunny::Render
 {
+class Camera;
+
+//  traces the shadow rays for half of the pixels each frame in a checkerboard pattern
+//  the other half reprojects the shadow of the last frame, the resolve fills in what the reprojection rejected
 class RaytracingShadowPass : public PbrGraphicsPass
 {
   public:
@@ -18,13 +24,22 @@ class RaytracingShadowPass : public PbrGraphicsPass
         const PbrMaterialBank* materialBank, const MeshBank<NormalVertex>* meshBank);
 
     virtual void draw() const override;
+    //  run after draw(), writes the out image from the traced and reprojected samples
+    void resolve() const;
+    void updateRenderParams(const Camera& camera);
 
     void updateVertIdxBufferData(VkDeviceAddress vertBufAddress, VkDeviceAddress idxBufAddress);
-    void linkWorldData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData);
+    void linkWorldData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData);
     void linkObjectData(const AllocatedBuffer& objectBuffer, size_t bufferSize);
     void linkTopLevelAccelerationStructure(VkAccelerationStructureKHR acceStruct);
 
     [[nodiscard]] std::array<VkImageView, MAX_FRAMES_IN_FLIGHT> getOutImageViews() const;
+    const AllocatedImage& getCurrentOutImage() const;
+    //  the out image of the last frame, the history for the reprojection
+    const AllocatedImage& getPreviousOutImage() const;
+    const AllocatedImage& getCurrentSampleImage() const;
+    const AllocatedImage& getCurrentGeometryImage() const;
+    const AllocatedImage& getPreviousGeometryImage() const;
 
   protected:
     virtual BunnyResult initPipeline() override;
@@ -40,15 +55,27 @@ class RaytracingShadowPass : public PbrGraphicsPass
         VkDescriptorSet mObjectDescSet;
         VkDescriptorSet mMaterialDescSet;
         VkDescriptorSet mRtDataDescSet;
+        VkDescriptorSet mResolveDescSet;
 
-        AllocatedImage mOutImage;
+        AllocatedImage mOutImage;      //  resolved light bit field per pixel, read by the shading passes
+        AllocatedImage mSampleImage;   //  traced or reprojected light bit field, SHADOW_SAMPLE_REJECTED if neither
+        AllocatedImage mGeometryImage; //  normal and view depth of the primary hit, for rejecting the history
+    };
+
+    struct ReprojectionParams
+    {
+        glm::mat4 mPrevViewProj;
+        uint32_t mCheckerboardParity; //  pixels with (x + y) % 2 == parity are traced this frame
+        uint32_t mIsHistoryValid;
+        uint32_t mPadding[2];
     };
 
     BunnyResult buildPipelineLayout();
+    BunnyResult buildResolvePipelineLayout();
     BunnyResult buildRaytracingDescSetLayouts();
     BunnyResult buildShaderBindingTable();
     void queryRaytracingProperties();
-    void resetFrameImage() const;
+    const FrameData& getPreviousFrameData() const;
 
     AllocatedBuffer mShaderBindingTableBuffer;
     VkStridedDeviceAddressRegionKHR mRayGenRegion{};
@@ -59,14 +86,23 @@ class RaytracingShadowPass : public PbrGraphicsPass
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR mRaytracingProperties{
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR};
 
+    const FrameBufferSlice* mLightData = nullptr;
+    const FrameBufferSlice* mCameraData = nullptr;
+
     VertexIndexBufferData mVertIdxBufData;
     AllocatedBuffer mVertIdxBufBuffer;
 
-    //  buffer for resetting the frame out image
-    AllocatedBuffer mFrameImageResetBuffer;
+    ReprojectionParams mReprojectionParams{};
+    //  view projection of the last frame with its jitter, the primary rays of the history were traced through it
+    glm::mat4 mLastViewProj{1.0f};
+    uint32_t mFrameCount = 0;
+
+    VkPipeline mResolvePipeline = nullptr;
+    VkPipelineLayout mResolvePipelineLayout = nullptr;
 
     VkDescriptorSetLayout mObjectDescSetLayout;
     VkDescriptorSetLayout mRtDataDescSetLayout;
+    VkDescriptorSetLayout mResolveDescSetLayout;
 
     DescriptorAllocator mDescriptorAllocator;
     std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
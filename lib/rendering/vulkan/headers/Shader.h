@@ -7,10 +7,14 @@
 
 namespace Bunny::Render
 {
+class ShaderModuleCache;
+
 class Shader
 {
   public:
     Shader(std::string_view shaderPath, VkDevice device);
+    //  the module is owned by the cache and is not destroyed with this shader
+    Shader(std::string_view shaderPath, ShaderModuleCache* moduleCache);
     ~Shader();
 
     VkShaderModule getShaderModule() const { return mShaderModule; }
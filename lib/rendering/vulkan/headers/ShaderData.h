@@ -50,6 +50,65 @@ struct PbrLightData
     uint32_t mLightCount;
 };
 
+//  PBR clustered lights
+//  the point and spot lights are binned into view space clusters (froxels) by the light cluster pass
+//  and the shading only loops over the lights of the cluster of each fragment
+//  keep these in sync with lightCluster.glsl
+static constexpr uint32_t MAX_CLUSTERED_LIGHT_COUNT = 4096;
+static constexpr uint32_t LIGHT_CLUSTER_COUNT_X = 16;
+static constexpr uint32_t LIGHT_CLUSTER_COUNT_Y = 9;
+static constexpr uint32_t LIGHT_CLUSTER_COUNT_Z = 24; //  exponential slices between the near and far plane
+static constexpr uint32_t LIGHT_CLUSTER_COUNT = LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y * LIGHT_CLUSTER_COUNT_Z;
+static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+static constexpr uint32_t INVALID_SHADOW_IDX = ~0u;
+
+//  fft ocean cascades, spectra of different area widths that are summed into one ocean
+//  keep in sync with waveCascade.glsl
+static constexpr uint32_t WAVE_CASCADE_COUNT = 3;
+
+//  PbrLight prepared for the clustered shading, the spot cone is turned into a scale and offset of the cosine
+struct ClusteredLight
+{
+    glm::vec3 mPosition;
+    float mInfluenceRadius;
+    glm::vec3 mColor;
+    float mIntensity;
+    glm::vec3 mSpotDirection;
+    float mSpotScale;
+    float mSpotOffset;
+    LightType mType;
+    uint32_t mShadowIdx; //  bit in the raytraced shadow image, INVALID_SHADOW_IDX for no shadow
+    uint32_t mPadding;
+};
+
+//  followed by the ClusteredLight array in the light buffer
+struct ClusteredLightHeader
+{
+    uint32_t mLightCount;
+    uint32_t mPadding[3];
+};
+
+//  written by the light cluster pass, only the size is used on the cpu since it is too large for the stack
+struct LightClusterData
+{
+    //  slice = log(view depth) * scale + bias
+    float mSliceScale;
+    float mSliceBias;
+    uint32_t mPadding[2];
+    uint32_t mLightCounts[LIGHT_CLUSTER_COUNT];
+    uint32_t mLightIndices[LIGHT_CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER];
+};
+
+//  push constants of the light cluster pass
+struct LightClusterParams
+{
+    glm::mat4 mViewMat;
+    float mTanHalfFovX;
+    float mTanHalfFovY;
+    float mZNear;
+    float mZFar;
+};
+
 //  PBR
 struct PbrCameraData
 {
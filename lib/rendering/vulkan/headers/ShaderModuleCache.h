@@ -0,0 +1,50 @@
+#pragma once
+
+#include "BunnyResult.h"
+#include "MappedFile.h"
+
+#include <volk.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Bunny::Render
+{
+//  creates every shader module only once per content, shared by all passes
+//  shader code is taken from the memory mapped SPIR-V bundle written by compile_glsl_shaders
+//  and falls back to the loose .spv file when the shader is not in the bundle or the file is newer
+//  all functions except initialize() and cleanup() are thread safe
+class ShaderModuleCache
+{
+  public:
+    BunnyResult initialize(VkDevice device, std::string_view bundlePath);
+    void cleanup();
+
+    //  the returned module is owned by the cache and stays valid until cleanup()
+    VkShaderModule getShaderModule(std::string_view shaderPath);
+
+  private:
+    BunnyResult loadBundle(std::string_view bundlePath);
+    std::span<const std::byte> findShaderCode(
+        const std::filesystem::path& shaderPath, std::vector<std::byte>& fileBuffer) const;
+
+    VkDevice mDevice = VK_NULL_HANDLE;
+
+    Base::MappedFile mBundleFile;
+    std::filesystem::file_time_type mBundleWriteTime;
+    std::unordered_map<std::string, std::span<const std::byte>> mBundledShaders;
+
+    //  modules keyed by the hash of their SPIR-V code, so identical code loaded from different paths is shared
+    std::unordered_map<uint64_t, VkShaderModule> mShaderModules;
+    //  skip reading and hashing the code again when the same path is requested
+    std::unordered_map<std::string, VkShaderModule> mShaderModulesByPath;
+    std::mutex mMutex;
+};
+} // namespace Bunny::Render
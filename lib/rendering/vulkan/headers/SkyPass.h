@@ -18,8 +18,14 @@ namespace Bunny::Render
 class VulkanRenderResources;
 class VulkanGraphicsRenderer;
 class TextureBank;
+class CloudNoisePass;
 class Camera;
 
+//  the clouds are ray marched at half of the render resolution on each axis, one pixel of every 4 x 4 block a frame
+//  in a bayer pattern, the other pixels reproject the cloud history of the last frame
+//  draw() upsamples the clouds with the scene depth and composes them with the sky at the render resolution
+//  the noise volumes and the weather map are loaded from the baked textures, or taken from a CloudNoisePass
+//  that generates them on the gpu
 class SkyPass : public PbrGraphicsPass
 {
   public:
@@ -46,6 +52,7 @@ class SkyPass : public PbrGraphicsPass
         float mCloudRegionR1; //  the distance from the bottom of the cloud region to the center of the Earth
         float mCloudRegionR2; //  the distance from the top of the cloud region to the center of the Earth
         float mCloudRegionCy; //  the distance from center of the game world (0, 0, 0) to the center of the Earth
+        glm::vec2 mCloudResolution; //  the resolution of the cloud history, half of the render resolution
     };
 
     struct CloudRenderParams
@@ -60,20 +67,32 @@ class SkyPass : public PbrGraphicsPass
         glm::vec3 mCameraPosition;
 
         float mElapsedTime;
-        uint32_t mDitherIdx;
-        constexpr static uint32_t MAX_DITHER_COUNT = 4;
+        uint32_t mDitherIdx; //  the pixel of every block that is ray marched this frame, in the bayer order
+        uint32_t mIsHistoryValid;
+        constexpr static uint32_t MAX_DITHER_COUNT = 16; //  keep in sync with cloud.glsl
     };
 
     SkyPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
-        TextureBank* textureBank, std::string_view cloudShaderPath = "sky_comp.spv");
-
+        TextureBank* textureBank, const CloudNoisePass* cloudNoisePass = nullptr,
+        std::string_view cloudShaderPath = "sky_comp.spv",
+        std::string_view cloudMarchShaderPath = "cloud_march_comp.spv",
+        std::string_view cloudReprojectShaderPath = "cloud_reproject_comp.spv");
+
+    //  ray march one pixel of every block of the cloud history into the cloud sample image
+    void marchClouds() const;
+    //  run after marchClouds(), writes the cloud history from the marched samples and the history of the last frame
+    void reprojectClouds() const;
+    //  run after reprojectClouds(), writes the cloud and fog shadow textures at the render resolution
     void draw() const override;
-    void updateFrameData();
     void updateRenderParams(const Camera& camera, float elapsedTime);
-    void linkLightData(const AllocatedBuffer& lightData);
+    void linkLightData(const FrameBufferSlice& lightData);
 
     const AllocatedImage& getCurrentCloudTexture() const;
     const AllocatedImage& getCurrentFogShadowTexture() const;
+    const AllocatedImage& getCurrentCloudSampleImage() const;
+    const AllocatedImage& getCurrentCloudHistoryImage() const;
+    //  the cloud history of the last frame, read for temporal reprojection
+    const AllocatedImage& getPreviousCloudHistoryImage() const;
 
   protected:
     BunnyResult initPipeline() override;
@@ -85,59 +104,55 @@ class SkyPass : public PbrGraphicsPass
 
     struct FrameData
     {
-        //  because we want to have last frame cloud texture
-        //  we create two sets of descriptor sets
-        //  so they can bind there render target and last frame cloud texture
-        //  to different allocated images
-        //  this is not the same as multi frames in flight
-        //  because each frame in flight has two sets of desc sets
-        static constexpr int frameSequenceCount = 2;
-
-        struct DescSets
-        {
-            VkDescriptorSet mCloudDescSet;   //  contains cloud rendering data
-            VkDescriptorSet mTextureDescSet; //  contains texture images for render and render results
-        };
-        std::array<DescSets, frameSequenceCount> mDescriptors;
-
-        AllocatedImage mCloudTexture1;
-        AllocatedImage mCloudTexture2;
+        //  the two sets are allocated next to each other so they can be bound in one call
+        VkDescriptorSet mCloudDescSet;   //  contains cloud rendering data
+        VkDescriptorSet mTextureDescSet; //  contains texture images for render and render results
+
+        AllocatedImage mCloudTexture;      //  sky and clouds at the render resolution, read by the final output
         AllocatedImage mFogShadowTexture;
+        AllocatedImage mCloudSampleImage;  //  one ray marched pixel per block of the cloud history
+        AllocatedImage mCloudHistoryImage; //  light scattered by the clouds and their transmittance at half resolution
         const AllocatedImage* mDepthTexture = nullptr; //  depth image created in renderer
-        int mCurrentFrameSeqId = 0;
-
-        void advanceFrameInSequence() { mCurrentFrameSeqId = (mCurrentFrameSeqId + 1) % frameSequenceCount; }
-        const VkDescriptorSet* getCurrentDescSets() const { return &mDescriptors[mCurrentFrameSeqId].mCloudDescSet; }
-        const AllocatedImage& getCloudTexture() const;
     };
 
     BunnyResult initDescriptorLayouts();
+    const FrameData& getPreviousFrameData() const;
+    //  both sets, with the dynamic offsets of the light data and the render params
+    void bindDescriptorSets(VkCommandBuffer cmd, const FrameData& frame) const;
 
     TextureBank* mTextureBank;
+    const CloudNoisePass* mCloudNoisePass;
     std::string_view mCloudShaderPath;
+    std::string_view mCloudMarchShaderPath;
+    std::string_view mCloudReprojectShaderPath;
+
+    VkPipeline mCloudMarchPipeline = nullptr;
+    VkPipeline mCloudReprojectPipeline = nullptr;
 
     std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
 
     CloudData mCloudData;
-    CloudRenderParams mCloudRenderParams;
+    CloudRenderParams mCloudRenderParams{};
+    uint32_t mFrameCount = 0;
     AllocatedBuffer mCloudDataBuffer;
-    AllocatedBuffer mCloudRenderParamsBuffer;
+    //  the light data and the render params change every frame, they are in the frame buffer arena
+    const FrameBufferSlice* mLightData = nullptr;
+    FrameBufferSlice mCloudRenderParamsSlice;
 
     AllocatedImage mMainNoiseTexture;
     AllocatedImage mDetailNoiseTexture;
     AllocatedImage mBlueNoiseTexture;
-    AllocatedImage mWeatherNoiseTexture;
+    AllocatedImage mWeatherNoiseTexture; //  only the baked one, the generated ones are per frame in the CloudNoisePass
 
     VkDescriptorSetLayout mCloudDescSetLayout;
     VkDescriptorSetLayout mTextureDescSetLayout;
     DescriptorAllocator mDescriptorAllocator;
 
-    static constexpr uint32_t MAIN_CLOUD_NOISE_RESOLUTION = 128;
-    static constexpr uint32_t DETAIL_CLOUD_NOISE_RESOLUTION = 32;
     static constexpr uint32_t WEATHER_RESOLUTION = 256;
     static constexpr uint32_t BLUE_NOISE_RESOLUTION = 256;
     static constexpr uint32_t TEXTURE_2D_COUNT = 2;
     static constexpr uint32_t TEXTURE_3D_COUNT = 2;
+    static constexpr uint32_t CLOUD_BLOCK_SIZE = 4; //  keep in sync with cloud.glsl
 };
 
 } // namespace Bunny::Render
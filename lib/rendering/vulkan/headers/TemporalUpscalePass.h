@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Fundamentals.h"
+#include "Descriptor.h"
+#include "BunnyResult.h"
+
+#include <volk.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include <array>
+#include <string>
+
+namespace Bunny::Render
+{
+class VulkanRenderResources;
+class VulkanGraphicsRenderer;
+class TextureBank;
+class Camera;
+
+//  accumulates the jittered scene color of the render extent over frames into an image of the swap chain extent
+//  the history is reprojected with the depth and the camera motion, and clamped to the neighbourhood of the new sample
+class TemporalUpscalePass
+{
+  public:
+    TemporalUpscalePass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
+        const TextureBank* textureBank);
+
+    BunnyResult initializePass();
+    void cleanup();
+    //  the jitter for the camera of the next frame, in normalized device coordinates of the render extent
+    glm::vec2 advanceJitter();
+    //  call after the jitter is applied to the camera
+    void updateRenderParams(const Camera& camera);
+    void dispatch() const;
+
+    const AllocatedImage& getCurrentOutputImage() const;
+    //  the output of the last frame, the history for the reprojection
+    const AllocatedImage& getPreviousOutputImage() const;
+
+    ~TemporalUpscalePass();
+
+  private:
+    struct UpscaleParams
+    {
+        glm::mat4 mReprojection; //  from clip space of this frame to clip space of the last frame
+        glm::vec2 mJitterUv;
+        float mBlendFactor; //  weight of a new sample that hits the output pixel center
+        uint32_t mIsHistoryValid;
+    };
+
+    void initDescriptorSets();
+    BunnyResult initPipeline();
+    void createImages();
+
+    VkPipeline mPipeline = nullptr;
+    VkPipelineLayout mPipelineLayout = nullptr;
+
+    DescriptorAllocator mDescriptorAllocator;
+    VkDescriptorSetLayout mDescSetLayout = nullptr;
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> mDescSets;
+
+    std::array<AllocatedImage, MAX_FRAMES_IN_FLIGHT> mOutputImages;
+
+    UpscaleParams mParams{};
+    uint32_t mJitterIdx = 0;
+    uint32_t mFrameCount = 0;
+
+    const VulkanRenderResources* mVulkanResources = nullptr;
+    const VulkanGraphicsRenderer* mRenderer = nullptr;
+    const TextureBank* mTextureBank = nullptr;
+
+    std::string mUpscaleShaderPath{"./temporal_upscale_comp.spv"};
+
+    static constexpr uint32_t JITTER_SEQUENCE_LENGTH = 16;
+};
+} // namespace Bunny::Render
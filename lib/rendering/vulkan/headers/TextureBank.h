@@ -8,6 +8,7 @@
 #include <span>
 #include <string>
 #include <vector>
+#include <deque>
 #include <unordered_map>
 
 namespace Bunny::Render
@@ -15,20 +16,28 @@ namespace Bunny::Render
 
 class VulkanRenderResources;
 class VulkanGraphicsRenderer;
-class DescriptorWriter;
 
 class TextureBank
 {
   public:
+    //  Upper bound of the bindless texture array in the shader
+    //  the actual capacity is clamped to the device limits in initialize()
+    static constexpr uint32_t MAX_BINDLESS_TEXTURE_COUNT = 32768;
+
     TextureBank(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer);
 
     BunnyResult initialize();
     BunnyResult addTexture(const char* filePath, VkFormat format, IdType& outId);
     BunnyResult addTextureFromMemory(unsigned char* data, int dataLength, VkFormat, IdType& outId);
     BunnyResult addAllocatedTexture(const AllocatedImage& image, IdType& outId);
-    BunnyResult addTexture3d(
-        const char* filePath, VkFormat format, uint32_t width, uint32_t height, uint32_t depth, IdType& outId);
-    BunnyResult addDescriptorSetWrite(uint32_t binding, DescriptorWriter& outWriter) const;
+    //  load a 3d dds texture with the mips in the file, the format and the dimensions come from the file
+    BunnyResult addTexture3d(const char* filePath, IdType& outId);
+    //  the slot of a released texture is only reused after all frames that may use it have finished
+    BunnyResult releaseTexture(IdType id);
+    //  write only the texture slots changed since the last call to the bindless texture array
+    //  and recycle the slots that are no longer used by any frame in flight, call once per frame
+    void updateBindlessTextures(VkDescriptorSet descriptorSet, uint32_t binding);
+    uint32_t getBindlessTextureCapacity() const { return mBindlessTextureCapacity; }
     bool getTexture(IdType id, AllocatedImage& outTexture) const; //  return true when success, otherwise false
     const std::vector<AllocatedImage>& getAllTextures() const;
     bool getTexture3d(IdType id, AllocatedImage& outTexture) const; //  return true when success, otherwise false
@@ -38,14 +47,31 @@ class TextureBank
     void cleanup();
 
   private:
+    struct ReleasedTexture
+    {
+        IdType mId;
+        AllocatedImage mImage;
+        uint64_t mReleaseFrame;
+    };
+
     BunnyResult createSampler();
+    void queryBindlessTextureCapacity();
+    BunnyResult acquireTextureId(const AllocatedImage& texture, IdType& outId);
 
     const VulkanRenderResources* mVulkanResources;
     const VulkanGraphicsRenderer* mRenderer;
 
+    //  2D textures are indexed by their slot in the bindless texture array
     std::vector<AllocatedImage> mTextures;
+    std::vector<std::string> mTexturePaths;
+    std::vector<IdType> mFreeTextureIds;
+    std::vector<IdType> mDirtyTextureIds;
+    std::deque<ReleasedTexture> mReleasedTextures;
+    uint32_t mBindlessTextureCapacity = MAX_BINDLESS_TEXTURE_COUNT;
+    uint64_t mFrameCount = 0;
+
     std::vector<AllocatedImage> mTextures3d;
-    std::unordered_map<std::string_view, IdType> mTexturePathToIds;
+    std::unordered_map<std::string, IdType> mTexturePathToIds;
     VkSampler mImageSampler;
 };
 } // namespace Bunny::Render
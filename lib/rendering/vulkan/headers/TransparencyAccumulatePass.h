@@ -17,10 +17,19 @@ class TransparencyAccumulatePass : public PbrGraphicsPass
 
     void draw() const override;
 
-    void linkWorldData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData);
+    void linkWorldData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData);
+    //  the cluster buffers are written by the light cluster pass, one per frame in flight
+    void linkLightClusterData(const FrameBufferSlice& clusteredLightData,
+        const std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT>& clusterBuffers);
     void linkObjectData(const AllocatedBuffer& objectBuffer, const AllocatedBuffer& instObjectBuffer);
     void linkShadowData(std::array<VkImageView, MAX_FRAMES_IN_FLIGHT> shadowImageViews);
     void setDrawCommandsBuffer(const AllocatedBuffer& buffer);
+    //  the render targets only live within a frame, so they are owned by the frame graph
+    //  the multi sampled ones are only used if multi sample is enabled
+    void linkRenderTargets(const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& accumImages,
+        const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& revealImages,
+        const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& accumImagesMultiSampled,
+        const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& revealImagesMultiSampled);
 
     std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> getAccumulateImages() const;
     std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> getRevealImages() const;
@@ -40,14 +49,19 @@ class TransparencyAccumulatePass : public PbrGraphicsPass
         VkDescriptorSet mMaterialDescSet;
         VkDescriptorSet mEffectDescSet; // for shadows
 
-        AllocatedImage mAccumulateImageMultiSampled;
-        AllocatedImage mRevealageImageMultiSampled;
-        AllocatedImage mAccumulateImage;
-        AllocatedImage mRevealageImage;
+        const AllocatedImage* mAccumulateImageMultiSampled = nullptr;
+        const AllocatedImage* mRevealageImageMultiSampled = nullptr;
+        const AllocatedImage* mAccumulateImage = nullptr;
+        const AllocatedImage* mRevealageImage = nullptr;
     };
 
     const AllocatedBuffer* mDrawCommandsBuffer;
 
+    //  in the frame buffer arena, their offsets change every frame
+    const FrameBufferSlice* mLightData = nullptr;
+    const FrameBufferSlice* mCameraData = nullptr;
+    const FrameBufferSlice* mClusteredLightData = nullptr;
+
     std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
     DescriptorAllocator mDescriptorAllocator;
 
@@ -5,12 +5,18 @@
 #include "FunctionStack.h"
 #include "SwapChainSupportDetails.h"
 #include "BunnyGuard.h"
+#include "GpuProfiler.h"
+#include "FrameBufferArena.h"
+#include "Descriptor.h"
 
 #include <volk.h>
 
 #include <vector>
 #include <array>
+#include <cstddef>
+#include <mutex>
 #include <span>
+#include <string_view>
 
 namespace Bunny::Render
 {
@@ -54,13 +60,19 @@ class VulkanGraphicsRenderer
 
         bool mRenderBeginned = false;
 
+        //  the render extent, or the swap chain extent when drawing into the swap chain image
+        VkExtent2D mRenderArea{};
+
         const VulkanGraphicsRenderer* mRenderer = nullptr;
     };
     friend class RenderHelper;
 
     VulkanGraphicsRenderer(VulkanRenderResources* renderResources);
 
-    BunnyResult initialize(int multiSampleCount = 1);
+    //  headlessExtent is the size of the offscreen images when the render resources have no window
+    //  renderScale scales the render extent of the scene images relative to the swap chain extent
+    BunnyResult initialize(
+        int multiSampleCount = 1, VkExtent2D headlessExtent = {1280, 720}, float renderScale = 1.0f);
 
     void beginRenderFrame();
     void finishRenderFrame();
@@ -68,13 +80,63 @@ class VulkanGraphicsRenderer
     void finishImguiFrame();
     void finishImguiFrame(VkCommandBuffer commandBuffer, VkImageView targetImageView);
 
+    //  async compute, between beginAsyncCompute() and submitAsyncCompute() getCurrentCommandBuffer() returns
+    //  a command buffer of the compute queue, so compute passes record into it without knowing
+    bool isAsyncComputeEnabled() const { return mIsAsyncComputeEnabled; }
+    void beginAsyncCompute();
+    //  the compute commands wait for the semaphores in all stages
+    void submitAsyncCompute(std::span<const VkSemaphore> waitSemaphores, std::span<const VkSemaphore> signalSemaphores);
+    //  submit the graphics commands recorded so far and continue recording in a new command buffer
+    void submitGraphicsCommands(std::span<const VkSemaphore> signalSemaphores);
+    //  the next graphics submit waits for the semaphore
+    void addGraphicsWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stages);
+
+    //  parallel recording, every recording slot has a command pool per frame in flight, so several threads can
+    //  record graphics commands at once as long as each records into its own slot. call before the first frame
+    BunnyResult initRecordingSlots(uint32_t slotCount);
+    uint32_t getRecordingSlotCount() const { return mRecordingSlotCount; }
+    //  between them getCurrentCommandBuffer() returns the slot command buffer on the calling thread
+    VkCommandBuffer beginSlotCommandBuffer(uint32_t slotIdx);
+    void endSlotCommandBuffer();
+    //  end the current graphics command buffer and continue recording in a new one, the slot command buffers
+    //  are executed in between, in the given order, as part of the next graphics submit
+    void insertGraphicsCommandBuffers(std::span<const VkCommandBuffer> commandBuffers);
+
+    //  time the commands recorded between them into the current command buffer, on either queue
+    void beginGpuZone(std::string_view name);
+    void endGpuZone();
+    GpuProfiler& getGpuProfiler() { return mGpuProfiler; }
+
+    //  the passes write the data they rewrite every frame here, the arena is reset in beginRenderFrame(),
+    //  so it is written between beginRenderFrame() and finishRenderFrame()
+    FrameBufferArena& getFrameArena() const { return mFrameArena; }
+
+    //  the set for the layout and the resources of the writer, it is written only the first time the same
+    //  resources are asked for and shared with the other frames in flight, so it must not be updated
+    //  when the cache is full the set comes from the descriptor arena of the frame and is written every time
+    //  can be called from the recording threads of the frame graph
+    VkDescriptorSet getCachedDescriptorSet(VkDescriptorSetLayout layout, DescriptorWriter& writer) const;
+
+    //  headless only, copy every frame into a host visible buffer so it can be read back
+    void setFrameReadbackEnabled(bool enabled) { mIsFrameReadbackEnabled = enabled; }
+    //  wait for the last finished frame and copy its pixels out, in the swap chain image format
+    BunnyResult readbackLastFrame(std::vector<std::byte>& outPixels);
+
     void waitForRenderFinish();
     void cleanup();
     ~VulkanGraphicsRenderer();
 
     [[nodiscard]] RenderHelper getRenderHelper() const;
 
-    VkCommandBuffer getCurrentCommandBuffer() const { return mFrameResources.at(mCurrentFrameId).mCommandBuffer; }
+    VkCommandBuffer getCurrentCommandBuffer() const
+    {
+        if (msSlotCommandBuffer != VK_NULL_HANDLE)
+        {
+            return msSlotCommandBuffer;
+        }
+        const FrameRenderObject& frame = mFrameResources.at(mCurrentFrameId);
+        return frame.mIsRecordingCompute ? frame.mComputeCommandBuffer : frame.mCommandBuffer;
+    }
     uint32_t getCurrentFrameIdx() const { return mCurrentFrameId; }
     VkFormat getSwapChainImageFormat() const { return mSwapChainImageFormat; }
     VkFormat getDepthImageFormat() const { return mDepthImageFormat; }
@@ -87,18 +149,48 @@ class VulkanGraphicsRenderer
     {
         return mFrameResources[mCurrentFrameId].mMultiSampledColorImage;
     }
+    const AllocatedImage& getMultiSampledDepthImage() const { return mFrameResources[mCurrentFrameId].mDepthImage; }
     const AllocatedImage& getColorImageResolved() const { return mFrameResources[mCurrentFrameId].mColorImageResolved; }
+    const AllocatedImage& getColorImageResolved(uint32_t frameId) const
+    {
+        return mFrameResources[frameId].mColorImageResolved;
+    }
     VkExtent2D getSwapChainExtent() const { return mSwapChainExtent; }
+    //  the size of the color and depth images the scene is rendered into, the swap chain extent times the render scale
+    VkExtent2D getRenderExtent() const { return mRenderExtent; }
+    float getRenderScale() const { return mRenderScale; }
     VkSampleCountFlagBits getRenderMultiSampleCount() const { return mRenderMultiSampleCount; }
     bool isMultiSampleEnabled() const { return mRenderMultiSampleCount != VK_SAMPLE_COUNT_1_BIT; }
 
     VkImageMemoryBarrier getResolvedColorBarrier() const;
 
   private:
+    struct RecordingSlot
+    {
+        VkCommandPool mCommandPool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> mCommandBuffers;
+        uint32_t mUsedCommandBufferCount = 0;
+    };
+
     struct FrameRenderObject
     {
         VkCommandPool mCommandPool;
-        VkCommandBuffer mCommandBuffer;
+        VkCommandBuffer mCommandBuffer; //  the graphics command buffer being recorded
+        //  a frame is submitted in several parts when it hands work over to the compute queue
+        std::vector<VkCommandBuffer> mCommandBuffers;
+        uint32_t mUsedCommandBufferCount = 0;
+        //  ended but not submitted yet, go into the next graphics submit before mCommandBuffer
+        std::vector<VkCommandBuffer> mPendingCommandBuffers;
+        std::vector<RecordingSlot> mRecordingSlots;
+        std::vector<VkSemaphore> mWaitSemaphores;
+        std::vector<VkPipelineStageFlags> mWaitStages;
+
+        VkCommandPool mComputeCommandPool = VK_NULL_HANDLE;
+        VkCommandBuffer mComputeCommandBuffer = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> mComputeCommandBuffers;
+        uint32_t mUsedComputeCommandBufferCount = 0;
+        bool mIsRecordingCompute = false;
+
         VkSemaphore mSwapchainImageSemaphore;
         VkSemaphore mRenderFinishSemaphore;
         VkFence mFrameInflightFence;
@@ -107,6 +199,12 @@ class VulkanGraphicsRenderer
         AllocatedImage mColorImageResolved;
         AllocatedImage mDepthImage;
         AllocatedImage mDepthImageResolved;
+
+        //  headless only, the rendered image copied for the host
+        AllocatedBuffer mReadbackBuffer;
+
+        //  sets that live for one frame, reset after the fence of the frame is waited for
+        mutable DescriptorArena mDescriptorArena;
     };
 
     BunnyResult initSwapChain();
@@ -114,8 +212,21 @@ class VulkanGraphicsRenderer
     BunnyResult initColorResources();
     BunnyResult initDepthResource();
     BunnyResult initImgui();
+    BunnyResult initDescriptorCache();
+
+    VkCommandBuffer beginNextCommandBuffer(
+        VkCommandPool pool, std::vector<VkCommandBuffer>& commandBuffers, uint32_t& usedCount);
+    void beginGraphicsCommandBuffer(FrameRenderObject& frame);
+    void setDefaultDynamicStates(VkCommandBuffer cmdBuf);
+    static void setViewportAndScissor(VkCommandBuffer cmdBuf, VkExtent2D extent);
+    void updateRenderExtent();
+    void endAndSubmitGraphicsCommands(
+        FrameRenderObject& frame, std::span<const VkSemaphore> signalSemaphores, VkFence fence);
+    void finishHeadlessFrame(FrameRenderObject& frame);
 
     BunnyResult createSwapChain();
+    //  headless replacement of the swap chain, one image per frame in flight
+    BunnyResult createOffscreenImages();
     BunnyResult recreateSwapChain();
     void destroySwapChain();
 
@@ -137,10 +248,13 @@ class VulkanGraphicsRenderer
 
     VkSwapchainKHR mSwapChain;
     std::vector<VkImage> mSwapChainImages;
+    std::vector<AllocatedImage> mOffscreenImages; //  headless only, own the images in mSwapChainImages
     std::vector<VkImageView> mSwapChainImageViews;
     VkFormat mSwapChainImageFormat;
     VkExtent2D mSwapChainExtent;
     uint32_t mSwapchainImageIndex = 0;
+    float mRenderScale = 1.0f;
+    VkExtent2D mRenderExtent;
     VkFormat mDepthImageFormat;
 
     VkSampleCountFlagBits mMaxSupportedSampleCount = VK_SAMPLE_COUNT_1_BIT;
@@ -150,6 +264,22 @@ class VulkanGraphicsRenderer
     uint32_t mCurrentFrameId = 0;
 
     bool mFrameBufferResized = false;
+    bool mIsHeadless = false;
+    VkExtent2D mHeadlessExtent{};
+    bool mIsFrameReadbackEnabled = false;
+    bool mIsAsyncComputeEnabled = false;
+    uint32_t mRecordingSlotCount = 0;
+
+    //  the slot command buffer the calling thread records into, if any
+    static inline thread_local VkCommandBuffer msSlotCommandBuffer = VK_NULL_HANDLE;
+
+    GpuProfiler mGpuProfiler;
+    //  mutable since the passes only hold a const renderer, writing the frame data does not change the renderer
+    mutable FrameBufferArena mFrameArena;
+    //  cleared when the swap chain is recreated, the color and depth images in the cached sets are recreated with it
+    mutable DescriptorSetCache mDescriptorCache;
+    //  guards the cache and the descriptor arenas of the frames, the passes ask for sets on several threads
+    mutable std::mutex mDescriptorCacheMutex;
 
     Base::FunctionStack<> mDeletionStack;
 };
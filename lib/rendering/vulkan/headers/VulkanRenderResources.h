@@ -12,6 +12,10 @@
 #include <span>
 #include <functional>
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
 
 namespace Bunny::Base
 {
@@ -20,6 +24,8 @@ class Window;
 
 namespace Bunny::Render
 {
+class ShaderModuleCache;
+
 class VulkanRenderResources
 {
   public:
@@ -41,10 +47,12 @@ class VulkanRenderResources
         VkCommandBuffer mBuffer;
     };
 
+    //  without a window there is no surface and no present queue, the renderer draws to offscreen images
     BunnyResult initialize(Base::Window* window);
     void cleanup();
 
     Base::Window* getWindow() const { return mWindow; }
+    bool isHeadless() const { return mIsHeadless; }
     VkInstance getInstance() const { return mInstance; }
     VkSurfaceKHR getSurface() const { return mSurface; }
     VkPhysicalDevice getPhysicalDevice() const { return mPhysicalDevice; }
@@ -53,21 +61,31 @@ class VulkanRenderResources
     const Queue& getPresentQueue() const { return mPresentQueue; }
     const Queue& getComputeQueue() const { return mComputeQueue; }
     const Queue& getTransferQueue() const { return mTransferQueue; }
+    VkPipelineCache getPipelineCache() const { return mPipelineCache; }
+    ShaderModuleCache* getShaderModuleCache() const { return mShaderModuleCache.get(); }
 
     BunnyResult createBufferWithData(const void* data, VkDeviceSize size, VkBufferUsageFlags bufferUsage,
         VmaAllocationCreateFlags vmaCreateFlags, VmaMemoryUsage vmaUsage, AllocatedBuffer& outBuffer,
         VkDeviceSize minAlignment = 0) const;
+    //  with mip offsets the data holds the whole mip chain, every level is tightly packed at its offset
     BunnyResult createImageWithData(void* data, VkDeviceSize dataSize, VkExtent3D imageExtent, VkFormat format,
         VkImageUsageFlags usage, VkImageAspectFlags aspectFlags, VkImageLayout layout, AllocatedImage& outImage,
-        bool is3d = false) const;
+        bool is3d = false, uint32_t arrayLayers = 1, std::span<const VkDeviceSize> mipOffsets = {}) const;
 
     AllocatedBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags bufferUsage,
         VmaAllocationCreateFlags vmaCreateFlags, VmaMemoryUsage vmaUsage, VkDeviceSize minAlignment = 0) const;
     AllocatedImage createImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage,
         VkImageAspectFlags aspectFlags, bool is3d = false, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED,
-        uint32_t mipCount = 1, VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT) const;
+        uint32_t mipCount = 1, VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT,
+        uint32_t arrayLayers = 1) const; //  more than 1 layer gives a 2d array view
     void destroyBuffer(AllocatedBuffer& buffer) const;
+    //  make gpu writes to a mapped buffer visible to the host, needed for memory that is not host coherent
+    void invalidateMappedBuffer(const AllocatedBuffer& buffer) const;
     void destroyImage(AllocatedImage& image) const;
+    //  raw device local memory for placing several resources in, e.g. aliased transient images
+    BunnyResult allocateMemory(const VkMemoryRequirements& requirements, VmaAllocation& outAllocation) const;
+    BunnyResult bindImageMemory(VkImage image, VmaAllocation allocation, VkDeviceSize offset) const;
+    void freeMemory(VmaAllocation& allocation) const;
     void copyBuffer(VkCommandBuffer cmd, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const;
     void transitionBufferAccess(VkCommandBuffer cmd, VkBuffer buffer, VkAccessFlags srcAccessMask,
         VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) const;
@@ -90,15 +108,24 @@ class VulkanRenderResources
     //  https://registry.khronos.org/vulkan/specs/latest/man/html/VkPhysicalDeviceProperties2.html#VUID-VkPhysicalDeviceProperties2-pNext-pNext
     VkPhysicalDeviceProperties getPhysicalDeviceProperties(void* properties) const;
 
+    //  write the pipeline cache to disk so that the next launch does not need to recompile the pipelines
+    //  this is also done automatically in cleanup()
+    BunnyResult savePipelineCache() const;
+
     bool getSupportMeshShader() const { return mSupportMeshShader; }
+    bool getSupportPushDescriptor() const { return mSupportPushDescriptor; }
+    bool getSupportPipelineStatistics() const { return mSupportPipelineStatistics; }
 
     ~VulkanRenderResources();
 
   private:
     BunnyResult getQueueFromDevice(Queue& queue, const vkb::Device& device, vkb::QueueType queueType) const;
     BunnyResult createImmediateCommand();
+    BunnyResult createPipelineCache();
+    bool loadPipelineCacheData(std::vector<std::byte>& outData) const;
 
     Base::Window* mWindow = nullptr;
+    bool mIsHeadless = false;
     VkInstance mInstance = VK_NULL_HANDLE;
 #ifdef _DEBUG
     VkDebugUtilsMessengerEXT mDebugMessenger = VK_NULL_HANDLE;
@@ -118,9 +145,18 @@ class VulkanRenderResources
 
     VmaAllocator mAllocator = nullptr;
 
+    //  shared by all pipeline builders, persisted on disk between launches
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    std::string mPipelineCacheFilePath{"./pipeline_cache.bin"};
+
+    std::unique_ptr<ShaderModuleCache> mShaderModuleCache;
+    std::string mShaderBundleFilePath{"./shaders.spvbundle"};
+
     //  deletion stack
     Base::FunctionStack<> mDeletionStack;
 
     bool mSupportMeshShader = false;
+    bool mSupportPushDescriptor = false;
+    bool mSupportPipelineStatistics = false;
 };
 } // namespace Bunny::Render
@@ -4,10 +4,12 @@
 #include "Fundamentals.h"
 #include "PbrGraphicsPass.h"
 #include "ShaderData.h"
+#include "OceanSimulation.h"
 
 #include <glm/vec2.hpp>
 
 #include <array>
+#include <span>
 #include <string_view>
 
 namespace Bunny::Render
@@ -15,17 +17,45 @@ namespace Bunny::Render
 class WaveSpectrumPrePass : public PbrGraphicsPass
 {
   public:
+    struct CascadeData
+    {
+        float width;         //  the horizontal dimension of the wave grid area of the cascade, in meters
+        float minWavenumber; //  band of |k| kept in the cascade
+        float maxWavenumber;
+        float padding;
+    };
+
     struct WaveSpectrumData
     {
         glm::vec2 wind; //  wind vector
-        float width;    //  the horizontal dimension of the whole wave grid area, in meters
         int N;          //  size of the spectrum (in one dimension)
         float A;        //  Phillips spectrum magnitude coefficient
+        CascadeData cascades[WAVE_CASCADE_COUNT];
     };
 
+    //  the cascades from the largest to the smallest, AREA_WIDTH is the primary one the ocean grid is built for
+    //  the small cascades add detail and the large one adds swell without a larger fft
+    static constexpr float SWELL_AREA_WIDTH = 512.0f;
     static constexpr float AREA_WIDTH = 102.4f;
+    static constexpr float DETAIL_AREA_WIDTH = 24.0f;
     static constexpr int GRID_N = 256;
 
+    //  a cascade hands the waves over to the next smaller one when that one tiles at least this many of them,
+    //  so every wave is only added once and is always sampled by at least about 8 texels
+    static constexpr float CASCADE_BAND_WAVE_COUNT = 6.0f;
+    static constexpr float SWELL_MAX_WAVENUMBER = 2 * 3.14159265359f * CASCADE_BAND_WAVE_COUNT / AREA_WIDTH;
+    static constexpr float PRIMARY_MAX_WAVENUMBER = 2 * 3.14159265359f * CASCADE_BAND_WAVE_COUNT / DETAIL_AREA_WIDTH;
+
+    //  the cpu ocean simulation built from these params gives the same waves
+    static constexpr std::array<Physics::OceanSpectrumParams, WAVE_CASCADE_COUNT> CASCADE_PARAMS{{
+        {.mAreaWidth = SWELL_AREA_WIDTH, .mGridN = GRID_N, .mSeed = 20240228,
+            .mMaxWavenumber = SWELL_MAX_WAVENUMBER},
+        {.mAreaWidth = AREA_WIDTH, .mGridN = GRID_N, .mSeed = 20240229, .mMinWavenumber = SWELL_MAX_WAVENUMBER,
+            .mMaxWavenumber = PRIMARY_MAX_WAVENUMBER},
+        {.mAreaWidth = DETAIL_AREA_WIDTH, .mGridN = GRID_N, .mSeed = 20240301,
+            .mMinWavenumber = PRIMARY_MAX_WAVENUMBER},
+    }};
+
     WaveSpectrumPrePass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
         std::string_view shaderPath = "wave_spectrum_comp.spv");
 
@@ -34,6 +64,8 @@ class WaveSpectrumPrePass : public PbrGraphicsPass
     const AllocatedImage& getSpectrumImage() const { return mSpectrumImage; }
     const float getWidth() const { return AREA_WIDTH; }
     const int getGridN() const { return GRID_N; }
+    std::array<float, WAVE_CASCADE_COUNT> getCascadeWidths() const;
+    std::span<const Physics::OceanSpectrumParams> getCascadeParams() const { return CASCADE_PARAMS; }
 
     //  transition the spectrum image for viewing
     void prepareSpectrumImageForView();
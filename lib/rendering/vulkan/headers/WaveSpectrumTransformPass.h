@@ -4,10 +4,13 @@
 #include "Fundamentals.h"
 #include "PbrGraphicsPass.h"
 #include "ShaderData.h"
+#include "OceanSimulation.h"
 
 #include <glm/vec2.hpp>
 
 #include <array>
+#include <optional>
+#include <span>
 #include <string_view>
 
 namespace Bunny::Render
@@ -18,8 +21,8 @@ class WaveSpectrumTransformPass : public PbrGraphicsPass
     struct TimedSpectrumParams
     {
         float mTime;
-        float mWidth;
-        uint32_t mN; //  size of the sequence
+        uint32_t mN;                       //  size of the sequence
+        float mWidths[WAVE_CASCADE_COUNT]; //  area width of every cascade
     };
 
     struct FFTParams
@@ -27,7 +30,7 @@ class WaveSpectrumTransformPass : public PbrGraphicsPass
         uint32_t mN;         //  size of the sequence
         uint32_t mIsInverse; //  0: forward fft, 1: inversed fft
         uint32_t mDirection; //  0: fft on row, 1: fft on column
-        uint32_t iteration;  //  currenct iteration, should be between 0 and log2(N);
+        uint32_t mLog2N;
     };
 
     struct WaveParams
@@ -36,22 +39,34 @@ class WaveSpectrumTransformPass : public PbrGraphicsPass
     };
 
     WaveSpectrumTransformPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
-        uint32_t size, float width, std::string_view spectrumShaderPath = "wave_time_spectrum_comp.spv",
-        std::string_view bitReverseShaderPath = "fft_bit_reverse_comp.spv",
-        std::string_view fftPingPongShaderPath = "fft_ping_pong_comp.spv",
+        uint32_t size, std::span<const float, WAVE_CASCADE_COUNT> widths,
+        std::string_view spectrumShaderPath = "wave_time_spectrum_comp.spv",
+        std::string_view fftShaderPath = "fft_stockham_comp.spv",
         std::string_view waveConstructShaderPath = "wave_construct_comp.spv");
 
     void draw() const override;
 
     void updateWaveTime(float time);
-    void updateWidth(uint32_t size, float width);
+    void updateWidth(uint32_t size, std::span<const float, WAVE_CASCADE_COUNT> widths);
     void updateSpectrumImage(const AllocatedImage* spectrumImage);
 
-    //  transition the timed spectrum and fft transformed image for viewing
-    void prepareCurrentFrameImagesForView();
-    const AllocatedImage& getHeightImage() const;
+    //  the spectra are only used within the pass, so the image is owned by the frame graph
+    //  one layer per spectrum: timed, slope, displacement and displacement slope, transformed in place
+    //  the spectra of all cascades are in the same image, cascade after cascade, so one fft transforms all of them
+    static constexpr uint32_t SPECTRUM_LAYER_COUNT = 4;
+    static constexpr uint32_t CASCADE_SPECTRUM_LAYER_COUNT = SPECTRUM_LAYER_COUNT * WAVE_CASCADE_COUNT;
+    //  the fft keeps a whole line in shared memory, see fftStockham.comp
+    static constexpr uint32_t MAX_FFT_SIZE = 1024;
+    void linkSpectrumImage(uint32_t frameIdx, const AllocatedImage* spectrumImages);
+
+    //  2d arrays with one layer per cascade
     const AllocatedImage& getWaveDisplacementImage() const;
-    const AllocatedImage& getWaveNormalImage() const;
+    //  the slopes after the displacement, unlike normals the slopes of the cascades can be summed
+    const AllocatedImage& getWaveSlopeImage() const;
+
+    //  reads the wave displacement back and compares it with a cpu ocean simulation of the same cascades,
+    //  updated to the time of the frame, slow, for debugging only
+    void enableValidation(std::span<const Physics::OceanSpectrumParams> cascades);
 
   protected:
     BunnyResult initPipeline() override;
@@ -63,68 +78,64 @@ class WaveSpectrumTransformPass : public PbrGraphicsPass
     struct FrameData
     {
         const AllocatedImage* mSpectrumImage;
-
-        AllocatedImage mTimedSpectrumPing;
-        AllocatedImage mTimedSpectrumPong;
-        AllocatedImage mSlopeSpectrumPing;
-        AllocatedImage mSlopeSpectrumPong;
-        AllocatedImage mDisplaceSpectrumPing;
-        AllocatedImage mDisplaceSpectrumPong;
-        AllocatedImage mDisplaceSlopeSpectrumPing;
-        AllocatedImage mDisplaceSlopeSpectrumPong;
+        const AllocatedImage* mTimedSpectrumImages; //  2d array, CASCADE_SPECTRUM_LAYER_COUNT layers
 
         AllocatedImage mWaveDisplacementImage;
-        AllocatedImage mWaveNormalImage;
+        AllocatedImage mWaveSlopeImage;
         //  self intersection image?
-
-        bool mIsOutputToImagePong; //  now all images have same dimension so can share the same mIsOutputToImagePong
-        mutable DescriptorAllocator mDescriptorAllocator;
     };
 
     BunnyResult initDescriptorLayouts();
 
     void computeTimedSpectrum() const;
 
-    //  perform 2D fast fourier transform on input image
+    //  perform 2D fast fourier transform on all layers of the image in place
     //  isInverse: indicates whether to perform fft or inverse fft
-    //  isOutputToBuffer: the fft/ifft is performed using two images in a ping-pong way,
-    //                    so the result can be in the inputImage or in the bufferImage
-    //                    depending on the size of the image
-    //                    (which determines the number of iterations).
-    //                    Therefore, to retrieve the result,
-    //                    check isOutputToBuffer afterwards to see where the result is.
-    //                    if true, output is bufferImage, otherwise output is inputImage
-    void fastFourierTransform(const AllocatedImage& inputImage, const AllocatedImage& bufferImage, uint32_t N,
-        bool isInverse, bool& isOutputToBuffer) const;
-    void fastFourierTransformOneDir(const AllocatedImage& inputImage, const AllocatedImage& bufferImage, uint32_t N,
-        uint32_t direction, bool isInverse, bool& isOutputToBuffer) const;
+    void fastFourierTransform(const AllocatedImage& spectrumImages, bool isInverse) const;
+    //  one dispatch for all lines of all layers in one direction
+    void fastFourierTransformOneDir(VkDescriptorSet fftDescSet, uint32_t direction, bool isInverse) const;
+
+    //  e^(-2 pi i t / N), the fft looks the twiddle factors up instead of evaluating them per butterfly
+    BunnyResult createTwiddleImage();
 
     void constructWave() const;
 
+    void readBackWaveDisplacement() const;
+    void validateWaveDisplacement(uint32_t frameIdx) const;
+
     void showImguiControlPanel();
 
     VkPipelineLayout mSpectrumPipelineLayout;
     VkPipeline mSpectrumPipeline;
-    VkPipelineLayout mBitReversePipelineLayout;
-    VkPipeline mBitReversePipeline;
     VkPipelineLayout mWaveConstructPipelineLayout;
     VkPipeline mWaveConstructPipeline;
 
     std::string_view mTimedSpectrumShaderPath;
-    std::string_view mBitReverseShaderPath;
     std::string_view mFftShaderPath;
     std::string_view mWaveConstructShaderPath;
 
     mutable std::array<FrameData, MAX_FRAMES_IN_FLIGHT> mFrameData;
 
     VkDescriptorSetLayout mTimedSpectrumDescLayout;
-    VkDescriptorSetLayout mImageDescLayout;
+    VkDescriptorSetLayout mFftDescLayout;
     VkDescriptorSetLayout mWaveConstructDescLayout;
 
     TimedSpectrumParams mTimedSpectrumParams;
     mutable FFTParams mFFTParams{.mIsInverse = 1};
+    AllocatedImage mTwiddleImage;
     WaveParams mWaveParams{.mU = 1.0f};
 
     bool mFreezeWaveTime = false;
+
+    //  validation
+    struct ValidationFrame
+    {
+        AllocatedBuffer mReadbackBuffer;
+        float mTime = 0;
+        float mDisplacementScale = 1.0f;
+        bool mHasResult = false;
+    };
+    mutable std::optional<Physics::OceanSimulation> mValidationSimulation;
+    mutable std::array<ValidationFrame, MAX_FRAMES_IN_FLIGHT> mValidationFrames;
 };
 } // namespace Bunny::Render
@@ -0,0 +1,354 @@
+//  shared by the cloud march, the cloud reprojection and the sky compose shaders
+
+#include "pbrCommon.glsl"
+
+#define CLOUD_MAIN_NOISE_TEX_ID 0
+#define CLOUD_DETAIL_NOISE_TEX_ID 1
+#define BLUE_NOISE_TEX_ID 0
+#define WEATHER_NOISE_TEX_ID 1
+
+//  keep in sync with SkyPass.h
+//  the cloud history is split into blocks of 4 x 4 pixels, one pixel of every block is ray marched each frame
+#define CLOUD_BLOCK_SIZE 4
+#define MAX_DITHER_COUNT 16
+
+layout(set = 0, binding = 0) uniform LightData
+{
+    Light lights[MAX_LIGHT_COUNT];
+    uint lightCount;
+};
+
+layout(set = 0, binding = 1) uniform CloudData
+{
+	vec3 cloudNoiseDimension;
+    float cloudCoverage;
+	vec3 detailNoiseDimension;
+	float lightMarchStepSize;
+	vec2 renderResolution;
+    vec2 cloudRegionMinXZ;
+    vec2 cloudRegionMaxXZ;
+	float g1;   //  henyey greestein coefficient
+	float g2;
+	float extinctionCoef;
+	float scatteringCoef;
+	float densityModifier;
+	float minRayMarchStepSize;
+	float zNear;
+	float zFar;
+	float detailErodeModCoef;
+	float lodStartDistance;
+	float lodStageLength;
+	float cloudRegionR1;    //  the distance from the bottom of the cloud region to the center of the Earth
+	float cloudRegionR2;    //  the distance from the top of the cloud region to the center of the Earth
+	float cloudRegionCy;    //  the distance from center of the game world (0, 0, 0) to the center of the Earth
+	vec2 cloudResolution;   //  the resolution of the cloud history, half of the render resolution
+};
+
+layout(set = 0, binding = 2) uniform RenderData
+{
+    mat4 prevViewProj;    //  view projection matrix of previous frame
+
+    vec4 cameraFrameWorldTL;    //  top left
+    vec4 cameraFrameWorldTR;    //  top right
+    vec4 cameraFrameWorldBL;    //  bottom left
+    vec4 cameraFrameWorldBR;    //  bottom right
+
+    vec3 cameraPosition;
+
+    float elapsedTime;
+    uint ditherIdx;     //  the pixel of every block that is ray marched this frame, in the bayer order
+    uint isHistoryValid;
+};
+
+layout(set = 1, binding = 0) uniform sampler3D textures3D[];
+layout(set = 1, binding = 1) uniform sampler2D textures2D[];
+layout(set = 1, binding = 2) uniform sampler2D sceneDepthTexture;
+
+//  the pixels of a block in the order of a 4 x 4 bayer matrix, consecutive frames march pixels far from each other
+const ivec2 BAYER_OFFSETS[MAX_DITHER_COUNT] = {
+    ivec2(0, 0), ivec2(2, 2), ivec2(2, 0), ivec2(0, 2),
+    ivec2(1, 1), ivec2(3, 3), ivec2(3, 1), ivec2(1, 3),
+    ivec2(1, 0), ivec2(3, 2), ivec2(3, 0), ivec2(1, 2),
+    ivec2(0, 1), ivec2(2, 3), ivec2(2, 1), ivec2(0, 3)
+};
+
+float saturate(float val)
+{
+	return clamp(val, 0, 1);
+}
+
+bool isPointInsideSphere(vec3 posWorld, vec3 C, bool insideAboveCloud)
+{
+	float d = length(posWorld - C);
+	float lowerBound = -1500;
+	if (insideAboveCloud) {
+		lowerBound = 0;
+	}
+	return d < cloudRegionR2 && d > cloudRegionR1 && posWorld.y > lowerBound;
+}
+
+//	light ray intersection with cloud region
+//	only check intersection with outer sphere since a light ray always starts in between
+//	not always correct when sun is near horizion but lets just take it for now
+float lightRayCloudRegionIntersection(vec3 rayOrigin, vec3 rayDir, float r, vec3 C)
+{
+	vec3 L = rayOrigin - C;
+	float a = dot(rayDir, rayDir);
+	float b = 2 * dot(rayDir, L);
+	float c = dot(L, L) - r * r;
+	float discr = b * b - 4 * a * c;
+	if (discr > 0)
+	{
+		float q = -0.5f * (b + sign(b) * sqrt(discr));
+		float t = max(q / a, c / q);
+		return t;
+	}
+	return 0.0f;
+}
+
+//	view ray intersection with cloud region
+vec2 rayCloudRegionIntersection(vec3 rayOrigin, vec3 rayDir, float r1, float r2, float Cy)
+{
+	//	if the rayOrigin is above the sphere and looking upwards
+	//	or the rayOrigin is below the horizon and looking downwards
+	//	then there is no chance of intersection
+	if ((rayOrigin.y > r2 - Cy && rayDir.y > 0))
+	{
+		return vec2(0.0f, 0.0f);
+	}
+
+	//	ray sphere intersection
+	//	compute a, b, c
+	float a = dot(rayDir, rayDir);
+	float b = 2 * (rayOrigin.y + Cy) * rayDir.y;
+	float b2 = b * b;
+	float L2 = (Cy + rayOrigin.y) * (Cy + rayOrigin.y);
+	float c1 = L2 - r1 * r1;
+	float c2 = L2 - r2 * r2;
+
+	vec2 t1 = vec2(0.0f, 0.0f);
+	vec2 t2 = vec2(0.0f, 0.0f);
+
+	//	solve 2 quadratic equations
+	//	use the implementation from https://www.scratchapixel.com/lessons/3d-basic-rendering/minimal-ray-tracer-rendering-simple-shapes/ray-sphere-intersection
+	//	to avoid catastropic cancellation
+
+	//	outer sphere
+	float discr2 = b2 - 4 * a * c2;
+	if (discr2 > 0)
+	{
+		float q = -0.5f * (b + sign(b) * sqrt(discr2));
+		t2 = vec2(q / a, c2 / q);
+		if (t2.x > t2.y)
+		{
+			t2 = t2.yx;
+		}
+	}
+	else
+	{
+		return vec2(0.0, 0.0f);
+	}
+	//	inner sphere
+	float discr1 = b2 - 4 * a * c1;
+	if (discr1 > 0)
+	{
+		float q = -0.5f * (b + sign(b) * sqrt(discr1));
+		t1 = vec2(q / a, c1 / q);
+		if (t1.x > t1.y)
+		{
+			t1 = t1.yx;
+		}
+	}
+
+	float rayGroundDstAboveGround;
+	if (rayDir.y < 0) 
+	{
+		rayGroundDstAboveGround = -rayOrigin.y / rayDir.y;
+	}
+	else
+	{
+		//	some really big number
+		rayGroundDstAboveGround = 4000000;
+	}
+	
+	if (rayOrigin.y > r2 - Cy)
+	{
+		if (t2.x > 0)
+		{
+			return vec2(t2.x, 1.0f);
+		}
+	}
+	else if (rayOrigin.y > r1 - Cy)
+	{
+		return vec2(0.0f, 1.0f);
+	}
+	else
+	{
+		vec3 p1 = rayOrigin + rayDir * t1.y;
+		if (p1.y > -1500)
+		{
+			return vec2(t1.y, 1.0f);
+		}
+	}
+	return vec2(0.0f, 0.0f);
+}
+
+//	Henyey-Greenstein
+float henyey(float cosTheta, float g)
+{
+	float g2 = g * g;
+	return (1 - g2) / (4 * 3.1415 * pow(1 + g2 - 2 * g * cosTheta, 1.5f));
+}
+
+float phase(float cosTheta)
+{
+	float p = (henyey(cosTheta, g1) + henyey(cosTheta, g2) + 0.07958) / 3.0f;
+	return p;
+}
+
+float remap(float v, float x0, float y0, float x1, float y1)
+{
+	return x1 + ((v - x0) / (y0 - x0)) * (y1 - x1);
+}
+
+float getNormalizedHeightSphere(vec3 posWorld, vec3 C, float r1, float r2)
+{
+	float d = length(posWorld - C);
+	return (d - r1) / (r2 - r1);
+}
+
+vec3 computeCloudTexCoordSphere(vec3 posWorld, vec3 C, float r1, float r2)
+{
+	float textureScale = cloudNoiseDimension.y / (r2 - r1);
+	float normalizedHeight = getNormalizedHeightSphere(posWorld, C, r1, r2);
+	return vec3(posWorld.x / cloudNoiseDimension.x * textureScale, normalizedHeight, posWorld.z / cloudNoiseDimension.z * textureScale) + elapsedTime * 0.01;
+	// return vec3(posWorld.x / cloudNoiseDimension.x * textureScale, normalizedHeight, posWorld.z / cloudNoiseDimension.z * textureScale);
+}
+
+vec3 computeDetailTexCoordSphere(vec3 posWorld)
+{
+	// return 0.1 * posWorld / detailNoiseDimension.xyz;
+	return 0.1 * posWorld / detailNoiseDimension.xyz + elapsedTime * 0.05f;
+}
+
+vec2 computeWeatherTexCoordSphere(vec3 posWorld)
+{
+	// return posWorld.xz / (cloudRegionMaxXZ - cloudRegionMinXZ);
+	return posWorld.xz / (cloudRegionMaxXZ - cloudRegionMinXZ) + elapsedTime * 0.005f;
+}
+
+float recoverLinearDepth(float nonLinearDepth)
+{
+    //  check zNear and zFar direction
+	return -(zNear * zFar) / ((zFar - zNear) * nonLinearDepth - zFar);
+}
+
+vec2 sampleCloudDensityLOD2(vec3 posWorld, vec3 cloudTexCoord, vec2 weatherMapCoord, float viewDistance, float normalizedHeight, vec3 C, bool insideAboveCloud)
+{
+	if (!isPointInsideSphere(posWorld, C, insideAboveCloud))
+	{
+		return vec2(0, 0);
+	}
+	float lodLevel = max((viewDistance - lodStartDistance), 0) / lodStageLength;
+	//	the lod walks down the mip chain baked into the noise volume
+    vec2 shape = textureLod(textures3D[CLOUD_MAIN_NOISE_TEX_ID], cloudTexCoord, lodLevel).xy;
+	float shapeFBM = mix(shape.x, shape.y, remap(normalizedHeight, 0, 0.5, 0.4, 1.0));
+
+	if (shapeFBM > 0)
+	{
+		float weatherTex = textureLod(textures2D[WEATHER_NOISE_TEX_ID], weatherMapCoord, lodLevel).x;
+		float lowLevel = remap(weatherTex.x, 0.1f, 1.0f, 0.6f, 0.95f);
+		float bottomLevel = remap(weatherTex.x, 0.0f, 1.0f, 0.2f, 0.05f);
+		
+
+		float heightNormalCoef = 0
+			+ saturate(remap(normalizedHeight, 0.0f, lowLevel, 1.0f, 0.0f))
+			* saturate(remap(normalizedHeight, 0.0f, bottomLevel, 0.0f, 1.0f))
+			;
+
+		float heightModCoef = saturate(heightNormalCoef) * remap(normalizedHeight, 0.0f, 1.0f, 0.2f, 1.0f);
+
+		float coverageModCoef = 1 - (1 - weatherTex) * (1 - weatherTex);
+		float result1 = heightModCoef * coverageModCoef * shapeFBM;
+		float result2 = heightModCoef * coverageModCoef * shape.x;
+
+		float detailFBM = textureLod(textures3D[CLOUD_DETAIL_NOISE_TEX_ID], computeDetailTexCoordSphere(posWorld), 0).x;
+
+		float oneMinusShape = clamp(1 - result1, 0, 1);
+		float detailErodeWeight = oneMinusShape * oneMinusShape;
+		detailErodeWeight *= normalizedHeight * normalizedHeight * (1 - normalizedHeight);
+		float detailErode = clamp((1 - detailFBM) * detailErodeWeight * detailErodeModCoef, 0, 1);
+
+		result1 = max(densityModifier * (result1 - detailErode * clamp(remap(cloudCoverage, 0.99, 1.0, 1.0, 0.1), 0, 1)), 0);
+		result2 = max(densityModifier * (result2 - detailErode * clamp(remap(cloudCoverage, 0.99, 1.0, 1.0, 0.1), 0, 1)), 0);
+		result1 = max(0, result1 - 1 + cloudCoverage);
+		return vec2(result1, result2);
+	}
+	return vec2(0, 0);
+}
+
+// Calculate proportion of light that reaches the given point from the lightsource
+float lightMarch(vec3 position, vec3 lightDir, float viewDistance,  float cosTheta, vec3 C, vec2 texCoord, bool insideAboveCloud)
+{
+	const int maxLmSteps = 5;
+	const float constInset = 0.1f;
+	float transmittance = 1.0f;
+	float lastDensity = 0;
+	float cumulatedDensity = 0;
+	float lightMarchedDistance = 0;
+
+	vec3 cloudTexCoord = computeCloudTexCoordSphere(position, C, cloudRegionR1, cloudRegionR2);
+	vec2 weatherTexCoord = computeWeatherTexCoordSphere(position);
+	float normalizedHeight = getNormalizedHeightSphere(position, C, cloudRegionR1, cloudRegionR2);
+	float initNormalizedHeight = normalizedHeight;
+	float currentDensity = sampleCloudDensityLOD2(position, cloudTexCoord, weatherTexCoord, viewDistance, normalizedHeight, C, insideAboveCloud).x;
+	float currentStepSize;
+
+	for (int s = 0; s < maxLmSteps; s++)
+	{
+		currentStepSize = lightMarchStepSize + s * 150;
+		
+		position += lightDir * currentStepSize;
+
+		if (!isPointInsideSphere(position, C, insideAboveCloud))
+		{
+			break;
+		}
+
+		lightMarchedDistance += currentStepSize;
+		lastDensity = currentDensity;
+
+		cloudTexCoord = computeCloudTexCoordSphere(position, C, cloudRegionR1, cloudRegionR2);
+		weatherTexCoord = computeWeatherTexCoordSphere(position);
+		normalizedHeight = getNormalizedHeightSphere(position, C, cloudRegionR1, cloudRegionR2);
+
+		currentDensity = sampleCloudDensityLOD2(position, cloudTexCoord, weatherTexCoord, viewDistance, normalizedHeight, C, insideAboveCloud).x;
+		cumulatedDensity += (lastDensity + currentDensity) * extinctionCoef * currentStepSize / 2.0f;
+	}
+
+	//	multi scattering approximation
+	//	push light deeper into the cloud
+	//	when looking away from the sun
+	float normalTrans = exp(-cumulatedDensity);
+	float pushedTrans = exp(-cumulatedDensity * 0.4) * 0.5;
+	float furtherTrans = exp(-cumulatedDensity * 0.02) * 0.2;
+	transmittance = max(max(normalTrans, pushedTrans), furtherTrans);
+
+	return transmittance;
+}
+
+//  the pixel of the cloud history ray marched for the block this frame
+//  blocks on the border of the history may be cut off, they march their last pixel instead
+ivec2 getMarchedPixel(ivec2 block)
+{
+	return min(block * CLOUD_BLOCK_SIZE + BAYER_OFFSETS[ditherIdx], ivec2(cloudResolution) - 1);
+}
+
+//  the view ray from the camera through the texture coordinate of the screen, its length is 1 along the view direction
+vec3 getViewRay(vec2 texCoord)
+{
+	vec3 posWorld = cameraFrameWorldTL.xyz +
+		texCoord.x * (cameraFrameWorldTR.xyz - cameraFrameWorldTL.xyz) +
+		texCoord.y * (cameraFrameWorldBL.xyz - cameraFrameWorldTL.xyz);
+	return posWorld - cameraPosition;
+}
@@ -0,0 +1,121 @@
+//  tiling noise for generating the cloud volumes and the weather map
+//  every noise takes the position in cells and the period in cells, the cells are wrapped by the period
+//  so a volume of period cells across tiles seamlessly
+
+//  keep in sync with CloudNoisePass::NoiseParams
+layout(push_constant) uniform NoiseParams
+{
+	uint resolution;
+	uint period;		//	cells of the lowest octave across the tile
+	uint seed;
+	uint octaveCount;
+	uint rowOffset;		//	first row of the weather map updated by the dispatch
+	float evolveTime;	//	offset of the weather map along the third axis of the noise
+};
+
+//	https://jcgt.org/published/0009/03/02/
+uvec3 pcg3d(uvec3 v)
+{
+	v = v * 1664525u + 1013904223u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	v ^= v >> 16u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	return v;
+}
+
+//	random point in [0, 1)^3 for the cell, the neighbour cells looked up are never below -1
+vec3 hashCell(ivec3 cell, ivec3 cellPeriod, uint cellSeed)
+{
+	uvec3 wrapped = uvec3(cell + cellPeriod) % uvec3(cellPeriod);
+	return vec3(pcg3d(wrapped + uvec3(cellSeed, cellSeed * 3u, cellSeed * 7u)) >> 8u) / 16777216.0;
+}
+
+float gradientDot(ivec3 cell, ivec3 corner, vec3 fraction, ivec3 cellPeriod, uint cellSeed)
+{
+	vec3 gradient = hashCell(cell + corner, cellPeriod, cellSeed) * 2.0 - 1.0;
+	return dot(gradient, fraction - vec3(corner));
+}
+
+//	gradient noise in about [-1, 1]
+float perlinNoise(vec3 p, ivec3 cellPeriod, uint cellSeed)
+{
+	ivec3 cell = ivec3(floor(p));
+	vec3 f = fract(p);
+	vec3 u = f * f * f * (f * (f * 6.0 - 15.0) + 10.0);
+
+	float x00 = mix(gradientDot(cell, ivec3(0, 0, 0), f, cellPeriod, cellSeed),
+		gradientDot(cell, ivec3(1, 0, 0), f, cellPeriod, cellSeed), u.x);
+	float x10 = mix(gradientDot(cell, ivec3(0, 1, 0), f, cellPeriod, cellSeed),
+		gradientDot(cell, ivec3(1, 1, 0), f, cellPeriod, cellSeed), u.x);
+	float x01 = mix(gradientDot(cell, ivec3(0, 0, 1), f, cellPeriod, cellSeed),
+		gradientDot(cell, ivec3(1, 0, 1), f, cellPeriod, cellSeed), u.x);
+	float x11 = mix(gradientDot(cell, ivec3(0, 1, 1), f, cellPeriod, cellSeed),
+		gradientDot(cell, ivec3(1, 1, 1), f, cellPeriod, cellSeed), u.x);
+	return mix(mix(x00, x10, u.y), mix(x01, x11, u.y), u.z);
+}
+
+//	distance to the closest feature point, one point per cell, in about [0, 1]
+float worleyNoise(vec3 p, ivec3 cellPeriod, uint cellSeed)
+{
+	ivec3 cell = ivec3(floor(p));
+	vec3 f = fract(p);
+
+	float minDistSq = 1.0;
+	for (int z = -1; z <= 1; z++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				ivec3 neighbour = ivec3(x, y, z);
+				vec3 diff = vec3(neighbour) + hashCell(cell + neighbour, cellPeriod, cellSeed) - f;
+				minDistSq = min(minDistSq, dot(diff, diff));
+			}
+		}
+	}
+	return sqrt(minDistSq);
+}
+
+//	every octave doubles the cells across the tile, so all of them tile, in [0, 1]
+float perlinFbm(vec3 uvw, uint basePeriod, uint octaves, ivec3 periodScale)
+{
+	float sum = 0;
+	float amplitude = 1;
+	float amplitudeSum = 0;
+	uint octavePeriod = basePeriod;
+	for (uint octave = 0; octave < octaves; octave++)
+	{
+		ivec3 cellPeriod = ivec3(octavePeriod) * periodScale;
+		sum += perlinNoise(uvw * float(octavePeriod), cellPeriod, seed + octave) * amplitude;
+		amplitudeSum += amplitude;
+		amplitude *= 0.5;
+		octavePeriod *= 2u;
+	}
+	return clamp(sum / amplitudeSum * 0.5 + 0.5, 0.0, 1.0);
+}
+
+//	inverted worley, round billows with the highest value at the feature points, in [0, 1]
+float worleyFbm(vec3 uvw, uint basePeriod, uint octaves)
+{
+	float sum = 0;
+	float amplitude = 1;
+	float amplitudeSum = 0;
+	uint octavePeriod = basePeriod;
+	for (uint octave = 0; octave < octaves; octave++)
+	{
+		sum += (1.0 - worleyNoise(uvw * float(octavePeriod), ivec3(octavePeriod), seed + octave)) * amplitude;
+		amplitudeSum += amplitude;
+		amplitude *= 0.5;
+		octavePeriod *= 2u;
+	}
+	return clamp(sum / amplitudeSum, 0.0, 1.0);
+}
+
+float remapNoise(float value, float oldMin, float oldMax, float newMin, float newMax)
+{
+	return newMin + (value - oldMin) / (oldMax - oldMin) * (newMax - newMin);
+}
@@ -0,0 +1,62 @@
+//  clustered point and spot lights, include after pbr.glsl
+//  the light cluster pass bins the lights into froxels, each fragment only shades the lights of its cluster
+
+layout(std430, set = WORLD_SET, binding = 2) readonly buffer ClusteredLightData
+{
+    uint clusteredLightCount;
+    uint clusteredLightPad0;
+    uint clusteredLightPad1;
+    uint clusteredLightPad2;
+    ClusteredLight clusteredLights[];
+};
+
+layout(std430, set = WORLD_SET, binding = 3) readonly buffer LightClusterData
+{
+    float clusterSliceScale;
+    float clusterSliceBias;
+    uint clusterPad0;
+    uint clusterPad1;
+    uint clusterLightCounts[LIGHT_CLUSTER_COUNT];
+    uint clusterLightIndices[LIGHT_CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER];
+};
+
+uint getLightClusterIdx(vec2 fragCoord, vec3 fragPos)
+{
+    uvec2 tile = uvec2(fragCoord / cameraData.resolution * vec2(LIGHT_CLUSTER_COUNT_X, LIGHT_CLUSTER_COUNT_Y));
+    tile = min(tile, uvec2(LIGHT_CLUSTER_COUNT_X - 1, LIGHT_CLUSTER_COUNT_Y - 1));
+
+    //  the camera looks at -z in view space
+    float viewDepth = dot(fragPos - cameraData.position, -cameraData.inverseView[2].xyz);
+    float slice = log(max(viewDepth, 1e-4)) * clusterSliceScale + clusterSliceBias;
+    uint sliceIdx = uint(clamp(slice, 0.0, LIGHT_CLUSTER_COUNT_Z - 1));
+
+    return tile.x + tile.y * LIGHT_CLUSTER_COUNT_X + sliceIdx * LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y;
+}
+
+//  shadowBits: the raytraced shadow image of the fragment, one bit per light of the light uniform buffer
+vec3 calculateClusteredLighting(PbrSurface surface, vec3 fragPos, vec3 viewDir, uint shadowBits)
+{
+    uint clusterIdx = getLightClusterIdx(gl_FragCoord.xy, fragPos);
+    uint clusterLightCount = clusterLightCounts[clusterIdx];
+    uint firstIndex = clusterIdx * MAX_LIGHTS_PER_CLUSTER;
+
+    vec3 lightResult = vec3(0, 0, 0);
+    for (uint i = 0; i < clusterLightCount; i++)
+    {
+        ClusteredLight light = clusteredLights[clusterLightIndices[firstIndex + i]];
+
+        vec3 posToLight = light.position - fragPos;
+        vec3 lightDir = normalize(posToLight);
+        float attenuation = getSquareFalloffAttenuation(posToLight, 1.0 / light.influenceRadius);
+        if (light.type == SPOT)
+        {
+            attenuation *= getSpotAngleAttenuation(lightDir, light.spotDirection, light.spotScale, light.spotOffset);
+        }
+
+        bool isInShadow = light.shadowIdx < MAX_LIGHT_COUNT && (shadowBits & (1u << light.shadowIdx)) != 0;
+        float shadowCoef = isInShadow ? 0.5 : 1.0;
+        vec3 lightIntensity = light.intensity * attenuation * light.color;
+        lightResult += shadowCoef * shadeSurface(surface, lightDir, viewDir, lightIntensity);
+    }
+    return lightResult;
+}
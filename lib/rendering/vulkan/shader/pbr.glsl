@@ -126,16 +126,31 @@ float getSquareFalloffAttenuation(vec3 posToLight, float invRadius)
     return (smoothFactor * smoothFactor) / max(distanceSquare, 1e-4);
 }
 
-//  mostly based on the implementation in Filament: https://google.github.io/filament/Filament.html
-vec4 calculateLighting(PbrMaterial material, Light light, vec3 fragPos, vec3 viewDir, vec3 normalFromVtx, mat3 tbnMatrix, vec2 texCoord)
+//  lightDir: from the fragment to the light
+float getSpotAngleAttenuation(vec3 lightDir, vec3 spotDirection, float spotScale, float spotOffset)
+{
+    float attenuation = clamp(dot(-lightDir, spotDirection) * spotScale + spotOffset, 0.0, 1.0);
+    return attenuation * attenuation;
+}
+
+//  material parameters after the texture lookups, shared by all lights of a fragment
+struct PbrSurface
+{
+    vec3 baseColor;
+    float alpha;
+    vec3 normal;
+    float metallic;
+    float roughness;
+    float reflectance;
+};
+
+PbrSurface getPbrSurface(PbrMaterial material, vec3 normalFromVtx, mat3 tbnMatrix, vec2 texCoord)
 {
     vec4 baseColor = material.baseColor;
     vec4 emissiveColor = material.emissiveColor;
     vec3 normal = normalFromVtx;
     float metallic = material.metallic;
     float roughness = material.roughness;
-    float reflectance = material.reflectance;
-    float ambientOcclusion = material.ambientOcclusion;
 
     if (material.normalTexId != INVALID_ID)
     {
@@ -162,25 +177,44 @@ vec4 calculateLighting(PbrMaterial material, Light light, vec3 fragPos, vec3 vie
         roughness = roughness * metalRoughness.y;
     }
 
-    vec3 lightDir = light.type == DIRECTIONAL ? -light.dirOrPos : normalize(light.dirOrPos - fragPos);
+    return PbrSurface(baseColor.rgb, baseColor.a, normal, metallic, roughness, material.reflectance);
+}
 
-    vec3 f = brdf(baseColor.rgb, normal, lightDir, viewDir, metallic, roughness, reflectance);
+//  lightIntensity: color times illuminance (dir light) or luminous power with attenuation (point/spot light)
+vec3 shadeSurface(PbrSurface surface, vec3 lightDir, vec3 viewDir, vec3 lightIntensity)
+{
+    vec3 f = brdf(surface.baseColor, surface.normal, lightDir, viewDir, surface.metallic, surface.roughness,
+                  surface.reflectance);
+    float ndotl = clamp(dot(surface.normal, lightDir), 0.0, 1.0);
+    return f * lightIntensity * ndotl;
+}
+
+//  mostly based on the implementation in Filament: https://google.github.io/filament/Filament.html
+vec4 calculateLighting(PbrMaterial material, Light light, vec3 fragPos, vec3 viewDir, vec3 normalFromVtx, mat3 tbnMatrix, vec2 texCoord)
+{
+    PbrSurface surface = getPbrSurface(material, normalFromVtx, tbnMatrix, texCoord);
+
+    vec3 lightDir = light.type == DIRECTIONAL ? -light.dirOrPos : normalize(light.dirOrPos - fragPos);
 
     //  calculate luminance
-    float ndotl = clamp(dot(normal, lightDir), 0.0, 1.0);
     vec3 outLuminance;
     if (light.type == DIRECTIONAL)
     {
-        float illuminance = light.intensity * ndotl;
-        outLuminance = f * illuminance * light.color;
+        outLuminance = shadeSurface(surface, lightDir, viewDir, light.intensity * light.color);
     }
-    else if (light.type == POINT)
+    else
     {
         vec3 posToLight =  light.dirOrPos - fragPos;
         float attenuation = getSquareFalloffAttenuation(posToLight, 1.0 / light.influenceRadius);
-        outLuminance = f * light.intensity * attenuation * ndotl * light.color;
+        if (light.type == SPOT)
+        {
+            float cosOuter = cos(light.outerAngle);
+            float spotScale = 1.0 / max(cos(light.innerAngle) - cosOuter, 1e-4);
+            attenuation *= getSpotAngleAttenuation(lightDir, light.spotDirection, spotScale, -cosOuter * spotScale);
+        }
+        outLuminance = shadeSurface(surface, lightDir, viewDir, light.intensity * attenuation * light.color);
     }
 
     //  camera exposure will be applied with all light results combined
-    return vec4(outLuminance, baseColor.a);
+    return vec4(outLuminance, surface.alpha);
 }
\ No newline at end of file
@@ -1,7 +1,16 @@
 #define DIRECTIONAL 0
 #define POINT 1
+#define SPOT 2
 #define MAX_LIGHT_COUNT 8
 
+//  clustered lights, keep in sync with ShaderData.h
+#define MAX_CLUSTERED_LIGHT_COUNT 4096
+#define LIGHT_CLUSTER_COUNT_X 16
+#define LIGHT_CLUSTER_COUNT_Y 9
+#define LIGHT_CLUSTER_COUNT_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y * LIGHT_CLUSTER_COUNT_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+
 #define PI 3.14159265359
 
 #define INVALID_ID 114514
@@ -15,6 +24,22 @@ struct Light
     float innerAngle;
     float outerAngle;   
     uint type;
+    vec3 spotDirection;
+};
+
+//  point or spot light of the clustered light buffer
+struct ClusteredLight
+{
+    vec3 position;
+    float influenceRadius;
+    vec3 color;
+    float intensity;
+    vec3 spotDirection;
+    float spotScale;    //  spot angle attenuation = saturate(cos angle * scale + offset)
+    float spotOffset;
+    uint type;
+    uint shadowIdx;     //  bit in the raytraced shadow image
+    uint padding;
 };
 
 //  parameters: https://google.github.io/filament/Filament.html#materialsystem/parameterization
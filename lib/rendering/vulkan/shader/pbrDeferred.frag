@@ -1,6 +1,7 @@
 #version 460
 
 #include "pbr.glsl"
+#include "lightCluster.glsl"
 
 //  gbuffer images
 layout(set = 1, binding = 0) uniform sampler2D colorMap;
@@ -21,9 +22,21 @@ void main()
 
     uint lightCountCapped = min(lightCount, MAX_LIGHT_COUNT);
     vec3 lightResult = vec3(0, 0, 0);
-    // for (uint i = 0; i < lightCountCapped; i++)
-    // {
-    //     lightResult += calculateLighting(materialInstances[0], lights[0], fragPos, normalize(cameraData.position - fragPos), normal, uv);
-    // }
+
+    //  the gbuffer has no material id yet, and the normal is already in world space
+    PbrSurface surface = getPbrSurface(materialInstances[0], normal, mat3(1), texCoord);
+    surface.normal = normal;
+    vec3 viewDir = normalize(cameraData.position - fragPos);
+
+    for (uint i = 0; i < lightCountCapped; i++)
+    {
+        if (lights[i].type == DIRECTIONAL)
+        {
+            lightResult += shadeSurface(surface, -lights[i].dirOrPos, viewDir, lights[i].intensity * lights[i].color);
+        }
+    }
+    //  no raytraced shadow image in the deferred path
+    lightResult += calculateClusteredLighting(surface, fragPos, viewDir, 0);
+    lightResult *= cameraData.exposure;
     outColor = vec4(lightResult, 1);
 }
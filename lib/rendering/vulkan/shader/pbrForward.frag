@@ -1,6 +1,7 @@
 #version 460
 
 #include "pbr.glsl"
+#include "lightCluster.glsl"
 
 layout (location = 0) in vec3 normal;
 layout (location = 1) in vec3 fragPos;
@@ -21,14 +22,21 @@ void main()
     uvec4 lightShadowInfo = imageLoad(lightShadowMap, ivec2(gl_FragCoord.xy));
 
     mat3 tbnMat = mat3(tangent, bitangent, normal);
+    PbrSurface surface = getPbrSurface(materialInstances[matId], normal, tbnMat, uv);
+    vec3 viewDir = normalize(cameraData.position - fragPos);
 
+    //  only the directional lights, the point and spot lights come from the light clusters
     for (uint i = 0; i < lightCountCapped; i++)
     {
+        if (lights[i].type != DIRECTIONAL)
+        {
+            continue;
+        }
         float shadowCoef = (lightShadowInfo.r & (shadowBit << i)) > 0 ? 0.5 : 1.0;
-        vec4 pbrLightCalcResult = calculateLighting(materialInstances[matId], lights[i], fragPos, 
-                                            normalize(cameraData.position - fragPos), normal, tbnMat, uv);
-        lightResult += shadowCoef * pbrLightCalcResult.xyz;
+        lightResult += shadowCoef * shadeSurface(surface, -lights[i].dirOrPos, viewDir, 
+                                                 lights[i].intensity * lights[i].color);
     }
+    lightResult += calculateClusteredLighting(surface, fragPos, viewDir, lightShadowInfo.r);
     lightResult *= cameraData.exposure;
     outColor = vec4(lightResult, 1);
 }
\ No newline at end of file
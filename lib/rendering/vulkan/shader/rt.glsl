@@ -3,4 +3,13 @@ struct LightHitInfo
     //  a bit field containing the info of which lights hit this point
     //  the n-th bit set to 1 == the n-th light hits this point
     uint lights;
+    //  only half of the pixels trace the shadow rays each frame, the rest reproject the last frame
+    bool shouldTraceShadows;
+    //  the primary hit, used for reprojection, negative distance if nothing is hit
+    float hitDistance;
+    vec3 normal;
 };
+
+//  a sample that neither traced nor found a valid history, filled in from its neighbours in the resolve
+//  the light bits only use the lowest MAX_LIGHT_COUNT bits
+#define SHADOW_SAMPLE_REJECTED (1u << 31)
@@ -5,16 +5,18 @@
 #define WORLD_SET 2
 #define MATERIAL_SET 3
 #include "pbr.glsl"
+#include "waveCascade.glsl"
 
-layout(set = 1, binding = 0) uniform sampler2D waveDisplacementTex;
-layout(set = 1, binding = 1) uniform sampler2D waveNormalTex;
+//  one layer per cascade
+layout(set = 1, binding = 0) uniform sampler2DArray waveDisplacementTex;
+layout(set = 1, binding = 1) uniform sampler2DArray waveSlopeTex;
 
 //  top level acceleration structure for ray traced shadow
 layout(set = 4, binding = 0) uniform accelerationStructureEXT topLevelAcceStruct;
 
-// layout(location = 0) in vec3 normal;
-layout(location = 0) in vec2 texCoord;
-layout(location = 1) in vec3 fragPos;
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec4 cascadeWeights;
+layout(location = 2) in vec2 cascadeTexCoords[CASCADE_COUNT];
 
 layout(location = 0) out vec4 outColor;
 
@@ -23,25 +25,25 @@ layout(push_constant) uniform WavePushParams
     uint materialIdx;
 };
 
-vec3 getWaveDisplacement(vec2 normalizedWorldPosXZ)
+//  the slopes of the cascades add up like their heights, the normal is built from the sum
+//  no branch on the weights, the implicit derivatives of the sampling need uniform control flow
+vec3 getWaveNormal()
 {
-    return texture(waveDisplacementTex, normalizedWorldPosXZ).xyz;
-}
+    vec2 slope = vec2(0);
+    for (uint cascade = 0; cascade < CASCADE_COUNT; cascade++)
+    {
+        slope += cascadeWeights[cascade] * texture(waveSlopeTex, vec3(cascadeTexCoords[cascade], cascade)).xy;
+    }
 
-vec3 getWaveNormal(vec2 normalizedWorldPosXZ)
-{
-    vec3 norm = texture(waveNormalTex, normalizedWorldPosXZ).xyz;
-    return norm * 2.0 - 1.0;
-    // return norm;
+    return normalize(vec3(-slope.x, 1, -slope.y));
 }
 
 void main()
 {
     vec3 lightResult = vec3(0, 0, 0);
 
-    vec3 normal = getWaveNormal(texCoord);
+    vec3 normal = getWaveNormal();
     // outColor = vec4(normal, 1.0);
-    // outColor = vec4(texCoord.x, texCoord.y, 0, 1);
     uint lightCountCapped = min(lightCount, MAX_LIGHT_COUNT);
 
     for (uint i = 0; i < lightCountCapped; i++)
@@ -0,0 +1,19 @@
+//  shared by the ocean shaders, the spectra of every cascade are stored as layers of the wave images
+
+//  keep in sync with ShaderData.h
+#define CASCADE_COUNT 3
+
+//  a small cascade fades out between these distances to the camera, in its area widths
+//  further away its waves are smaller than a pixel and only alias, the largest cascade (0) is never faded
+#define CASCADE_FADE_START 4.0
+#define CASCADE_FADE_END 8.0
+
+float getCascadeWeight(uint cascade, float cascadeWidth, float distToCamera)
+{
+    if (cascade == 0)
+    {
+        return 1.0;
+    }
+
+    return 1.0 - smoothstep(CASCADE_FADE_START * cascadeWidth, CASCADE_FADE_END * cascadeWidth, distToCamera);
+}
@@ -0,0 +1,60 @@
+//  shared by the ocean task and mesh shaders
+
+#include "waveCascade.glsl"
+
+//  keep in sync with OceanPass.h
+#define PATCH_VERTEX_COUNT_X 8
+#define PATCH_VERTEX_COUNT_Y 8
+//  a node of every lod level is a patch of (8-1) x (8-1) cells, the cells of level n are 2^n times as wide as level 0
+#define PATCH_CELL_COUNT 7
+#define LOD_COUNT 8
+//  nodes per axis of each level around the camera, covers the lod range of the level with any camera position
+#define LOD_WINDOW_SIZE 16
+#define TASK_THREAD_SIZE_X 8
+#define TASK_THREAD_SIZE_Y 8
+//  where a level starts morphing into the next one, between the range of the level below and its own range
+#define MORPH_START_RATIO 0.8
+
+struct Plane
+{
+    vec3 normal;            //  plane normal, should be normalized
+    float distToOrigin;     //  distance from plane to the origin point
+};
+
+layout(set = 0, binding = 0) uniform WaveFieldParams
+{
+    vec2 gridOrigin;    //  the position of the (0, 0) point in the grid
+    float gridCellWidth;    //  the distance between two ajacent vertices in the wave grid of level 0
+    float displacementBound;    //  the max distance a vertex can be displaced by the waves, for the bounding boxes
+    uint patchCount;    //  number of level 0 patches on each axis of the ocean
+    vec4 cascadeWidths;     //  the width of the wave area of every cascade, tiled from the world origin
+                            //  note that this does not necessarily equal to gridCellWidth * number of grid cells
+};
+
+layout(set = 0, binding = 1) uniform WorldParams
+{
+    mat4 mvpMatrix;
+    //  mat4 invTransModel;     //  for now always unit matrix
+    Plane frustumPlanes[6];
+    vec3 cameraPosition;
+    float elapsedTime;
+    vec4 lodRanges[LOD_COUNT / 4];  //  distance to the camera where each level is fully morphed into the next one
+    float deltaTime;
+};
+
+//  the nodes of one lod level that pass the culling, one mesh shader work group each
+struct WaveTaskPayload
+{
+    uint lod;
+    uint nodes[TASK_THREAD_SIZE_X * TASK_THREAD_SIZE_Y];    //  x in the low 16 bits, y in the high 16 bits
+};
+
+float getLodRange(uint lod)
+{
+    return lodRanges[lod / 4][lod % 4];
+}
+
+float getNodeWidth(uint lod)
+{
+    return gridCellWidth * PATCH_CELL_COUNT * float(1 << lod);
+}
@@ -0,0 +1,339 @@
+#include "CloudNoisePass.h"
+
+#include "Error.h"
+#include "ErrorCheck.h"
+#include "Helper.h"
+#include "Shader.h"
+#include "VulkanRenderResources.h"
+#include "VulkanGraphicsRenderer.h"
+#include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+namespace Bunny::Render
+{
+CloudNoisePass::CloudNoisePass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
+    std::string_view shapeShaderPath, std::string_view detailShaderPath, std::string_view weatherShaderPath)
+    : super(vulkanResources, renderer, nullptr, nullptr),
+      mShapeShaderPath(shapeShaderPath),
+      mDetailShaderPath(detailShaderPath),
+      mWeatherShaderPath(weatherShaderPath)
+{
+}
+
+BunnyResult CloudNoisePass::generateNoise()
+{
+    VkCommandBuffer cmd = mVulkanResources->startImmedidateCommand();
+    if (cmd == nullptr)
+    {
+        return BUNNY_SAD;
+    }
+
+    recordVolume(cmd, mPipeline, mMainNoiseDescSet, MAIN_NOISE_SETTINGS, mMainNoiseImage);
+    recordVolume(cmd, mDetailPipeline, mDetailNoiseDescSet, DETAIL_NOISE_SETTINGS, mDetailNoiseImage);
+
+    //  the whole weather maps at the start time
+    NoiseParams weatherParams = makeNoiseParams(WEATHER_SETTINGS);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mWeatherPipeline);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoiseParams), &weatherParams);
+    constexpr static uint32_t weatherComputeSize = 16;
+    const uint32_t weatherGroupCount = (WEATHER_SETTINGS.mResolution + weatherComputeSize - 1) / weatherComputeSize;
+    std::array<VkImageMemoryBarrier, MAX_FRAMES_IN_FLIGHT> weatherBarriers;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        vkCmdBindDescriptorSets(
+            cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mWeatherDescSets[idx], 0, nullptr);
+        vkCmdDispatch(cmd, weatherGroupCount, weatherGroupCount, 1);
+
+        //  sampled by the clouds and copied by the next frame
+        weatherBarriers[idx] = makeImageMemoryBarrier(mWeatherImages[idx].mImage, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(weatherBarriers.size()), weatherBarriers.data());
+
+    return mVulkanResources->endAndSubmitImmediateCommand();
+}
+
+void CloudNoisePass::draw() const
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    const uint32_t frameIdx = mRenderer->getCurrentFrameIdx();
+    const AllocatedImage& weatherImage = mWeatherImages[frameIdx];
+    const AllocatedImage& previousWeatherImage = getPreviousWeatherImage();
+
+    //  the rows outside of the band are the ones of the last frame
+    VkImageCopy copyRegion{
+        .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .extent = weatherImage.mExtent,
+    };
+    vkCmdCopyImage(cmd, previousWeatherImage.mImage, VK_IMAGE_LAYOUT_GENERAL, weatherImage.mImage,
+        VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+
+    VkImageMemoryBarrier copyBarrier = makeImageMemoryBarrier(weatherImage.mImage, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &copyBarrier);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mWeatherPipeline);
+    vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mWeatherDescSets[frameIdx], 0, nullptr);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoiseParams), &mWeatherParams);
+
+    constexpr static uint32_t computeSize = 16;
+    vkCmdDispatch(cmd, (WEATHER_SETTINGS.mResolution + computeSize - 1) / computeSize,
+        (WEATHER_ROWS_PER_FRAME + computeSize - 1) / computeSize, 1);
+
+    //  the weather images are synchronized with the cloud passes reading them by the frame graph
+}
+
+const AllocatedImage& CloudNoisePass::getCurrentWeatherImage() const
+{
+    return mWeatherImages[mRenderer->getCurrentFrameIdx()];
+}
+
+const AllocatedImage& CloudNoisePass::getPreviousWeatherImage() const
+{
+    return mWeatherImages[(mRenderer->getCurrentFrameIdx() + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+}
+
+void CloudNoisePass::updateWeather(float elapsedTime)
+{
+    //  the bands go down the map, every band is generated at the time it is reached
+    mWeatherParams = makeNoiseParams(WEATHER_SETTINGS);
+    mWeatherParams.mRowOffset = (mWeatherFrameCount * WEATHER_ROWS_PER_FRAME) % WEATHER_SETTINGS.mResolution;
+    mWeatherParams.mEvolveTime = elapsedTime * WEATHER_EVOLVE_SPEED;
+    mWeatherFrameCount++;
+}
+
+BunnyResult CloudNoisePass::initPipeline()
+{
+    VkDevice device = mVulkanResources->getDevice();
+
+    //  the three shaders share the layout, one storage image and the noise params
+    VkPushConstantRange pushConstRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(NoiseParams)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mDescSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstRange;
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &mPipelineLayout))
+    mDeletionStack.AddFunction(
+        [this]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), mPipelineLayout, nullptr); });
+
+    mDeletionStack.AddFunction([this]() {
+        VkDevice device = mVulkanResources->getDevice();
+        vkDestroyPipeline(device, mPipeline, nullptr);
+        vkDestroyPipeline(device, mDetailPipeline, nullptr);
+        vkDestroyPipeline(device, mWeatherPipeline, nullptr);
+    });
+
+    auto enqueueBuild = [this, device](std::string_view shaderPath, VkPipeline& pipeline) {
+        return PipelineCompileQueue::enqueue([this, device, shaderPath, &pipeline]() {
+            Shader shader(shaderPath, mVulkanResources->getShaderModuleCache());
+
+            ComputePipelineBuilder pipelineBuilder;
+            pipelineBuilder.setShader(shader.getShaderModule());
+            pipelineBuilder.setPipelineLayout(mPipelineLayout);
+            pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+            pipeline = pipelineBuilder.build(device);
+
+            return BUNNY_HAPPY;
+        });
+    };
+
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(enqueueBuild(mDetailShaderPath, mDetailPipeline))
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(enqueueBuild(mWeatherShaderPath, mWeatherPipeline))
+    return enqueueBuild(mShapeShaderPath, mPipeline);
+}
+
+BunnyResult CloudNoisePass::initDescriptors()
+{
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorLayout())
+
+    VkDevice device = mVulkanResources->getDevice();
+
+    DescriptorAllocator::PoolSize poolSizes[] = {
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .mRatio = 1},
+    };
+    mDescriptorAllocator.init(device, 2 + MAX_FRAMES_IN_FLIGHT, poolSizes);
+    mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
+
+    mDescriptorAllocator.allocate(device, &mDescSetLayout, &mMainNoiseDescSet);
+    mDescriptorAllocator.allocate(device, &mDescSetLayout, &mDetailNoiseDescSet);
+    for (VkDescriptorSet& weatherDescSet : mWeatherDescSets)
+    {
+        mDescriptorAllocator.allocate(device, &mDescSetLayout, &weatherDescSet);
+    }
+
+    return BUNNY_HAPPY;
+}
+
+BunnyResult CloudNoisePass::initDataAndResources()
+{
+    VkDevice device = mVulkanResources->getDevice();
+
+    //  the volumes are sampled with their whole mip chain like the baked ones
+    auto createVolume = [this, device](const NoiseSettings& settings, VkFormat format, AllocatedImage& outImage,
+                            VkImageView& outMip0View) {
+        const uint32_t resolution = settings.mResolution;
+        outImage = mVulkanResources->createImage(VkExtent3D{resolution, resolution, resolution}, format,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT, true, VK_IMAGE_LAYOUT_UNDEFINED, std::bit_width(resolution));
+
+        //  a storage image view can only have one mip
+        VkImageViewCreateInfo viewCreateInfo = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+        viewCreateInfo.image = outImage.mImage;
+        viewCreateInfo.format = format;
+        viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewCreateInfo.subresourceRange.baseMipLevel = 0;
+        viewCreateInfo.subresourceRange.levelCount = 1;
+        viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+        viewCreateInfo.subresourceRange.layerCount = 1;
+        return vkCreateImageView(device, &viewCreateInfo, nullptr, &outMip0View);
+    };
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        createVolume(MAIN_NOISE_SETTINGS, VK_FORMAT_R8G8_UNORM, mMainNoiseImage, mMainNoiseMip0View))
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        createVolume(DETAIL_NOISE_SETTINGS, VK_FORMAT_R8_UNORM, mDetailNoiseImage, mDetailNoiseMip0View))
+    for (AllocatedImage& weatherImage : mWeatherImages)
+    {
+        weatherImage = mVulkanResources->createImage(
+            VkExtent3D{WEATHER_SETTINGS.mResolution, WEATHER_SETTINGS.mResolution, 1}, VK_FORMAT_R8G8B8A8_UNORM,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT, false, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    mDeletionStack.AddFunction([this]() {
+        VkDevice device = mVulkanResources->getDevice();
+        vkDestroyImageView(device, mMainNoiseMip0View, nullptr);
+        vkDestroyImageView(device, mDetailNoiseMip0View, nullptr);
+        mVulkanResources->destroyImage(mMainNoiseImage);
+        mVulkanResources->destroyImage(mDetailNoiseImage);
+        for (AllocatedImage& weatherImage : mWeatherImages)
+        {
+            mVulkanResources->destroyImage(weatherImage);
+        }
+    });
+
+    DescriptorWriter writer;
+    writer.writeImage(0, mMainNoiseMip0View, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.updateSet(device, mMainNoiseDescSet);
+    writer.clear();
+    writer.writeImage(0, mDetailNoiseMip0View, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.updateSet(device, mDetailNoiseDescSet);
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        writer.clear();
+        writer.writeImage(0, mWeatherImages[idx].mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, mWeatherDescSets[idx]);
+    }
+
+    return BUNNY_HAPPY;
+}
+
+BunnyResult CloudNoisePass::initDescriptorLayout()
+{
+    DescriptorLayoutBuilder builder;
+    builder.addBinding(VkDescriptorSetLayoutBinding{
+        0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr});
+    mDescSetLayout = builder.build(mVulkanResources->getDevice());
+
+    mDeletionStack.AddFunction(
+        [this]() { vkDestroyDescriptorSetLayout(mVulkanResources->getDevice(), mDescSetLayout, nullptr); });
+
+    return BUNNY_HAPPY;
+}
+
+CloudNoisePass::NoiseParams CloudNoisePass::makeNoiseParams(const NoiseSettings& settings)
+{
+    //  the noise only tiles with a whole number of cells across the volume
+    const float cellsAcross = settings.mFrequency * settings.mResolution;
+    return NoiseParams{.mResolution = settings.mResolution,
+        .mPeriod = (std::max)(static_cast<uint32_t>(std::lround(cellsAcross)), 1u),
+        .mSeed = settings.mSeed,
+        .mOctaveCount = settings.mOctaveCount,
+        .mRowOffset = 0,
+        .mEvolveTime = 0};
+}
+
+void CloudNoisePass::recordVolume(VkCommandBuffer cmd, VkPipeline pipeline, VkDescriptorSet descSet,
+    const NoiseSettings& settings, const AllocatedImage& image) const
+{
+    const uint32_t mipCount = std::bit_width(settings.mResolution);
+    auto makeMipBarrier = [&image](uint32_t baseMip, uint32_t mipLevelCount, VkAccessFlags srcAccess,
+                              VkAccessFlags dstAccess, VkImageLayout oldLayout, VkImageLayout newLayout) {
+        VkImageMemoryBarrier barrier = makeImageMemoryBarrier(
+            image.mImage, srcAccess, dstAccess, oldLayout, newLayout, VK_IMAGE_ASPECT_COLOR_BIT);
+        barrier.subresourceRange.baseMipLevel = baseMip;
+        barrier.subresourceRange.levelCount = mipLevelCount;
+        return barrier;
+    };
+
+    //  the first mip is written by the shader, the others receive the blits
+    VkImageMemoryBarrier preBarriers[] = {
+        makeMipBarrier(0, 1, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL),
+        makeMipBarrier(1, VK_REMAINING_MIP_LEVELS, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+        mipCount > 1 ? 2 : 1, preBarriers);
+
+    NoiseParams params = makeNoiseParams(settings);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &descSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(NoiseParams), &params);
+    constexpr static uint32_t computeSize = 4;
+    const uint32_t groupCount = (settings.mResolution + computeSize - 1) / computeSize;
+    vkCmdDispatch(cmd, groupCount, groupCount, groupCount);
+
+    VkImageMemoryBarrier mip0Barrier = makeMipBarrier(0, 1, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &mip0Barrier);
+
+    //  a linear blit to half the size averages the 2 x 2 x 2 texels, the box filter of the baked mips
+    for (uint32_t mip = 1; mip < mipCount; mip++)
+    {
+        const int32_t srcSize = static_cast<int32_t>((std::max)(settings.mResolution >> (mip - 1), 1u));
+        const int32_t dstSize = static_cast<int32_t>((std::max)(settings.mResolution >> mip, 1u));
+        VkImageBlit blit{
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1},
+            .srcOffsets = {{0, 0, 0}, {srcSize, srcSize, srcSize}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1},
+            .dstOffsets = {{0, 0, 0}, {dstSize, dstSize, dstSize}},
+        };
+        vkCmdBlitImage(cmd, image.mImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.mImage,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        VkImageMemoryBarrier mipBarrier = makeMipBarrier(mip, 1, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+            nullptr, 1, &mipBarrier);
+    }
+
+    VkImageMemoryBarrier readBarrier = makeMipBarrier(0, mipCount, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &readBarrier);
+}
+
+} // namespace Bunny::Render
@@ -14,6 +14,11 @@ void ComputePipelineBuilder::setPipelineLayout(VkPipelineLayout layout)
     mPipelineLayout = layout;
 }
 
+void ComputePipelineBuilder::setPipelineCache(VkPipelineCache pipelineCache)
+{
+    mPipelineCache = pipelineCache;
+}
+
 VkPipeline ComputePipelineBuilder::build(VkDevice device)
 {
     VkComputePipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -22,7 +27,7 @@ VkPipeline ComputePipelineBuilder::build(VkDevice device)
         .layout = mPipelineLayout};
 
     VkPipeline newPipeline;
-    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
+    if (vkCreateComputePipelines(device, mPipelineCache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
     {
         return VK_NULL_HANDLE; // failed to create graphics pipeline
     }
@@ -6,6 +6,7 @@
 #include "ErrorCheck.h"
 #include "Error.h"
 #include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "Camera.h"
 #include "Helper.h"
 
@@ -25,7 +26,7 @@ BunnyResult CullingPass::initializePass()
 {
     initDescriptorSets();
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initPipeline())
-    createBuffers();
+    mCullingDataSlice = mRenderer->getFrameArena().makeSlice(sizeof(ViewFrustum));
 
     return BUNNY_HAPPY;
 }
@@ -73,18 +74,9 @@ void CullingPass::cleanup()
     mDrawCommandBuffer = nullptr;
     mInstanceObjectBuffer = nullptr;
     mSurfaceToCommandMapBuffer = nullptr;
-    mVulkanResources->destroyBuffer(mCullingDataBuffer);
     mVulkanResources->destroyBuffer(mDebugDataBuffer);
 }
 
-void CullingPass::createBuffers()
-{
-    VkDeviceSize bufferSize = sizeof(ViewFrustum);
-    mCullingDataBuffer = mVulkanResources->createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        VMA_MEMORY_USAGE_AUTO);
-}
-
 void CullingPass::linkDrawData(const AllocatedBuffer& drawCommandBuffer, size_t drawbufferSize,
     const AllocatedBuffer& instObjectBuffer, size_t instBufferSize, const AllocatedBuffer& surfaceToCommandMapBuffer)
 {
@@ -132,7 +124,6 @@ void CullingPass::linkCullingData(
 
     //  link culling data buffer
     DescriptorWriter writer;
-    VkDeviceSize bufferSize = sizeof(ViewFrustum);
 
     for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
     {
@@ -143,7 +134,8 @@ void CullingPass::linkCullingData(
         //  if want to use the previous 1 frame we should use (idx-1)%MAX_FRAMES_IN_FLIGHT
 
         writer.clear();
-        writer.writeBuffer(0, mCullingDataBuffer.mBuffer, bufferSize, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        writer.writeBuffer(0, mCullingDataSlice.mBuffer, mCullingDataSlice.mRange, 0,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
         writer.writeImage(1, depthHierarchyImages[idx]->mImageView, sampler, VK_IMAGE_LAYOUT_GENERAL,
             VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
@@ -180,8 +172,7 @@ void CullingPass::updateCullingData(const Camera& camera)
     viewFrustum.mDepthImageWidth = mDepthImageWidth;
     viewFrustum.mDepthImageHeight = mDepthImageHeight;
 
-    void* data = mCullingDataBuffer.mAllocationInfo.pMappedData;
-    memcpy(data, &viewFrustum, sizeof(ViewFrustum));
+    mRenderer->getFrameArena().write(viewFrustum, mCullingDataSlice);
 }
 
 void CullingPass::dispatch()
@@ -194,8 +185,8 @@ void CullingPass::dispatch()
 
     //  bind descriptors
     //  cull data
-    vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mCullDataDescSets[currentFrameIdx], 0, nullptr);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1,
+        &mCullDataDescSets[currentFrameIdx], 1, &mCullingDataSlice.mOffset);
 
     //  object data
     vkCmdBindDescriptorSets(
@@ -214,38 +205,13 @@ void CullingPass::dispatch()
 
     vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &mObjectCount);
 
-    {
-        //  barrier for depth hierarchy image write
-        VkImageMemoryBarrier depthHierarchyBarrier = makeImageMemoryBarrier(
-            mDepthHierarchyImages[currentFrameIdx]->mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
-            nullptr, 0, nullptr, 1, &depthHierarchyBarrier);
-    }
-
     //  dispatch culling compute shader
     constexpr static uint32_t computeSizeX = 256;
     //  +1 to make sure enough threads are dispatched
     vkCmdDispatch(cmd, mObjectCount / computeSizeX + 1, 1, 1);
     //  Todo: maybe research later submitting this to compute queue?
 
-    //  set up barrier to make sure the buffers containing the culling result is ready to use
-    std::array<VkBufferMemoryBarrier, 2> barriers;
-
-    barriers[0] = makeBufferMemoryBarrier(
-        mDrawCommandBuffer->mBuffer, mVulkanResources->getGraphicQueue().mQueueFamilyIndex.value());
-    barriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-
-    barriers[1] = makeBufferMemoryBarrier(
-        mInstanceObjectBuffer->mBuffer, mVulkanResources->getGraphicQueue().mQueueFamilyIndex.value());
-    barriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barriers[1].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
-
-    //  Todo: here we directly start the barrier, maybe we should save it somewhere and start it later
-    //  in case we want to have multiple culling passes and wait all at the end
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr,
-        2, barriers.data(), 0, nullptr);
+    //  the barriers for the depth hierarchy input and the culling results are recorded by the frame graph
 }
 
 CullingPass::~CullingPass()
@@ -259,7 +225,7 @@ void CullingPass::initDescriptorSets()
     DescriptorLayoutBuilder layoutBuilder;
 
     VkDescriptorSetLayoutBinding uniformBufferBinding{
-        0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+        0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
     VkDescriptorSetLayoutBinding imageBinding{
         1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
     VkDescriptorSetLayoutBinding storageBufferBinding{
@@ -300,7 +266,7 @@ void CullingPass::initDescriptorSets()
     //  set up descriptor allocator
     DescriptorAllocator::PoolSize poolSizes[] = {
         {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 10},
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 2 },
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .mRatio = 2 },
         {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = 2 }
     };
     mDescriptorAllocator.init(mVulkanResources->getDevice(), 2, poolSizes);
@@ -323,9 +289,6 @@ void CullingPass::initDescriptorSets()
 
 BunnyResult CullingPass::initPipeline()
 {
-    //  load shader
-    Shader computeShader(mCullingShaderPath, mVulkanResources->getDevice());
-
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {
         mCullDataLayout, mStorageBufferLayout, mMeshDataLayout, mDrawDataLayout, mStorageBufferLayout};
@@ -344,12 +307,17 @@ BunnyResult CullingPass::initPipeline()
         vkCreatePipelineLayout(mVulkanResources->getDevice(), &pipelineLayoutInfo, nullptr, &mPipelineLayout))
 
     //  build pipeline
-    ComputePipelineBuilder pipelineBuilder;
-    pipelineBuilder.setShader(computeShader.getShaderModule());
-    pipelineBuilder.setPipelineLayout(mPipelineLayout);
-    mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+    return PipelineCompileQueue::enqueue([this]() {
+        Shader computeShader(mCullingShaderPath, mVulkanResources->getShaderModuleCache());
 
-    return BUNNY_HAPPY;
+        ComputePipelineBuilder pipelineBuilder;
+        pipelineBuilder.setShader(computeShader.getShaderModule());
+        pipelineBuilder.setPipelineLayout(mPipelineLayout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
 }
 
 } // namespace Bunny::Render
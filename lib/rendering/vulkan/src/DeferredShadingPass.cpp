@@ -177,8 +177,8 @@ void DeferredShadingPass::createSampler()
 BunnyResult DeferredShadingPass::initPipeline()
 {
     //  load shader
-    Shader vertexShader(mVertexShaderPath, mVulkanResources->getDevice());
-    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getDevice());
+    Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
 
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {mUniformDescLayout, mGBufferDescLayout};
@@ -209,6 +209,7 @@ BunnyResult DeferredShadingPass::initPipeline()
     builder.disableDepthTest();                                              //  no need to do depth test
     builder.setPipelineLayout(mPipelineLayout);
 
+    builder.setPipelineCache(mVulkanResources->getPipelineCache());
     mPipeline = builder.build(mVulkanResources->getDevice());
 
     return BUNNY_HAPPY;
@@ -6,6 +6,7 @@
 #include "Error.h"
 #include "Shader.h"
 #include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "BunnyResult.h"
 
 #include <glm/vec2.hpp>
@@ -68,13 +69,7 @@ void DepthReducePass::dispatch()
 
     const AllocatedImage& depthImage = mRenderer->getDepthImageResolved();
 
-    //  wait for the previous pass to finish writing to the depth image
-    VkImageMemoryBarrier depthWriteFinishBarrier = makeImageMemoryBarrier(depthImage.mImage,
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
-
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &depthWriteFinishBarrier);
+    //  the depth image and the hierarchy image are transitioned by the frame graph
 
     //  bind pipeline
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
@@ -109,14 +104,6 @@ void DepthReducePass::dispatch()
             VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &reduceBarrier);
     }
 
-    //  transition the depth image back to the optimal format as depth attachment
-    VkImageMemoryBarrier depthReadFinishBarrier = makeImageMemoryBarrier(depthImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_ASPECT_DEPTH_BIT);
-
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &depthReadFinishBarrier);
 }
 
 const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> DepthReducePass::getDepthHierarchyImages() const
@@ -251,8 +238,6 @@ void DepthReducePass::initDescriptorSets()
 
 void DepthReducePass::initPipeline()
 {
-    Shader computeShader(mShaderPath, mVulkanResources->getDevice());
-
     VkPushConstantRange pushConstRange{
         .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(glm::vec2)};
 
@@ -265,10 +250,17 @@ void DepthReducePass::initPipeline()
 
     vkCreatePipelineLayout(mVulkanResources->getDevice(), &pipelineLayoutInfo, nullptr, &mPipelineLayout);
 
-    ComputePipelineBuilder pipelineBuilder;
-    pipelineBuilder.setShader(computeShader.getShaderModule());
-    pipelineBuilder.setPipelineLayout(mPipelineLayout);
-    mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+    PipelineCompileQueue::enqueue([this]() {
+        Shader computeShader(mShaderPath, mVulkanResources->getShaderModuleCache());
+
+        ComputePipelineBuilder pipelineBuilder;
+        pipelineBuilder.setShader(computeShader.getShaderModule());
+        pipelineBuilder.setPipelineLayout(mPipelineLayout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
 }
 
 uint32_t DepthReducePass::findHierarchyLevels(uint32_t width, uint32_t height) const
@@ -4,10 +4,52 @@
 
 #include <algorithm>
 #include <cassert>
+#include <functional>
 #include <iterator>
+#include <type_traits>
+#include <utility>
 
 namespace Bunny::Render
 {
+namespace
+{
+VkDescriptorPool createDescriptorPool(VkDevice device, uint32_t maxSets,
+    std::span<const DescriptorAllocator::PoolSize> poolSizes, VkDescriptorPoolCreateFlags poolCreateFlags)
+{
+    std::vector<VkDescriptorPoolSize> descPoolSizes;
+    descPoolSizes.reserve(poolSizes.size());
+    std::transform(poolSizes.begin(), poolSizes.end(), std::back_inserter(descPoolSizes),
+        [maxSets](const DescriptorAllocator::PoolSize& ps) {
+            return VkDescriptorPoolSize{.type = ps.mType, .descriptorCount = ps.mRatio * maxSets};
+        });
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = poolCreateFlags;
+    poolInfo.maxSets = maxSets;
+    poolInfo.poolSizeCount = (uint32_t)descPoolSizes.size();
+    poolInfo.pPoolSizes = descPoolSizes.data();
+
+    VkDescriptorPool newPool;
+    VK_HARD_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &newPool));
+    return newPool;
+}
+
+//  the non-dispatchable handles are pointers on 64 bit platforms and uint64_t on 32 bit ones
+template <typename T>
+uint64_t handleToKey(T handle)
+{
+    if constexpr (std::is_pointer_v<T>)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle));
+    }
+    else
+    {
+        return static_cast<uint64_t>(handle);
+    }
+}
+} // namespace
+
 void DescriptorLayoutBuilder::addBinding(VkDescriptorSetLayoutBinding binding)
 {
     mBindings.push_back(binding);
@@ -39,11 +81,13 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::build(
     return layout;
 }
 
-void DescriptorAllocator::init(VkDevice device, uint32_t maxSets, std::span<PoolSize> poolSizes)
+void DescriptorAllocator::init(
+    VkDevice device, uint32_t maxSets, std::span<PoolSize> poolSizes, VkDescriptorPoolCreateFlags poolCreateFlags)
 {
     assert(maxSets > 0 && !poolSizes.empty());
 
     mMaxSets = (std::min)(maxSets, msMaxSetsLimit);
+    mPoolCreateFlags = poolCreateFlags;
 
     for (const PoolSize& ps : poolSizes)
     {
@@ -130,21 +174,7 @@ VkDescriptorPool DescriptorAllocator::getPool(VkDevice device)
 VkDescriptorPool DescriptorAllocator::createPool(VkDevice device)
 {
     assert(mMaxSets > 0 && mMaxSets <= msMaxSetsLimit && !mPoolSizes.empty());
-    std::vector<VkDescriptorPoolSize> descPoolSizes;
-    descPoolSizes.reserve(mPoolSizes.size());
-    std::transform(mPoolSizes.begin(), mPoolSizes.end(), std::back_inserter(descPoolSizes), [this](const PoolSize& ps) {
-        return VkDescriptorPoolSize{.type = ps.mType, .descriptorCount = ps.mRatio * mMaxSets};
-    });
-
-    VkDescriptorPoolCreateInfo poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.flags = 0;
-    poolInfo.maxSets = mMaxSets;
-    poolInfo.poolSizeCount = (uint32_t)descPoolSizes.size();
-    poolInfo.pPoolSizes = descPoolSizes.data();
-
-    VkDescriptorPool newPool;
-    VK_HARD_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &newPool));
+    VkDescriptorPool newPool = createDescriptorPool(device, mMaxSets, mPoolSizes, mPoolCreateFlags);
     if (newPool != nullptr)
     {
         mMaxSets = (std::min)(static_cast<uint32_t>(mMaxSets * 1.5), msMaxSetsLimit);
@@ -152,6 +182,67 @@ VkDescriptorPool DescriptorAllocator::createPool(VkDevice device)
     return newPool;
 }
 
+void DescriptorArena::init(VkDevice device, uint32_t maxSets, std::span<DescriptorAllocator::PoolSize> poolSizes)
+{
+    assert(maxSets > 0 && !poolSizes.empty());
+
+    mMaxSets = maxSets;
+    mPoolSizes.assign(poolSizes.begin(), poolSizes.end());
+    mPool = createPool(device);
+}
+
+VkDescriptorSet DescriptorArena::allocate(VkDevice device, VkDescriptorSetLayout layout)
+{
+    VkDescriptorSetAllocateInfo allocInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocInfo.descriptorPool = mOverflowPools.empty() ? mPool : mOverflowPools.back();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    VkDescriptorSet descSet = VK_NULL_HANDLE;
+    VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descSet);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        allocInfo.descriptorPool = mOverflowPools.emplace_back(createPool(device));
+        VK_HARD_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &descSet));
+    }
+
+    return descSet;
+}
+
+void DescriptorArena::reset(VkDevice device)
+{
+    if (mOverflowPools.empty())
+    {
+        vkResetDescriptorPool(device, mPool, 0);
+        return;
+    }
+
+    //  the frame did not fit, grow the pool so that the next frames do
+    mMaxSets *= static_cast<uint32_t>(mOverflowPools.size() + 1);
+    destroy(device);
+    mPool = createPool(device);
+}
+
+void DescriptorArena::destroy(VkDevice device)
+{
+    if (mPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(device, mPool, nullptr);
+        mPool = VK_NULL_HANDLE;
+    }
+    for (VkDescriptorPool pool : mOverflowPools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    mOverflowPools.clear();
+}
+
+VkDescriptorPool DescriptorArena::createPool(VkDevice device) const
+{
+    assert(mMaxSets > 0 && !mPoolSizes.empty());
+    return createDescriptorPool(device, mMaxSets, mPoolSizes, 0);
+}
+
 DescriptorWriter::~DescriptorWriter()
 {
     clear();
@@ -208,8 +299,8 @@ void DescriptorWriter::writeAccelerationStructure(uint32_t binding, VkAccelerati
     mWrites.push_back(write);
 }
 
-void DescriptorWriter::writeImages(
-    uint32_t binding, std::vector<VkDescriptorImageInfo> imageInfos, VkDescriptorType type)
+void DescriptorWriter::writeImages(uint32_t binding, std::vector<VkDescriptorImageInfo> imageInfos,
+    VkDescriptorType type, uint32_t firstArrayElement)
 {
     const std::vector<VkDescriptorImageInfo>& infos = mImageInfos.emplace_back(std::move(imageInfos));
 
@@ -217,7 +308,7 @@ void DescriptorWriter::writeImages(
         .pNext = nullptr,
         .dstSet = VK_NULL_HANDLE,
         .dstBinding = binding,
-        .dstArrayElement = 0,
+        .dstArrayElement = firstArrayElement,
         .descriptorCount = static_cast<uint32_t>(infos.size()),
         .descriptorType = type,
         .pImageInfo = infos.data()};
@@ -249,6 +340,116 @@ void DescriptorWriter::updateSet(VkDevice device, VkDescriptorSet descriptorSet)
         write.dstSet = descriptorSet;
     }
     vkUpdateDescriptorSets(device, static_cast<uint32_t>(mWrites.size()), mWrites.data(), 0, nullptr);
+    msWriteCount.fetch_add(getDescriptorCount(), std::memory_order_relaxed);
+}
+
+void DescriptorWriter::pushSet(
+    VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set) const
+{
+    //  dstSet is ignored when pushing
+    vkCmdPushDescriptorSetKHR(cmd, bindPoint, layout, set, static_cast<uint32_t>(mWrites.size()), mWrites.data());
+    msWriteCount.fetch_add(getDescriptorCount(), std::memory_order_relaxed);
+}
+
+void DescriptorWriter::appendKey(std::vector<uint64_t>& key) const
+{
+    for (const VkWriteDescriptorSet& write : mWrites)
+    {
+        key.push_back(write.dstBinding);
+        key.push_back(write.dstArrayElement);
+        key.push_back(write.descriptorCount);
+        key.push_back(write.descriptorType);
+
+        if (write.pImageInfo != nullptr)
+        {
+            for (uint32_t idx = 0; idx < write.descriptorCount; idx++)
+            {
+                const VkDescriptorImageInfo& info = write.pImageInfo[idx];
+                key.push_back(handleToKey(info.sampler));
+                key.push_back(handleToKey(info.imageView));
+                key.push_back(info.imageLayout);
+            }
+        }
+        else if (write.pBufferInfo != nullptr)
+        {
+            for (uint32_t idx = 0; idx < write.descriptorCount; idx++)
+            {
+                const VkDescriptorBufferInfo& info = write.pBufferInfo[idx];
+                key.push_back(handleToKey(info.buffer));
+                key.push_back(info.offset);
+                key.push_back(info.range);
+            }
+        }
+        else if (write.descriptorType == VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR)
+        {
+            const auto* acceWrite = static_cast<const VkWriteDescriptorSetAccelerationStructureKHR*>(write.pNext);
+            for (uint32_t idx = 0; idx < acceWrite->accelerationStructureCount; idx++)
+            {
+                key.push_back(handleToKey(acceWrite->pAccelerationStructures[idx]));
+            }
+        }
+    }
+}
+
+uint32_t DescriptorWriter::getDescriptorCount() const
+{
+    uint32_t count = 0;
+    for (const VkWriteDescriptorSet& write : mWrites)
+    {
+        count += write.descriptorCount;
+    }
+    return count;
+}
+
+void DescriptorSetCache::init(VkDevice device, uint32_t maxSets, std::span<DescriptorAllocator::PoolSize> poolSizes)
+{
+    mAllocator.init(device, maxSets, poolSizes);
+}
+
+VkDescriptorSet DescriptorSetCache::getSet(VkDevice device, VkDescriptorSetLayout layout, DescriptorWriter& writer)
+{
+    std::vector<uint64_t> key;
+    key.push_back(handleToKey(layout));
+    writer.appendKey(key);
+
+    if (auto found = mSets.find(key); found != mSets.end())
+    {
+        return found->second;
+    }
+
+    if (mSets.size() >= MAX_CACHED_SET_COUNT)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    VkDescriptorSet descSet = VK_NULL_HANDLE;
+    mAllocator.allocate(device, &layout, &descSet);
+    writer.updateSet(device, descSet);
+
+    mSets.emplace(std::move(key), descSet);
+    return descSet;
+}
+
+void DescriptorSetCache::clear(VkDevice device)
+{
+    mAllocator.clearPools(device);
+    mSets.clear();
+}
+
+void DescriptorSetCache::destroy(VkDevice device)
+{
+    mAllocator.destroyPools(device);
+    mSets.clear();
+}
+
+size_t DescriptorSetCache::KeyHash::operator()(const std::vector<uint64_t>& key) const
+{
+    size_t hash = key.size();
+    for (uint64_t word : key)
+    {
+        hash ^= std::hash<uint64_t>{}(word) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
 }
 
 } // namespace Bunny::Render
@@ -4,6 +4,7 @@
 #include "VulkanGraphicsRenderer.h"
 #include "Shader.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "Helper.h"
 #include "TextureBank.h"
 #include "Error.h"
@@ -25,36 +26,22 @@ void FinalOutputPass::draw() const
     VkCommandBuffer cmdBuf = mRenderer->getCurrentCommandBuffer();
     const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    //  wait for scene render and cloud render to finish
-    //  huh? should probably transition the image layout to shader read only optimal
-    //  not sure why I didn't do that
-    VkImageMemoryBarrier sceneRenderBarrier = makeImageMemoryBarrier(frame.mRenderedSceneTexture->mImage,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    VkImageMemoryBarrier cloudRenderBarrier =
-        makeImageMemoryBarrier(frame.mCloudTexture->mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    VkImageMemoryBarrier fogShadowRenderBarrier =
-        makeImageMemoryBarrier(frame.mFogShadowTexture->mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-
-    VkImageMemoryBarrier barriers[] = {cloudRenderBarrier, fogShadowRenderBarrier};
-
-    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-
-    VkImageMemoryBarrier sceneBarriers[] = {sceneRenderBarrier};
-
-    vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, sceneBarriers);
+    //  the scene and cloud textures are transitioned to be read by the frame graph
 
     auto renderHelper = mRenderer->getRenderHelper().addDefaultColorAttachment().setDepthTest(false).beginRender();
 
     //  bind pipeline and resources
     vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
 
-    vkCmdBindDescriptorSets(
-        cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &frame.mTextureDescSet, 0, nullptr);
+    if (mIsPushDescriptorUsed)
+    {
+        frame.mTextureWriter.pushSet(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0);
+    }
+    else
+    {
+        vkCmdBindDescriptorSets(
+            cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &frame.mTextureDescSet, 0, nullptr);
+    }
 
     //  bind vertex and index buffers
     VkBuffer vertexBuffers[] = {mVertexBuffer.mBuffer};
@@ -72,31 +59,27 @@ void FinalOutputPass::updateInputTextures(const AllocatedImage* cloudTexture, co
     const AllocatedImage* renderedSceneTexture)
 {
     FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
 
-    frame.mDescriptorAllocator.clearPools(device);
     frame.mCloudTexture = cloudTexture;
     frame.mFogShadowTexture = fogShadowTexture;
     frame.mRenderedSceneTexture = renderedSceneTexture;
 
-    frame.mDescriptorAllocator.allocate(device, &mTextureDescSetLayout, &frame.mTextureDescSet);
-
-    DescriptorWriter writer;
+    DescriptorWriter& writer = frame.mTextureWriter;
+    writer.clear();
     writer.writeImage(0, frame.mRenderedSceneTexture->mImageView, mTextureBank->getSampler(),
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     writer.writeImage(1, frame.mCloudTexture->mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     writer.writeImage(2, frame.mFogShadowTexture->mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    writer.updateSet(device, frame.mTextureDescSet);
+    if (!mIsPushDescriptorUsed)
+    {
+        frame.mTextureDescSet = mRenderer->getCachedDescriptorSet(mTextureDescSetLayout, writer);
+    }
 }
 
 BunnyResult FinalOutputPass::initPipeline()
 {
-    //  load shader
-    Shader vertexShader(mVertexShaderPath, mVulkanResources->getDevice());
-    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getDevice());
-
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {mTextureDescSetLayout};
 
@@ -111,50 +94,45 @@ BunnyResult FinalOutputPass::initPipeline()
     mDeletionStack.AddFunction(
         [this]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), mPipelineLayout, nullptr); });
 
-    //  vertex info
-    auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
-    auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
-
-    //  build pipeline
-    GraphicsPipelineBuilder builder;
-    builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
-    builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
-    builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    builder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    builder.setMultisamplingNone();
-    builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
-    builder.disableDepthTest();                                              //  no need to do depth test
-    builder.setPipelineLayout(mPipelineLayout);
-
-    mPipeline = builder.build(mVulkanResources->getDevice());
     mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    return BUNNY_HAPPY;
+    return PipelineCompileQueue::enqueue([this]() {
+        //  load shader
+        Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
+
+        //  vertex info
+        auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
+        auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
+
+        //  build pipeline
+        GraphicsPipelineBuilder builder;
+        builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
+        builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
+        builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        builder.setMultisamplingNone();
+        builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
+        builder.disableDepthTest();                                              //  no need to do depth test
+        builder.setPipelineLayout(mPipelineLayout);
+
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult FinalOutputPass::initDescriptors()
 {
-    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorLayouts())
-    VkDevice device = mVulkanResources->getDevice();
-
-    for (FrameData& frame : mFrameData)
-    {
-        DescriptorAllocator::PoolSize poolSizes[] = {
-            {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = 3},
-        };
-        frame.mDescriptorAllocator.init(device, 1, poolSizes);
+    //  three textures, small enough to be pushed instead of written into a set
+    mIsPushDescriptorUsed = mVulkanResources->getSupportPushDescriptor();
 
-        //  no need to allocate descriptor sets here, they will be allocated every frame
-    }
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorLayouts())
 
-    mDeletionStack.AddFunction([this]() {
-        for (FrameData& frame : mFrameData)
-        {
-            frame.mDescriptorAllocator.destroyPools(mVulkanResources->getDevice());
-        }
-    });
+    //  no sets to allocate, the textures are pushed or come from the descriptor cache of the renderer
 
     return BUNNY_HAPPY;
 }
@@ -190,7 +168,8 @@ BunnyResult FinalOutputPass::initDescriptorLayouts()
     builder.addBinding(imageBinding); //  cloud
     imageBinding.binding = 2;
     builder.addBinding(imageBinding); //  fog shadow
-    mTextureDescSetLayout = builder.build(mVulkanResources->getDevice());
+    mTextureDescSetLayout = builder.build(mVulkanResources->getDevice(), nullptr,
+        mIsPushDescriptorUsed ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0);
 
     mDeletionStack.AddFunction(
         [this]() { vkDestroyDescriptorSetLayout(mVulkanResources->getDevice(), mTextureDescSetLayout, nullptr); });
@@ -0,0 +1,84 @@
+#include "FrameBufferArena.h"
+
+#include "VulkanRenderResources.h"
+#include "Error.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace Bunny::Render
+{
+FrameBufferArena::FrameBufferArena(const VulkanRenderResources* vulkanResources) : mVulkanResources(vulkanResources)
+{
+}
+
+FrameBufferArena::~FrameBufferArena()
+{
+    cleanup();
+}
+
+BunnyResult FrameBufferArena::initialize(VkDeviceSize frameCapacity)
+{
+    VkPhysicalDeviceProperties properties = mVulkanResources->getPhysicalDeviceProperties(nullptr);
+    mAlignment = (std::max)(
+        properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+    mFrameCapacity = (frameCapacity + mAlignment - 1) / mAlignment * mAlignment;
+
+    mBuffer = mVulkanResources->createBuffer(mFrameCapacity * MAX_FRAMES_IN_FLIGHT,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+        VMA_MEMORY_USAGE_AUTO);
+    if (mBuffer.mBuffer == nullptr)
+    {
+        PRINT_AND_RETURN_VALUE("Failed to create the frame buffer arena", BUNNY_SAD)
+    }
+
+    mFrameBegin = 0;
+    mFrameUsedSize = 0;
+
+    return BUNNY_HAPPY;
+}
+
+void FrameBufferArena::cleanup()
+{
+    if (mBuffer.mBuffer != nullptr)
+    {
+        mVulkanResources->destroyBuffer(mBuffer);
+        mBuffer.mBuffer = nullptr;
+    }
+}
+
+void FrameBufferArena::beginFrame(uint32_t frameIdx)
+{
+    mFrameBegin = mFrameCapacity * frameIdx;
+    mFrameUsedSize = 0;
+}
+
+FrameBufferSlice FrameBufferArena::makeSlice(VkDeviceSize range) const
+{
+    //  the offset starts at the first frame region, so a slice bound before its first write is still in range
+    return FrameBufferSlice{.mBuffer = mBuffer.mBuffer, .mRange = range, .mOffset = 0};
+}
+
+void* FrameBufferArena::allocate(VkDeviceSize size, FrameBufferSlice& slice)
+{
+    //  the whole bound range has to be inside the region, also when less of it is written
+    VkDeviceSize alignedSize = ((std::max)(size, slice.mRange) + mAlignment - 1) / mAlignment * mAlignment;
+    if (mFrameUsedSize + alignedSize > mFrameCapacity)
+    {
+        //  there is no offset to fall back to, the slice still points into the region of an earlier frame,
+        //  which the cpu rewrites while the gpu may read it
+        PRINT_AND_ABORT(fmt::format("The frame buffer arena is full, {} of {} bytes used and {} more asked for, "
+                                    "increase its frame capacity",
+            mFrameUsedSize, mFrameCapacity, alignedSize))
+    }
+
+    VkDeviceSize offset = mFrameBegin + mFrameUsedSize;
+    mFrameUsedSize += alignedSize;
+
+    slice.mOffset = static_cast<uint32_t>(offset);
+    return static_cast<std::byte*>(mBuffer.mAllocationInfo.pMappedData) + offset;
+}
+} // namespace Bunny::Render
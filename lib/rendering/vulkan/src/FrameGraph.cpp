@@ -0,0 +1,1076 @@
+#include "FrameGraph.h"
+
+#include "VulkanRenderResources.h"
+#include "VulkanGraphicsRenderer.h"
+#include "Helper.h"
+#include "Error.h"
+#include "ErrorCheck.h"
+#include "CpuProfiler.h"
+#include "Task.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace Bunny::Render
+{
+
+//  only writes need to be made available, reads just need the execution dependency
+static constexpr VkAccessFlags WRITE_ACCESS_MASK =
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT |
+    VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool isRangeOverlapping(VkDeviceSize offsetA, VkDeviceSize sizeA, VkDeviceSize offsetB, VkDeviceSize sizeB)
+{
+    return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+}
+
+FrameGraph::PassBuilder::PassBuilder(FrameGraph* graph, uint32_t passIdx)
+    : mGraph(graph),
+      mPassIdx(passIdx)
+{
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::read(
+    ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+{
+    return addAccess(resource, stages, access, layout, false);
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::write(
+    ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+{
+    return addAccess(resource, stages, access, layout, true);
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::setSideEffect()
+{
+    mGraph->mPasses[mPassIdx].mHasSideEffect = true;
+    return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::setAsyncCompute()
+{
+    mGraph->mPasses[mPassIdx].mIsAsyncCompute = true;
+    return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::setExecute(ExecuteFunction execute)
+{
+    mGraph->mPasses[mPassIdx].mExecute = std::move(execute);
+    return *this;
+}
+
+FrameGraph::PassBuilder& FrameGraph::PassBuilder::addAccess(
+    ResourceHandle resource, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout, bool isWrite)
+{
+    Pass& pass = mGraph->mPasses[mPassIdx];
+
+    //  reading and writing the same resource in one pass is merged into one access
+    //  the graph can not change the layout in the middle of a pass, so they have to agree on it
+    auto found = std::find_if(pass.mAccesses.begin(), pass.mAccesses.end(),
+        [resource](const Access& existing) { return existing.mResource == resource; });
+    if (found != pass.mAccesses.end())
+    {
+        if (found->mLayout != layout)
+        {
+            PRINT_WARNING(fmt::format("Pass {} uses {} in different layouts", pass.mName,
+                mGraph->mResources[resource].mName))
+        }
+        found->mStages |= stages;
+        found->mAccess |= access;
+        found->mIsRead |= !isWrite;
+        found->mIsWrite |= isWrite;
+        return *this;
+    }
+
+    pass.mAccesses.emplace_back(Access{.mResource = resource,
+        .mStages = stages,
+        .mAccess = access,
+        .mLayout = layout,
+        .mIsRead = !isWrite,
+        .mIsWrite = isWrite});
+    return *this;
+}
+
+FrameGraph::FrameGraph(const VulkanRenderResources* vulkanResources, VulkanGraphicsRenderer* renderer)
+    : mVulkanResources(vulkanResources),
+      mRenderer(renderer)
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+    cleanup();
+    mRecordingDispatcher.Shutdown();
+}
+
+FrameGraph::ResourceHandle FrameGraph::importImage(
+    std::string_view name, ImageGetter getter, VkImageAspectFlags aspect, VkImageLayout initialLayout)
+{
+    Resource& resource = mResources.emplace_back();
+    resource.mCarriedFrom = static_cast<ResourceHandle>(mResources.size() - 1);
+    resource.mName = name;
+    resource.mType = ResourceType::Image;
+    resource.mAspect = aspect;
+    resource.mInitialLayout = initialLayout;
+    resource.mImageGetter = std::move(getter);
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+FrameGraph::ResourceHandle FrameGraph::importBuffer(std::string_view name, BufferGetter getter)
+{
+    Resource& resource = mResources.emplace_back();
+    resource.mCarriedFrom = static_cast<ResourceHandle>(mResources.size() - 1);
+    resource.mName = name;
+    resource.mType = ResourceType::Buffer;
+    resource.mBufferGetter = std::move(getter);
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+FrameGraph::ResourceHandle FrameGraph::createTransientImage(std::string_view name, const TransientImageDesc& desc)
+{
+    Resource& resource = mResources.emplace_back();
+    resource.mCarriedFrom = static_cast<ResourceHandle>(mResources.size() - 1);
+    resource.mName = name;
+    resource.mType = ResourceType::TransientImage;
+    resource.mAspect = desc.mAspect;
+    resource.mTransientDesc = desc;
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+void FrameGraph::markOutput(ResourceHandle resource)
+{
+    mResources[resource].mIsOutput = true;
+}
+
+void FrameGraph::markHistory(ResourceHandle current, ResourceHandle previous)
+{
+    mResources[previous].mCarriedFrom = current;
+    mResources[current].mCarriedFrom = previous;
+}
+
+FrameGraph::PassBuilder FrameGraph::addPass(std::string_view name)
+{
+    Pass& pass = mPasses.emplace_back();
+    pass.mName = name;
+    return PassBuilder(this, static_cast<uint32_t>(mPasses.size() - 1));
+}
+
+BunnyResult FrameGraph::compile()
+{
+    //  compiling again, e.g. after adding passes, recreates the transient images
+    cleanup();
+    mStatistics = Statistics{.mRecordingThreadCount = mRecordingThreadCount};
+
+    cullPasses();
+    assignQueues();
+    computeTransientLifetimes();
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createTransientImages())
+    computeBarriers();
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildBatches())
+
+    mIsCompiled = true;
+    return BUNNY_HAPPY;
+}
+
+BunnyResult FrameGraph::setRecordingThreadCount(uint32_t threadCount)
+{
+    if (threadCount <= 1 || mRecordingThreadCount > 1)
+    {
+        return BUNNY_HAPPY;
+    }
+
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mRenderer->initRecordingSlots(threadCount - 1))
+    mRecordingDispatcher.StartRunners(threadCount - 1);
+    mRecordingThreadCount = threadCount;
+    mStatistics.mRecordingThreadCount = threadCount;
+    return BUNNY_HAPPY;
+}
+
+void FrameGraph::execute()
+{
+    BUNNY_PROFILE_FUNCTION();
+    uint32_t frameIdx = mRenderer->getCurrentFrameIdx();
+    //  graph work recorded into the graphics command buffer that is not submitted yet
+    bool hasPendingGraphicsWork = false;
+
+    for (uint32_t batchIdx = 0; batchIdx < mBatches.size(); batchIdx++)
+    {
+        const Batch& batch = mBatches[batchIdx];
+        std::vector<VkSemaphore> waitSemaphores;
+        for (const auto& semaphores : batch.mWaitSemaphores)
+        {
+            waitSemaphores.push_back(semaphores[frameIdx]);
+        }
+        std::vector<VkSemaphore> signalSemaphores = getSignalSemaphores(batchIdx, frameIdx);
+
+        if (batch.mIsOnAsyncCompute)
+        {
+            mRenderer->beginAsyncCompute();
+            recordBatch(batch, frameIdx);
+            mRenderer->submitAsyncCompute(waitSemaphores, signalSemaphores);
+
+            if (batch.mFrameEndSemaphores[frameIdx] != VK_NULL_HANDLE)
+            {
+                if (hasPendingGraphicsWork)
+                {
+                    mRenderer->submitGraphicsCommands({});
+                    hasPendingGraphicsWork = false;
+                }
+                mRenderer->addGraphicsWaitSemaphore(
+                    batch.mFrameEndSemaphores[frameIdx], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            }
+            continue;
+        }
+
+        //  a wait holds back the whole submit, so the graphics work before it is submitted on its own
+        if (!waitSemaphores.empty() && hasPendingGraphicsWork)
+        {
+            mRenderer->submitGraphicsCommands({});
+        }
+        for (VkSemaphore semaphore : waitSemaphores)
+        {
+            mRenderer->addGraphicsWaitSemaphore(semaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        }
+
+        recordBatch(batch, frameIdx);
+        hasPendingGraphicsWork = true;
+
+        if (!signalSemaphores.empty())
+        {
+            mRenderer->submitGraphicsCommands(signalSemaphores);
+            hasPendingGraphicsWork = false;
+        }
+    }
+}
+
+void FrameGraph::cleanup()
+{
+    mDeletionStack.Flush();
+    mMemoryBlocks.clear();
+    mBatches.clear();
+    mIsCompiled = false;
+}
+
+const AllocatedImage* FrameGraph::getTransientImage(ResourceHandle resource, uint32_t frameIdx) const
+{
+    return &mResources[resource].mTransientImages[frameIdx];
+}
+
+std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> FrameGraph::getTransientImages(ResourceHandle resource) const
+{
+    std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> images;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        images[idx] = getTransientImage(resource, idx);
+    }
+    return images;
+}
+
+void FrameGraph::printStatistics() const
+{
+    constexpr double bytesPerMB = 1024.0 * 1024.0;
+
+    fmt::print("Frame graph: {} passes, {} culled.\n", mStatistics.mPassCount, mStatistics.mCulledPassCount);
+    for (const Pass& pass : mPasses)
+    {
+        if (pass.mIsCulled)
+        {
+            fmt::print("    {}: culled\n", pass.mName);
+            continue;
+        }
+        size_t barrierCount = std::count_if(pass.mBarriers.begin(), pass.mBarriers.end(),
+            [](const Barrier& barrier) { return !barrier.mIsOptional; });
+        barrierCount += pass.mReleaseBarriers.size();
+        fmt::print("    {}: {} accesses, {} barriers{}\n", pass.mName, pass.mAccesses.size(), barrierCount,
+            pass.mIsOnAsyncCompute ? ", async compute" : "");
+    }
+    fmt::print("Frame graph: {} barriers in {} batches per frame, {} with a barrier before every access.\n",
+        mStatistics.mBarrierCount, mStatistics.mBarrierBatchCount, mStatistics.mNaiveBarrierCount);
+    fmt::print("Frame graph: {} passes on the async compute queue, {} submits, {} queue ownership transfers per frame.\n",
+        mStatistics.mAsyncComputePassCount, mStatistics.mBatchCount, mStatistics.mQueueTransferCount);
+    fmt::print("Frame graph: graphics passes recorded on {} threads.\n", mStatistics.mRecordingThreadCount);
+    fmt::print("Frame graph: transient images use {:.2f} MB per frame in flight, {:.2f} MB without aliasing.\n",
+        mStatistics.mTransientMemorySize / bytesPerMB, mStatistics.mUnaliasedTransientMemorySize / bytesPerMB);
+}
+
+void FrameGraph::cullPasses()
+{
+    std::vector<bool> isNeeded(mResources.size());
+    for (size_t idx = 0; idx < mResources.size(); idx++)
+    {
+        isNeeded[idx] = mResources[idx].mIsOutput;
+    }
+
+    //  walk backwards, a pass is kept if it has side effects or writes something a kept pass after it reads
+    for (auto pass = mPasses.rbegin(); pass != mPasses.rend(); pass++)
+    {
+        pass->mIsCulled = !pass->mHasSideEffect &&
+                          std::none_of(pass->mAccesses.begin(), pass->mAccesses.end(),
+                              [&isNeeded](const Access& access) { return access.mIsWrite && isNeeded[access.mResource]; });
+        if (pass->mIsCulled)
+        {
+            mStatistics.mCulledPassCount++;
+            continue;
+        }
+
+        //  the passes before only matter for what this pass reads, whatever it writes is overwritten
+        for (const Access& access : pass->mAccesses)
+        {
+            if (access.mIsWrite)
+            {
+                isNeeded[access.mResource] = false;
+            }
+        }
+        for (const Access& access : pass->mAccesses)
+        {
+            if (access.mIsRead)
+            {
+                isNeeded[access.mResource] = true;
+            }
+        }
+    }
+
+    mStatistics.mPassCount = static_cast<uint32_t>(mPasses.size());
+}
+
+void FrameGraph::assignQueues()
+{
+    for (Pass& pass : mPasses)
+    {
+        pass.mIsOnAsyncCompute = pass.mIsAsyncCompute && mRenderer->isAsyncComputeEnabled();
+        if (pass.mIsOnAsyncCompute && !pass.mIsCulled)
+        {
+            mStatistics.mAsyncComputePassCount++;
+        }
+    }
+}
+
+void FrameGraph::computeTransientLifetimes()
+{
+    for (Resource& resource : mResources)
+    {
+        resource.mFirstPassIdx = UINT32_MAX;
+        resource.mLastPassIdx = 0;
+        resource.mLastStages = 0;
+        resource.mLastAccess = 0;
+        resource.mAliasSrcStages = 0;
+        resource.mAliasSrcAccess = 0;
+        resource.mIsUsedOnGraphics = false;
+        resource.mIsUsedOnAsyncCompute = false;
+    }
+
+    for (uint32_t passIdx = 0; passIdx < mPasses.size(); passIdx++)
+    {
+        const Pass& pass = mPasses[passIdx];
+        if (pass.mIsCulled)
+        {
+            continue;
+        }
+
+        for (const Access& access : pass.mAccesses)
+        {
+            Resource& resource = mResources[access.mResource];
+            if (resource.mType != ResourceType::TransientImage)
+            {
+                continue;
+            }
+
+            if (resource.mFirstPassIdx == UINT32_MAX)
+            {
+                resource.mFirstPassIdx = passIdx;
+            }
+            resource.mLastPassIdx = passIdx;
+            resource.mLastStages = access.mStages;
+            resource.mLastAccess = access.mAccess & WRITE_ACCESS_MASK;
+            resource.mIsUsedOnGraphics |= !pass.mIsOnAsyncCompute;
+            resource.mIsUsedOnAsyncCompute |= pass.mIsOnAsyncCompute;
+        }
+    }
+}
+
+BunnyResult FrameGraph::createTransientImages()
+{
+    VkDevice device = mVulkanResources->getDevice();
+
+    mDeletionStack.AddFunction([this]() {
+        VkDevice device = mVulkanResources->getDevice();
+        for (Resource& resource : mResources)
+        {
+            for (AllocatedImage& image : resource.mTransientImages)
+            {
+                if (image.mImageView != VK_NULL_HANDLE)
+                {
+                    vkDestroyImageView(device, image.mImageView, nullptr);
+                }
+                if (image.mImage != VK_NULL_HANDLE)
+                {
+                    vkDestroyImage(device, image.mImage, nullptr);
+                }
+                image = AllocatedImage{};
+            }
+        }
+        for (MemoryBlock& block : mMemoryBlocks)
+        {
+            for (VmaAllocation& allocation : block.mAllocations)
+            {
+                mVulkanResources->freeMemory(allocation);
+            }
+        }
+    });
+
+    for (Resource& resource : mResources)
+    {
+        if (resource.mType != ResourceType::TransientImage)
+        {
+            continue;
+        }
+
+        const TransientImageDesc& desc = resource.mTransientDesc;
+        VkImageCreateInfo imgCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imgCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imgCreateInfo.extent = desc.mExtent;
+        imgCreateInfo.mipLevels = 1;
+        imgCreateInfo.arrayLayers = desc.mArrayLayers;
+        imgCreateInfo.format = desc.mFormat;
+        imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imgCreateInfo.usage = desc.mUsage;
+        imgCreateInfo.samples = desc.mSampleCount;
+
+        for (AllocatedImage& image : resource.mTransientImages)
+        {
+            image.mExtent = desc.mExtent;
+            image.mFormat = desc.mFormat;
+            //  the memory belongs to the graph, destroyImage() should not free it
+            image.mIsOwning = false;
+            VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateImage(device, &imgCreateInfo, nullptr, &image.mImage))
+        }
+
+        vkGetImageMemoryRequirements(device, resource.mTransientImages[0].mImage, &resource.mMemoryRequirements);
+        mStatistics.mUnaliasedTransientMemorySize += resource.mMemoryRequirements.size;
+    }
+
+    placeTransientImages();
+
+    for (MemoryBlock& block : mMemoryBlocks)
+    {
+        VkMemoryRequirements blockRequirements{
+            .size = block.mSize, .alignment = block.mAlignment, .memoryTypeBits = block.mMemoryTypeBits};
+        for (VmaAllocation& allocation : block.mAllocations)
+        {
+            BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mVulkanResources->allocateMemory(blockRequirements, allocation))
+        }
+        mStatistics.mTransientMemorySize += block.mSize;
+    }
+
+    for (Resource& resource : mResources)
+    {
+        if (resource.mType != ResourceType::TransientImage)
+        {
+            continue;
+        }
+
+        const MemoryBlock& block = mMemoryBlocks[resource.mMemoryBlockIdx];
+        const uint32_t arrayLayers = resource.mTransientDesc.mArrayLayers;
+        for (uint32_t frameIdx = 0; frameIdx < MAX_FRAMES_IN_FLIGHT; frameIdx++)
+        {
+            AllocatedImage& image = resource.mTransientImages[frameIdx];
+            image.mAllocation = block.mAllocations[frameIdx];
+            BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(
+                mVulkanResources->bindImageMemory(image.mImage, image.mAllocation, resource.mMemoryOffset))
+
+            VkImageViewCreateInfo viewCreateInfo = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            viewCreateInfo.viewType = arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+            viewCreateInfo.image = image.mImage;
+            viewCreateInfo.format = image.mFormat;
+            viewCreateInfo.subresourceRange.baseMipLevel = 0;
+            viewCreateInfo.subresourceRange.levelCount = 1;
+            viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+            viewCreateInfo.subresourceRange.layerCount = arrayLayers;
+            viewCreateInfo.subresourceRange.aspectMask = resource.mAspect;
+            VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateImageView(device, &viewCreateInfo, nullptr, &image.mImageView))
+        }
+    }
+
+    return BUNNY_HAPPY;
+}
+
+void FrameGraph::placeTransientImages()
+{
+    auto isUsed = [](const Resource& resource) { return resource.mFirstPassIdx != UINT32_MAX; };
+    //  the two queues run side by side, so pass order says nothing about images used on different queues
+    auto isLifetimeOverlapping = [&isUsed](const Resource& a, const Resource& b) {
+        const bool isSameQueue = a.mIsUsedOnGraphics == b.mIsUsedOnGraphics &&
+                                 a.mIsUsedOnAsyncCompute == b.mIsUsedOnAsyncCompute &&
+                                 !(a.mIsUsedOnGraphics && a.mIsUsedOnAsyncCompute);
+        return isUsed(a) && isUsed(b) &&
+               (!isSameQueue || (a.mFirstPassIdx <= b.mLastPassIdx && b.mFirstPassIdx <= a.mLastPassIdx));
+    };
+
+    std::vector<ResourceHandle> transients;
+    for (ResourceHandle handle = 0; handle < mResources.size(); handle++)
+    {
+        if (mResources[handle].mType == ResourceType::TransientImage)
+        {
+            transients.push_back(handle);
+        }
+    }
+
+    //  placing the largest ones first packs well enough for the handful of transient images per frame
+    std::sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+        return mResources[a].mMemoryRequirements.size > mResources[b].mMemoryRequirements.size;
+    });
+
+    std::vector<std::vector<ResourceHandle>> placedPerBlock;
+    for (ResourceHandle handle : transients)
+    {
+        Resource& resource = mResources[handle];
+        const VkMemoryRequirements& requirements = resource.mMemoryRequirements;
+
+        bool isPlaced = false;
+        for (uint32_t blockIdx = 0; blockIdx < mMemoryBlocks.size() && !isPlaced; blockIdx++)
+        {
+            MemoryBlock& block = mMemoryBlocks[blockIdx];
+            if ((block.mMemoryTypeBits & requirements.memoryTypeBits) == 0)
+            {
+                continue;
+            }
+
+            //  the image can go at the start of the block or right after any image alive at the same time,
+            //  take the lowest of those that does not overlap with an image alive at the same time
+            std::vector<const Resource*> conflicts;
+            std::vector<VkDeviceSize> candidates{0};
+            for (ResourceHandle placedHandle : placedPerBlock[blockIdx])
+            {
+                const Resource& placed = mResources[placedHandle];
+                if (isLifetimeOverlapping(resource, placed))
+                {
+                    conflicts.push_back(&placed);
+                    candidates.push_back(
+                        alignUp(placed.mMemoryOffset + placed.mMemoryRequirements.size, requirements.alignment));
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            for (VkDeviceSize offset : candidates)
+            {
+                bool isFree = std::none_of(conflicts.begin(), conflicts.end(), [&](const Resource* conflict) {
+                    return isRangeOverlapping(
+                        offset, requirements.size, conflict->mMemoryOffset, conflict->mMemoryRequirements.size);
+                });
+                if (isFree)
+                {
+                    resource.mMemoryBlockIdx = blockIdx;
+                    resource.mMemoryOffset = offset;
+                    block.mMemoryTypeBits &= requirements.memoryTypeBits;
+                    block.mSize = std::max(block.mSize, offset + requirements.size);
+                    block.mAlignment = std::max(block.mAlignment, requirements.alignment);
+                    placedPerBlock[blockIdx].push_back(handle);
+                    isPlaced = true;
+                    break;
+                }
+            }
+        }
+
+        if (!isPlaced)
+        {
+            MemoryBlock& block = mMemoryBlocks.emplace_back();
+            block.mMemoryTypeBits = requirements.memoryTypeBits;
+            block.mSize = requirements.size;
+            block.mAlignment = requirements.alignment;
+            resource.mMemoryBlockIdx = static_cast<uint32_t>(mMemoryBlocks.size() - 1);
+            resource.mMemoryOffset = 0;
+            placedPerBlock.push_back({handle});
+        }
+    }
+
+    //  an image taking over memory from images used earlier in the frame has to wait for them
+    for (ResourceHandle handle : transients)
+    {
+        Resource& resource = mResources[handle];
+        if (!isUsed(resource))
+        {
+            continue;
+        }
+
+        for (ResourceHandle otherHandle : placedPerBlock[resource.mMemoryBlockIdx])
+        {
+            const Resource& other = mResources[otherHandle];
+            if (isUsed(other) && other.mLastPassIdx < resource.mFirstPassIdx &&
+                isRangeOverlapping(resource.mMemoryOffset, resource.mMemoryRequirements.size, other.mMemoryOffset,
+                    other.mMemoryRequirements.size))
+            {
+                resource.mAliasSrcStages |= other.mLastStages;
+                resource.mAliasSrcAccess |= other.mLastAccess;
+            }
+        }
+    }
+}
+
+void FrameGraph::computeBarriers()
+{
+    //  the first walk finds the state each resource ends the frame in,
+    //  the second one starts from there so the recorded barriers are the ones of a steady frame
+    std::vector<ResourceState> states(mResources.size());
+    for (size_t idx = 0; idx < mResources.size(); idx++)
+    {
+        states[idx].mLayout = mResources[idx].mInitialLayout;
+    }
+    simulateAccesses(states, false);
+
+    std::vector<ResourceState> steadyStates(mResources.size());
+    for (size_t idx = 0; idx < mResources.size(); idx++)
+    {
+        if (mResources[idx].mType != ResourceType::TransientImage)
+        {
+            steadyStates[idx] = states[mResources[idx].mCarriedFrom];
+        }
+        steadyStates[idx].mIsAccessed = false;
+    }
+    simulateAccesses(steadyStates, true);
+
+    for (const Pass& pass : mPasses)
+    {
+        if (pass.mIsCulled)
+        {
+            continue;
+        }
+
+        uint32_t barrierCount = static_cast<uint32_t>(std::count_if(pass.mBarriers.begin(), pass.mBarriers.end(),
+            [](const Barrier& barrier) { return !barrier.mIsOptional; }));
+        mStatistics.mBarrierCount += barrierCount + static_cast<uint32_t>(pass.mReleaseBarriers.size());
+        mStatistics.mBarrierBatchCount += (barrierCount > 0 ? 1 : 0) + (pass.mReleaseBarriers.empty() ? 0 : 1);
+        mStatistics.mNaiveBarrierCount += static_cast<uint32_t>(pass.mAccesses.size());
+        mStatistics.mQueueTransferCount += static_cast<uint32_t>(pass.mReleaseBarriers.size());
+    }
+}
+
+void FrameGraph::simulateAccesses(std::vector<ResourceState>& states, bool recordBarriers)
+{
+    const uint32_t graphicsQueueFamily = mVulkanResources->getGraphicQueue().mQueueFamilyIndex.value();
+    const uint32_t computeQueueFamily = mRenderer->isAsyncComputeEnabled()
+                                            ? mVulkanResources->getComputeQueue().mQueueFamilyIndex.value()
+                                            : graphicsQueueFamily;
+
+    if (recordBarriers)
+    {
+        for (Pass& pass : mPasses)
+        {
+            pass.mBarriers.clear();
+            pass.mReleaseBarriers.clear();
+            pass.mWaitPasses.clear();
+        }
+    }
+
+    for (uint32_t passIdx = 0; passIdx < mPasses.size(); passIdx++)
+    {
+        Pass& pass = mPasses[passIdx];
+        if (pass.mIsCulled)
+        {
+            continue;
+        }
+
+        for (const Access& access : pass.mAccesses)
+        {
+            const Resource& resource = mResources[access.mResource];
+            ResourceState& state = states[access.mResource];
+            const bool isImage = resource.mType != ResourceType::Buffer;
+            const bool isFirstAccess = !state.mIsAccessed;
+            //  a resource last used on the other queue has to be released there and acquired here
+            const bool isQueueTransfer =
+                state.mLastPassIdx != UINT32_MAX && state.mIsOnAsyncCompute != pass.mIsOnAsyncCompute;
+            state.mIsAccessed = true;
+
+            Barrier barrier{.mResource = access.mResource,
+                .mSrcStages = 0,
+                .mSrcAccess = 0,
+                .mDstStages = access.mStages,
+                .mDstAccess = access.mAccess,
+                .mOldLayout = isImage ? state.mLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+                .mNewLayout = isImage ? access.mLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+                .mIsFirstAccess = isFirstAccess,
+                .mIsOptional = false};
+            bool isNeeded = false;
+
+            if (resource.mType == ResourceType::TransientImage && isFirstAccess)
+            {
+                //  nothing is kept from the previous frame, but the memory may have been used by another image
+                barrier.mOldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.mSrcStages = resource.mAliasSrcStages;
+                barrier.mSrcAccess = resource.mAliasSrcAccess;
+                isNeeded = true;
+            }
+            else if (isQueueTransfer)
+            {
+                //  the semaphore between the queues covers the execution and memory dependency,
+                //  the acquire here and the release after the last use on the other queue only move the ownership
+                //  and do the layout transition, the two halves have to agree on it
+                barrier.mSrcQueueFamily = state.mIsOnAsyncCompute ? computeQueueFamily : graphicsQueueFamily;
+                barrier.mDstQueueFamily = pass.mIsOnAsyncCompute ? computeQueueFamily : graphicsQueueFamily;
+                isNeeded = true;
+
+                if (recordBarriers)
+                {
+                    Barrier release = barrier;
+                    //  at the start of a frame the resource was last used under the handle it is carried from
+                    release.mResource = isFirstAccess ? resource.mCarriedFrom : access.mResource;
+                    release.mSrcStages = state.mWriteStages | state.mReadStages;
+                    release.mSrcAccess = state.mWriteAccess;
+                    release.mDstStages = 0;
+                    release.mDstAccess = 0;
+                    release.mIsFirstAccess = false;
+                    mPasses[state.mLastPassIdx].mReleaseBarriers.push_back(release);
+
+                    //  across frames the frame fence already orders the two uses
+                    if (!isFirstAccess)
+                    {
+                        pass.mWaitPasses.push_back(state.mLastPassIdx);
+                    }
+                }
+            }
+            else if (access.mIsWrite || barrier.mOldLayout != barrier.mNewLayout)
+            {
+                //  writes and layout transitions wait for the last write and all reads after it
+                isNeeded = barrier.mOldLayout != barrier.mNewLayout || state.mWriteStages != 0 || state.mReadStages != 0;
+                barrier.mSrcStages = state.mWriteStages | state.mReadStages;
+                barrier.mSrcAccess = state.mWriteAccess;
+            }
+            else
+            {
+                //  reads wait for the last write, unless an earlier barrier already made it visible to them
+                bool isVisible = (access.mStages & ~state.mVisibleStages) == 0 &&
+                                 (access.mAccess & ~state.mVisibleAccess) == 0;
+                isNeeded = state.mWriteStages != 0 && !isVisible;
+                barrier.mSrcStages = state.mWriteStages;
+                barrier.mSrcAccess = state.mWriteAccess;
+            }
+
+            //  an imported image seen for the first time may still need a transition from its initial layout
+            if (!isNeeded && isFirstAccess && resource.mType == ResourceType::Image)
+            {
+                barrier.mIsOptional = true;
+            }
+
+            if (recordBarriers && (isNeeded || barrier.mIsOptional))
+            {
+                pass.mBarriers.push_back(barrier);
+            }
+
+            //  update the state after this access
+            if (access.mIsWrite)
+            {
+                state.mWriteStages = access.mStages;
+                state.mWriteAccess = access.mAccess & WRITE_ACCESS_MASK;
+                state.mReadStages = 0;
+                state.mVisibleStages = 0;
+                state.mVisibleAccess = 0;
+            }
+            else if (isNeeded && (barrier.mOldLayout != barrier.mNewLayout || isQueueTransfer))
+            {
+                //  later accesses have to wait for the layout transition or the acquire, which happens before this access
+                state.mWriteStages = access.mStages;
+                state.mReadStages = access.mStages;
+                state.mVisibleStages = access.mStages;
+                state.mVisibleAccess = access.mAccess;
+            }
+            else if (isNeeded)
+            {
+                state.mReadStages |= access.mStages;
+                state.mVisibleStages |= access.mStages;
+                state.mVisibleAccess |= access.mAccess;
+            }
+            else
+            {
+                state.mReadStages |= access.mStages;
+            }
+
+            if (isImage)
+            {
+                state.mLayout = access.mLayout;
+            }
+            state.mIsOnAsyncCompute = pass.mIsOnAsyncCompute;
+            state.mLastPassIdx = passIdx;
+        }
+    }
+}
+
+BunnyResult FrameGraph::buildBatches()
+{
+    std::vector<uint32_t> passBatches(mPasses.size(), UINT32_MAX);
+
+    for (uint32_t passIdx = 0; passIdx < mPasses.size(); passIdx++)
+    {
+        const Pass& pass = mPasses[passIdx];
+        if (pass.mIsCulled)
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> waitBatches;
+        for (uint32_t waitPassIdx : pass.mWaitPasses)
+        {
+            if (std::find(waitBatches.begin(), waitBatches.end(), passBatches[waitPassIdx]) == waitBatches.end())
+            {
+                waitBatches.push_back(passBatches[waitPassIdx]);
+            }
+        }
+
+        //  a new batch starts on a queue switch, or when the pass waits for something the batch does not wait for,
+        //  so the passes before it in the batch do not wait with it
+        bool isNewBatch = mBatches.empty() || mBatches.back().mIsOnAsyncCompute != pass.mIsOnAsyncCompute ||
+                          std::any_of(waitBatches.begin(), waitBatches.end(), [this](uint32_t waitBatch) {
+                              const std::vector<uint32_t>& current = mBatches.back().mWaitBatches;
+                              return std::find(current.begin(), current.end(), waitBatch) == current.end();
+                          });
+        if (isNewBatch)
+        {
+            Batch& batch = mBatches.emplace_back();
+            batch.mIsOnAsyncCompute = pass.mIsOnAsyncCompute;
+            batch.mWaitBatches = std::move(waitBatches);
+        }
+
+        mBatches.back().mPasses.push_back(passIdx);
+        passBatches[passIdx] = static_cast<uint32_t>(mBatches.size() - 1);
+    }
+
+    //  the frame fence is only signaled by the last graphics submit,
+    //  so every compute batch has to be waited for by a graphics batch after it, or by the end of the frame
+    std::vector<bool> isWaitedFor(mBatches.size(), false);
+    for (const Batch& batch : mBatches)
+    {
+        for (uint32_t waitBatch : batch.mWaitBatches)
+        {
+            isWaitedFor[waitBatch] = true;
+        }
+    }
+    std::vector<bool> isWaitedByFrameEnd(mBatches.size(), false);
+    for (uint32_t batchIdx = 0; batchIdx < mBatches.size(); batchIdx++)
+    {
+        if (!mBatches[batchIdx].mIsOnAsyncCompute || isWaitedFor[batchIdx])
+        {
+            continue;
+        }
+
+        auto nextGraphics = std::find_if(mBatches.begin() + batchIdx, mBatches.end(),
+            [](const Batch& batch) { return !batch.mIsOnAsyncCompute; });
+        if (nextGraphics != mBatches.end())
+        {
+            nextGraphics->mWaitBatches.push_back(batchIdx);
+        }
+        else
+        {
+            isWaitedByFrameEnd[batchIdx] = true;
+        }
+    }
+
+    VkDevice device = mVulkanResources->getDevice();
+    VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    auto createSemaphores = [this, device, &semaphoreInfo](
+                                std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT>& semaphores) -> BunnyResult {
+        for (VkSemaphore& semaphore : semaphores)
+        {
+            VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore))
+            mDeletionStack.AddFunction([this, semaphore]() {
+                vkDestroySemaphore(mVulkanResources->getDevice(), semaphore, nullptr);
+            });
+        }
+        return BUNNY_HAPPY;
+    };
+
+    for (uint32_t batchIdx = 0; batchIdx < mBatches.size(); batchIdx++)
+    {
+        Batch& batch = mBatches[batchIdx];
+        batch.mWaitSemaphores.resize(batch.mWaitBatches.size());
+        for (auto& semaphores : batch.mWaitSemaphores)
+        {
+            BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createSemaphores(semaphores))
+        }
+        if (isWaitedByFrameEnd[batchIdx])
+        {
+            BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createSemaphores(batch.mFrameEndSemaphores))
+        }
+    }
+
+    mStatistics.mBatchCount = static_cast<uint32_t>(mBatches.size());
+    return BUNNY_HAPPY;
+}
+
+void FrameGraph::recordBatch(const Batch& batch, uint32_t frameIdx)
+{
+    //  the compute command buffer has no recording slots, and the compute batches are small anyway
+    const uint32_t passCount = static_cast<uint32_t>(batch.mPasses.size());
+    const uint32_t chunkCount = batch.mIsOnAsyncCompute ? 1 : std::min(mRecordingThreadCount, passCount);
+    if (chunkCount <= 1)
+    {
+        recordPasses(batch.mPasses, frameIdx);
+        return;
+    }
+
+    //  the calling thread records the first chunk into the current command buffer, the runners record the others
+    //  into slot command buffers that are submitted right after it in pass order
+    std::span<const uint32_t> passes(batch.mPasses);
+    auto getChunk = [&passes, passCount, chunkCount](uint32_t chunkIdx) {
+        uint32_t begin = chunkIdx * passCount / chunkCount;
+        uint32_t end = (chunkIdx + 1) * passCount / chunkCount;
+        return passes.subspan(begin, end - begin);
+    };
+
+    std::vector<VkCommandBuffer> chunkCommandBuffers(chunkCount - 1);
+    std::vector<std::shared_ptr<Utils::FunctionTask>> tasks;
+    for (uint32_t chunkIdx = 1; chunkIdx < chunkCount; chunkIdx++)
+    {
+        auto task = std::make_shared<Utils::FunctionTask>(
+            [this, chunk = getChunk(chunkIdx), slotIdx = chunkIdx - 1, frameIdx, &chunkCommandBuffers]() {
+                BUNNY_PROFILE_THREAD("Frame graph recording");
+                chunkCommandBuffers[slotIdx] = mRenderer->beginSlotCommandBuffer(slotIdx);
+                recordPasses(chunk, frameIdx);
+                mRenderer->endSlotCommandBuffer();
+            });
+        if (!mRecordingDispatcher.ScheduleTask(task))
+        {
+            task->Run();
+        }
+        tasks.emplace_back(std::move(task));
+    }
+
+    recordPasses(getChunk(0), frameIdx);
+    for (const auto& task : tasks)
+    {
+        task->Wait();
+    }
+    mRenderer->insertGraphicsCommandBuffers(chunkCommandBuffers);
+}
+
+void FrameGraph::recordPasses(std::span<const uint32_t> passes, uint32_t frameIdx)
+{
+    for (uint32_t passIdx : passes)
+    {
+        const Pass& pass = mPasses[passIdx];
+        VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+
+        BUNNY_PROFILE_ZONE(pass.mName.c_str());
+        mRenderer->beginGpuZone(pass.mName);
+        recordBarriers(cmd, pass.mBarriers, frameIdx);
+        if (pass.mExecute)
+        {
+            pass.mExecute();
+        }
+        recordBarriers(cmd, pass.mReleaseBarriers, frameIdx);
+        mRenderer->endGpuZone();
+    }
+}
+
+std::vector<VkSemaphore> FrameGraph::getSignalSemaphores(uint32_t batchIdx, uint32_t frameIdx) const
+{
+    std::vector<VkSemaphore> semaphores;
+    for (const Batch& batch : mBatches)
+    {
+        for (size_t waitIdx = 0; waitIdx < batch.mWaitBatches.size(); waitIdx++)
+        {
+            if (batch.mWaitBatches[waitIdx] == batchIdx)
+            {
+                semaphores.push_back(batch.mWaitSemaphores[waitIdx][frameIdx]);
+            }
+        }
+    }
+    if (mBatches[batchIdx].mFrameEndSemaphores[frameIdx] != VK_NULL_HANDLE)
+    {
+        semaphores.push_back(mBatches[batchIdx].mFrameEndSemaphores[frameIdx]);
+    }
+    return semaphores;
+}
+
+bool FrameGraph::isImageKnown(const Resource& resource, VkImage image) const
+{
+    //  ping pong images are seen under both handles
+    const std::vector<VkImage>& carried = mResources[resource.mCarriedFrom].mKnownImages;
+    return std::find(resource.mKnownImages.begin(), resource.mKnownImages.end(), image) !=
+               resource.mKnownImages.end() ||
+           std::find(carried.begin(), carried.end(), image) != carried.end();
+}
+
+void FrameGraph::recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers, uint32_t frameIdx)
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+
+    for (const Barrier& barrier : barriers)
+    {
+        Resource& resource = mResources[barrier.mResource];
+        uint32_t srcQueueFamily = barrier.mSrcQueueFamily;
+        uint32_t dstQueueFamily = barrier.mDstQueueFamily;
+
+        if (resource.mType == ResourceType::Buffer)
+        {
+            VkBufferMemoryBarrier& bufferBarrier = bufferBarriers.emplace_back(
+                makeBufferMemoryBarrier(resource.mBufferGetter()->mBuffer, VK_QUEUE_FAMILY_IGNORED));
+            bufferBarrier.srcAccessMask = barrier.mSrcAccess;
+            bufferBarrier.dstAccessMask = barrier.mDstAccess;
+            bufferBarrier.srcQueueFamilyIndex = srcQueueFamily;
+            bufferBarrier.dstQueueFamilyIndex = dstQueueFamily;
+        }
+        else
+        {
+            VkImage image = resource.mType == ResourceType::TransientImage
+                                ? resource.mTransientImages[frameIdx].mImage
+                                : resource.mImageGetter()->mImage;
+            VkImageLayout oldLayout = barrier.mOldLayout;
+
+            //  first time the graph sees this image (first frame, or it was recreated e.g. on resize),
+            //  there was no release on the other queue either
+            if (barrier.mIsFirstAccess && resource.mType == ResourceType::Image)
+            {
+                std::lock_guard lock(mKnownImagesMutex);
+                if (!isImageKnown(resource, image))
+                {
+                    oldLayout = resource.mInitialLayout;
+                    srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+                    dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+                    resource.mKnownImages.push_back(image);
+                }
+            }
+
+            if (barrier.mIsOptional && oldLayout == barrier.mNewLayout)
+            {
+                continue;
+            }
+
+            VkImageMemoryBarrier& imageBarrier = imageBarriers.emplace_back(makeImageMemoryBarrier(image,
+                barrier.mSrcAccess, barrier.mDstAccess, oldLayout, barrier.mNewLayout, resource.mAspect));
+            imageBarrier.srcQueueFamilyIndex = srcQueueFamily;
+            imageBarrier.dstQueueFamilyIndex = dstQueueFamily;
+        }
+
+        srcStages |= barrier.mSrcStages;
+        dstStages |= barrier.mDstStages;
+    }
+
+    if (imageBarriers.empty() && bufferBarriers.empty())
+    {
+        return;
+    }
+
+    //  acquires have no source and releases no destination on their own queue
+    vkCmdPipelineBarrier(cmd, srcStages == 0 ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : srcStages,
+        dstStages == 0 ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()),
+        imageBarriers.data());
+}
+
+} // namespace Bunny::Render
@@ -0,0 +1,92 @@
+#include "FrameGraphValidation.h"
+
+#include "Error.h"
+#include "FrameGraph.h"
+
+#include <fmt/core.h>
+
+#include <string_view>
+
+namespace Bunny::Render
+{
+namespace
+{
+template <typename T> uint32_t checkStatistic(std::string_view name, T value, T expected)
+{
+    if (value == expected)
+    {
+        return 0;
+    }
+    PRINT_WARNING(fmt::format("Frame graph validation: {} is {}, expected {}.", name, value, expected))
+    return 1;
+}
+} // namespace
+
+uint32_t validateFrameGraph(const VulkanRenderResources* vulkanResources, VulkanGraphicsRenderer* renderer)
+{
+    FrameGraph frameGraph(vulkanResources, renderer);
+
+    //  the getters are only called when the graph is executed, which this one never is
+    auto result = frameGraph.importBuffer("result", []() { return nullptr; });
+    auto unused = frameGraph.importBuffer("unused", []() { return nullptr; });
+    frameGraph.markOutput(result);
+
+    //  same size and format, so the memory of a and c can be shared exactly
+    const FrameGraph::TransientImageDesc imageDesc{.mExtent = {256, 256, 1},
+        .mFormat = VK_FORMAT_R8G8B8A8_UNORM,
+        .mUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT};
+    auto imageA = frameGraph.createTransientImage("a", imageDesc);
+    auto imageB = frameGraph.createTransientImage("b", imageDesc);
+    auto imageC = frameGraph.createTransientImage("c", imageDesc);
+
+    constexpr VkPipelineStageFlags compute = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    constexpr VkAccessFlags read = VK_ACCESS_SHADER_READ_BIT;
+    constexpr VkAccessFlags write = VK_ACCESS_SHADER_WRITE_BIT;
+    constexpr VkImageLayout general = VK_IMAGE_LAYOUT_GENERAL;
+
+    //  1 barrier, first use of a
+    frameGraph.addPass("write a").write(imageA, compute, write, general);
+    //  2 barriers, a is read after its write and b is used the first time
+    frameGraph.addPass("a to b").read(imageA, compute, read, general).write(imageB, compute, write, general);
+    //  2 barriers, the same for b and c, c starts after a ends and takes over its memory
+    frameGraph.addPass("b to c").read(imageB, compute, read, general).write(imageC, compute, write, general);
+    //  2 barriers, b is already visible to compute reads, c changes layout and result is written after the last
+    //  frame wrote it
+    frameGraph.addPass("read b and c")
+        .read(imageB, compute, read, general)
+        .read(imageC, compute, read, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .write(result, compute, write);
+    //  culled, nothing reads what it writes
+    frameGraph.addPass("write unused").write(unused, compute, write);
+
+    if (!BUNNY_SUCCESS(frameGraph.compile()))
+    {
+        PRINT_AND_RETURN_VALUE("Frame graph validation: failed to compile the graph.", 1)
+    }
+
+    const FrameGraph::Statistics& statistics = frameGraph.getStatistics();
+    uint32_t mismatchCount = 0;
+    mismatchCount += checkStatistic("pass count", statistics.mPassCount, 5u);
+    mismatchCount += checkStatistic("culled pass count", statistics.mCulledPassCount, 1u);
+    mismatchCount += checkStatistic("barrier count", statistics.mBarrierCount, 7u);
+    mismatchCount += checkStatistic("barrier batch count", statistics.mBarrierBatchCount, 4u);
+    mismatchCount += checkStatistic("naive barrier count", statistics.mNaiveBarrierCount, 8u);
+    mismatchCount += checkStatistic("async compute pass count", statistics.mAsyncComputePassCount, 0u);
+    mismatchCount += checkStatistic("batch count", statistics.mBatchCount, 1u);
+    mismatchCount += checkStatistic("queue transfer count", statistics.mQueueTransferCount, 0u);
+
+    //  a and c share memory and b sits next to them, two images plus the alignment padding between them
+    const VkDeviceSize imageSize = statistics.mUnaliasedTransientMemorySize / 3;
+    const bool isAliased =
+        statistics.mTransientMemorySize >= 2 * imageSize && statistics.mTransientMemorySize < 3 * imageSize;
+    if (!isAliased)
+    {
+        PRINT_WARNING(fmt::format("Frame graph validation: transient images use {} bytes, expected two of the three "
+                                  "images of {} bytes to share memory.",
+            statistics.mTransientMemorySize, imageSize))
+        mismatchCount++;
+    }
+
+    return mismatchCount;
+}
+} // namespace Bunny::Render
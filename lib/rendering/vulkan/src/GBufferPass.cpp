@@ -250,8 +250,8 @@ void GBufferPass::initDescriptorSets()
 BunnyResult GBufferPass::initPipeline()
 {
     //  load shader
-    Shader vertexShader(mVertexShaderPath, mVulkanResources->getDevice());
-    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getDevice());
+    Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
 
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {mUniformDescLayout, mStorageDescLayout, mStorageDescLayout};
@@ -285,6 +285,7 @@ BunnyResult GBufferPass::initPipeline()
     builder.setDepthFormat(mRenderer->getDepthImageFormat());
     builder.setPipelineLayout(mPipelineLayout);
 
+    builder.setPipelineCache(mVulkanResources->getPipelineCache());
     mPipeline = builder.build(mVulkanResources->getDevice());
 
     return BUNNY_HAPPY;
@@ -294,8 +295,8 @@ void GBufferPass::createImages()
 {
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-        VkExtent2D swapChainExtent = mRenderer->getSwapChainExtent();
-        VkExtent3D imageExtent{.width = swapChainExtent.width, .height = swapChainExtent.height, .depth = 1};
+        VkExtent2D renderExtent = mRenderer->getRenderExtent();
+        VkExtent3D imageExtent{.width = renderExtent.width, .height = renderExtent.height, .depth = 1};
         mColorMaps[i] = mVulkanResources->createImage(imageExtent, VK_FORMAT_R8G8B8A8_UNORM,
             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
         mFragPosMaps[i] = mVulkanResources->createImage(imageExtent, VK_FORMAT_R16G16B16A16_SFLOAT,
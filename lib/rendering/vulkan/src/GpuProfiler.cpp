@@ -0,0 +1,402 @@
+#include "GpuProfiler.h"
+
+#include "VulkanRenderResources.h"
+#include "Error.h"
+#include "ErrorCheck.h"
+#include "JsonHelpers.h"
+
+#include <fmt/core.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace Bunny::Render
+{
+static constexpr uint32_t NOT_RECORDED_ZONE = UINT32_MAX;
+static constexpr double AVERAGE_WEIGHT = 0.05;
+
+GpuProfiler::GpuProfiler(const VulkanRenderResources* vulkanResources) : mVulkanResources(vulkanResources)
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    cleanup();
+}
+
+BunnyResult GpuProfiler::initialize()
+{
+    VkPhysicalDeviceProperties properties = mVulkanResources->getPhysicalDeviceProperties(nullptr);
+    mTimestampPeriod = properties.limits.timestampPeriod;
+    //  the passes on the compute queue are timed as well, so timestamps have to work on both queues
+    mIsSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+    if (!mIsSupported)
+    {
+        PRINT_WARNING("Timestamp queries are not supported on all queues, gpu profiling is disabled.")
+        return BUNNY_HAPPY;
+    }
+
+    VkDevice device = mVulkanResources->getDevice();
+    for (uint32_t frameIdx = 0; frameIdx < MAX_FRAMES_IN_FLIGHT; frameIdx++)
+    {
+        VkQueryPoolCreateInfo timestampPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampPoolInfo.queryCount = MAX_ZONE_COUNT * 2;
+        VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateQueryPool(device, &timestampPoolInfo, nullptr, &mTimestampPools[frameIdx]))
+        vkResetQueryPool(device, mTimestampPools[frameIdx], 0, MAX_ZONE_COUNT * 2);
+
+        if (mVulkanResources->getSupportPipelineStatistics())
+        {
+            //  the order of the results follows the order of the bits
+            VkQueryPoolCreateInfo statisticsPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            statisticsPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsPoolInfo.queryCount = MAX_ZONE_COUNT;
+            statisticsPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                                    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                                    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                                    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+            VK_CHECK_OR_RETURN_BUNNY_SAD(
+                vkCreateQueryPool(device, &statisticsPoolInfo, nullptr, &mStatisticsPools[frameIdx]))
+            vkResetQueryPool(device, mStatisticsPools[frameIdx], 0, MAX_ZONE_COUNT);
+        }
+    }
+
+    mDeletionStack.AddFunction([this, device]() {
+        for (uint32_t frameIdx = 0; frameIdx < MAX_FRAMES_IN_FLIGHT; frameIdx++)
+        {
+            vkDestroyQueryPool(device, mTimestampPools[frameIdx], nullptr);
+            vkDestroyQueryPool(device, mStatisticsPools[frameIdx], nullptr);
+            mTimestampPools[frameIdx] = VK_NULL_HANDLE;
+            mStatisticsPools[frameIdx] = VK_NULL_HANDLE;
+        }
+    });
+
+    return BUNNY_HAPPY;
+}
+
+void GpuProfiler::cleanup()
+{
+    mDeletionStack.Flush();
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIdx)
+{
+    mCurrentFrameIdx = frameIdx;
+    mOpenZones.clear();
+    if (!mIsSupported)
+    {
+        return;
+    }
+
+    FrameZones& frame = mFrameZones[frameIdx];
+    if (!frame.mZones.empty())
+    {
+        readResults(frameIdx);
+
+        VkDevice device = mVulkanResources->getDevice();
+        vkResetQueryPool(device, mTimestampPools[frameIdx], 0, MAX_ZONE_COUNT * 2);
+        if (mStatisticsPools[frameIdx] != VK_NULL_HANDLE)
+        {
+            vkResetQueryPool(device, mStatisticsPools[frameIdx], 0, MAX_ZONE_COUNT);
+        }
+    }
+
+    frame.mZones.clear();
+    frame.mFrameNumber = mFrameNumber++;
+}
+
+void GpuProfiler::beginZone(VkCommandBuffer cmd, std::string_view name, bool isOnAsyncCompute)
+{
+    std::lock_guard lock(mZoneMutex);
+    FrameZones& frame = mFrameZones[mCurrentFrameIdx];
+    OpenZones& openZones = mOpenZones[cmd];
+    if (!mIsSupported || !mIsEnabled || frame.mZones.size() >= MAX_ZONE_COUNT)
+    {
+        openZones.mZones.push_back(NOT_RECORDED_ZONE);
+        return;
+    }
+
+    //  pipeline statistics can not be queried on a compute only queue, and queries of one type can not nest
+    bool hasStatistics = mIsStatisticsEnabled && mStatisticsPools[mCurrentFrameIdx] != VK_NULL_HANDLE &&
+                         !isOnAsyncCompute && !openZones.mIsStatisticsQueryActive;
+
+    uint32_t zoneIdx = static_cast<uint32_t>(frame.mZones.size());
+    frame.mZones.push_back(Zone{.mName{name}, .mIsOnAsyncCompute = isOnAsyncCompute, .mHasStatistics = hasStatistics});
+    openZones.mZones.push_back(zoneIdx);
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestampPools[mCurrentFrameIdx], zoneIdx * 2);
+    if (hasStatistics)
+    {
+        vkCmdBeginQuery(cmd, mStatisticsPools[mCurrentFrameIdx], zoneIdx, 0);
+        openZones.mIsStatisticsQueryActive = true;
+    }
+}
+
+void GpuProfiler::endZone(VkCommandBuffer cmd)
+{
+    std::lock_guard lock(mZoneMutex);
+    auto openIter = mOpenZones.find(cmd);
+    if (openIter == mOpenZones.end() || openIter->second.mZones.empty())
+    {
+        return;
+    }
+    OpenZones& openZones = openIter->second;
+    uint32_t zoneIdx = openZones.mZones.back();
+    openZones.mZones.pop_back();
+    if (zoneIdx == NOT_RECORDED_ZONE)
+    {
+        return;
+    }
+
+    if (mFrameZones[mCurrentFrameIdx].mZones[zoneIdx].mHasStatistics)
+    {
+        vkCmdEndQuery(cmd, mStatisticsPools[mCurrentFrameIdx], zoneIdx);
+        openZones.mIsStatisticsQueryActive = false;
+    }
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampPools[mCurrentFrameIdx], zoneIdx * 2 + 1);
+}
+
+void GpuProfiler::readResults(uint32_t frameIdx)
+{
+    const FrameZones& frame = mFrameZones[frameIdx];
+    VkDevice device = mVulkanResources->getDevice();
+    uint32_t zoneCount = static_cast<uint32_t>(frame.mZones.size());
+
+    //  no wait flag, a frame that was never submitted (e.g. the swapchain was recreated) just has no results
+    std::vector<uint64_t> timestamps(zoneCount * 2);
+    VkResult result = vkGetQueryPoolResults(device, mTimestampPools[frameIdx], 0, zoneCount * 2,
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+    {
+        return;
+    }
+
+    FrameResult frameResult;
+    frameResult.mFrameNumber = frame.mFrameNumber;
+    frameResult.mStartTimestamp = UINT64_MAX;
+    uint64_t endTimestamp = 0;
+    for (uint32_t zoneIdx = 0; zoneIdx < zoneCount; zoneIdx++)
+    {
+        frameResult.mStartTimestamp = std::min(frameResult.mStartTimestamp, timestamps[zoneIdx * 2]);
+        endTimestamp = std::max(endTimestamp, timestamps[zoneIdx * 2 + 1]);
+    }
+    frameResult.mDurationMs =
+        endTimestamp > frameResult.mStartTimestamp ? ticksToMs(endTimestamp - frameResult.mStartTimestamp) : 0;
+
+    for (uint32_t zoneIdx = 0; zoneIdx < zoneCount; zoneIdx++)
+    {
+        const Zone& zone = frame.mZones[zoneIdx];
+        uint64_t begin = timestamps[zoneIdx * 2];
+        uint64_t end = timestamps[zoneIdx * 2 + 1];
+
+        ZoneResult& zoneResult = frameResult.mZones.emplace_back();
+        zoneResult.mName = zone.mName;
+        zoneResult.mIsOnAsyncCompute = zone.mIsOnAsyncCompute;
+        zoneResult.mStartMs = ticksToMs(begin - frameResult.mStartTimestamp);
+        zoneResult.mDurationMs = end > begin ? ticksToMs(end - begin) : 0;
+
+        if (zone.mHasStatistics)
+        {
+            result = vkGetQueryPoolResults(device, mStatisticsPools[frameIdx], zoneIdx, 1,
+                sizeof(zoneResult.mStatistics), zoneResult.mStatistics.data(), sizeof(zoneResult.mStatistics),
+                VK_QUERY_RESULT_64_BIT);
+            zoneResult.mHasStatistics = result == VK_SUCCESS;
+        }
+
+        auto averageIter = mAverageDurationsMs.find(zone.mName);
+        if (averageIter == mAverageDurationsMs.end())
+        {
+            mAverageDurationsMs.emplace(zone.mName, zoneResult.mDurationMs);
+        }
+        else
+        {
+            averageIter->second += (zoneResult.mDurationMs - averageIter->second) * AVERAGE_WEIGHT;
+        }
+    }
+
+    mCapturedFrames.push_back(std::move(frameResult));
+    if (mCapturedFrames.size() > MAX_CAPTURED_FRAME_COUNT)
+    {
+        mCapturedFrames.pop_front();
+    }
+}
+
+double GpuProfiler::ticksToMs(uint64_t ticks) const
+{
+    return static_cast<double>(ticks) * mTimestampPeriod / 1000000.0;
+}
+
+BunnyResult GpuProfiler::exportCsv(std::string_view filePath) const
+{
+    std::ofstream file{std::string(filePath), std::ios::trunc};
+    if (!file.is_open())
+    {
+        std::string errMsg = fmt::format("Can not open {} to export gpu profile.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+
+    file << "frame,zone,queue,start_ms,duration_ms";
+    for (const char* statisticName : PIPELINE_STATISTIC_NAMES)
+    {
+        file << "," << statisticName;
+    }
+    file << "\n";
+
+    for (const FrameResult& frame : mCapturedFrames)
+    {
+        for (const ZoneResult& zone : frame.mZones)
+        {
+            file << fmt::format("{},\"{}\",{},{:.4f},{:.4f}", frame.mFrameNumber, Base::escapeCsvField(zone.mName),
+                zone.mIsOnAsyncCompute ? "compute" : "graphics", zone.mStartMs, zone.mDurationMs);
+            for (uint64_t statistic : zone.mStatistics)
+            {
+                file << ",";
+                if (zone.mHasStatistics)
+                {
+                    file << statistic;
+                }
+            }
+            file << "\n";
+        }
+    }
+
+    if (!file.good())
+    {
+        std::string errMsg = fmt::format("Fail to export gpu profile to {}.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+    return BUNNY_HAPPY;
+}
+
+BunnyResult GpuProfiler::exportChromeTrace(std::string_view filePath) const
+{
+    std::ofstream file{std::string(filePath), std::ios::trunc};
+    if (!file.is_open())
+    {
+        std::string errMsg = fmt::format("Can not open {} to export gpu trace.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+
+    //  timestamps of both queues are on the same device clock, so one queue per track lines them up
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << R"({"name":"thread_name","ph":"M","pid":0,"tid":0,"args":{"name":"Graphics queue"}},)" << "\n";
+    file << R"({"name":"thread_name","ph":"M","pid":0,"tid":1,"args":{"name":"Compute queue"}})";
+
+    uint64_t traceStartTimestamp = mCapturedFrames.empty() ? 0 : mCapturedFrames.front().mStartTimestamp;
+    for (const FrameResult& frame : mCapturedFrames)
+    {
+        double frameStartUs = frame.mStartTimestamp > traceStartTimestamp
+                                  ? ticksToMs(frame.mStartTimestamp - traceStartTimestamp) * 1000.0
+                                  : 0;
+        for (const ZoneResult& zone : frame.mZones)
+        {
+            file << fmt::format(
+                ",\n{{\"name\":\"{}\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},"
+                "\"args\":{{\"frame\":{}}}}}",
+                Base::escapeJsonString(zone.mName), zone.mIsOnAsyncCompute ? 1 : 0,
+                frameStartUs + zone.mStartMs * 1000.0, zone.mDurationMs * 1000.0, frame.mFrameNumber);
+        }
+    }
+    file << "\n]}\n";
+
+    if (!file.good())
+    {
+        std::string errMsg = fmt::format("Fail to export gpu trace to {}.", filePath);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+    return BUNNY_HAPPY;
+}
+
+void GpuProfiler::showImguiPanel()
+{
+    if (!ImGui::Begin("GPU Profiler"))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!mIsSupported)
+    {
+        ImGui::Text("Timestamp queries are not supported by the device.");
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Enabled", &mIsEnabled);
+    if (isPipelineStatisticsSupported())
+    {
+        ImGui::SameLine();
+        ImGui::Checkbox("Pipeline statistics", &mIsStatisticsEnabled);
+    }
+
+    if (ImGui::Button("Export CSV"))
+    {
+        exportCsv("./gpu_profile.csv");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace"))
+    {
+        exportChromeTrace("./gpu_trace.json");
+    }
+
+    if (mCapturedFrames.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    const FrameResult& frame = mCapturedFrames.back();
+    ImGui::Text(fmt::format("Frame {}: {:.3f} ms", frame.mFrameNumber, frame.mDurationMs).c_str());
+
+    bool showStatistics = mIsStatisticsEnabled && isPipelineStatisticsSupported();
+    int columnCount = 5 + (showStatistics ? PIPELINE_STATISTIC_COUNT : 0);
+    if (ImGui::BeginTable("GPU zones", columnCount,
+            ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+    {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Queue");
+        ImGui::TableSetupColumn("Start (ms)");
+        ImGui::TableSetupColumn("Time (ms)");
+        ImGui::TableSetupColumn("Average (ms)");
+        if (showStatistics)
+        {
+            for (const char* statisticName : PIPELINE_STATISTIC_NAMES)
+            {
+                ImGui::TableSetupColumn(statisticName);
+            }
+        }
+        ImGui::TableHeadersRow();
+
+        for (const ZoneResult& zone : frame.mZones)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(zone.mName.c_str());
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(zone.mIsOnAsyncCompute ? "compute" : "graphics");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", zone.mStartMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", zone.mDurationMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", mAverageDurationsMs[zone.mName]);
+            if (showStatistics)
+            {
+                for (uint64_t statistic : zone.mStatistics)
+                {
+                    ImGui::TableNextColumn();
+                    if (zone.mHasStatistics)
+                    {
+                        ImGui::TextUnformatted(fmt::format("{}", statistic).c_str());
+                    }
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+} // namespace Bunny::Render
@@ -67,7 +67,7 @@ VkPipeline GraphicsPipelineBuilder::build(VkDevice device, PipelineType pipeline
 
     //  build the pipeline!
     VkPipeline newPipeline;
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, mPipelineCache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
     {
         return VK_NULL_HANDLE; // failed to create graphics pipeline
     }
@@ -179,6 +179,11 @@ void GraphicsPipelineBuilder::setPipelineLayout(VkPipelineLayout layout)
     mPipelineLayout = layout;
 }
 
+void GraphicsPipelineBuilder::setPipelineCache(VkPipelineCache pipelineCache)
+{
+    mPipelineCache = pipelineCache;
+}
+
 void GraphicsPipelineBuilder::addColorAttachmentNoBlend(VkFormat format)
 {
     addColorAttachmentWithBlend(format, makeNoBlendAttachmentState());
@@ -0,0 +1,244 @@
+#include "LightClusterPass.h"
+
+#include "VulkanRenderResources.h"
+#include "VulkanGraphicsRenderer.h"
+#include "Shader.h"
+#include "ErrorCheck.h"
+#include "Error.h"
+#include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
+#include "LightClustering.h"
+
+#include <fmt/core.h>
+
+namespace Bunny::Render
+{
+LightClusterPass::LightClusterPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer)
+    : mVulkanResources(vulkanResources),
+      mRenderer(renderer)
+{
+}
+
+BunnyResult LightClusterPass::initializePass()
+{
+    initDescriptorSets();
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initPipeline())
+    createBuffers();
+
+    return BUNNY_HAPPY;
+}
+
+void LightClusterPass::cleanup()
+{
+    VkDevice device = mVulkanResources->getDevice();
+
+    if (mPipeline != nullptr)
+    {
+        vkDestroyPipeline(device, mPipeline, nullptr);
+        mPipeline = nullptr;
+    }
+
+    if (mPipelineLayout != nullptr)
+    {
+        vkDestroyPipelineLayout(device, mPipelineLayout, nullptr);
+        mPipelineLayout = nullptr;
+    }
+
+    mDescriptorAllocator.destroyPools(device);
+
+    if (mDescSetLayout != nullptr)
+    {
+        vkDestroyDescriptorSetLayout(device, mDescSetLayout, nullptr);
+        mDescSetLayout = nullptr;
+    }
+
+    for (AllocatedBuffer& buffer : mClusterBuffers)
+    {
+        if (buffer.mBuffer != nullptr)
+        {
+            mVulkanResources->destroyBuffer(buffer);
+            buffer.mBuffer = nullptr;
+        }
+    }
+
+    for (ValidationFrame& frame : mValidationFrames)
+    {
+        if (frame.mReadbackBuffer.mBuffer != nullptr)
+        {
+            mVulkanResources->destroyBuffer(frame.mReadbackBuffer);
+            frame.mReadbackBuffer.mBuffer = nullptr;
+        }
+    }
+}
+
+void LightClusterPass::createBuffers()
+{
+    for (AllocatedBuffer& buffer : mClusterBuffers)
+    {
+        buffer = mVulkanResources->createBuffer(sizeof(LightClusterData),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0, VMA_MEMORY_USAGE_AUTO);
+    }
+
+    DescriptorWriter writer;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        writer.clear();
+        writer.writeBuffer(
+            1, mClusterBuffers[idx].mBuffer, sizeof(LightClusterData), 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        writer.updateSet(mVulkanResources->getDevice(), mDescSets[idx]);
+    }
+}
+
+void LightClusterPass::linkLightData(const FrameBufferSlice& clusteredLightData)
+{
+    mClusteredLightData = &clusteredLightData;
+
+    DescriptorWriter writer;
+    writer.writeBuffer(0, clusteredLightData.mBuffer, clusteredLightData.mRange, 0,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+    for (VkDescriptorSet set : mDescSets)
+    {
+        writer.updateSet(mVulkanResources->getDevice(), set);
+    }
+}
+
+void LightClusterPass::updateClusterParams(const Camera& camera, std::span<const ClusteredLight> lights)
+{
+    mParams = makeLightClusterParams(camera);
+
+    if (mIsValidationEnabled)
+    {
+        mValidationLights.assign(lights.begin(), lights.end());
+    }
+}
+
+const AllocatedBuffer& LightClusterPass::getCurrentClusterBuffer() const
+{
+    return mClusterBuffers[mRenderer->getCurrentFrameIdx()];
+}
+
+void LightClusterPass::dispatch()
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    uint32_t currentFrameIdx = mRenderer->getCurrentFrameIdx();
+
+    //  the frame fence has been waited for, so the readback of this frame index from last time is complete
+    if (mIsValidationEnabled)
+    {
+        validateClusters(currentFrameIdx);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescSets[currentFrameIdx],
+        1, &mClusteredLightData->mOffset);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(LightClusterParams), &mParams);
+
+    //  one thread per cluster
+    constexpr static uint32_t computeSizeX = 64;
+    vkCmdDispatch(cmd, (LIGHT_CLUSTER_COUNT + computeSizeX - 1) / computeSizeX, 1, 1);
+
+    //  the barrier for the shading passes reading the clusters is recorded by the frame graph
+    if (mIsValidationEnabled)
+    {
+        ValidationFrame& frame = mValidationFrames[currentFrameIdx];
+        if (frame.mReadbackBuffer.mBuffer == nullptr)
+        {
+            frame.mReadbackBuffer = mVulkanResources->createBuffer(sizeof(LightClusterData),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, VMA_MEMORY_USAGE_AUTO);
+        }
+
+        const AllocatedBuffer& clusterBuffer = mClusterBuffers[currentFrameIdx];
+        mVulkanResources->transitionBufferAccess(cmd, clusterBuffer.mBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        mVulkanResources->copyBuffer(
+            cmd, clusterBuffer.mBuffer, frame.mReadbackBuffer.mBuffer, sizeof(LightClusterData));
+        mVulkanResources->transitionBufferAccess(cmd, frame.mReadbackBuffer.mBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+
+        frame.mParams = mParams;
+        frame.mLights = mValidationLights;
+        frame.mHasResult = true;
+    }
+}
+
+void LightClusterPass::validateClusters(uint32_t frameIdx)
+{
+    ValidationFrame& frame = mValidationFrames[frameIdx];
+    if (!frame.mHasResult)
+    {
+        return;
+    }
+    frame.mHasResult = false;
+
+    mVulkanResources->invalidateMappedBuffer(frame.mReadbackBuffer);
+    const auto* gpuClusters = static_cast<const LightClusterData*>(frame.mReadbackBuffer.mAllocationInfo.pMappedData);
+    const uint32_t mismatchCount = validateLightClusters(frame.mParams, frame.mLights, *gpuClusters);
+    if (mismatchCount > 0)
+    {
+        PRINT_WARNING(fmt::format("{} of {} light clusters do not match the cpu binning of {} lights.", mismatchCount,
+            LIGHT_CLUSTER_COUNT, frame.mLights.size()))
+    }
+}
+
+LightClusterPass::~LightClusterPass()
+{
+    cleanup();
+}
+
+void LightClusterPass::initDescriptorSets()
+{
+    DescriptorLayoutBuilder layoutBuilder;
+    VkDescriptorSetLayoutBinding storageBufferBinding{
+        0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+
+    //  clustered lights, in the frame buffer arena
+    storageBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    layoutBuilder.addBinding(storageBufferBinding);
+    //  light clusters
+    storageBufferBinding.binding = 1;
+    storageBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    layoutBuilder.addBinding(storageBufferBinding);
+    mDescSetLayout = layoutBuilder.build(mVulkanResources->getDevice());
+
+    DescriptorAllocator::PoolSize poolSizes[] = {
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 1},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, .mRatio = 1},
+    };
+    mDescriptorAllocator.init(mVulkanResources->getDevice(), MAX_FRAMES_IN_FLIGHT, poolSizes);
+
+    for (VkDescriptorSet& set : mDescSets)
+    {
+        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), &mDescSetLayout, &set);
+    }
+}
+
+BunnyResult LightClusterPass::initPipeline()
+{
+    VkPushConstantRange pushConstRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(LightClusterParams)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mDescSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstRange;
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        vkCreatePipelineLayout(mVulkanResources->getDevice(), &pipelineLayoutInfo, nullptr, &mPipelineLayout))
+
+    return PipelineCompileQueue::enqueue([this]() {
+        Shader computeShader(mLightClusterShaderPath, mVulkanResources->getShaderModuleCache());
+
+        ComputePipelineBuilder pipelineBuilder;
+        pipelineBuilder.setShader(computeShader.getShaderModule());
+        pipelineBuilder.setPipelineLayout(mPipelineLayout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
+}
+
+} // namespace Bunny::Render
@@ -0,0 +1,145 @@
+#include "LightClustering.h"
+
+#include "Camera.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Bunny::Render
+{
+LightClusterParams makeLightClusterParams(const Camera& camera)
+{
+    const float tanHalfFovY = std::tan(camera.getFov() * 0.5f);
+    return LightClusterParams{
+        .mViewMat = camera.getViewMatrix(),
+        .mTanHalfFovX = tanHalfFovY * camera.getAspectRatio(),
+        .mTanHalfFovY = tanHalfFovY,
+        .mZNear = Camera::NearPlaneDistance,
+        .mZFar = Camera::FarPlaneDistance,
+    };
+}
+
+LightClusterBounds getLightClusterBounds(const LightClusterParams& params, uint32_t clusterIdx)
+{
+    const uint32_t x = clusterIdx % LIGHT_CLUSTER_COUNT_X;
+    const uint32_t y = (clusterIdx / LIGHT_CLUSTER_COUNT_X) % LIGHT_CLUSTER_COUNT_Y;
+    const uint32_t z = clusterIdx / (LIGHT_CLUSTER_COUNT_X * LIGHT_CLUSTER_COUNT_Y);
+
+    const float depthRatio = params.mZFar / params.mZNear;
+    const float depthNear = params.mZNear * std::pow(depthRatio, static_cast<float>(z) / LIGHT_CLUSTER_COUNT_Z);
+    const float depthFar = params.mZNear * std::pow(depthRatio, static_cast<float>(z + 1) / LIGHT_CLUSTER_COUNT_Z);
+
+    //  screen space x goes right and y goes down, view space y goes up
+    const float ndcLeft = 2.0f * x / LIGHT_CLUSTER_COUNT_X - 1.0f;
+    const float ndcRight = 2.0f * (x + 1) / LIGHT_CLUSTER_COUNT_X - 1.0f;
+    const float ndcTop = 1.0f - 2.0f * y / LIGHT_CLUSTER_COUNT_Y;
+    const float ndcBottom = 1.0f - 2.0f * (y + 1) / LIGHT_CLUSTER_COUNT_Y;
+
+    //  the cluster is a frustum segment, its corners at both depths bound it
+    LightClusterBounds bounds{.mMin = glm::vec3(INFINITY), .mMax = glm::vec3(-INFINITY)};
+    for (float depth : {depthNear, depthFar})
+    {
+        const glm::vec2 cornerMin(ndcLeft * params.mTanHalfFovX * depth, ndcBottom * params.mTanHalfFovY * depth);
+        const glm::vec2 cornerMax(ndcRight * params.mTanHalfFovX * depth, ndcTop * params.mTanHalfFovY * depth);
+        bounds.mMin = glm::min(bounds.mMin, glm::vec3(cornerMin, -depthFar));
+        bounds.mMax = glm::max(bounds.mMax, glm::vec3(cornerMax, -depthNear));
+    }
+    return bounds;
+}
+
+Base::BoundingSphere getLightCullingSphere(const ClusteredLight& light, const glm::mat4& viewMat)
+{
+    glm::vec3 center = light.mPosition;
+    float radius = light.mInfluenceRadius;
+
+    if (light.mType == LightType::Spot)
+    {
+        //  bounding sphere of the cone capped by the influence radius
+        //  https://bartwronski.com/2017/04/13/cull-that-cone/
+        const float cosOuter = -light.mSpotOffset / light.mSpotScale;
+        if (cosOuter > glm::one_over_root_two<float>())
+        {
+            radius = light.mInfluenceRadius / (2.0f * cosOuter);
+            center = light.mPosition + light.mSpotDirection * radius;
+        }
+        else if (cosOuter > 0)
+        {
+            center = light.mPosition + light.mSpotDirection * (light.mInfluenceRadius * cosOuter);
+            radius = light.mInfluenceRadius * std::sqrt(1.0f - cosOuter * cosOuter);
+        }
+    }
+
+    return Base::BoundingSphere{.mCenter = glm::vec3(viewMat * glm::vec4(center, 1.0f)), .mRadius = radius};
+}
+
+bool isSphereInLightCluster(const LightClusterBounds& bounds, const Base::BoundingSphere& sphere)
+{
+    const glm::vec3 closest = glm::clamp(sphere.mCenter, bounds.mMin, bounds.mMax);
+    const glm::vec3 offset = closest - sphere.mCenter;
+    return glm::dot(offset, offset) <= sphere.mRadius * sphere.mRadius;
+}
+
+void binLightsToClusters(const LightClusterParams& params, std::span<const ClusteredLight> lights,
+    std::vector<std::vector<uint32_t>>& outClusterLights, float radiusScale)
+{
+    std::vector<LightClusterBounds> clusterBounds(LIGHT_CLUSTER_COUNT);
+    for (uint32_t clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; clusterIdx++)
+    {
+        clusterBounds[clusterIdx] = getLightClusterBounds(params, clusterIdx);
+    }
+
+    outClusterLights.assign(LIGHT_CLUSTER_COUNT, {});
+    for (uint32_t lightIdx = 0; lightIdx < lights.size(); lightIdx++)
+    {
+        Base::BoundingSphere sphere = getLightCullingSphere(lights[lightIdx], params.mViewMat);
+        sphere.mRadius *= radiusScale;
+        for (uint32_t clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; clusterIdx++)
+        {
+            if (isSphereInLightCluster(clusterBounds[clusterIdx], sphere))
+            {
+                outClusterLights[clusterIdx].push_back(lightIdx);
+            }
+        }
+    }
+}
+
+uint32_t validateLightClusters(
+    const LightClusterParams& params, std::span<const ClusteredLight> lights, const LightClusterData& gpuClusters)
+{
+    //  lights right at a cluster border can go either way with the float differences between cpu and gpu
+    //  so the gpu lists only have to be between the lists of slightly shrunk and grown lights
+    constexpr float radiusTolerance = 0.01f;
+    std::vector<std::vector<uint32_t>> shrunkClusterLights;
+    std::vector<std::vector<uint32_t>> grownClusterLights;
+    binLightsToClusters(params, lights, shrunkClusterLights, 1.0f - radiusTolerance);
+    binLightsToClusters(params, lights, grownClusterLights, 1.0f + radiusTolerance);
+
+    uint32_t mismatchCount = 0;
+    for (uint32_t clusterIdx = 0; clusterIdx < LIGHT_CLUSTER_COUNT; clusterIdx++)
+    {
+        const uint32_t gpuCount = gpuClusters.mLightCounts[clusterIdx];
+        if (gpuCount > MAX_LIGHTS_PER_CLUSTER)
+        {
+            mismatchCount++;
+            continue;
+        }
+
+        std::span<const uint32_t> gpuLights(&gpuClusters.mLightIndices[clusterIdx * MAX_LIGHTS_PER_CLUSTER], gpuCount);
+        const auto& shrunkLights = shrunkClusterLights[clusterIdx];
+        const auto& grownLights = grownClusterLights[clusterIdx];
+
+        //  a full cluster drops the lights after the first MAX_LIGHTS_PER_CLUSTER
+        const bool isFull = gpuCount == MAX_LIGHTS_PER_CLUSTER;
+        const bool hasNoExtraLights =
+            std::includes(grownLights.begin(), grownLights.end(), gpuLights.begin(), gpuLights.end());
+        const bool hasAllLights =
+            isFull || std::includes(gpuLights.begin(), gpuLights.end(), shrunkLights.begin(), shrunkLights.end());
+        const bool isValid = std::is_sorted(gpuLights.begin(), gpuLights.end()) && hasNoExtraLights && hasAllLights;
+        mismatchCount += isValid ? 0 : 1;
+    }
+    return mismatchCount;
+}
+} // namespace Bunny::Render
@@ -26,6 +26,7 @@ BunnyResult PbrMaterialBank::initialize()
 {
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildDescriptorSetLayouts())
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildPipelineLayouts())
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(allocateMaterialDescriptorSet())
 
     Base::ImguiHelper::get().registerCommand([this]() { showImguiControlPanel(); });
 
@@ -74,8 +75,7 @@ BunnyResult PbrMaterialBank::addMaterialInstance(const PbrMaterialParameters& ma
     return BUNNY_HAPPY;
 }
 
-void PbrMaterialBank::updateMaterialDescriptorSet(
-    VkDescriptorSet descriptorSet, const MeshBank<NormalVertex>* meshBank) const
+void PbrMaterialBank::updateMaterialDescriptorSet(const MeshBank<NormalVertex>* meshBank)
 {
     assert(!mMaterialBufferNeedUpdate);
 
@@ -86,8 +86,14 @@ void PbrMaterialBank::updateMaterialDescriptorSet(
         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
     writer.writeBuffer(2, meshBank->getSurfaceDataBuffer().mBuffer, meshBank->getSurfaceDataBufferSize(), 0,
         VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
-    mTextureBank->addDescriptorSetWrite(3, writer);
-    writer.updateSet(mVulkanResources->getDevice(), descriptorSet);
+    writer.updateSet(mVulkanResources->getDevice(), mMaterialDescSet);
+
+    updateTextureDescriptors();
+}
+
+void PbrMaterialBank::updateTextureDescriptors()
+{
+    mTextureBank->updateBindlessTextures(mMaterialDescSet, TEXTURE_ARRAY_BINDING);
 }
 
 BunnyResult PbrMaterialBank::recreateMaterialBuffer()
@@ -130,18 +136,32 @@ BunnyResult PbrMaterialBank::buildDescriptorSetLayouts()
 
     DescriptorLayoutBuilder builder;
 
+    //  the lights and the camera are in the frame buffer arena, bound with the dynamic offsets of the frame
+    VkDescriptorSetLayoutBinding frameUniformBinding = uniformBufferBinding;
+    frameUniformBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    VkDescriptorSetLayoutBinding frameStorageBinding = storageBufferBinding;
+    frameStorageBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
     //  light data
-    uniformBufferBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
-    builder.addBinding(uniformBufferBinding);
+    frameUniformBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+    builder.addBinding(frameUniformBinding);
     //  camera data
-    uniformBufferBinding.binding = 1;
-    uniformBufferBinding.stageFlags =
+    frameUniformBinding.binding = 1;
+    frameUniformBinding.stageFlags =
         VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR;
-    builder.addBinding(uniformBufferBinding);
+    builder.addBinding(frameUniformBinding);
+    //  clustered point and spot lights
+    frameStorageBinding.binding = 2;
+    frameStorageBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    builder.addBinding(frameStorageBinding);
+    //  light clusters
+    storageBufferBinding.binding = 3;
+    storageBufferBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    builder.addBinding(storageBufferBinding);
     mWorldDescSetLayout = builder.build(mVulkanResources->getDevice());
 
     builder.clear();
     //  object data
+    storageBufferBinding.binding = 0;
     storageBufferBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     builder.addBinding(storageBufferBinding);
     //  instance to object id
@@ -173,11 +193,21 @@ BunnyResult PbrMaterialBank::buildDescriptorSetLayouts()
     storageBufferBinding.binding = 2;
     builder.addBinding(storageBufferBinding);
     //  all textures array
-    imageBinding.binding = 3;
+    //  bindless, slots can be written while the set is in use and only the slots in use need to be valid
+    imageBinding.binding = TEXTURE_ARRAY_BINDING;
     imageBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
-    imageBinding.descriptorCount = TEXTURE_ARRAY_SIZE;
+    imageBinding.descriptorCount = mTextureBank->getBindlessTextureCapacity();
     builder.addBinding(imageBinding);
-    mMaterialDescSetLayout = builder.build(mVulkanResources->getDevice());
+    VkDescriptorBindingFlags materialBindingFlags[] = {0, 0, 0,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo materialBindingFlagsInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = 4,
+        .pBindingFlags = materialBindingFlags};
+    mMaterialDescSetLayout = builder.build(mVulkanResources->getDevice(), &materialBindingFlagsInfo,
+        VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
 
     builder.clear();
     //  light shadow info
@@ -243,6 +273,28 @@ BunnyResult PbrMaterialBank::buildPipelineLayouts()
     return BUNNY_HAPPY;
 }
 
+BunnyResult PbrMaterialBank::allocateMaterialDescriptorSet()
+{
+    VkDevice device = mVulkanResources->getDevice();
+    uint32_t textureCapacity = mTextureBank->getBindlessTextureCapacity();
+
+    DescriptorAllocator::PoolSize poolSizes[] = {
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 3              },
+        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = textureCapacity}
+    };
+    mDescriptorAllocator.init(device, 1, poolSizes, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+        .descriptorSetCount = 1,
+        .pDescriptorCounts = &textureCapacity};
+    mDescriptorAllocator.allocate(device, &mMaterialDescSetLayout, &mMaterialDescSet, 1, &variableCountInfo);
+
+    mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
+
+    return BUNNY_HAPPY;
+}
+
 void PbrMaterialBank::showImguiControlPanel()
 {
     ImGui::Begin("Materials");
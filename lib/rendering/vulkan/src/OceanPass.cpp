@@ -5,6 +5,7 @@
 #include "Error.h"
 #include "Shader.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "TextureBank.h"
 #include "VulkanRenderResources.h"
 #include "VulkanGraphicsRenderer.h"
@@ -14,6 +15,9 @@
 
 #include <glm/gtx/euler_angles.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace Bunny::Render
 {
 constexpr static PbrMaterialParameters defaultWaveMaterial{
@@ -26,18 +30,31 @@ constexpr static PbrMaterialParameters defaultWaveMaterial{
 
 OceanPass::OceanPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
     const TextureBank* textureBank, PbrMaterialBank* materialBank, const MeshBank<NormalVertex>* meshBank,
-    float waveAreaWidth, uint32_t patternAreaGridCount, uint32_t totalGridCount, std::string_view meshShaderPath,
+    std::span<const float, WAVE_CASCADE_COUNT> cascadeWidths, float waveAreaWidth, uint32_t patternAreaGridCount,
+    uint32_t totalGridCount, std::string_view taskShaderPath, std::string_view meshShaderPath,
     std::string_view fragShaderPath)
     : super(vulkanResources, renderer, materialBank, meshBank),
+      mTaskShaderPath(taskShaderPath),
       mMeshShaderPath(meshShaderPath),
       mFragShaderPath(fragShaderPath),
       mTextureBank(textureBank),
       mTotalWaveGridCount(totalGridCount)
 {
     //  create wave field and world param data
-    mWaveParams.mGridAreaWidth = waveAreaWidth;
+    static_assert(WAVE_CASCADE_COUNT <= 4);
+    std::copy(cascadeWidths.begin(), cascadeWidths.end(), &mWaveParams.mCascadeWidths[0]);
     mWaveParams.mGridCellWidth = waveAreaWidth / patternAreaGridCount;
     mWaveParams.mGridOrigin = glm::vec2(-mWaveParams.mGridCellWidth * mTotalWaveGridCount / 2);
+    mWaveParams.mDisplacementBound = WAVE_DISPLACEMENT_BOUND;
+    //  a patch spans PATCH_CELL_COUNT cells, round up so the patches cover the far edge of the grid too
+    mWaveParams.mPatchCount = (mTotalWaveGridCount + PATCH_CELL_COUNT - 1) / PATCH_CELL_COUNT;
+
+    //  each level has twice the range of the one below, as its nodes are twice as wide
+    float nodeWidth = mWaveParams.mGridCellWidth * PATCH_CELL_COUNT;
+    for (uint32_t lod = 0; lod < LOD_COUNT; lod++)
+    {
+        mWorldParams.mLodRanges[lod / 4][lod % 4] = LOD_RANGE_SCALE * nodeWidth * static_cast<float>(1 << lod);
+    }
 
     //  add wave material to material bank
     //  the materialBank param is not const so we can call this function here
@@ -50,27 +67,7 @@ void OceanPass::draw() const
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    VkImageMemoryBarrier waveDisplacementImageBarrier = makeImageMemoryBarrier(frame.mVertexDisplacementImage->mImage,
-        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    VkImageMemoryBarrier waveNormalImageBarrier =
-        makeImageMemoryBarrier(frame.mVertexNormalImage->mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    {
-        VkImageMemoryBarrier barriers[]{waveDisplacementImageBarrier, waveNormalImageBarrier};
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-    }
-
-    //  wait for rendering from other passes onto the render target is done
-    VkImageMemoryBarrier renderTargetBarrier = makeImageMemoryBarrier(frame.mRenderTarget->mImage,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    {
-        VkImageMemoryBarrier barriers[]{renderTargetBarrier, mRenderer->getResolvedColorBarrier()};
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-    }
+    //  the wave images and the render targets are transitioned by the frame graph
 
     //  render
     bool multiSample = mRenderer->isMultiSampleEnabled();
@@ -86,13 +83,17 @@ void OceanPass::draw() const
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
 
+    //  world params of the mesh set, then light and camera of the fragment set
+    const uint32_t dynamicOffsets[] = {mWorldParamsSlice.mOffset, mLightData->mOffset, mCameraData->mOffset};
     vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 5, &frame.mMeshDescSet, 0, nullptr);
+        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 5, &frame.mMeshDescSet, 3, dynamicOffsets);
 
     vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(WavePushParams), &mWavePushParams);
 
-    //  dispatch mesh pipeline
-    vkCmdDrawMeshTasksEXT(cmd, mTotalWaveGridCount / MESH_THREAD_COUNT_X, mTotalWaveGridCount / MESH_THREAD_COUNT_Y, 1);
+    //  dispatch the task shader over the node window of every lod level, it emits the mesh work groups of the nodes
+    //  that are selected and in the view, so the cost does not grow with the size of the ocean
+    vkCmdDrawMeshTasksEXT(
+        cmd, LOD_WINDOW_SIZE / TASK_THREAD_COUNT_X, LOD_WINDOW_SIZE / TASK_THREAD_COUNT_Y, LOD_COUNT);
 
     renderHelper.finishRender();
 }
@@ -100,59 +101,54 @@ void OceanPass::draw() const
 void OceanPass::prepareFrameDescriptors()
 {
     FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
-    frame.mDescriptorAllocator.clearPools(device);
 
-    //  allocate discriptors for this frame
-    //  mainly because we need to bind the updated wave textures
-    //  maybe find a solution later to avoid reallocating descriptors every frame
-    //  because the wave textures for each frame is basically fixed and can be bound upfront
-    //  this is just an easy and lazy temp solution
+    //  the wave textures change with the frame in flight, the sets come from the descriptor cache of the renderer
+    //  so they are only written the first time every frame in flight draws the ocean
 
-    //  allocate descriptor sets
-    VkDescriptorSetLayout descLayouts[] = {mMeshDescLayout, mWaveImageDescLayout, mFragDescLayout,
-        mMaterialBank->getMaterialDescSetLayout(), mAcceStructDescLayout};
-    frame.mDescriptorAllocator.allocate(device, descLayouts, &frame.mMeshDescSet, 5);
+    //  material data and the bindless textures are shared by all passes
+    frame.mMaterialDescSet = mMaterialBank->getMaterialDescSet();
 
-    //  write the resources to the desc sets
     DescriptorWriter writer;
     writer.writeBuffer(0, mWaveParamsBuffer.mBuffer, sizeof(WaveFieldParams), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(1, mWorldParamsBuffer.mBuffer, sizeof(WorldParams), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.updateSet(device, frame.mMeshDescSet);
+    writer.writeBuffer(
+        1, mWorldParamsSlice.mBuffer, mWorldParamsSlice.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    frame.mMeshDescSet = mRenderer->getCachedDescriptorSet(mMeshDescLayout, writer);
 
     writer.clear();
     writer.writeImage(0, frame.mVertexDisplacementImage->mImageView, mTextureBank->getSampler(),
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    writer.writeImage(1, frame.mVertexNormalImage->mImageView, mTextureBank->getSampler(),
+    writer.writeImage(1, frame.mWaveSlopeImage->mImageView, mTextureBank->getSampler(),
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    writer.updateSet(device, frame.mWaveImageDescSet);
+    frame.mWaveImageDescSet = mRenderer->getCachedDescriptorSet(mWaveImageDescLayout, writer);
 
     writer.clear();
-    writer.writeBuffer(0, mLightDataBuffer->mBuffer, sizeof(PbrLightData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(1, mCameraDataBuffer->mBuffer, sizeof(PbrCameraData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.updateSet(device, frame.mFragDescSet);
-
-    mMaterialBank->updateMaterialDescriptorSet(frame.mMaterialDescSet, mMeshBank);
+    writer.writeBuffer(0, mLightData->mBuffer, mLightData->mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    writer.writeBuffer(1, mCameraData->mBuffer, mCameraData->mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    frame.mFragDescSet = mRenderer->getCachedDescriptorSet(mFragDescLayout, writer);
 
     writer.clear();
     writer.writeAccelerationStructure(0, mSceneAcceStruct);
-    writer.updateSet(device, frame.mAcceStructDescSet);
+    frame.mAcceStructDescSet = mRenderer->getCachedDescriptorSet(mAcceStructDescLayout, writer);
 }
 
-void OceanPass::updateWorldParams(const glm::mat4& mvpMatrix, float elapsedTime, float deltaTime)
+void OceanPass::updateWorldParams(const Camera& camera, float elapsedTime, float deltaTime)
 {
-    mWorldParams.mMvpMatrix = mvpMatrix;
+    ViewFrustum viewFrustum;
+    camera.getViewFrustum(viewFrustum);
+
+    mWorldParams.mMvpMatrix = camera.getViewProjMatrix();
+    std::copy(std::begin(viewFrustum.mPlanes), std::end(viewFrustum.mPlanes), mWorldParams.mFrustumPlanes);
+    mWorldParams.mCameraPosition = camera.getPosition();
     mWorldParams.mElapsedTime = elapsedTime;
     mWorldParams.mDeltaTime = deltaTime;
 
-    void* data = mWorldParamsBuffer.mAllocationInfo.pMappedData;
-    memcpy(data, &mWorldParams, sizeof(WorldParams));
+    mRenderer->getFrameArena().write(mWorldParams, mWorldParamsSlice);
 }
 
-void OceanPass::linkLightAndCameraData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData)
+void OceanPass::linkLightAndCameraData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData)
 {
-    mLightDataBuffer = &lightData;
-    mCameraDataBuffer = &cameraData;
+    mLightData = &lightData;
+    mCameraData = &cameraData;
 }
 
 void OceanPass::linkSceneAccelerationStructure(VkAccelerationStructureKHR acceStruct)
@@ -166,21 +162,18 @@ void OceanPass::updateRenderTarget(const AllocatedImage* renderTarget)
     frame.mRenderTarget = renderTarget;
 }
 
-void OceanPass::updateWaveTextures(const AllocatedImage* vertexDisplacementTex, const AllocatedImage* vertexNormalTex)
+void OceanPass::updateWaveTextures(const AllocatedImage* vertexDisplacementTex, const AllocatedImage* waveSlopeTex)
 {
     FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
     frame.mVertexDisplacementImage = vertexDisplacementTex;
-    frame.mVertexNormalImage = vertexNormalTex;
+    frame.mWaveSlopeImage = waveSlopeTex;
 }
 
 BunnyResult OceanPass::initPipeline()
 {
     VkDevice device = mVulkanResources->getDevice();
 
-    Shader meshShader(mMeshShaderPath, device);
-    Shader fragShader(mFragShaderPath, device);
-
     VkDescriptorSetLayout layouts[] = {mMeshDescLayout, mWaveImageDescLayout, mFragDescLayout,
         mMaterialBank->getMaterialDescSetLayout(), mAcceStructDescLayout};
     std::vector<VkPushConstantRange> pushConsts;
@@ -199,60 +192,48 @@ BunnyResult OceanPass::initPipeline()
     mDeletionStack.AddFunction(
         [this]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), mPipelineLayout, nullptr); });
 
-    GraphicsPipelineBuilder pipelineBuilder;
-    pipelineBuilder.addShaderStage(meshShader.getShaderModule(), VK_SHADER_STAGE_MESH_BIT_EXT);
-    pipelineBuilder.addShaderStage(fragShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    pipelineBuilder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    if (mRenderer->isMultiSampleEnabled())
-    {
-        pipelineBuilder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
-    }
-    else
-    {
-        pipelineBuilder.setMultisamplingNone();
-    }
-    pipelineBuilder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
-    pipelineBuilder.enableDepthTest(VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
-    pipelineBuilder.setDepthFormat(mRenderer->getDepthImageFormat());
-    pipelineBuilder.setPipelineLayout(mPipelineLayout);
-    mPipeline = pipelineBuilder.build(device);
-    if (mPipeline == nullptr)
-    {
-        return BUNNY_SAD;
-    }
-
     mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    return BUNNY_HAPPY;
+    return PipelineCompileQueue::enqueue([this, device]() {
+        //  load shader
+        Shader taskShader(mTaskShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader meshShader(mMeshShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragShader(mFragShaderPath, mVulkanResources->getShaderModuleCache());
+
+        GraphicsPipelineBuilder pipelineBuilder;
+        pipelineBuilder.addShaderStage(taskShader.getShaderModule(), VK_SHADER_STAGE_TASK_BIT_EXT);
+        pipelineBuilder.addShaderStage(meshShader.getShaderModule(), VK_SHADER_STAGE_MESH_BIT_EXT);
+        pipelineBuilder.addShaderStage(fragShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        pipelineBuilder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        pipelineBuilder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        if (mRenderer->isMultiSampleEnabled())
+        {
+            pipelineBuilder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
+        }
+        else
+        {
+            pipelineBuilder.setMultisamplingNone();
+        }
+        pipelineBuilder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
+        pipelineBuilder.enableDepthTest(VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+        pipelineBuilder.setDepthFormat(mRenderer->getDepthImageFormat());
+        pipelineBuilder.setPipelineLayout(mPipelineLayout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = pipelineBuilder.build(device);
+        if (mPipeline == nullptr)
+        {
+            return BUNNY_SAD;
+        }
+
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult OceanPass::initDescriptors()
 {
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorLayouts())
 
-    VkDevice device = mVulkanResources->getDevice();
-
-    DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             .mRatio = 8                                       },
-        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,     .mRatio = PbrMaterialBank::TEXTURE_ARRAY_SIZE + 10},
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .mRatio = 6                                       },
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .mRatio = 2                                       },
-        {.mType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .mRatio = 2                                       }
-    };
-    for (FrameData& frame : mFrameData)
-    {
-        frame.mDescriptorAllocator.init(device, 10, poolSizes);
-    }
-
-    //  descriptors will be allocated every frame when wave textures are updated
-
-    mDeletionStack.AddFunction([this]() {
-        for (FrameData& frame : mFrameData)
-        {
-            frame.mDescriptorAllocator.destroyPools(mVulkanResources->getDevice());
-        }
-    });
+    //  the sets come from the descriptor cache of the renderer in prepareFrameDescriptors()
 
     return BUNNY_HAPPY;
 }
@@ -263,14 +244,9 @@ BunnyResult OceanPass::initDataAndResources()
     mVulkanResources->createBufferWithData(&mWaveParams, sizeof(WaveFieldParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         VMA_MEMORY_USAGE_AUTO, mWaveParamsBuffer);
-    mWorldParamsBuffer = mVulkanResources->createBuffer(sizeof(WorldParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-        VMA_MEMORY_USAGE_AUTO);
+    mWorldParamsSlice = mRenderer->getFrameArena().makeSlice(sizeof(WorldParams));
 
-    mDeletionStack.AddFunction([this]() {
-        mVulkanResources->destroyBuffer(mWaveParamsBuffer);
-        mVulkanResources->destroyBuffer(mWorldParamsBuffer);
-    });
+    mDeletionStack.AddFunction([this]() { mVulkanResources->destroyBuffer(mWaveParamsBuffer); });
 
     return BUNNY_HAPPY;
 }
@@ -278,13 +254,14 @@ BunnyResult OceanPass::initDataAndResources()
 BunnyResult OceanPass::initDescriptorLayouts()
 {
     VkDescriptorSetLayoutBinding descBinding{
-        0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_MESH_BIT_EXT, nullptr};
+        0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, nullptr};
 
     VkDevice device = mVulkanResources->getDevice();
 
     DescriptorLayoutBuilder builder;
     builder.addBinding(descBinding); //  wave field params
     descBinding.binding = 1;
+    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     builder.addBinding(descBinding); //  world params
     mMeshDescLayout = builder.build(device);
 
@@ -294,13 +271,13 @@ BunnyResult OceanPass::initDescriptorLayouts()
     descBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     builder.addBinding(descBinding); //  wave vertex displacement texture
     descBinding.binding = 1;
-    builder.addBinding(descBinding); //  wave vertex normal texture
+    builder.addBinding(descBinding); //  wave slope texture
     mWaveImageDescLayout = builder.build(device);
 
     builder.clear();
     descBinding.binding = 0;
     descBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     builder.addBinding(descBinding); //  light data
     descBinding.binding = 1;
     builder.addBinding(descBinding); //  camera data
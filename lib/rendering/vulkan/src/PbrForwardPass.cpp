@@ -7,6 +7,7 @@
 #include "Shader.h"
 #include "ShaderData.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "Helper.h"
 
 namespace Bunny::Render
@@ -31,13 +32,6 @@ void PbrForwardPass::draw() const
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    //  transition the render target image layout back to color attachment optimal
-    VkImageMemoryBarrier renderTargetBarrier = makeImageMemoryBarrier(frame.mSceneRenderTarget->mImage,
-        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &renderTargetBarrier);
-
     auto renderHelper = mRenderer->getRenderHelper()
                             .addColorAttachment(frame.mSceneRenderTarget->mImageView, true)
                             .setClearDepth(true)
@@ -53,8 +47,11 @@ void PbrForwardPass::draw() const
     //  bind all scene, object and material descriptor sets at once
     //  they are laid out properly in FrameData
     //  if the layout changes this needs to be updated
+    const std::array<uint32_t, PbrMaterialBank::WORLD_DYNAMIC_OFFSET_COUNT> worldOffsets{
+        mLightData->mOffset, mCameraData->mOffset, mClusteredLightData->mOffset};
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 4,
-        &mFrameData[mRenderer->getCurrentFrameIdx()].mWorldDescSet, 0, nullptr);
+        &mFrameData[mRenderer->getCurrentFrameIdx()].mWorldDescSet, static_cast<uint32_t>(worldOffsets.size()),
+        worldOffsets.data());
 
     //  only draw the opaque surfaces
     vkCmdDrawIndexedIndirect(
@@ -178,22 +175,39 @@ void PbrForwardPass::prepareDrawCommandsForFrame()
     const VkDeviceSize drawCommandsSize = getContainerDataSize(mDrawCommandsData);
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     mVulkanResources->copyBuffer(cmd, mInitialDrawCommandBuffer.mBuffer, mDrawCommandsBuffer.mBuffer, drawCommandsSize);
-    mVulkanResources->transitionBufferAccess(cmd, mDrawCommandsBuffer.mBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
-        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 }
 
-void PbrForwardPass::linkWorldData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData)
+void PbrForwardPass::linkWorldData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData)
 {
+    mLightData = &lightData;
+    mCameraData = &cameraData;
+
     DescriptorWriter writer;
-    writer.writeBuffer(0, lightData.mBuffer, sizeof(PbrLightData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(1, cameraData.mBuffer, sizeof(PbrCameraData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.writeBuffer(0, lightData.mBuffer, lightData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    writer.writeBuffer(1, cameraData.mBuffer, cameraData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     for (const FrameData& frame : mFrameData)
     {
         writer.updateSet(mVulkanResources->getDevice(), frame.mWorldDescSet);
     }
 }
 
+void PbrForwardPass::linkLightClusterData(const FrameBufferSlice& clusteredLightData,
+    const std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT>& clusterBuffers)
+{
+    mClusteredLightData = &clusteredLightData;
+
+    DescriptorWriter writer;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        writer.clear();
+        writer.writeBuffer(2, clusteredLightData.mBuffer, clusteredLightData.mRange, 0,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+        writer.writeBuffer(
+            3, clusterBuffers[idx].mBuffer, sizeof(LightClusterData), 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        writer.updateSet(mVulkanResources->getDevice(), mFrameData[idx].mWorldDescSet);
+    }
+}
+
 void PbrForwardPass::linkObjectData(const AllocatedBuffer& objectBuffer, size_t bufferSize)
 {
     Render::DescriptorWriter writer;
@@ -232,42 +246,45 @@ BunnyResult PbrForwardPass::initPipeline()
 {
     VkDevice device = mVulkanResources->getDevice();
 
-    //  load shader file
-    Shader vertexShader(mVertexShaderPath, device);
-    Shader fragmentShader(mFragmentShaderPath, device);
-
     mPipelineLayout = mMaterialBank->getPbrForwardPipelineLayout();
 
-    //  vertex info
-    auto bindingDescription = getBindingDescription<NormalVertex>(0, VertexInputRate::Vertex);
-    auto attributeDescriptions = NormalVertex::getAttributeDescriptions();
-
-    //  build pipeline
-    GraphicsPipelineBuilder builder;
-    builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
-    builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
-    builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    builder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    if (mRenderer->isMultiSampleEnabled())
-    {
-        builder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
-    }
-    else
-    {
-        builder.setMultisamplingNone();
-    }
-    builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
-    builder.enableDepthTest(VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
-    builder.setDepthFormat(mRenderer->getDepthImageFormat());
-    builder.setPipelineLayout(mPipelineLayout);
+    mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    mPipeline = builder.build(device);
+    return PipelineCompileQueue::enqueue([this, device]() {
+        //  load shader
+        Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
+
+        //  vertex info
+        auto bindingDescription = getBindingDescription<NormalVertex>(0, VertexInputRate::Vertex);
+        auto attributeDescriptions = NormalVertex::getAttributeDescriptions();
+
+        //  build pipeline
+        GraphicsPipelineBuilder builder;
+        builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
+        builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
+        builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        if (mRenderer->isMultiSampleEnabled())
+        {
+            builder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
+        }
+        else
+        {
+            builder.setMultisamplingNone();
+        }
+        builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
+        builder.enableDepthTest(VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+        builder.setDepthFormat(mRenderer->getDepthImageFormat());
+        builder.setPipelineLayout(mPipelineLayout);
 
-    mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(device);
 
-    return BUNNY_HAPPY;
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult PbrForwardPass::initDescriptors()
@@ -275,23 +292,25 @@ BunnyResult PbrForwardPass::initDescriptors()
     VkDevice device = mVulkanResources->getDevice();
 
     DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 4                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 4                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = PbrMaterialBank::TEXTURE_ARRAY_SIZE},
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 2                                  },
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, .mRatio = 1},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 2},
     };
     mDescriptorAllocator.init(device, 10, poolSizes);
 
-    VkDescriptorSetLayout descLayouts[] = {mMaterialBank->getWorldDescSetLayout(),
-        mMaterialBank->getObjectDescSetLayout(), mMaterialBank->getMaterialDescSetLayout(),
-        mMaterialBank->getEffectDescSetLayout()};
+    VkDescriptorSetLayout descLayouts[] = {
+        mMaterialBank->getWorldDescSetLayout(), mMaterialBank->getObjectDescSetLayout()};
+    VkDescriptorSetLayout effectDescLayout = mMaterialBank->getEffectDescSetLayout();
     for (FrameData& frame : mFrameData)
     {
-        //  allocate all 4 sets of one frame at once
-        mDescriptorAllocator.allocate(device, descLayouts, &frame.mWorldDescSet, 4);
+        mDescriptorAllocator.allocate(device, descLayouts, &frame.mWorldDescSet, 2);
+
+        //  material data and the bindless textures are shared by all passes
+        frame.mMaterialDescSet = mMaterialBank->getMaterialDescSet();
 
-        //  link material data to material descriptor set
-        mMaterialBank->updateMaterialDescriptorSet(frame.mMaterialDescSet, mMeshBank);
+        mDescriptorAllocator.allocate(device, &effectDescLayout, &frame.mEffectDescSet);
     }
 
     mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
@@ -3,8 +3,10 @@
 #include "Error.h"
 #include "ErrorCheck.h"
 #include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 
 #include <cassert>
+#include <string>
 
 namespace Bunny::Render
 {
@@ -54,7 +56,6 @@ BunnyResult PbrGraphicsPass::buildComputePipeline(std::string_view shaderPath,
     VkPipelineLayout* layout, VkPipeline* pipeline)
 {
     VkDevice device = mVulkanResources->getDevice();
-    Shader spectrumShader(shaderPath, device);
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -84,14 +85,19 @@ BunnyResult PbrGraphicsPass::buildComputePipeline(std::string_view shaderPath,
     mDeletionStack.AddFunction(
         [this, layout]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), *layout, nullptr); });
 
-    ComputePipelineBuilder pipelineBuilder;
-    pipelineBuilder.setShader(spectrumShader.getShaderModule());
-    pipelineBuilder.setPipelineLayout(*layout);
-    *pipeline = pipelineBuilder.build(device);
-
     mDeletionStack.AddFunction(
         [this, pipeline]() { vkDestroyPipeline(mVulkanResources->getDevice(), *pipeline, nullptr); });
 
-    return BUNNY_HAPPY;
+    return PipelineCompileQueue::enqueue([this, device, shader = std::string(shaderPath), layout, pipeline]() {
+        Shader computeShader(shader, mVulkanResources->getShaderModuleCache());
+
+        ComputePipelineBuilder pipelineBuilder;
+        pipelineBuilder.setShader(computeShader.getShaderModule());
+        pipelineBuilder.setPipelineLayout(*layout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        *pipeline = pipelineBuilder.build(device);
+
+        return BUNNY_HAPPY;
+    });
 }
 } // namespace Bunny::Render
@@ -0,0 +1,72 @@
+#include "PipelineCompileQueue.h"
+
+#include "Error.h"
+#include "CpuProfiler.h"
+
+namespace Bunny::Render
+{
+
+std::unique_ptr<PipelineCompileQueue> PipelineCompileQueue::msInstance = nullptr;
+
+PipelineCompileQueue::PipelineCompileQueue()
+{
+    mDispatcher.StartRunners();
+}
+
+PipelineCompileQueue::~PipelineCompileQueue()
+{
+    //  runners drop whatever is left in their queues, so finish the jobs first
+    for (const auto& task : mTasks)
+    {
+        task->Wait();
+    }
+    mDispatcher.Shutdown();
+}
+
+BunnyResult PipelineCompileQueue::enqueue(CompileJob job)
+{
+    if (msInstance == nullptr)
+    {
+        return job();
+    }
+
+    PipelineCompileQueue& queue = get();
+    auto task = std::make_shared<Utils::FunctionTask>([&queue, job = std::move(job)]() {
+        BUNNY_PROFILE_ZONE("Compile pipeline");
+        if (!BUNNY_SUCCESS(job()))
+        {
+            queue.mHasFailedJob = true;
+        }
+    });
+
+    if (!queue.mDispatcher.ScheduleTask(task))
+    {
+        task->Run();
+    }
+    queue.mTasks.emplace_back(std::move(task));
+
+    return BUNNY_HAPPY;
+}
+
+BunnyResult PipelineCompileQueue::waitForAll()
+{
+    if (msInstance == nullptr)
+    {
+        return BUNNY_HAPPY;
+    }
+
+    PipelineCompileQueue& queue = get();
+    for (const auto& task : queue.mTasks)
+    {
+        task->Wait();
+    }
+    queue.mTasks.clear();
+
+    if (queue.mHasFailedJob.exchange(false))
+    {
+        PRINT_AND_RETURN_VALUE("Failed to compile some of the pipelines", BUNNY_SAD)
+    }
+
+    return BUNNY_HAPPY;
+}
+} // namespace Bunny::Render
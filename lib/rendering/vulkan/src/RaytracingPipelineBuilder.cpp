@@ -16,7 +16,7 @@ VkPipeline RaytracingPipelineBuilder::build(VkDevice device)
     createInfo.layout = mPipelineLayout;
 
     VkPipeline pipeline;
-    vkCreateRayTracingPipelinesKHR(device, {}, {}, 1, &createInfo, nullptr, &pipeline);
+    vkCreateRayTracingPipelinesKHR(device, {}, mPipelineCache, 1, &createInfo, nullptr, &pipeline);
 
     return pipeline;
 }
@@ -84,4 +84,9 @@ void RaytracingPipelineBuilder::setPipelineLayout(VkPipelineLayout pipelineLayou
     mPipelineLayout = pipelineLayout;
 }
 
+void RaytracingPipelineBuilder::setPipelineCache(VkPipelineCache pipelineCache)
+{
+    mPipelineCache = pipelineCache;
+}
+
 } // namespace Bunny::Render
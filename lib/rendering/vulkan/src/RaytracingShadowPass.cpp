@@ -5,10 +5,13 @@
 #include "MaterialBank.h"
 #include "Shader.h"
 #include "RaytracingPipelineBuilder.h"
+#include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "AlignHelpers.h"
 #include "VulkanRenderResources.h"
 #include "VulkanGraphicsRenderer.h"
 #include "Helper.h"
+#include "Camera.h"
 
 #include <volk.h>
 
@@ -29,31 +32,50 @@ void RaytracingShadowPass::draw() const
 
     const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    resetFrameImage();
+    //  the clustered lights are not used here
+    const std::array<uint32_t, PbrMaterialBank::WORLD_DYNAMIC_OFFSET_COUNT> worldOffsets{
+        mLightData->mOffset, mCameraData->mOffset, 0};
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, mPipeline);
-    vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, mPipelineLayout, 0, 4, &frame.mWorldDescSet, 0, nullptr);
-
-    //  set up barrier to make sure the light shadow image has finished being read in the fragment shader of last frame
-    {
-        VkImageMemoryBarrier barrier = makeImageMemoryBarrier(frame.mOutImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &barrier);
-    }
-
-    VkExtent2D renderExtent = mRenderer->getSwapChainExtent();
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, mPipelineLayout, 0, 4, &frame.mWorldDescSet,
+        static_cast<uint32_t>(worldOffsets.size()), worldOffsets.data());
+    vkCmdPushConstants(
+        cmd, mPipelineLayout, VK_SHADER_STAGE_RAYGEN_BIT_KHR, 0, sizeof(ReprojectionParams), &mReprojectionParams);
+
+    //  every pixel writes its sample and geometry, so the images do not need to be reset
+    //  the frame graph makes sure the images are no longer read by the last frame and are visible to the next passes
+    VkExtent2D renderExtent = mRenderer->getRenderExtent();
     vkCmdTraceRaysKHR(
         cmd, &mRayGenRegion, &mMissRegion, &mHitRegion, &mCallableRegion, renderExtent.width, renderExtent.height, 1);
+}
 
-    //  set up barrier to make sure the light shadow image has finished rendering
-    {
-        VkImageMemoryBarrier barrier = makeImageMemoryBarrier(frame.mOutImage.mImage, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &barrier);
-    }
+void RaytracingShadowPass::resolve() const
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+
+    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mResolvePipeline);
+    vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mResolvePipelineLayout, 0, 1, &frame.mResolveDescSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mResolvePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+        &mReprojectionParams.mCheckerboardParity);
+
+    constexpr static uint32_t computeSize = 8;
+    VkExtent3D outExtent = frame.mOutImage.mExtent;
+    vkCmdDispatch(
+        cmd, (outExtent.width + computeSize - 1) / computeSize, (outExtent.height + computeSize - 1) / computeSize, 1);
+}
+
+void RaytracingShadowPass::updateRenderParams(const Camera& camera)
+{
+    //  the history is the out image of the last frame, so it is seen from the camera of the last frame
+    //  not camera.getPrevViewProjMatrix(), that one has no jitter and the history would shift by the jitter delta
+    mReprojectionParams.mPrevViewProj = mLastViewProj;
+    mLastViewProj = camera.getViewProjMatrix();
+    mReprojectionParams.mCheckerboardParity = mFrameCount % 2;
+    mReprojectionParams.mIsHistoryValid = mFrameCount > 0 ? 1 : 0;
+    mFrameCount++;
 }
 
 void RaytracingShadowPass::updateVertIdxBufferData(VkDeviceAddress vertBufAddress, VkDeviceAddress idxBufAddress)
@@ -64,11 +86,14 @@ void RaytracingShadowPass::updateVertIdxBufferData(VkDeviceAddress vertBufAddres
     copyDataToBuffer(mVertIdxBufData, mVertIdxBufBuffer);
 }
 
-void RaytracingShadowPass::linkWorldData(const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData)
+void RaytracingShadowPass::linkWorldData(const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData)
 {
+    mLightData = &lightData;
+    mCameraData = &cameraData;
+
     DescriptorWriter writer;
-    writer.writeBuffer(0, lightData.mBuffer, sizeof(PbrLightData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(1, cameraData.mBuffer, sizeof(PbrCameraData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.writeBuffer(0, lightData.mBuffer, lightData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    writer.writeBuffer(1, cameraData.mBuffer, cameraData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     for (const FrameData& frame : mFrameData)
     {
         writer.updateSet(mVulkanResources->getDevice(), frame.mWorldDescSet);
@@ -105,34 +130,40 @@ std::array<VkImageView, MAX_FRAMES_IN_FLIGHT> Render::RaytracingShadowPass::getO
     return imageViews;
 }
 
-BunnyResult RaytracingShadowPass::initPipeline()
+const AllocatedImage& RaytracingShadowPass::getCurrentOutImage() const
 {
-    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildPipelineLayout())
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mOutImage;
+}
 
-    VkDevice device = mVulkanResources->getDevice();
-    Shader rayGenShader("rtbasic_rgen.spv", device);
-    Shader closestHitShader("rtshadow_rchit.spv", device);
-    Shader basicMissShader("rtbasic_rmiss.spv", device);
-    Shader shadowMissShader("rtshadow_rmiss.spv", device);
+const AllocatedImage& RaytracingShadowPass::getPreviousOutImage() const
+{
+    return getPreviousFrameData().mOutImage;
+}
 
-    RaytracingPipelineBuilder builder;
-    uint32_t rayGenIdx = builder.addShaderStage(rayGenShader.getShaderModule(), VK_SHADER_STAGE_RAYGEN_BIT_KHR);
-    uint32_t basicMissIdx = builder.addShaderStage(basicMissShader.getShaderModule(), VK_SHADER_STAGE_MISS_BIT_KHR);
-    uint32_t shadowMissIdx = builder.addShaderStage(shadowMissShader.getShaderModule(), VK_SHADER_STAGE_MISS_BIT_KHR);
-    uint32_t closestHitIdx =
-        builder.addShaderStage(closestHitShader.getShaderModule(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+const AllocatedImage& RaytracingShadowPass::getCurrentSampleImage() const
+{
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mSampleImage;
+}
 
-    builder.addGeneralShaderGroup(rayGenIdx);
-    builder.addGeneralShaderGroup(basicMissIdx);
-    builder.addGeneralShaderGroup(shadowMissIdx);
-    builder.addClosestHitShaderGroup(closestHitIdx);
+const AllocatedImage& RaytracingShadowPass::getCurrentGeometryImage() const
+{
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mGeometryImage;
+}
 
-    builder.setMaxRecursionDepth(2); //  1 camera ray + 1 shadow ray
-                                     //  need more if multiple light?
+const AllocatedImage& RaytracingShadowPass::getPreviousGeometryImage() const
+{
+    return getPreviousFrameData().mGeometryImage;
+}
 
-    builder.setPipelineLayout(mPipelineLayout);
+const RaytracingShadowPass::FrameData& RaytracingShadowPass::getPreviousFrameData() const
+{
+    return mFrameData[(mRenderer->getCurrentFrameIdx() + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+}
 
-    mPipeline = builder.build(mVulkanResources->getDevice());
+BunnyResult RaytracingShadowPass::initPipeline()
+{
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildPipelineLayout())
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildResolvePipelineLayout())
 
     mDeletionStack.AddFunction([this]() {
         if (mPipeline != nullptr)
@@ -141,10 +172,59 @@ BunnyResult RaytracingShadowPass::initPipeline()
             mPipeline = nullptr;
         }
     });
+    mDeletionStack.AddFunction([this]() { this->mVulkanResources->destroyBuffer(mShaderBindingTableBuffer); });
+    mDeletionStack.AddFunction([this]() {
+        if (mResolvePipeline != nullptr)
+        {
+            vkDestroyPipeline(mVulkanResources->getDevice(), mResolvePipeline, nullptr);
+            mResolvePipeline = nullptr;
+        }
+    });
 
-    buildShaderBindingTable();
-
-    return BUNNY_HAPPY;
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(PipelineCompileQueue::enqueue([this]() {
+        Shader resolveShader("rtshadow_resolve_comp.spv", mVulkanResources->getShaderModuleCache());
+
+        ComputePipelineBuilder builder;
+        builder.setShader(resolveShader.getShaderModule());
+        builder.setPipelineLayout(mResolvePipelineLayout);
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mResolvePipeline = builder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    }))
+
+    return PipelineCompileQueue::enqueue([this]() {
+        VkDevice device = mVulkanResources->getDevice();
+        Shader rayGenShader("rtbasic_rgen.spv", mVulkanResources->getShaderModuleCache());
+        Shader closestHitShader("rtshadow_rchit.spv", mVulkanResources->getShaderModuleCache());
+        Shader basicMissShader("rtbasic_rmiss.spv", mVulkanResources->getShaderModuleCache());
+        Shader shadowMissShader("rtshadow_rmiss.spv", mVulkanResources->getShaderModuleCache());
+
+        RaytracingPipelineBuilder builder;
+        uint32_t rayGenIdx = builder.addShaderStage(rayGenShader.getShaderModule(), VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        uint32_t basicMissIdx =
+            builder.addShaderStage(basicMissShader.getShaderModule(), VK_SHADER_STAGE_MISS_BIT_KHR);
+        uint32_t shadowMissIdx =
+            builder.addShaderStage(shadowMissShader.getShaderModule(), VK_SHADER_STAGE_MISS_BIT_KHR);
+        uint32_t closestHitIdx =
+            builder.addShaderStage(closestHitShader.getShaderModule(), VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+
+        builder.addGeneralShaderGroup(rayGenIdx);
+        builder.addGeneralShaderGroup(basicMissIdx);
+        builder.addGeneralShaderGroup(shadowMissIdx);
+        builder.addClosestHitShaderGroup(closestHitIdx);
+
+        builder.setMaxRecursionDepth(2); //  1 camera ray + 1 shadow ray
+                                         //  need more if multiple light?
+
+        builder.setPipelineLayout(mPipelineLayout);
+
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(device);
+
+        //  the shader group handles are only known after the pipeline is built
+        return buildShaderBindingTable();
+    });
 }
 
 BunnyResult RaytracingShadowPass::initDescriptors()
@@ -153,23 +233,25 @@ BunnyResult RaytracingShadowPass::initDescriptors()
 
     //  allocate descriptor sets
     DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .mRatio = 4                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             .mRatio = 6                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,     .mRatio = PbrMaterialBank::TEXTURE_ARRAY_SIZE},
-        {.mType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .mRatio = 2                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .mRatio = 2                                  }
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             .mRatio = 6},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,     .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,     .mRatio = 1},
+        {.mType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .mRatio = 8}
     };
     mDescriptorAllocator.init(mVulkanResources->getDevice(), 12, poolSizes);
 
-    VkDescriptorSetLayout descLayouts[] = {mMaterialBank->getWorldDescSetLayout(), mObjectDescSetLayout,
-        mMaterialBank->getMaterialDescSetLayout(), mRtDataDescSetLayout};
+    VkDescriptorSetLayout descLayouts[] = {mMaterialBank->getWorldDescSetLayout(), mObjectDescSetLayout};
     for (FrameData& frame : mFrameData)
     {
-        //  allocate all 4 sets of one frame at once
-        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), descLayouts, &frame.mWorldDescSet, 4);
+        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), descLayouts, &frame.mWorldDescSet, 2);
+
+        //  material data and the bindless textures are shared by all passes
+        frame.mMaterialDescSet = mMaterialBank->getMaterialDescSet();
 
-        //  link material data to material descriptor set
-        mMaterialBank->updateMaterialDescriptorSet(frame.mMaterialDescSet, mMeshBank);
+        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), &mRtDataDescSetLayout, &frame.mRtDataDescSet);
+        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), &mResolveDescSetLayout, &frame.mResolveDescSet);
     }
 
     mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
@@ -186,34 +268,57 @@ BunnyResult RaytracingShadowPass::initDataAndResources()
             VMA_MEMORY_USAGE_AUTO);
     mDeletionStack.AddFunction([this]() { mVulkanResources->destroyBuffer(mVertIdxBufBuffer); });
 
-    VkExtent2D swapchainExtent = mRenderer->getSwapChainExtent();
-    //  create the frame image reset buffer
-    VkDeviceSize resetBufferSize = sizeof(uint32_t) * swapchainExtent.width * swapchainExtent.height;
-    std::vector<uint32_t> frameImageResetData(resetBufferSize, 0);
-    assert(frameImageResetData.size() == resetBufferSize);
-    mVulkanResources->createBufferWithData(frameImageResetData.data(), resetBufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0, VMA_MEMORY_USAGE_AUTO, mFrameImageResetBuffer);
-    mDeletionStack.AddFunction([this]() { mVulkanResources->destroyBuffer(mFrameImageResetBuffer); });
-    //  create and bind out images for all frames
+    VkExtent2D renderExtent = mRenderer->getRenderExtent();
+    VkExtent3D imageExtent{.width = renderExtent.width, .height = renderExtent.height, .depth = 1};
+    //  create the images for all frames
     for (FrameData& frame : mFrameData)
     {
-        frame.mOutImage = mVulkanResources->createImage(
-            VkExtent3D{.width = swapchainExtent.width, .height = swapchainExtent.height, .depth = 1},
-            VK_FORMAT_R32_UINT,
-            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-            VK_IMAGE_ASPECT_COLOR_BIT);
-        mDeletionStack.AddFunction([this, &frame]() { mVulkanResources->destroyImage(frame.mOutImage); });
+        frame.mOutImage = mVulkanResources->createImage(imageExtent, VK_FORMAT_R32_UINT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        frame.mSampleImage = mVulkanResources->createImage(
+            imageExtent, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        frame.mGeometryImage = mVulkanResources->createImage(
+            imageExtent, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        mDeletionStack.AddFunction([this, &frame]() {
+            mVulkanResources->destroyImage(frame.mOutImage);
+            mVulkanResources->destroyImage(frame.mSampleImage);
+            mVulkanResources->destroyImage(frame.mGeometryImage);
+        });
+
+        //  transition image layout to general, the out and geometry images are read as history before written
+        for (const AllocatedImage* image : {&frame.mOutImage, &frame.mSampleImage, &frame.mGeometryImage})
+        {
+            mVulkanResources->immediateTransitionImageLayout(
+                image->mImage, image->mFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
 
-        //  transition image layout to general
-        mVulkanResources->immediateTransitionImageLayout(
-            frame.mOutImage.mImage, frame.mOutImage.mFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    for (size_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        //  the history of a frame is what the frame before it wrote
+        const FrameData& frame = mFrameData[idx];
+        const FrameData& prevFrame = mFrameData[(idx + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
 
         DescriptorWriter writer;
-        //  storage image, no need sampler?
         writer.writeImage(
-            1, frame.mOutImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            1, frame.mSampleImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(
+            2, frame.mGeometryImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(
+            3, prevFrame.mOutImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(4, prevFrame.mGeometryImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
         writer.updateSet(mVulkanResources->getDevice(), frame.mRtDataDescSet);
 
+        writer.clear();
+        writer.writeImage(
+            0, frame.mSampleImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(
+            1, frame.mGeometryImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(
+            2, frame.mOutImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(mVulkanResources->getDevice(), frame.mResolveDescSet);
+
         writer.clear();
         writer.writeBuffer(
             1, mVertIdxBufBuffer.mBuffer, sizeof(VertexIndexBufferData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
@@ -229,9 +334,11 @@ BunnyResult RaytracingShadowPass::buildPipelineLayout()
     //  need to also add descriptor set layouts for vertex and index buffer as storage buffers
     std::array<VkDescriptorSetLayout, 4> descLayouts{mMaterialBank->getWorldDescSetLayout(), mObjectDescSetLayout,
         mMaterialBank->getMaterialDescSetLayout(), mRtDataDescSetLayout};
+    VkPushConstantRange pushConstRange{
+        .stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR, .offset = 0, .size = sizeof(ReprojectionParams)};
     VkPipelineLayoutCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-    createInfo.pushConstantRangeCount = 0;
-    createInfo.pPushConstantRanges = nullptr;
+    createInfo.pushConstantRangeCount = 1;
+    createInfo.pPushConstantRanges = &pushConstRange;
     createInfo.setLayoutCount = descLayouts.size();
     createInfo.pSetLayouts = descLayouts.data();
 
@@ -249,6 +356,31 @@ BunnyResult RaytracingShadowPass::buildPipelineLayout()
     return BUNNY_HAPPY;
 }
 
+BunnyResult RaytracingShadowPass::buildResolvePipelineLayout()
+{
+    //  the push constant is the checkerboard parity
+    VkPushConstantRange pushConstRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(uint32_t)};
+    VkPipelineLayoutCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    createInfo.pushConstantRangeCount = 1;
+    createInfo.pPushConstantRanges = &pushConstRange;
+    createInfo.setLayoutCount = 1;
+    createInfo.pSetLayouts = &mResolveDescSetLayout;
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        vkCreatePipelineLayout(mVulkanResources->getDevice(), &createInfo, nullptr, &mResolvePipelineLayout))
+
+    mDeletionStack.AddFunction([this]() {
+        if (mResolvePipelineLayout != nullptr)
+        {
+            vkDestroyPipelineLayout(mVulkanResources->getDevice(), mResolvePipelineLayout, nullptr);
+            mResolvePipelineLayout = nullptr;
+        }
+    });
+
+    return BUNNY_HAPPY;
+}
+
 BunnyResult RaytracingShadowPass::buildRaytracingDescSetLayouts()
 {
     //  build object descriptor set
@@ -273,12 +405,17 @@ BunnyResult RaytracingShadowPass::buildRaytracingDescSetLayouts()
     //  build descriptor set layouts that are specific to the ray tracing pipeline
     VkDescriptorSetLayoutBinding acceStructBinding{0, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1,
         VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr};
-    VkDescriptorSetLayoutBinding outImageBinding{
+    VkDescriptorSetLayoutBinding imageBinding{
         1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr};
 
     builder.clear();
     builder.addBinding(acceStructBinding);
-    builder.addBinding(outImageBinding);
+    //  sample image, geometry image, history out image, history geometry image
+    for (uint32_t binding = 1; binding <= 4; binding++)
+    {
+        imageBinding.binding = binding;
+        builder.addBinding(imageBinding);
+    }
     mRtDataDescSetLayout = builder.build(mVulkanResources->getDevice());
 
     mDeletionStack.AddFunction([this]() {
@@ -289,6 +426,24 @@ BunnyResult RaytracingShadowPass::buildRaytracingDescSetLayouts()
         }
     });
 
+    //  sample image, geometry image, out image
+    imageBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    builder.clear();
+    for (uint32_t binding = 0; binding < 3; binding++)
+    {
+        imageBinding.binding = binding;
+        builder.addBinding(imageBinding);
+    }
+    mResolveDescSetLayout = builder.build(mVulkanResources->getDevice());
+
+    mDeletionStack.AddFunction([this]() {
+        if (mResolveDescSetLayout != nullptr)
+        {
+            vkDestroyDescriptorSetLayout(mVulkanResources->getDevice(), mResolveDescSetLayout, nullptr);
+            mResolveDescSetLayout = nullptr;
+        }
+    });
+
     return BUNNY_HAPPY;
 }
 
@@ -324,7 +479,6 @@ BunnyResult Render::RaytracingShadowPass::buildShaderBindingTable()
             VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR,
         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         VMA_MEMORY_USAGE_AUTO, groupAlignment);
-    mDeletionStack.AddFunction([this]() { this->mVulkanResources->destroyBuffer(mShaderBindingTableBuffer); });
 
     VkDeviceAddress sbtAddress = mVulkanResources->getBufferDeviceAddress(mShaderBindingTableBuffer);
     mRayGenRegion.deviceAddress = sbtAddress;
@@ -363,29 +517,4 @@ void RaytracingShadowPass::queryRaytracingProperties()
     mVulkanResources->getPhysicalDeviceProperties(&mRaytracingProperties);
 }
 
-void Render::RaytracingShadowPass::resetFrameImage() const
-{
-    const AllocatedImage& frameImage = mFrameData[mRenderer->getCurrentFrameIdx()].mOutImage;
-
-    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
-
-    VkImageSubresourceLayers imageSubresource{
-        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1};
-    VkBufferImageCopy bufImgCopy{
-        .bufferOffset = 0,
-        .bufferRowLength = 0, //  image data is tightly packed
-        .bufferImageHeight = 0, //  image data is tightly packed
-        .imageSubresource = imageSubresource,
-        .imageOffset = {0, 0, 0},
-        .imageExtent = frameImage.mExtent
-    };
-
-    mVulkanResources->transitionImageLayout(
-        cmd, frameImage.mImage, frameImage.mFormat, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    vkCmdCopyBufferToImage(
-        cmd, mFrameImageResetBuffer.mBuffer, frameImage.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufImgCopy);
-    mVulkanResources->transitionImageLayout(
-        cmd, frameImage.mImage, frameImage.mFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
-}
-
 } // namespace Bunny::Render
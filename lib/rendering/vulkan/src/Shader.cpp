@@ -1,5 +1,6 @@
 #include "Shader.h"
 
+#include "ShaderModuleCache.h"
 #include "Error.h"
 
 #include <fstream>
@@ -12,6 +13,11 @@ Shader::Shader(std::string_view shaderPath, VkDevice device) : mDevice(device)
     createShaderModule(fileBuffer, device);
 }
 
+Shader::Shader(std::string_view shaderPath, ShaderModuleCache* moduleCache)
+    : mShaderModule(moduleCache->getShaderModule(shaderPath))
+{
+}
+
 Shader::~Shader()
 {
     destroyShaderModule();
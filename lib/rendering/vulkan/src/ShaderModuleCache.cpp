@@ -0,0 +1,210 @@
+#include "ShaderModuleCache.h"
+
+#include "Error.h"
+#include "ErrorCheck.h"
+#include "HashHelpers.h"
+
+#include <fmt/core.h>
+
+#include <charconv>
+#include <fstream>
+
+namespace Bunny::Render
+{
+namespace
+{
+//  bundle layout, see compile_glsl_shaders.sh
+//  BUNNY_SPIRV_BUNDLE 1\n
+//  <shader file name> <offset> <size>\n   one line per shader, offset is relative to the data section
+//  END\n
+//  zero padding to 4 bytes, then the data section with all the SPIR-V code
+constexpr std::string_view SHADER_BUNDLE_HEADER = "BUNNY_SPIRV_BUNDLE 1";
+constexpr std::string_view SHADER_BUNDLE_END = "END";
+
+bool readLine(std::string_view text, size_t& pos, std::string_view& outLine)
+{
+    size_t lineEnd = text.find('\n', pos);
+    if (lineEnd == std::string_view::npos)
+    {
+        return false;
+    }
+    outLine = text.substr(pos, lineEnd - pos);
+    pos = lineEnd + 1;
+    return true;
+}
+
+bool parseNumber(std::string_view text, size_t& outValue)
+{
+    auto [ptr, err] = std::from_chars(text.data(), text.data() + text.size(), outValue);
+    return err == std::errc{} && ptr == text.data() + text.size();
+}
+} // namespace
+
+BunnyResult ShaderModuleCache::initialize(VkDevice device, std::string_view bundlePath)
+{
+    mDevice = device;
+
+    if (!BUNNY_SUCCESS(loadBundle(bundlePath)))
+    {
+        mBundleFile.close();
+        mBundledShaders.clear();
+        PRINT_WARNING("Shader bundle is not available, shaders will be loaded from separate files.")
+    }
+
+    return BUNNY_HAPPY;
+}
+
+void ShaderModuleCache::cleanup()
+{
+    std::lock_guard lock(mMutex);
+
+    for (auto& [hash, shaderModule] : mShaderModules)
+    {
+        vkDestroyShaderModule(mDevice, shaderModule, nullptr);
+    }
+    mShaderModules.clear();
+    mShaderModulesByPath.clear();
+    mBundledShaders.clear();
+    mBundleFile.close();
+}
+
+VkShaderModule ShaderModuleCache::getShaderModule(std::string_view shaderPath)
+{
+    std::string pathKey(shaderPath);
+    {
+        std::lock_guard lock(mMutex);
+        if (auto moduleIt = mShaderModulesByPath.find(pathKey); moduleIt != mShaderModulesByPath.end())
+        {
+            return moduleIt->second;
+        }
+    }
+
+    //  reading and hashing the code is done without the lock, so the pipeline compile jobs do not wait on each other
+    //  the bundle is not changed after initialize(), so it is read without the lock
+    std::vector<std::byte> fileBuffer;
+    std::span<const std::byte> code = findShaderCode(std::filesystem::path(shaderPath), fileBuffer);
+    if (code.empty() || code.size() % sizeof(uint32_t) != 0)
+    {
+        PRINT_AND_RETURN_VALUE(fmt::format("Can not load shader {}", shaderPath), VK_NULL_HANDLE)
+    }
+
+    const uint64_t hash = Base::fnv1aHash(code.data(), code.size());
+
+    //  another job may have created the module for the same code in the meantime
+    std::lock_guard lock(mMutex);
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (auto moduleIt = mShaderModules.find(hash); moduleIt != mShaderModules.end())
+    {
+        shaderModule = moduleIt->second;
+    }
+    else
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+        VK_CHECK_OR_RETURN_VALUE(vkCreateShaderModule(mDevice, &createInfo, nullptr, &shaderModule), VK_NULL_HANDLE)
+        mShaderModules.emplace(hash, shaderModule);
+    }
+
+    mShaderModulesByPath.emplace(std::move(pathKey), shaderModule);
+    return shaderModule;
+}
+
+BunnyResult ShaderModuleCache::loadBundle(std::string_view bundlePath)
+{
+    if (!mBundleFile.open(bundlePath))
+    {
+        return BUNNY_SAD;
+    }
+
+    std::error_code error;
+    mBundleWriteTime = std::filesystem::last_write_time(std::filesystem::path(bundlePath), error);
+
+    std::span<const std::byte> content = mBundleFile.getContent();
+    std::string_view text(reinterpret_cast<const char*>(content.data()), content.size());
+    size_t pos = 0;
+    std::string_view line;
+
+    if (!readLine(text, pos, line) || line != SHADER_BUNDLE_HEADER)
+    {
+        return BUNNY_SAD;
+    }
+
+    struct BundleEntry
+    {
+        std::string_view mName;
+        size_t mOffset;
+        size_t mSize;
+    };
+    std::vector<BundleEntry> entries;
+    while (true)
+    {
+        if (!readLine(text, pos, line))
+        {
+            return BUNNY_SAD;
+        }
+        if (line == SHADER_BUNDLE_END)
+        {
+            break;
+        }
+
+        size_t sizeSplit = line.rfind(' ');
+        size_t offsetSplit = sizeSplit == std::string_view::npos ? sizeSplit : line.rfind(' ', sizeSplit - 1);
+        if (offsetSplit == std::string_view::npos)
+        {
+            return BUNNY_SAD;
+        }
+
+        BundleEntry& entry = entries.emplace_back();
+        entry.mName = line.substr(0, offsetSplit);
+        if (!parseNumber(line.substr(offsetSplit + 1, sizeSplit - offsetSplit - 1), entry.mOffset) ||
+            !parseNumber(line.substr(sizeSplit + 1), entry.mSize))
+        {
+            return BUNNY_SAD;
+        }
+    }
+
+    //  data section starts at the next 4 byte boundary
+    const size_t dataStart = (pos + 3) & ~size_t(3);
+    for (const BundleEntry& entry : entries)
+    {
+        if (dataStart + entry.mOffset + entry.mSize > content.size())
+        {
+            return BUNNY_SAD;
+        }
+        mBundledShaders.emplace(std::string(entry.mName), content.subspan(dataStart + entry.mOffset, entry.mSize));
+    }
+
+    return BUNNY_HAPPY;
+}
+
+std::span<const std::byte> ShaderModuleCache::findShaderCode(
+    const std::filesystem::path& shaderPath, std::vector<std::byte>& fileBuffer) const
+{
+    std::error_code error;
+    const std::filesystem::file_time_type fileWriteTime = std::filesystem::last_write_time(shaderPath, error);
+    const bool hasLooseFile = !error;
+
+    //  prefer the bundle unless the shader was recompiled after the bundle was packed
+    auto bundleIt = mBundledShaders.find(shaderPath.filename().string());
+    if (bundleIt != mBundledShaders.end() && (!hasLooseFile || fileWriteTime <= mBundleWriteTime))
+    {
+        return bundleIt->second;
+    }
+
+    std::ifstream shaderFile(shaderPath, std::ios::ate | std::ios::binary);
+    if (!shaderFile.is_open())
+    {
+        return {};
+    }
+
+    size_t fileSize = static_cast<size_t>(shaderFile.tellg());
+    fileBuffer.resize(fileSize);
+    shaderFile.seekg(0);
+    shaderFile.read(reinterpret_cast<char*>(fileBuffer.data()), fileSize);
+
+    return fileBuffer;
+}
+} // namespace Bunny::Render
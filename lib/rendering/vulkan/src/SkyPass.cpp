@@ -4,10 +4,12 @@
 #include "VulkanRenderResources.h"
 #include "VulkanGraphicsRenderer.h"
 #include "TextureBank.h"
+#include "CloudNoisePass.h"
 #include "Shader.h"
 #include "Camera.h"
 #include "ErrorCheck.h"
 #include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 
 #include <cassert>
 
@@ -38,61 +40,68 @@ static constexpr SkyPass::CloudData defaultCloudData{
 };
 
 SkyPass::SkyPass(const VulkanRenderResources* vulkanResources, const VulkanGraphicsRenderer* renderer,
-    TextureBank* textureBank, std::string_view cloudShaderPath)
+    TextureBank* textureBank, const CloudNoisePass* cloudNoisePass, std::string_view cloudShaderPath,
+    std::string_view cloudMarchShaderPath, std::string_view cloudReprojectShaderPath)
     : super(vulkanResources, renderer, nullptr, nullptr),
       mTextureBank(textureBank),
-      mCloudShaderPath(cloudShaderPath)
+      mCloudNoisePass(cloudNoisePass),
+      mCloudShaderPath(cloudShaderPath),
+      mCloudMarchShaderPath(cloudMarchShaderPath),
+      mCloudReprojectShaderPath(cloudReprojectShaderPath)
 {
 }
 
-void SkyPass::draw() const
+void SkyPass::marchClouds() const
 {
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
-    uint32_t currentFrameIdx = mRenderer->getCurrentFrameIdx();
-    const FrameData& frame = mFrameData.at(currentFrameIdx);
+    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    //  should wait for cloud texture read by final output pass is finished
-    //  but probably not needed
-    //  check back later
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCloudMarchPipeline);
+    bindDescriptorSets(cmd, frame);
 
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
-    vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 2, frame.getCurrentDescSets(), 0, nullptr);
+    //  one thread per block
+    constexpr static uint32_t computeSize = 8;
+    VkExtent3D sampleExtent = frame.mCloudSampleImage.mExtent;
+    vkCmdDispatch(cmd, (sampleExtent.width + computeSize - 1) / computeSize,
+        (sampleExtent.height + computeSize - 1) / computeSize, 1);
+}
 
-    constexpr static uint32_t computeSizeX = 32;
-    constexpr static uint32_t computeSizeY = 16;
-    VkExtent3D renderImageExtent = frame.mCloudTexture1.mExtent;
-    vkCmdDispatch(cmd, renderImageExtent.width / computeSizeX, renderImageExtent.height / computeSizeY, 1);
+void SkyPass::reprojectClouds() const
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mCloudReprojectPipeline);
+    bindDescriptorSets(cmd, frame);
 
-    //  transition the depth image back to depth attachment optimal
-    //  maybe not needed here, because depth reduce pass still need to read
-    //  check back later
+    constexpr static uint32_t computeSize = 8;
+    VkExtent3D historyExtent = frame.mCloudHistoryImage.mExtent;
+    vkCmdDispatch(cmd, (historyExtent.width + computeSize - 1) / computeSize,
+        (historyExtent.height + computeSize - 1) / computeSize, 1);
 }
 
-void SkyPass::updateFrameData()
+void SkyPass::draw() const
 {
-    //  advance frame in sequence sothat it will use the correct current frame and last frame data
-    FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    frame.advanceFrameInSequence();
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    VkCommandBuffer cmdBuf = mRenderer->getCurrentCommandBuffer();
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    bindDescriptorSets(cmd, frame);
 
-    //  transition depth image from depth attachment optimal to shader read optimal
-    {
-        VkImageMemoryBarrier depthWriteFinishBarrier =
-            makeImageMemoryBarrier(frame.mDepthTexture->mImage, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT);
-        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &depthWriteFinishBarrier);
-    }
+    constexpr static uint32_t computeSizeX = 32;
+    constexpr static uint32_t computeSizeY = 16;
+    VkExtent3D renderImageExtent = frame.mCloudTexture.mExtent;
+    //  a scaled render extent is not a multiple of the group size
+    vkCmdDispatch(cmd, (renderImageExtent.width + computeSizeX - 1) / computeSizeX,
+        (renderImageExtent.height + computeSizeY - 1) / computeSizeY, 1);
 
-    //  wait for the prev frame cloud texture write finish (maybe not needed because it should be done by this point?)
+    //  the depth image and the cloud images are transitioned by the frame graph
 }
 
 void SkyPass::updateRenderParams(const Camera& camera, float elapsedTime)
 {
     //  update camera and time information
+    //  the history is the cloud history of the last frame, so it is seen from the camera of the last frame
     mCloudRenderParams.mPrevViewProj = camera.getPrevViewProjMatrix();
     mCloudRenderParams.mCameraPosition = camera.getPosition();
 
@@ -114,34 +123,31 @@ void SkyPass::updateRenderParams(const Camera& camera, float elapsedTime)
     mCloudRenderParams.mCameraFrameWorldBR =
         glm::vec4(frameCenter - camUp * frameHalfHeight + camRight * frameHalfWidth, 1.0f);
 
-    mCloudRenderParams.mDitherIdx = (mCloudRenderParams.mDitherIdx + 1) % CloudRenderParams::MAX_DITHER_COUNT;
+    mCloudRenderParams.mDitherIdx = mFrameCount % CloudRenderParams::MAX_DITHER_COUNT;
+    mCloudRenderParams.mIsHistoryValid = mFrameCount > 0 ? 1 : 0;
+    mFrameCount++;
 
     mCloudRenderParams.mElapsedTime = elapsedTime;
 
-    //  use the new data to update the render params buffer
-    {
-        void* data = mCloudRenderParamsBuffer.mAllocationInfo.pMappedData;
-        memcpy(data, &mCloudRenderParams, sizeof(CloudRenderParams));
-    }
+    mRenderer->getFrameArena().write(mCloudRenderParams, mCloudRenderParamsSlice);
 }
 
-void SkyPass::linkLightData(const AllocatedBuffer& lightData)
+void SkyPass::linkLightData(const FrameBufferSlice& lightData)
 {
+    mLightData = &lightData;
+
     VkDevice device = mVulkanResources->getDevice();
     DescriptorWriter writer;
-    writer.writeBuffer(0, lightData.mBuffer, sizeof(LightData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.writeBuffer(0, lightData.mBuffer, lightData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     for (FrameData& frame : mFrameData)
     {
-        for (FrameData::DescSets& descSets : frame.mDescriptors)
-        {
-            writer.updateSet(device, descSets.mCloudDescSet);
-        }
+        writer.updateSet(device, frame.mCloudDescSet);
     }
 }
 
 const AllocatedImage& SkyPass::getCurrentCloudTexture() const
 {
-    return mFrameData[mRenderer->getCurrentFrameIdx()].getCloudTexture();
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mCloudTexture;
 }
 
 const AllocatedImage& SkyPass::getCurrentFogShadowTexture() const
@@ -149,13 +155,38 @@ const AllocatedImage& SkyPass::getCurrentFogShadowTexture() const
     return mFrameData[mRenderer->getCurrentFrameIdx()].mFogShadowTexture;
 }
 
+const AllocatedImage& SkyPass::getCurrentCloudSampleImage() const
+{
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mCloudSampleImage;
+}
+
+const AllocatedImage& SkyPass::getCurrentCloudHistoryImage() const
+{
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mCloudHistoryImage;
+}
+
+const AllocatedImage& SkyPass::getPreviousCloudHistoryImage() const
+{
+    return getPreviousFrameData().mCloudHistoryImage;
+}
+
+const SkyPass::FrameData& SkyPass::getPreviousFrameData() const
+{
+    return mFrameData[(mRenderer->getCurrentFrameIdx() + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+}
+
+void SkyPass::bindDescriptorSets(VkCommandBuffer cmd, const FrameData& frame) const
+{
+    //  in binding order of the cloud set, the texture set has no dynamic buffers
+    const uint32_t dynamicOffsets[] = {mLightData->mOffset, mCloudRenderParamsSlice.mOffset};
+    vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 2, &frame.mCloudDescSet, 2, dynamicOffsets);
+}
+
 BunnyResult SkyPass::initPipeline()
 {
     VkDevice device = mVulkanResources->getDevice();
 
-    //  load shader
-    Shader cloudShader(mCloudShaderPath, device);
-
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {mCloudDescSetLayout, mTextureDescSetLayout};
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -169,14 +200,32 @@ BunnyResult SkyPass::initPipeline()
     mDeletionStack.AddFunction(
         [this]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), mPipelineLayout, nullptr); });
 
-    ComputePipelineBuilder pipelineBuilder;
-    pipelineBuilder.setShader(cloudShader.getShaderModule());
-    pipelineBuilder.setPipelineLayout(mPipelineLayout);
-    mPipeline = pipelineBuilder.build(device);
+    //  the three stages share the pipeline layout, every shader only declares the bindings it uses
+    mDeletionStack.AddFunction([this]() {
+        VkDevice device = mVulkanResources->getDevice();
+        vkDestroyPipeline(device, mPipeline, nullptr);
+        vkDestroyPipeline(device, mCloudMarchPipeline, nullptr);
+        vkDestroyPipeline(device, mCloudReprojectPipeline, nullptr);
+    });
 
-    mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
+    auto enqueueBuild = [this, device](std::string_view shaderPath, VkPipeline& pipeline) {
+        return PipelineCompileQueue::enqueue([this, device, shaderPath, &pipeline]() {
+            //  load shader
+            Shader shader(shaderPath, mVulkanResources->getShaderModuleCache());
 
-    return BUNNY_HAPPY;
+            ComputePipelineBuilder pipelineBuilder;
+            pipelineBuilder.setShader(shader.getShaderModule());
+            pipelineBuilder.setPipelineLayout(mPipelineLayout);
+            pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+            pipeline = pipelineBuilder.build(device);
+
+            return BUNNY_HAPPY;
+        });
+    };
+
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(enqueueBuild(mCloudMarchShaderPath, mCloudMarchPipeline))
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(enqueueBuild(mCloudReprojectShaderPath, mCloudReprojectPipeline))
+    return enqueueBuild(mCloudShaderPath, mPipeline);
 }
 
 BunnyResult SkyPass::initDescriptors()
@@ -186,7 +235,8 @@ BunnyResult SkyPass::initDescriptors()
     VkDevice device = mVulkanResources->getDevice();
 
     DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 3},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 1},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .mRatio = 2},
         {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = 2},
         {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 2},
     };
@@ -195,10 +245,7 @@ BunnyResult SkyPass::initDescriptors()
     VkDescriptorSetLayout descLayouts[] = {mCloudDescSetLayout, mTextureDescSetLayout};
     for (FrameData& frame : mFrameData)
     {
-        for (FrameData::DescSets& frameDescSets : frame.mDescriptors)
-        {
-            mDescriptorAllocator.allocate(device, descLayouts, &frameDescSets.mCloudDescSet, 2);
-        }
+        mDescriptorAllocator.allocate(device, descLayouts, &frame.mCloudDescSet, 2);
     }
 
     mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
@@ -208,21 +255,28 @@ BunnyResult SkyPass::initDescriptors()
 
 BunnyResult SkyPass::initDataAndResources()
 {
-    VkExtent2D swapchainExtent = mRenderer->getSwapChainExtent();
-    VkExtent3D renderImageExtent{swapchainExtent.width, swapchainExtent.height, 1};
+    VkExtent2D renderExtent = mRenderer->getRenderExtent();
+    VkExtent3D renderImageExtent{renderExtent.width, renderExtent.height, 1};
+    //  half of the render resolution on each axis, rounded up so the history covers every pixel
+    VkExtent3D cloudImageExtent{(renderExtent.width + 1) / 2, (renderExtent.height + 1) / 2, 1};
+    VkExtent3D sampleImageExtent{(cloudImageExtent.width + CLOUD_BLOCK_SIZE - 1) / CLOUD_BLOCK_SIZE,
+        (cloudImageExtent.height + CLOUD_BLOCK_SIZE - 1) / CLOUD_BLOCK_SIZE, 1};
     VkDevice device = mVulkanResources->getDevice();
 
     //  create output textures
     for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
     {
         FrameData& frame = mFrameData[idx];
-        frame.mCloudTexture1 = mVulkanResources->createImage(renderImageExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
+        frame.mCloudTexture = mVulkanResources->createImage(renderImageExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
             VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
             VK_IMAGE_LAYOUT_GENERAL);
-        frame.mCloudTexture2 = mVulkanResources->createImage(renderImageExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
+        frame.mFogShadowTexture = mVulkanResources->createImage(renderImageExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
             VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
             VK_IMAGE_LAYOUT_GENERAL);
-        frame.mFogShadowTexture = mVulkanResources->createImage(renderImageExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
+        frame.mCloudSampleImage = mVulkanResources->createImage(sampleImageExtent, VK_FORMAT_R16G16B16A16_SFLOAT,
+            VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        //  sampled by the reprojection of the next frame
+        frame.mCloudHistoryImage = mVulkanResources->createImage(cloudImageExtent, VK_FORMAT_R16G16B16A16_SFLOAT,
             VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
             VK_IMAGE_LAYOUT_GENERAL);
         frame.mDepthTexture = &mRenderer->getDepthImageResolved(idx);
@@ -231,31 +285,43 @@ BunnyResult SkyPass::initDataAndResources()
     mDeletionStack.AddFunction([this]() {
         for (FrameData& frame : mFrameData)
         {
-            mVulkanResources->destroyImage(frame.mCloudTexture1);
-            mVulkanResources->destroyImage(frame.mCloudTexture2);
+            mVulkanResources->destroyImage(frame.mCloudTexture);
             mVulkanResources->destroyImage(frame.mFogShadowTexture);
+            mVulkanResources->destroyImage(frame.mCloudSampleImage);
+            mVulkanResources->destroyImage(frame.mCloudHistoryImage);
             frame.mDepthTexture = nullptr;
         }
     });
 
     //  load noise and other textures to texture bank
     IdType texId;
-    //  main cloud noise
-    if (BUNNY_SUCCESS(mTextureBank->addTexture3d("./assets/texture/main_cloud_noise.png", VK_FORMAT_R8G8B8A8_UNORM,
-            MAIN_CLOUD_NOISE_RESOLUTION, MAIN_CLOUD_NOISE_RESOLUTION, MAIN_CLOUD_NOISE_RESOLUTION, texId)))
+    //  the generated weather maps keep being written, so they stay in the general layout
+    //  and each frame in flight samples its own, the baked one is shared
+    VkImageLayout weatherLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    if (mCloudNoisePass != nullptr)
     {
-        mTextureBank->getTexture3d(texId, mMainNoiseTexture);
+        mMainNoiseTexture = mCloudNoisePass->getMainNoiseImage();
+        mDetailNoiseTexture = mCloudNoisePass->getDetailNoiseImage();
+        weatherLayout = VK_IMAGE_LAYOUT_GENERAL;
     }
-    //  detail cloud noise
-    if (BUNNY_SUCCESS(mTextureBank->addTexture3d("./assets/texture/detail_cloud_noise.png", VK_FORMAT_R8G8B8A8_UNORM,
-            DETAIL_CLOUD_NOISE_RESOLUTION, DETAIL_CLOUD_NOISE_RESOLUTION, DETAIL_CLOUD_NOISE_RESOLUTION, texId)))
+    else
     {
-        mTextureBank->getTexture3d(texId, mDetailNoiseTexture);
-    }
-    //  weather
-    if (BUNNY_SUCCESS(mTextureBank->addTexture("./assets/texture/weather.png", VK_FORMAT_R8G8B8A8_UNORM, texId)))
-    {
-        mTextureBank->getTexture(texId, mWeatherNoiseTexture);
+        //  main cloud noise
+        if (BUNNY_SUCCESS(mTextureBank->addTexture3d("./assets/texture/main_cloud_noise.dds", texId)))
+        {
+            mTextureBank->getTexture3d(texId, mMainNoiseTexture);
+        }
+        //  detail cloud noise
+        if (BUNNY_SUCCESS(mTextureBank->addTexture3d("./assets/texture/detail_cloud_noise.dds", texId)))
+        {
+            mTextureBank->getTexture3d(texId, mDetailNoiseTexture);
+        }
+        //  weather
+        if (BUNNY_SUCCESS(
+                mTextureBank->addTexture("./assets/texture/weather.png", VK_FORMAT_R8G8B8A8_UNORM, texId)))
+        {
+            mTextureBank->getTexture(texId, mWeatherNoiseTexture);
+        }
     }
     //  blue noise
     if (BUNNY_SUCCESS(mTextureBank->addTexture("./assets/texture/blue_noise.png", VK_FORMAT_R8G8B8A8_UNORM, texId)))
@@ -271,7 +337,8 @@ BunnyResult SkyPass::initDataAndResources()
         glm::vec3(mMainNoiseTexture.mExtent.width, mMainNoiseTexture.mExtent.height, mMainNoiseTexture.mExtent.depth);
     mCloudData.mDetailNoiseDimension = glm::vec3(
         mDetailNoiseTexture.mExtent.width, mDetailNoiseTexture.mExtent.height, mDetailNoiseTexture.mExtent.depth);
-    mCloudData.mRenderResolution = glm::vec2(swapchainExtent.width, swapchainExtent.height);
+    mCloudData.mRenderResolution = glm::vec2(renderExtent.width, renderExtent.height);
+    mCloudData.mCloudResolution = glm::vec2(cloudImageExtent.width, cloudImageExtent.height);
     mCloudData.mZNear = Camera::NearPlaneDistance;
     mCloudData.mZFar = Camera::FarPlaneDistance;
     //  cloud render params will be updated from camera every frame
@@ -279,28 +346,23 @@ BunnyResult SkyPass::initDataAndResources()
     mVulkanResources->createBufferWithData(&mCloudData, sizeof(CloudData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         VMA_MEMORY_USAGE_AUTO, mCloudDataBuffer);
-    mCloudRenderParamsBuffer =
-        mVulkanResources->createBuffer(sizeof(CloudRenderParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-            VMA_MEMORY_USAGE_AUTO);
+    mCloudRenderParamsSlice = mRenderer->getFrameArena().makeSlice(sizeof(CloudRenderParams));
 
-    mDeletionStack.AddFunction([this]() {
-        mVulkanResources->destroyBuffer(mCloudDataBuffer);
-        mVulkanResources->destroyBuffer(mCloudRenderParamsBuffer);
-    });
+    mDeletionStack.AddFunction([this]() { mVulkanResources->destroyBuffer(mCloudDataBuffer); });
 
     //  use the created resources to update the frame descriptor sets
-    for (FrameData& frame : mFrameData)
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
     {
+        FrameData& frame = mFrameData[idx];
+        //  the history of the last frame is always the one of the previous frame in flight
+        const FrameData& previousFrame = mFrameData[(idx + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+
         DescriptorWriter writer;
         //  light buffer is linked separately
         writer.writeBuffer(1, mCloudDataBuffer.mBuffer, sizeof(CloudData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-        writer.writeBuffer(
-            2, mCloudRenderParamsBuffer.mBuffer, sizeof(CloudRenderParams), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-        for (FrameData::DescSets& descSets : frame.mDescriptors)
-        {
-            writer.updateSet(device, descSets.mCloudDescSet);
-        }
+        writer.writeBuffer(2, mCloudRenderParamsSlice.mBuffer, mCloudRenderParamsSlice.mRange, 0,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+        writer.updateSet(device, frame.mCloudDescSet);
         writer.clear();
 
         std::vector<VkDescriptorImageInfo> tex3dInfos(
@@ -312,33 +374,25 @@ BunnyResult SkyPass::initDataAndResources()
             TEXTURE_2D_COUNT, VkDescriptorImageInfo{.sampler = mTextureBank->getSampler(),
                                   .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
         tex2dInfos[0].imageView = mBlueNoiseTexture.mImageView;
-        tex2dInfos[1].imageView = mWeatherNoiseTexture.mImageView;
+        tex2dInfos[1].imageView = mCloudNoisePass != nullptr ? mCloudNoisePass->getWeatherImage(idx).mImageView
+                                                             : mWeatherNoiseTexture.mImageView;
+        tex2dInfos[1].imageLayout = weatherLayout;
 
         writer.writeImages(0, tex3dInfos, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
         writer.writeImages(1, tex2dInfos, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
         writer.writeImage(2, frame.mDepthTexture->mImageView, mTextureBank->getSampler(),
             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImage(3, frame.mCloudTexture2.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
-            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImage(4, frame.mCloudTexture1.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
-            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE); //  can the sampler be nullptr when storage image?
-        writer.writeImage(5, frame.mFogShadowTexture.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
+        writer.writeImage(3, previousFrame.mCloudHistoryImage.mImageView, mTextureBank->getSampler(),
+            VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(4, frame.mCloudSampleImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
             VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        writer.updateSet(device, frame.mDescriptors[0].mTextureDescSet);
-        writer.clear();
-
-        //  switch the cloud render target and last frame cloud tex
-        writer.writeImages(0, tex3dInfos, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImages(1, tex2dInfos, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImage(2, frame.mDepthTexture->mImageView, mTextureBank->getSampler(),
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImage(3, frame.mCloudTexture1.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
-            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-        writer.writeImage(4, frame.mCloudTexture2.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
-            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE); //  can the sampler be nullptr when storage image?
-        writer.writeImage(5, frame.mFogShadowTexture.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
+        writer.writeImage(5, frame.mCloudHistoryImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.writeImage(6, frame.mCloudTexture.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
             VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        writer.updateSet(device, frame.mDescriptors[1].mTextureDescSet);
+        writer.writeImage(7, frame.mFogShadowTexture.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(device, frame.mTextureDescSet);
     }
 
     return BUNNY_HAPPY;
@@ -352,13 +406,16 @@ BunnyResult SkyPass::initDescriptorLayouts()
     VkDevice device = mVulkanResources->getDevice();
 
     DescriptorLayoutBuilder builder;
-    //  light data
+    //  light data, in the frame buffer arena
+    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     builder.addBinding(descBinding);
     //  cloud data
     descBinding.binding = 1;
+    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     builder.addBinding(descBinding);
-    //  render data
+    //  render data, in the frame buffer arena
     descBinding.binding = 2;
+    descBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     builder.addBinding(descBinding);
     mCloudDescSetLayout = builder.build(device);
 
@@ -376,16 +433,22 @@ BunnyResult SkyPass::initDescriptorLayouts()
     descBinding.binding = 2;
     descBinding.descriptorCount = 1;
     builder.addBinding(descBinding);
-    //  last frame cloud texture
+    //  last frame cloud history
     descBinding.binding = 3;
     builder.addBinding(descBinding);
-    //  output cloud texture
+    //  ray marched cloud samples
     descBinding.binding = 4;
     descBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     builder.addBinding(descBinding);
-    //  output fog shadow texture
+    //  cloud history
     descBinding.binding = 5;
     builder.addBinding(descBinding);
+    //  output cloud texture
+    descBinding.binding = 6;
+    builder.addBinding(descBinding);
+    //  output fog shadow texture
+    descBinding.binding = 7;
+    builder.addBinding(descBinding);
     mTextureDescSetLayout = builder.build(device);
 
     mDeletionStack.AddFunction([this, device]() {
@@ -396,9 +459,4 @@ BunnyResult SkyPass::initDescriptorLayouts()
     return BUNNY_HAPPY;
 }
 
-const AllocatedImage& SkyPass::FrameData::getCloudTexture() const
-{
-    return mCurrentFrameSeqId == 0 ? mCloudTexture1 : mCloudTexture2;
-}
-
 } // namespace Bunny::Render
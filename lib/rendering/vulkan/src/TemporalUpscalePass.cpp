@@ -0,0 +1,224 @@
+#include "TemporalUpscalePass.h"
+
+#include "VulkanRenderResources.h"
+#include "VulkanGraphicsRenderer.h"
+#include "TextureBank.h"
+#include "Camera.h"
+#include "Shader.h"
+#include "ErrorCheck.h"
+#include "ComputePipelineBuilder.h"
+#include "PipelineCompileQueue.h"
+
+#include <glm/matrix.hpp>
+
+namespace Bunny::Render
+{
+namespace
+{
+float getHaltonValue(uint32_t index, uint32_t base)
+{
+    float result = 0;
+    float fraction = 1.0f / base;
+    while (index > 0)
+    {
+        result += fraction * (index % base);
+        index /= base;
+        fraction /= base;
+    }
+    return result;
+}
+} // namespace
+
+TemporalUpscalePass::TemporalUpscalePass(const VulkanRenderResources* vulkanResources,
+    const VulkanGraphicsRenderer* renderer, const TextureBank* textureBank)
+    : mVulkanResources(vulkanResources),
+      mRenderer(renderer),
+      mTextureBank(textureBank)
+{
+}
+
+BunnyResult TemporalUpscalePass::initializePass()
+{
+    initDescriptorSets();
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initPipeline())
+    createImages();
+
+    return BUNNY_HAPPY;
+}
+
+void TemporalUpscalePass::cleanup()
+{
+    VkDevice device = mVulkanResources->getDevice();
+
+    if (mPipeline != nullptr)
+    {
+        vkDestroyPipeline(device, mPipeline, nullptr);
+        mPipeline = nullptr;
+    }
+
+    if (mPipelineLayout != nullptr)
+    {
+        vkDestroyPipelineLayout(device, mPipelineLayout, nullptr);
+        mPipelineLayout = nullptr;
+    }
+
+    mDescriptorAllocator.destroyPools(device);
+
+    if (mDescSetLayout != nullptr)
+    {
+        vkDestroyDescriptorSetLayout(device, mDescSetLayout, nullptr);
+        mDescSetLayout = nullptr;
+    }
+
+    for (AllocatedImage& image : mOutputImages)
+    {
+        if (image.mImage != nullptr)
+        {
+            mVulkanResources->destroyImage(image);
+            image.mImage = nullptr;
+        }
+    }
+}
+
+glm::vec2 TemporalUpscalePass::advanceJitter()
+{
+    //  halton (2, 3) sequence, starts at 1 because 0 gives a zero offset on both axes
+    mJitterIdx = mJitterIdx % JITTER_SEQUENCE_LENGTH + 1;
+    const glm::vec2 pixelJitter{getHaltonValue(mJitterIdx, 2) - 0.5f, getHaltonValue(mJitterIdx, 3) - 0.5f};
+
+    const VkExtent2D renderExtent = mRenderer->getRenderExtent();
+    return 2.0f * pixelJitter / glm::vec2(renderExtent.width, renderExtent.height);
+}
+
+void TemporalUpscalePass::updateRenderParams(const Camera& camera)
+{
+    //  the history is accumulated without jitter, so it is reprojected with the unjittered matrix of the last frame
+    mParams.mReprojection = camera.getPrevViewProjMatrix() * glm::inverse(camera.getViewProjMatrix());
+    mParams.mJitterUv = camera.getJitter() * 0.5f;
+    mParams.mBlendFactor = 0.1f;
+    mParams.mIsHistoryValid = mFrameCount > 0 ? 1 : 0;
+    mFrameCount++;
+}
+
+void TemporalUpscalePass::dispatch() const
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    uint32_t currentFrameIdx = mRenderer->getCurrentFrameIdx();
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &mDescSets[currentFrameIdx], 0, nullptr);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpscaleParams), &mParams);
+
+    //  one thread per output pixel
+    constexpr static uint32_t computeSize = 8;
+    VkExtent3D outputExtent = mOutputImages[currentFrameIdx].mExtent;
+    vkCmdDispatch(cmd, (outputExtent.width + computeSize - 1) / computeSize,
+        (outputExtent.height + computeSize - 1) / computeSize, 1);
+}
+
+const AllocatedImage& TemporalUpscalePass::getCurrentOutputImage() const
+{
+    return mOutputImages[mRenderer->getCurrentFrameIdx()];
+}
+
+const AllocatedImage& TemporalUpscalePass::getPreviousOutputImage() const
+{
+    return mOutputImages[(mRenderer->getCurrentFrameIdx() + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+}
+
+TemporalUpscalePass::~TemporalUpscalePass()
+{
+    cleanup();
+}
+
+void TemporalUpscalePass::initDescriptorSets()
+{
+    DescriptorLayoutBuilder layoutBuilder;
+    VkDescriptorSetLayoutBinding textureBinding{
+        0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+
+    //  scene color, scene depth and history
+    for (uint32_t binding = 0; binding < 3; binding++)
+    {
+        textureBinding.binding = binding;
+        layoutBuilder.addBinding(textureBinding);
+    }
+    //  output
+    layoutBuilder.addBinding(
+        VkDescriptorSetLayoutBinding{3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr});
+    mDescSetLayout = layoutBuilder.build(mVulkanResources->getDevice());
+
+    DescriptorAllocator::PoolSize poolSizes[] = {
+        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = 3},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 1},
+    };
+    mDescriptorAllocator.init(mVulkanResources->getDevice(), MAX_FRAMES_IN_FLIGHT, poolSizes);
+
+    for (VkDescriptorSet& set : mDescSets)
+    {
+        mDescriptorAllocator.allocate(mVulkanResources->getDevice(), &mDescSetLayout, &set);
+    }
+}
+
+BunnyResult TemporalUpscalePass::initPipeline()
+{
+    VkPushConstantRange pushConstRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(UpscaleParams)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mDescSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstRange;
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        vkCreatePipelineLayout(mVulkanResources->getDevice(), &pipelineLayoutInfo, nullptr, &mPipelineLayout))
+
+    return PipelineCompileQueue::enqueue([this]() {
+        Shader computeShader(mUpscaleShaderPath, mVulkanResources->getShaderModuleCache());
+
+        ComputePipelineBuilder pipelineBuilder;
+        pipelineBuilder.setShader(computeShader.getShaderModule());
+        pipelineBuilder.setPipelineLayout(mPipelineLayout);
+        pipelineBuilder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = pipelineBuilder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
+}
+
+void TemporalUpscalePass::createImages()
+{
+    //  the output has the swap chain extent, the final output pass reads it instead of the scene color
+    VkExtent2D swapChainExtent = mRenderer->getSwapChainExtent();
+    for (AllocatedImage& image : mOutputImages)
+    {
+        image = mVulkanResources->createImage({swapChainExtent.width, swapChainExtent.height, 1},
+            VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT);
+        mVulkanResources->immediateTransitionImageLayout(
+            image.mImage, image.mFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    DescriptorWriter writer;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        //  the history of a frame is the output of the frame before it
+        const AllocatedImage& historyImage = mOutputImages[(idx + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+
+        writer.clear();
+        writer.writeImage(0, mRenderer->getColorImageResolved(idx).mImageView, mTextureBank->getSampler(),
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(1, mRenderer->getDepthImageResolved(idx).mImageView, mTextureBank->getSampler(),
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(2, historyImage.mImageView, mTextureBank->getSampler(), VK_IMAGE_LAYOUT_GENERAL,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        writer.writeImage(
+            3, mOutputImages[idx].mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.updateSet(mVulkanResources->getDevice(), mDescSets[idx]);
+    }
+}
+
+} // namespace Bunny::Render
@@ -5,6 +5,7 @@
 #include "Error.h"
 #include "ErrorCheck.h"
 #include "Descriptor.h"
+#include "DdsTexture.h"
 
 #include <stb_image.h>
 #include <fmt/core.h>
@@ -24,6 +25,7 @@ TextureBank::TextureBank(const VulkanRenderResources* vulkanResources, const Vul
 BunnyResult TextureBank::initialize()
 {
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createSampler())
+    queryBindlessTextureCapacity();
     return BUNNY_HAPPY;
 }
 
@@ -57,11 +59,16 @@ BunnyResult TextureBank::addTexture(const char* filePath, VkFormat format, IdTyp
         VkExtent3D{static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1}, format,
         VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture))
 
-    outId = mTextures.size();
-    mTextures.push_back(texture);
+    stbi_image_free(texData);
+
+    if (!BUNNY_SUCCESS(acquireTextureId(texture, outId)))
+    {
+        mVulkanResources->destroyImage(texture);
+        return BUNNY_SAD;
+    }
+    mTexturePaths[outId] = filePath;
     mTexturePathToIds[filePath] = outId;
 
-    stbi_image_free(texData);
     return BUNNY_HAPPY;
 }
 
@@ -81,28 +88,27 @@ BunnyResult TextureBank::addTextureFromMemory(unsigned char* data, int dataLengt
         VkExtent3D{static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1}, format,
         VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture))
 
-    outId = mTextures.size();
-    mTextures.push_back(texture);
-
     stbi_image_free(texData); //  is this still needed when load from memory?
+
+    if (!BUNNY_SUCCESS(acquireTextureId(texture, outId)))
+    {
+        mVulkanResources->destroyImage(texture);
+        return BUNNY_SAD;
+    }
+
     return BUNNY_HAPPY;
 }
 
 BunnyResult TextureBank::addAllocatedTexture(const AllocatedImage& image, IdType& outId)
 {
-    outId = mTextures.size();
-    AllocatedImage& newImage = mTextures.emplace_back(image);
-	newImage.mIsOwning = false; //  mark as non-owning to avoid double destrution
+    AllocatedImage newImage = image;
+    newImage.mIsOwning = false; //  mark as non-owning to avoid double destrution
 
-    return BUNNY_HAPPY;
+    return acquireTextureId(newImage, outId);
 }
 
-BunnyResult TextureBank::addTexture3d(
-    const char* filePath, VkFormat format, uint32_t width, uint32_t height, uint32_t depth, IdType& outId)
+BunnyResult TextureBank::addTexture3d(const char* filePath, IdType& outId)
 {
-    //  the image should be saved as normal 2D image
-    //  but each row is one "slice" of the 3D image spreaded
-
     outId = BUNNY_INVALID_ID;
 
     //  if the texture is already loaded, return directly
@@ -113,64 +119,120 @@ BunnyResult TextureBank::addTexture3d(
         return BUNNY_HAPPY;
     }
 
-    int texWidth;
-    int texHeight;
-    int texChannels;
-    const int desiredChannels = STBI_rgb_alpha;
-    stbi_uc* texData = stbi_load(filePath, &texWidth, &texHeight, &texChannels, desiredChannels);
-    if (texData == nullptr)
+    Base::DdsTexture ddsTexture;
+    if (!Base::readDdsTexture(filePath, ddsTexture))
     {
-        std::string errMsg =
-            fmt::format("Can not load image from {} because of stbi error {}", filePath, stbi_failure_reason());
+        std::string errMsg = fmt::format("Can not load a dds texture from {}", filePath);
         PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
     }
 
-    if (width * height != texWidth || depth != texHeight)
+    if (ddsTexture.mDepth == 1)
     {
-        std::string errMsg =
-            fmt::format("The texture loaded does not have correct dimension. Expected 3D dimensions: width {} height "
-                        "{} (w x h {}) depth {}, Actual dimensions: width {} height {}",
-                width, height, width * height, depth, texWidth, texHeight);
+        std::string errMsg = fmt::format("The texture loaded from {} is not a 3D texture", filePath);
         PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
     }
 
+    VkFormat format = ddsTexture.mFormat == Base::DdsFormat::R8G8Unorm ? VK_FORMAT_R8G8_UNORM : VK_FORMAT_R8_UNORM;
+    std::vector<VkDeviceSize> mipOffsets(ddsTexture.mMipCount);
+    for (uint32_t mip = 0; mip < ddsTexture.mMipCount; mip++)
+    {
+        mipOffsets[mip] = ddsTexture.getMipOffset(mip);
+    }
+
     AllocatedImage texture;
-    VkDeviceSize dataSize = texWidth * texHeight * desiredChannels;
-    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mVulkanResources->createImageWithData(static_cast<void*>(texData), dataSize,
-        VkExtent3D{width, height, depth}, format, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture, true))
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mVulkanResources->createImageWithData(ddsTexture.mData.data(),
+        ddsTexture.mData.size(), VkExtent3D{ddsTexture.mWidth, ddsTexture.mHeight, ddsTexture.mDepth}, format,
+        VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture, true,
+        1, mipOffsets))
 
     outId = mTextures3d.size();
     mTextures3d.push_back(texture);
     mTexturePathToIds[filePath] = outId;
 
-    stbi_image_free(texData);
     return BUNNY_HAPPY;
 }
 
-BunnyResult TextureBank::addDescriptorSetWrite(uint32_t binding, DescriptorWriter& outWriter) const
+BunnyResult TextureBank::releaseTexture(IdType id)
 {
-    if (mTextures.empty())
+    if (id >= mTextures.size() || mTextures[id].mImage == nullptr)
     {
-        return BUNNY_HAPPY;
+        std::string errMsg = fmt::format("Can not release texture {} because it does not exist", id);
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
     }
-    std::vector<VkDescriptorImageInfo> imageInfos;
-    imageInfos.reserve(mTextures.size());
-    std::transform(
-        mTextures.begin(), mTextures.end(), std::back_inserter(imageInfos), [this](const AllocatedImage& tex) {
-            return VkDescriptorImageInfo{.sampler = mImageSampler,
-                .imageView = tex.mImageView,
-                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-        });
 
-    outWriter.writeImages(binding, std::move(imageInfos), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+    //  the image might still be sampled by the frames in flight
+    //  keep it alive until the slot is recycled
+    mReleasedTextures.push_back(ReleasedTexture{.mId = id, .mImage = mTextures[id], .mReleaseFrame = mFrameCount});
+    mTextures[id] = AllocatedImage{};
+
+    if (!mTexturePaths[id].empty())
+    {
+        mTexturePathToIds.erase(mTexturePaths[id]);
+        mTexturePaths[id].clear();
+    }
 
     return BUNNY_HAPPY;
 }
 
+void TextureBank::updateBindlessTextures(VkDescriptorSet descriptorSet, uint32_t binding)
+{
+    mFrameCount++;
+
+    if (!mDirtyTextureIds.empty())
+    {
+        //  sort the changed slots so that consecutive ones can be written in one go
+        std::sort(mDirtyTextureIds.begin(), mDirtyTextureIds.end());
+        mDirtyTextureIds.erase(std::unique(mDirtyTextureIds.begin(), mDirtyTextureIds.end()), mDirtyTextureIds.end());
+
+        DescriptorWriter writer;
+        std::vector<VkDescriptorImageInfo> imageInfos;
+        IdType firstId = 0;
+        for (IdType id : mDirtyTextureIds)
+        {
+            const AllocatedImage& tex = mTextures[id];
+
+            //  released before ever being written, the slot is left untouched
+            if (tex.mImageView == nullptr)
+            {
+                continue;
+            }
+
+            if (!imageInfos.empty() && id != firstId + imageInfos.size())
+            {
+                writer.writeImages(binding, std::move(imageInfos), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, firstId);
+                imageInfos.clear();
+            }
+            if (imageInfos.empty())
+            {
+                firstId = id;
+            }
+            imageInfos.push_back(VkDescriptorImageInfo{.sampler = mImageSampler,
+                .imageView = tex.mImageView,
+                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+        }
+        if (!imageInfos.empty())
+        {
+            writer.writeImages(binding, std::move(imageInfos), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, firstId);
+        }
+
+        writer.updateSet(mVulkanResources->getDevice(), descriptorSet);
+        mDirtyTextureIds.clear();
+    }
+
+    //  recycle the slots once every frame that could have sampled them has finished
+    while (!mReleasedTextures.empty() &&
+           mFrameCount - mReleasedTextures.front().mReleaseFrame > MAX_FRAMES_IN_FLIGHT)
+    {
+        ReleasedTexture& released = mReleasedTextures.front();
+        mVulkanResources->destroyImage(released.mImage);
+        mFreeTextureIds.push_back(released.mId);
+        mReleasedTextures.pop_front();
+    }
+}
+
 bool TextureBank::getTexture(IdType id, AllocatedImage& outTexture) const
 {
-    if (!mTextures.empty() && id >= 0 && id < mTextures.size())
+    if (!mTextures.empty() && id >= 0 && id < mTextures.size() && mTextures[id].mImage != nullptr)
     {
         outTexture = mTextures.at(id);
         return true;
@@ -210,6 +272,12 @@ void TextureBank::cleanup()
         mVulkanResources->destroyImage(texture);
     }
 
+    for (ReleasedTexture& released : mReleasedTextures)
+    {
+        mVulkanResources->destroyImage(released.mImage);
+    }
+    mReleasedTextures.clear();
+
     for (AllocatedImage& texture : mTextures3d)
     {
         mVulkanResources->destroyImage(texture);
@@ -233,11 +301,62 @@ BunnyResult TextureBank::createSampler()
     createInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     createInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
     createInfo.minLod = 0;
-    createInfo.maxLod = 1;
+    createInfo.maxLod = VK_LOD_CLAMP_NONE; //  the cloud noise volumes are sampled down their whole mip chain
     createInfo.pNext = nullptr;
 
     VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateSampler(mVulkanResources->getDevice(), &createInfo, 0, &mImageSampler))
 
     return BUNNY_HAPPY;
 }
+
+void TextureBank::queryBindlessTextureCapacity()
+{
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES};
+    mVulkanResources->getPhysicalDeviceProperties(&indexingProperties);
+
+    uint32_t deviceLimit = (std::min)({indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
+
+    //  leave some room for the other image bindings used in the same pipelines
+    constexpr uint32_t reservedDescriptorCount = 64;
+    if (deviceLimit > reservedDescriptorCount)
+    {
+        deviceLimit -= reservedDescriptorCount;
+    }
+
+    mBindlessTextureCapacity = (std::min)(MAX_BINDLESS_TEXTURE_COUNT, deviceLimit);
+}
+
+BunnyResult TextureBank::acquireTextureId(const AllocatedImage& texture, IdType& outId)
+{
+    outId = BUNNY_INVALID_ID;
+
+    if (!mFreeTextureIds.empty())
+    {
+        outId = mFreeTextureIds.back();
+        mFreeTextureIds.pop_back();
+        mTextures[outId] = texture;
+    }
+    else
+    {
+        if (mTextures.size() >= mBindlessTextureCapacity)
+        {
+            std::string errMsg =
+                fmt::format("Can not add texture because the bindless texture array is full ({} textures)",
+                    mBindlessTextureCapacity);
+            PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+        }
+        outId = mTextures.size();
+        mTextures.push_back(texture);
+        mTexturePaths.emplace_back();
+    }
+
+    //  the descriptor of this slot is written in the next updateBindlessTextures()
+    mDirtyTextureIds.push_back(outId);
+
+    return BUNNY_HAPPY;
+}
 } // namespace Bunny::Render
@@ -4,6 +4,7 @@
 #include "MaterialBank.h"
 #include "TextureBank.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "Shader.h"
 #include "Vertex.h"
 #include "Error.h"
@@ -109,6 +110,12 @@ void TexturePreviewPass::showImguiControls()
             {
                 for (int idx = 0; idx < textures.size(); idx++)
                 {
+                    //  the slot of a released texture is empty until it is reused
+                    if (textures[idx].mImageView == nullptr)
+                    {
+                        continue;
+                    }
+
                     bool isSelected = idx == (mIsPreview3d ? mTex3dIdToPreview : mTex2dIdToPreview);
                     if (ImGui::Selectable(fmt::format("tex{}", idx).c_str(), isSelected))
                     {
@@ -151,6 +158,17 @@ void TexturePreviewPass::updateTextureForPreview()
 {
     //  wait for current rendering to end?
 
+    //  the texture being previewed was released, stop drawing it before its slot is recycled
+    AllocatedImage previewingTex;
+    if (mTex2dIdPreviewing >= 0 && !mTextureBank->getTexture(mTex2dIdPreviewing, previewingTex))
+    {
+        mTex2dIdPreviewing = -1;
+        if (!mIsPreview3d)
+        {
+            mTexturePreviewReady = false;
+        }
+    }
+
     if (mIsActive && shouldUpdatePreviewTexture())
     {
         mTexturePreviewReady = false;
@@ -224,10 +242,6 @@ void TexturePreviewPass::updateTextureForPreview()
 
 BunnyResult TexturePreviewPass::initPipeline()
 {
-    //  load shader
-    Shader vertexShader(mVertexShaderPath, mVulkanResources->getDevice());
-    Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getDevice());
-
     //  build pipeline layout
     VkDescriptorSetLayout layouts[] = {mTextureDescSetLayout};
 
@@ -245,27 +259,35 @@ BunnyResult TexturePreviewPass::initPipeline()
     mDeletionStack.AddFunction(
         [this]() { vkDestroyPipelineLayout(mVulkanResources->getDevice(), mPipelineLayout, nullptr); });
 
-    //  vertex info
-    auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
-    auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
-
-    //  build pipeline
-    GraphicsPipelineBuilder builder;
-    builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
-    builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
-    builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    builder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    builder.setMultisamplingNone();
-    builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
-    builder.disableDepthTest();                                              //  no need to do depth test
-    builder.setPipelineLayout(mPipelineLayout);
-
-    mPipeline = builder.build(mVulkanResources->getDevice());
     mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    return BUNNY_HAPPY;
+    return PipelineCompileQueue::enqueue([this]() {
+        //  load shader
+        Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
+
+        //  vertex info
+        auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
+        auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
+
+        //  build pipeline
+        GraphicsPipelineBuilder builder;
+        builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
+        builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
+        builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        builder.setMultisamplingNone();
+        builder.addColorAttachmentNoBlend(mRenderer->getSwapChainImageFormat()); //  opaque pipeline
+        builder.disableDepthTest();                                              //  no need to do depth test
+        builder.setPipelineLayout(mPipelineLayout);
+
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(mVulkanResources->getDevice());
+
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult TexturePreviewPass::initDescriptors()
@@ -3,6 +3,7 @@
 #include "MaterialBank.h"
 #include "Vertex.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 #include "VulkanRenderResources.h"
 #include "VulkanGraphicsRenderer.h"
 #include "Helper.h"
@@ -29,19 +30,7 @@ void Render::TransparencyAccumulatePass::draw() const
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
 
-    //  transition the render target image layout back to color attachment optimal
-    //  no need to transition the multi sampled image, because they are always attachment optimal
-    VkImageMemoryBarrier accuBarrier = makeImageMemoryBarrier(frame.mAccumulateImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_ASPECT_COLOR_BIT);
-    VkImageMemoryBarrier revealBarrier = makeImageMemoryBarrier(frame.mRevealageImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        VK_IMAGE_ASPECT_COLOR_BIT);
-    {
-        VkImageMemoryBarrier barriers[] = {accuBarrier, revealBarrier};
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-    }
+    //  the render targets are transitioned to color attachment optimal by the frame graph
 
     bool multiSample = mRenderer->isMultiSampleEnabled();
     auto renderHelper = mRenderer->getRenderHelper().setClearDepth(false).setDepthTest(true).setDepthMultiSample(
@@ -56,14 +45,14 @@ void Render::TransparencyAccumulatePass::draw() const
     {
         //  if multi sample,
         renderHelper.addColorAttachment(
-            frame.mAccumulateImageMultiSampled.mImageView, true, accuClear, frame.mAccumulateImage.mImageView);
+            frame.mAccumulateImageMultiSampled->mImageView, true, accuClear, frame.mAccumulateImage->mImageView);
         renderHelper.addColorAttachment(
-            frame.mRevealageImageMultiSampled.mImageView, true, revealClear, frame.mRevealageImage.mImageView);
+            frame.mRevealageImageMultiSampled->mImageView, true, revealClear, frame.mRevealageImage->mImageView);
     }
     else
     {
-        renderHelper.addColorAttachment(frame.mAccumulateImage.mImageView, true, accuClear);
-        renderHelper.addColorAttachment(frame.mRevealageImage.mImageView, true, revealClear);
+        renderHelper.addColorAttachment(frame.mAccumulateImage->mImageView, true, accuClear);
+        renderHelper.addColorAttachment(frame.mRevealageImage->mImageView, true, revealClear);
     }
     renderHelper.beginRender();
 
@@ -75,8 +64,11 @@ void Render::TransparencyAccumulatePass::draw() const
     //  bind all scene, object and material descriptor sets at once
     //  they are laid out properly in FrameData
     //  if the layout changes this needs to be updated
+    const std::array<uint32_t, PbrMaterialBank::WORLD_DYNAMIC_OFFSET_COUNT> worldOffsets{
+        mLightData->mOffset, mCameraData->mOffset, mClusteredLightData->mOffset};
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 4,
-        &mFrameData[mRenderer->getCurrentFrameIdx()].mWorldDescSet, 0, nullptr);
+        &mFrameData[mRenderer->getCurrentFrameIdx()].mWorldDescSet, static_cast<uint32_t>(worldOffsets.size()),
+        worldOffsets.data());
 
     //  only draw the transparent surfaces
     vkCmdDrawIndexedIndirect(cmd, mDrawCommandsBuffer->mBuffer,
@@ -87,17 +79,37 @@ void Render::TransparencyAccumulatePass::draw() const
 }
 
 void Render::TransparencyAccumulatePass::linkWorldData(
-    const AllocatedBuffer& lightData, const AllocatedBuffer& cameraData)
+    const FrameBufferSlice& lightData, const FrameBufferSlice& cameraData)
 {
+    mLightData = &lightData;
+    mCameraData = &cameraData;
+
     DescriptorWriter writer;
-    writer.writeBuffer(0, lightData.mBuffer, sizeof(PbrLightData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    writer.writeBuffer(1, cameraData.mBuffer, sizeof(PbrCameraData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+    writer.writeBuffer(0, lightData.mBuffer, lightData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    writer.writeBuffer(1, cameraData.mBuffer, cameraData.mRange, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     for (const FrameData& frame : mFrameData)
     {
         writer.updateSet(mVulkanResources->getDevice(), frame.mWorldDescSet);
     }
 }
 
+void Render::TransparencyAccumulatePass::linkLightClusterData(const FrameBufferSlice& clusteredLightData,
+    const std::array<AllocatedBuffer, MAX_FRAMES_IN_FLIGHT>& clusterBuffers)
+{
+    mClusteredLightData = &clusteredLightData;
+
+    DescriptorWriter writer;
+    for (uint32_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        writer.clear();
+        writer.writeBuffer(2, clusteredLightData.mBuffer, clusteredLightData.mRange, 0,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC);
+        writer.writeBuffer(
+            3, clusterBuffers[idx].mBuffer, sizeof(LightClusterData), 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        writer.updateSet(mVulkanResources->getDevice(), mFrameData[idx].mWorldDescSet);
+    }
+}
+
 void Render::TransparencyAccumulatePass::linkObjectData(
     const AllocatedBuffer& objectBuffer, const AllocatedBuffer& instObjectBuffer)
 {
@@ -128,13 +140,29 @@ void TransparencyAccumulatePass::setDrawCommandsBuffer(const AllocatedBuffer& bu
     mDrawCommandsBuffer = &buffer;
 }
 
+void TransparencyAccumulatePass::linkRenderTargets(
+    const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& accumImages,
+    const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& revealImages,
+    const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& accumImagesMultiSampled,
+    const std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT>& revealImagesMultiSampled)
+{
+    for (size_t idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+    {
+        FrameData& frame = mFrameData[idx];
+        frame.mAccumulateImage = accumImages[idx];
+        frame.mRevealageImage = revealImages[idx];
+        frame.mAccumulateImageMultiSampled = accumImagesMultiSampled[idx];
+        frame.mRevealageImageMultiSampled = revealImagesMultiSampled[idx];
+    }
+}
+
 std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> Render::TransparencyAccumulatePass::getAccumulateImages() const
 {
     std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> images;
 
     for (int idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
     {
-        images[idx] = &mFrameData[idx].mAccumulateImage;
+        images[idx] = mFrameData[idx].mAccumulateImage;
     }
 
     return images;
@@ -146,7 +174,7 @@ std::array<const AllocatedImage*, MAX_FRAMES_IN_FLIGHT> Render::TransparencyAccu
 
     for (int idx = 0; idx < MAX_FRAMES_IN_FLIGHT; idx++)
     {
-        images[idx] = &mFrameData[idx].mRevealageImage;
+        images[idx] = mFrameData[idx].mRevealageImage;
     }
 
     return images;
@@ -156,49 +184,52 @@ BunnyResult Render::TransparencyAccumulatePass::initPipeline()
 {
     VkDevice device = mVulkanResources->getDevice();
 
-    //  load shader file
-    Shader vertexShader(mVertexShaderPath, device);
-    Shader fragmentShader(mFragmentShaderPath, device);
-
     mPipelineLayout = mMaterialBank->getPbrForwardPipelineLayout();
 
-    //  vertex info
-    auto bindingDescription = getBindingDescription<NormalVertex>(0, VertexInputRate::Vertex);
-    auto attributeDescriptions = NormalVertex::getAttributeDescriptions();
-
-    //  build pipeline
-    GraphicsPipelineBuilder builder;
-    builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
-    builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
-    builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    builder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    if (mRenderer->isMultiSampleEnabled())
-    {
-        builder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
-    }
-    else
-    {
-        builder.setMultisamplingNone();
-    }
+    mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    builder.addColorAttachmentWithBlend(VK_FORMAT_R32G32B32A32_SFLOAT,
-        makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE)); //  accumulate
-    builder.addColorAttachmentWithBlend(VK_FORMAT_R16_SFLOAT, //  maybe R8_UNORM or R8_SNORM is enough?
-        makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR)); //  revealage
+    return PipelineCompileQueue::enqueue([this, device]() {
+        //  load shader
+        Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
+
+        //  vertex info
+        auto bindingDescription = getBindingDescription<NormalVertex>(0, VertexInputRate::Vertex);
+        auto attributeDescriptions = NormalVertex::getAttributeDescriptions();
+
+        //  build pipeline
+        GraphicsPipelineBuilder builder;
+        builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
+        builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
+        builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        if (mRenderer->isMultiSampleEnabled())
+        {
+            builder.setMultiSamplingCount(mRenderer->getRenderMultiSampleCount());
+        }
+        else
+        {
+            builder.setMultisamplingNone();
+        }
 
-    //  depth test is enabled so that we don't render transparent objects behind opaque ones
-    //  but depth write is disabled so that transparent objects don't block each other
-    builder.enableDepthTest(VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
-    builder.setDepthFormat(mRenderer->getDepthImageFormat());
-    builder.setPipelineLayout(mPipelineLayout);
+        builder.addColorAttachmentWithBlend(VK_FORMAT_R32G32B32A32_SFLOAT,
+            makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE)); //  accumulate
+        builder.addColorAttachmentWithBlend(VK_FORMAT_R16_SFLOAT, //  maybe R8_UNORM or R8_SNORM is enough?
+            makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR)); //  revealage
 
-    mPipeline = builder.build(device);
+        //  depth test is enabled so that we don't render transparent objects behind opaque ones
+        //  but depth write is disabled so that transparent objects don't block each other
+        builder.enableDepthTest(VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL);
+        builder.setDepthFormat(mRenderer->getDepthImageFormat());
+        builder.setPipelineLayout(mPipelineLayout);
 
-    mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(device);
 
-    return BUNNY_HAPPY;
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult Render::TransparencyAccumulatePass::initDescriptors()
@@ -206,23 +237,25 @@ BunnyResult Render::TransparencyAccumulatePass::initDescriptors()
     VkDevice device = mVulkanResources->getDevice();
 
     DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 4                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 4                                  },
-        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .mRatio = PbrMaterialBank::TEXTURE_ARRAY_SIZE},
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 2                                  },
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, .mRatio = 1},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          .mRatio = 2},
     };
     mDescriptorAllocator.init(device, 10, poolSizes);
 
-    VkDescriptorSetLayout descLayouts[] = {mMaterialBank->getWorldDescSetLayout(),
-        mMaterialBank->getObjectDescSetLayout(), mMaterialBank->getMaterialDescSetLayout(),
-        mMaterialBank->getEffectDescSetLayout()};
+    VkDescriptorSetLayout descLayouts[] = {
+        mMaterialBank->getWorldDescSetLayout(), mMaterialBank->getObjectDescSetLayout()};
+    VkDescriptorSetLayout effectDescLayout = mMaterialBank->getEffectDescSetLayout();
     for (FrameData& frame : mFrameData)
     {
-        //  allocate all 4 sets of one frame at once
-        mDescriptorAllocator.allocate(device, descLayouts, &frame.mWorldDescSet, 4);
+        mDescriptorAllocator.allocate(device, descLayouts, &frame.mWorldDescSet, 2);
 
-        //  link material data to material descriptor set
-        mMaterialBank->updateMaterialDescriptorSet(frame.mMaterialDescSet, mMeshBank);
+        //  material data and the bindless textures are shared by all passes
+        frame.mMaterialDescSet = mMaterialBank->getMaterialDescSet();
+
+        mDescriptorAllocator.allocate(device, &effectDescLayout, &frame.mEffectDescSet);
     }
 
     mDeletionStack.AddFunction([this]() { mDescriptorAllocator.destroyPools(mVulkanResources->getDevice()); });
@@ -231,35 +264,7 @@ BunnyResult Render::TransparencyAccumulatePass::initDescriptors()
 
 BunnyResult Render::TransparencyAccumulatePass::initDataAndResources()
 {
-    VkExtent3D renderTargetExtent{mRenderer->getSwapChainExtent().width, mRenderer->getSwapChainExtent().height, 1};
-    //  create the render targets
-    for (FrameData& frame : mFrameData)
-    {
-        //  accumulate
-        frame.mAccumulateImageMultiSampled =
-            mVulkanResources->createImage(renderTargetExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1, mRenderer->getRenderMultiSampleCount());
-        frame.mAccumulateImage = mVulkanResources->createImage(renderTargetExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        //  revealage
-        frame.mRevealageImageMultiSampled = mVulkanResources->createImage(renderTargetExtent, VK_FORMAT_R16_SFLOAT,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1, mRenderer->getRenderMultiSampleCount());
-        frame.mRevealageImage = mVulkanResources->createImage(renderTargetExtent, VK_FORMAT_R16_SFLOAT,
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-    }
-
-    mDeletionStack.AddFunction([this]() {
-        for (FrameData& frame : mFrameData)
-        {
-            mVulkanResources->destroyImage(frame.mAccumulateImageMultiSampled);
-            mVulkanResources->destroyImage(frame.mRevealageImageMultiSampled);
-            mVulkanResources->destroyImage(frame.mAccumulateImage);
-            mVulkanResources->destroyImage(frame.mRevealageImage);
-        }
-    });
-
+    //  the render targets are created by the frame graph and linked with linkRenderTargets()
     return BUNNY_HAPPY;
 }
 
@@ -5,6 +5,7 @@
 #include "Error.h"
 #include "ErrorCheck.h"
 #include "GraphicsPipelineBuilder.h"
+#include "PipelineCompileQueue.h"
 
 namespace Bunny::Render
 {
@@ -19,30 +20,17 @@ TransparencyCompositePass::TransparencyCompositePass(const VulkanRenderResources
 
 void TransparencyCompositePass::draw() const
 {
-    VkCommandBuffer cmdBuf = mRenderer->getCurrentCommandBuffer();
-    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-
+    //  the transparent images are not rendered if there are no transparent surfaces
+    //  and may hold whatever the frame graph aliased into their memory, skip
+    if (mMeshBank->getTransparentSurfaceCount() == 0)
     {
-        VkImageMemoryBarrier accumRenderBarrier = makeImageMemoryBarrier(frame.mAccumulateImage->mImage,
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier revealRenderBarrier = makeImageMemoryBarrier(frame.mRevealageImage->mImage,
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier sceneRenderBarrier = makeImageMemoryBarrier(frame.mSceneRenderTarget->mImage,
-            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-
-        //  barrier for transparent images
-        VkImageMemoryBarrier barriers[] = {accumRenderBarrier, revealRenderBarrier};
-        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-
-        //  barrier for render target
-        vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &sceneRenderBarrier);
+        return;
     }
 
+    VkCommandBuffer cmdBuf = mRenderer->getCurrentCommandBuffer();
+    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
+
+    //  the transparent images and the render target are transitioned by the frame graph
     auto renderHelper = mRenderer->getRenderHelper()
                             .addColorAttachment(frame.mSceneRenderTarget->mImageView)
                             .setDepthTest(false)
@@ -97,34 +85,37 @@ BunnyResult TransparencyCompositePass::initPipeline()
 
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initPipelineLayout())
 
-    //  load shader file
-    Shader vertexShader(mVertexShaderPath, device);
-    Shader fragmentShader(mFragmentShaderPath, device);
-
-    //  vertex info
-    auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
-    auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
-
-    //  build pipeline
-    GraphicsPipelineBuilder builder;
-    builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
-    builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
-    builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
-    builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-    builder.setPolygonMode(VK_POLYGON_MODE_FILL);
-    builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-    builder.setMultisamplingNone();
-    builder.addColorAttachmentWithBlend(mRenderer->getSwapChainImageFormat(),
-        makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA));
-    builder.disableDepthTest();
-    builder.setDepthFormat(mRenderer->getDepthImageFormat());
-    builder.setPipelineLayout(mPipelineLayout);
-
-    mPipeline = builder.build(device);
-
     mDeletionStack.AddFunction([this]() { vkDestroyPipeline(mVulkanResources->getDevice(), mPipeline, nullptr); });
 
-    return BUNNY_HAPPY;
+    return PipelineCompileQueue::enqueue([this, device]() {
+        //  load shader
+        Shader vertexShader(mVertexShaderPath, mVulkanResources->getShaderModuleCache());
+        Shader fragmentShader(mFragmentShaderPath, mVulkanResources->getShaderModuleCache());
+
+        //  vertex info
+        auto bindingDescription = getBindingDescription<ScreenQuadVertex>(0, VertexInputRate::Vertex);
+        auto attributeDescriptions = ScreenQuadVertex::getAttributeDescriptions();
+
+        //  build pipeline
+        GraphicsPipelineBuilder builder;
+        builder.addShaderStage(vertexShader.getShaderModule(), VK_SHADER_STAGE_VERTEX_BIT);
+        builder.addShaderStage(fragmentShader.getShaderModule(), VK_SHADER_STAGE_FRAGMENT_BIT);
+        builder.setVertexInput(attributeDescriptions.data(), attributeDescriptions.size(), &bindingDescription, 1);
+        builder.setInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        builder.setPolygonMode(VK_POLYGON_MODE_FILL);
+        builder.setCulling(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        builder.setMultisamplingNone();
+        builder.addColorAttachmentWithBlend(mRenderer->getSwapChainImageFormat(),
+            makePipelineColorBlendAttachmentState(VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA));
+        builder.disableDepthTest();
+        builder.setDepthFormat(mRenderer->getDepthImageFormat());
+        builder.setPipelineLayout(mPipelineLayout);
+
+        builder.setPipelineCache(mVulkanResources->getPipelineCache());
+        mPipeline = builder.build(device);
+
+        return BUNNY_HAPPY;
+    });
 }
 
 BunnyResult TransparencyCompositePass::initDescriptors()
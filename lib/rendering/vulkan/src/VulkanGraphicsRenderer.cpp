@@ -5,6 +5,7 @@
 #include "Helper.h"
 #include "Error.h"
 #include "ErrorCheck.h"
+#include "CpuProfiler.h"
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -12,6 +13,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <unordered_map>
 
 namespace Bunny::Render
@@ -37,18 +39,28 @@ VkSampleCountFlagBits getVkSampleCountFromInt(int sampleCount)
 }
 
 VulkanGraphicsRenderer::VulkanGraphicsRenderer(VulkanRenderResources* renderResources)
-    : mRenderResources(renderResources)
+    : mRenderResources(renderResources),
+      mGpuProfiler(renderResources),
+      mFrameArena(renderResources)
 {
     assert(mRenderResources != nullptr);
 }
 
-BunnyResult VulkanGraphicsRenderer::initialize(int multiSampleCount)
+BunnyResult VulkanGraphicsRenderer::initialize(int multiSampleCount, VkExtent2D headlessExtent, float renderScale)
 {
+    mIsHeadless = mRenderResources->isHeadless();
+    mHeadlessExtent = headlessExtent;
+    mRenderScale = std::clamp(renderScale, 0.25f, 1.0f);
     mRenderMultiSampleCount = getVkSampleCountFromInt(multiSampleCount);
     initMultiSampleParams();
 
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initSwapChain());
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initFrameResources());
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mGpuProfiler.initialize());
+    mDeletionStack.AddFunction([this]() { mGpuProfiler.cleanup(); });
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mFrameArena.initialize());
+    mDeletionStack.AddFunction([this]() { mFrameArena.cleanup(); });
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorCache());
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initColorResources());
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDepthResource());
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initImgui());
@@ -64,83 +76,87 @@ void VulkanGraphicsRenderer::beginRenderFrame()
     //  wait for previous frame to finish rendering
     vkWaitForFences(device, 1, &currentFrame.mFrameInflightFence, VK_TRUE, UINT64_MAX);
 
-    //  wait for image in the swap chain to be available before acquiring it
-    VkResult result = vkAcquireNextImageKHR(
-        device, mSwapChain, UINT64_MAX, currentFrame.mSwapchainImageSemaphore, VK_NULL_HANDLE, &mSwapchainImageIndex);
+    //  the gpu is done with the frame data written the last time this frame resource was used
+    mFrameArena.beginFrame(mCurrentFrameId);
+    currentFrame.mDescriptorArena.reset(device);
+    BUNNY_PROFILE_COUNTER("Descriptor writes", DescriptorWriter::takeWriteCount());
 
-    //  recreate swap chain when necessary
-    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    if (mIsHeadless)
     {
-        recreateSwapChain();
-        return;
+        //  every frame in flight has its own offscreen image, nothing to acquire
+        mSwapchainImageIndex = mCurrentFrameId;
     }
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    else
     {
-        PRINT_AND_RETURN("failed to acquire swap chain image!")
+        //  wait for image in the swap chain to be available before acquiring it
+        VkResult result = vkAcquireNextImageKHR(device, mSwapChain, UINT64_MAX,
+            currentFrame.mSwapchainImageSemaphore, VK_NULL_HANDLE, &mSwapchainImageIndex);
+
+        //  recreate swap chain when necessary
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            recreateSwapChain();
+            return;
+        }
+        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        {
+            PRINT_AND_RETURN("failed to acquire swap chain image!")
+        }
     }
 
     //  reset fence only after image is successfully acquired
     vkResetFences(device, 1, &currentFrame.mFrameInflightFence);
 
-    VkCommandBuffer cmdBuf = currentFrame.mCommandBuffer;
-    //  reset command buffer
-    vkResetCommandBuffer(cmdBuf, 0);
-
-    //  begin command buffer
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = 0;                  // Optional
-    beginInfo.pInheritanceInfo = nullptr; // Optional
+    //  reset all command buffers used in the last frame with this frame resource
+    vkResetCommandPool(device, currentFrame.mCommandPool, 0);
+    currentFrame.mUsedCommandBufferCount = 0;
+    if (currentFrame.mComputeCommandPool != VK_NULL_HANDLE)
+    {
+        vkResetCommandPool(device, currentFrame.mComputeCommandPool, 0);
+        currentFrame.mUsedComputeCommandBufferCount = 0;
+    }
+    for (RecordingSlot& slot : currentFrame.mRecordingSlots)
+    {
+        vkResetCommandPool(device, slot.mCommandPool, 0);
+        slot.mUsedCommandBufferCount = 0;
+    }
+    currentFrame.mPendingCommandBuffers.clear();
 
-    VK_HARD_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo))
+    //  the fence is signaled, so the queries of the last frame with this frame resource have their results
+    mGpuProfiler.beginFrame(mCurrentFrameId);
 
-    //  update dynamic states (viewport, scissors)
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(mSwapChainExtent.width);
-    viewport.height = static_cast<float>(mSwapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+    //  the first graphics submit of the frame waits for the swap chain image
+    currentFrame.mWaitSemaphores.clear();
+    currentFrame.mWaitStages.clear();
+    if (!mIsHeadless)
+    {
+        currentFrame.mWaitSemaphores.push_back(currentFrame.mSwapchainImageSemaphore);
+        currentFrame.mWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
 
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = mSwapChainExtent;
-    vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+    beginGraphicsCommandBuffer(currentFrame);
 
-    mRenderResources->transitionImageLayout(cmdBuf, mSwapChainImages[mSwapchainImageIndex], mSwapChainImageFormat,
-        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    mRenderResources->transitionImageLayout(currentFrame.mCommandBuffer, mSwapChainImages[mSwapchainImageIndex],
+        mSwapChainImageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 }
 
 void VulkanGraphicsRenderer::finishRenderFrame()
 {
-    VkDevice device = mRenderResources->getDevice();
     FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
-    VkCommandBuffer cmdBuf = currentFrame.mCommandBuffer;
 
-    mRenderResources->transitionImageLayout(cmdBuf, mSwapChainImages[mSwapchainImageIndex], mSwapChainImageFormat,
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    if (mIsHeadless)
+    {
+        finishHeadlessFrame(currentFrame);
+        mCurrentFrameId = (mCurrentFrameId + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
 
-    //  end command buffer
-    VK_HARD_CHECK(vkEndCommandBuffer(cmdBuf))
+    mRenderResources->transitionImageLayout(currentFrame.mCommandBuffer, mSwapChainImages[mSwapchainImageIndex],
+        mSwapChainImageFormat, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-    //  submit the command buffer
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    VkSemaphore waitSemaphores[] = {currentFrame.mSwapchainImageSemaphore};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmdBuf;
+    //  submit the last part of the frame
     VkSemaphore signalSemaphores[] = {currentFrame.mRenderFinishSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-
-    VK_HARD_CHECK(
-        vkQueueSubmit(mRenderResources->getGraphicQueue().mQueue, 1, &submitInfo, currentFrame.mFrameInflightFence))
+    endAndSubmitGraphicsCommands(currentFrame, signalSemaphores, currentFrame.mFrameInflightFence);
 
     //  present
     VkPresentInfoKHR presentInfo{};
@@ -169,6 +185,115 @@ void VulkanGraphicsRenderer::finishRenderFrame()
     mCurrentFrameId = (mCurrentFrameId + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+void VulkanGraphicsRenderer::beginAsyncCompute()
+{
+    FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
+    assert(mIsAsyncComputeEnabled && !currentFrame.mIsRecordingCompute);
+
+    currentFrame.mComputeCommandBuffer = beginNextCommandBuffer(currentFrame.mComputeCommandPool,
+        currentFrame.mComputeCommandBuffers, currentFrame.mUsedComputeCommandBufferCount);
+    currentFrame.mIsRecordingCompute = true;
+}
+
+void VulkanGraphicsRenderer::submitAsyncCompute(
+    std::span<const VkSemaphore> waitSemaphores, std::span<const VkSemaphore> signalSemaphores)
+{
+    FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
+    assert(currentFrame.mIsRecordingCompute);
+
+    VK_HARD_CHECK(vkEndCommandBuffer(currentFrame.mComputeCommandBuffer))
+
+    std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &currentFrame.mComputeCommandBuffer;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+    VK_HARD_CHECK(vkQueueSubmit(mRenderResources->getComputeQueue().mQueue, 1, &submitInfo, VK_NULL_HANDLE))
+
+    currentFrame.mIsRecordingCompute = false;
+}
+
+void VulkanGraphicsRenderer::submitGraphicsCommands(std::span<const VkSemaphore> signalSemaphores)
+{
+    FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
+    endAndSubmitGraphicsCommands(currentFrame, signalSemaphores, VK_NULL_HANDLE);
+    beginGraphicsCommandBuffer(currentFrame);
+}
+
+BunnyResult VulkanGraphicsRenderer::initRecordingSlots(uint32_t slotCount)
+{
+    assert(mRecordingSlotCount == 0);
+    VkDevice device = mRenderResources->getDevice();
+    for (FrameRenderObject& frame : mFrameResources)
+    {
+        frame.mRecordingSlots.resize(slotCount);
+        for (RecordingSlot& slot : frame.mRecordingSlots)
+        {
+            //  the pools are reset as a whole every frame, like the one of the frame itself
+            VkCommandPoolCreateInfo poolInfo = makeCommandPoolCreateInfo(
+                mRenderResources->getGraphicQueue().mQueueFamilyIndex.value(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+            VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateCommandPool(device, &poolInfo, nullptr, &slot.mCommandPool))
+        }
+    }
+    mRecordingSlotCount = slotCount;
+
+    mDeletionStack.AddFunction([this, device]() {
+        for (FrameRenderObject& frame : mFrameResources)
+        {
+            for (RecordingSlot& slot : frame.mRecordingSlots)
+            {
+                vkDestroyCommandPool(device, slot.mCommandPool, nullptr);
+            }
+            frame.mRecordingSlots.clear();
+        }
+        mRecordingSlotCount = 0;
+    });
+
+    return BUNNY_HAPPY;
+}
+
+VkCommandBuffer VulkanGraphicsRenderer::beginSlotCommandBuffer(uint32_t slotIdx)
+{
+    assert(slotIdx < mRecordingSlotCount && msSlotCommandBuffer == VK_NULL_HANDLE);
+    RecordingSlot& slot = mFrameResources[mCurrentFrameId].mRecordingSlots[slotIdx];
+
+    VkCommandBuffer cmdBuf =
+        beginNextCommandBuffer(slot.mCommandPool, slot.mCommandBuffers, slot.mUsedCommandBufferCount);
+    setDefaultDynamicStates(cmdBuf);
+    msSlotCommandBuffer = cmdBuf;
+    return cmdBuf;
+}
+
+void VulkanGraphicsRenderer::endSlotCommandBuffer()
+{
+    assert(msSlotCommandBuffer != VK_NULL_HANDLE);
+    VK_HARD_CHECK(vkEndCommandBuffer(msSlotCommandBuffer))
+    msSlotCommandBuffer = VK_NULL_HANDLE;
+}
+
+void VulkanGraphicsRenderer::insertGraphicsCommandBuffers(std::span<const VkCommandBuffer> commandBuffers)
+{
+    FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
+    VK_HARD_CHECK(vkEndCommandBuffer(currentFrame.mCommandBuffer))
+
+    //  command buffers of one submit execute in order, so barriers still order the work across them
+    currentFrame.mPendingCommandBuffers.push_back(currentFrame.mCommandBuffer);
+    currentFrame.mPendingCommandBuffers.insert(
+        currentFrame.mPendingCommandBuffers.end(), commandBuffers.begin(), commandBuffers.end());
+    beginGraphicsCommandBuffer(currentFrame);
+}
+
+void VulkanGraphicsRenderer::addGraphicsWaitSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stages)
+{
+    FrameRenderObject& currentFrame = mFrameResources[mCurrentFrameId];
+    currentFrame.mWaitSemaphores.push_back(semaphore);
+    currentFrame.mWaitStages.push_back(stages);
+}
+
 void VulkanGraphicsRenderer::waitForRenderFinish()
 {
     //  wait for rendering operations to finish before cleaning up
@@ -178,6 +303,21 @@ void VulkanGraphicsRenderer::waitForRenderFinish()
     }
 }
 
+VkDescriptorSet VulkanGraphicsRenderer::getCachedDescriptorSet(
+    VkDescriptorSetLayout layout, DescriptorWriter& writer) const
+{
+    VkDevice device = mRenderResources->getDevice();
+    //  the set is written under the lock too, another thread must not find it in the cache before it is written
+    std::lock_guard lock(mDescriptorCacheMutex);
+    VkDescriptorSet descSet = mDescriptorCache.getSet(device, layout, writer);
+    if (descSet == VK_NULL_HANDLE)
+    {
+        descSet = mFrameResources[mCurrentFrameId].mDescriptorArena.allocate(device, layout);
+        writer.updateSet(device, descSet);
+    }
+    return descSet;
+}
+
 void VulkanGraphicsRenderer::cleanup()
 {
     waitForRenderFinish();
@@ -204,6 +344,13 @@ VkImageMemoryBarrier VulkanGraphicsRenderer::getResolvedColorBarrier() const
 
 BunnyResult VulkanGraphicsRenderer::initSwapChain()
 {
+    if (mIsHeadless)
+    {
+        BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createOffscreenImages())
+        mDeletionStack.AddFunction([this]() { destroySwapChain(); });
+        return BUNNY_HAPPY;
+    }
+
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createSwapChain());
     mDeletionStack.AddFunction([this]() { destroySwapChain(); });
     return BUNNY_HAPPY;
@@ -221,6 +368,11 @@ BunnyResult VulkanGraphicsRenderer::initFrameResources()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //  initialize as signaled to not block the rendering of first frame
 
+    //  async compute only makes sense on a queue family of its own, otherwise everything stays on the graphics queue
+    const auto& computeFamily = mRenderResources->getComputeQueue().mQueueFamilyIndex;
+    mIsAsyncComputeEnabled =
+        computeFamily.has_value() && computeFamily != mRenderResources->getGraphicQueue().mQueueFamilyIndex;
+
     //  create 1 command pool and 1 command buffer for each frame in flight
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
@@ -231,10 +383,20 @@ BunnyResult VulkanGraphicsRenderer::initFrameResources()
         VK_CHECK_OR_RETURN_BUNNY_SAD(
             vkCreateCommandPool(mRenderResources->getDevice(), &poolInfo, nullptr, &mFrameResources[i].mCommandPool))
 
-        //  create command buffer
+        //  create command buffer, more are allocated when a frame is split into several submits
         VkCommandBufferAllocateInfo allocInfo = makeCommandBufferAllocateInfo(mFrameResources[i].mCommandPool, 1);
         VK_CHECK_OR_RETURN_BUNNY_SAD(
             vkAllocateCommandBuffers(mRenderResources->getDevice(), &allocInfo, &mFrameResources[i].mCommandBuffer))
+        mFrameResources[i].mCommandBuffers.push_back(mFrameResources[i].mCommandBuffer);
+
+        //  command pool for the async compute queue
+        if (mIsAsyncComputeEnabled)
+        {
+            VkCommandPoolCreateInfo computePoolInfo =
+                makeCommandPoolCreateInfo(mRenderResources->getComputeQueue().mQueueFamilyIndex.value(), 0);
+            VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateCommandPool(
+                mRenderResources->getDevice(), &computePoolInfo, nullptr, &mFrameResources[i].mComputeCommandPool))
+        }
 
         //  create sync objects
         VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreateSemaphore(
@@ -249,6 +411,10 @@ BunnyResult VulkanGraphicsRenderer::initFrameResources()
             vkDestroySemaphore(mRenderResources->getDevice(), mFrameResources[i].mSwapchainImageSemaphore, nullptr);
             vkDestroySemaphore(mRenderResources->getDevice(), mFrameResources[i].mRenderFinishSemaphore, nullptr);
             vkDestroyCommandPool(mRenderResources->getDevice(), mFrameResources[i].mCommandPool, nullptr);
+            if (mFrameResources[i].mComputeCommandPool != VK_NULL_HANDLE)
+            {
+                vkDestroyCommandPool(mRenderResources->getDevice(), mFrameResources[i].mComputeCommandPool, nullptr);
+            }
         });
     }
 
@@ -271,6 +437,12 @@ BunnyResult VulkanGraphicsRenderer::initDepthResource()
 
 BunnyResult VulkanGraphicsRenderer::initImgui()
 {
+    //  no window to take input from and nobody to look at it
+    if (mIsHeadless)
+    {
+        return BUNNY_HAPPY;
+    }
+
     //  create descriptor pool just for imgui
     VkDescriptorPool imguiDescPool;
     VkDescriptorPoolSize poolSizes[] = {
@@ -320,6 +492,120 @@ BunnyResult VulkanGraphicsRenderer::initImgui()
     return BUNNY_HAPPY;
 }
 
+BunnyResult VulkanGraphicsRenderer::initDescriptorCache()
+{
+    VkDevice device = mRenderResources->getDevice();
+
+    //  the types of the sets the passes rewrite every frame, the cached ones are written once per frame in flight
+    DescriptorAllocator::PoolSize poolSizes[] = {
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,             .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,     .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,             .mRatio = 2},
+        {.mType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,     .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,              .mRatio = 4},
+        {.mType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .mRatio = 1}
+    };
+    mDescriptorCache.init(device, 32, poolSizes);
+    for (FrameRenderObject& frame : mFrameResources)
+    {
+        frame.mDescriptorArena.init(device, 16, poolSizes);
+    }
+
+    mDeletionStack.AddFunction([this, device]() {
+        mDescriptorCache.destroy(device);
+        for (FrameRenderObject& frame : mFrameResources)
+        {
+            frame.mDescriptorArena.destroy(device);
+        }
+    });
+
+    return BUNNY_HAPPY;
+}
+
+VkCommandBuffer VulkanGraphicsRenderer::beginNextCommandBuffer(
+    VkCommandPool pool, std::vector<VkCommandBuffer>& commandBuffers, uint32_t& usedCount)
+{
+    //  command buffers are kept after the pool is reset, only allocate when a frame needs more than before
+    if (usedCount == commandBuffers.size())
+    {
+        VkCommandBuffer newCommandBuffer;
+        VkCommandBufferAllocateInfo allocInfo = makeCommandBufferAllocateInfo(pool, 1);
+        VK_HARD_CHECK(vkAllocateCommandBuffers(mRenderResources->getDevice(), &allocInfo, &newCommandBuffer))
+        commandBuffers.push_back(newCommandBuffer);
+    }
+    VkCommandBuffer cmdBuf = commandBuffers[usedCount++];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+
+    VK_HARD_CHECK(vkBeginCommandBuffer(cmdBuf, &beginInfo))
+
+    return cmdBuf;
+}
+
+void VulkanGraphicsRenderer::beginGraphicsCommandBuffer(FrameRenderObject& frame)
+{
+    VkCommandBuffer cmdBuf =
+        beginNextCommandBuffer(frame.mCommandPool, frame.mCommandBuffers, frame.mUsedCommandBufferCount);
+    frame.mCommandBuffer = cmdBuf;
+    setDefaultDynamicStates(cmdBuf);
+}
+
+void VulkanGraphicsRenderer::setDefaultDynamicStates(VkCommandBuffer cmdBuf)
+{
+    //  update dynamic states (viewport, scissors), they do not carry over to the next command buffer
+    setViewportAndScissor(cmdBuf, mRenderExtent);
+}
+
+void VulkanGraphicsRenderer::setViewportAndScissor(VkCommandBuffer cmdBuf, VkExtent2D extent)
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmdBuf, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+}
+
+void VulkanGraphicsRenderer::updateRenderExtent()
+{
+    mRenderExtent.width = std::max(static_cast<uint32_t>(mSwapChainExtent.width * mRenderScale), 1u);
+    mRenderExtent.height = std::max(static_cast<uint32_t>(mSwapChainExtent.height * mRenderScale), 1u);
+}
+
+void VulkanGraphicsRenderer::endAndSubmitGraphicsCommands(
+    FrameRenderObject& frame, std::span<const VkSemaphore> signalSemaphores, VkFence fence)
+{
+    VK_HARD_CHECK(vkEndCommandBuffer(frame.mCommandBuffer))
+    frame.mPendingCommandBuffers.push_back(frame.mCommandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(frame.mWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = frame.mWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = frame.mWaitStages.data();
+    submitInfo.commandBufferCount = static_cast<uint32_t>(frame.mPendingCommandBuffers.size());
+    submitInfo.pCommandBuffers = frame.mPendingCommandBuffers.data();
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    VK_HARD_CHECK(vkQueueSubmit(mRenderResources->getGraphicQueue().mQueue, 1, &submitInfo, fence))
+
+    //  each wait is consumed by one submit
+    frame.mWaitSemaphores.clear();
+    frame.mWaitStages.clear();
+    frame.mPendingCommandBuffers.clear();
+}
+
 BunnyResult VulkanGraphicsRenderer::createSwapChain()
 {
     SwapChainSupportDetails swapChainSupport =
@@ -340,6 +626,7 @@ BunnyResult VulkanGraphicsRenderer::createSwapChain()
             .value();
 
     mSwapChainExtent = vkbSwapchain.extent;
+    updateRenderExtent();
     mSwapChain = vkbSwapchain.swapchain;
     mSwapChainImages = vkbSwapchain.get_images().value();
     mSwapChainImageViews = vkbSwapchain.get_image_views().value();
@@ -348,6 +635,76 @@ BunnyResult VulkanGraphicsRenderer::createSwapChain()
     return BUNNY_HAPPY;
 }
 
+BunnyResult VulkanGraphicsRenderer::createOffscreenImages()
+{
+    //  same format the swap chain prefers, so the passes build the same pipelines in both modes
+    mSwapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    mSwapChainExtent = mHeadlessExtent;
+    updateRenderExtent();
+
+    for (FrameRenderObject& frame : mFrameResources)
+    {
+        AllocatedImage image = mRenderResources->createImage({mSwapChainExtent.width, mSwapChainExtent.height, 1},
+            mSwapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT);
+        if (image.mImage == nullptr)
+        {
+            PRINT_AND_RETURN_VALUE("Fail to create offscreen image for headless rendering.", BUNNY_SAD)
+        }
+        mOffscreenImages.push_back(image);
+        mSwapChainImages.push_back(image.mImage);
+        mSwapChainImageViews.push_back(image.mImageView);
+
+        VkDeviceSize readbackSize = static_cast<VkDeviceSize>(mSwapChainExtent.width) * mSwapChainExtent.height * 4;
+        frame.mReadbackBuffer = mRenderResources->createBuffer(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, VMA_MEMORY_USAGE_AUTO);
+    }
+
+    return BUNNY_HAPPY;
+}
+
+void VulkanGraphicsRenderer::finishHeadlessFrame(FrameRenderObject& frame)
+{
+    VkImage image = mSwapChainImages[mSwapchainImageIndex];
+    mRenderResources->transitionImageLayout(frame.mCommandBuffer, image, mSwapChainImageFormat,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+    if (mIsFrameReadbackEnabled)
+    {
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {mSwapChainExtent.width, mSwapChainExtent.height, 1};
+        vkCmdCopyImageToBuffer(frame.mCommandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            frame.mReadbackBuffer.mBuffer, 1, &region);
+        mRenderResources->transitionBufferAccess(frame.mCommandBuffer, frame.mReadbackBuffer.mBuffer,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT);
+    }
+
+    //  nothing waits for the frame except the fence
+    endAndSubmitGraphicsCommands(frame, {}, frame.mFrameInflightFence);
+}
+
+BunnyResult VulkanGraphicsRenderer::readbackLastFrame(std::vector<std::byte>& outPixels)
+{
+    if (!mIsHeadless || !mIsFrameReadbackEnabled)
+    {
+        PRINT_AND_RETURN_VALUE("Frame readback needs headless rendering with readback enabled.", BUNNY_SAD)
+    }
+
+    uint32_t lastFrameId = (mCurrentFrameId + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+    FrameRenderObject& lastFrame = mFrameResources[lastFrameId];
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        vkWaitForFences(mRenderResources->getDevice(), 1, &lastFrame.mFrameInflightFence, VK_TRUE, UINT64_MAX))
+
+    mRenderResources->invalidateMappedBuffer(lastFrame.mReadbackBuffer);
+    outPixels.resize(lastFrame.mReadbackBuffer.mSize);
+    memcpy(outPixels.data(), lastFrame.mReadbackBuffer.mAllocationInfo.pMappedData, outPixels.size());
+
+    return BUNNY_HAPPY;
+}
+
 BunnyResult VulkanGraphicsRenderer::recreateSwapChain()
 {
     int width = 0, height = 0;
@@ -355,6 +712,9 @@ BunnyResult VulkanGraphicsRenderer::recreateSwapChain()
 
     vkDeviceWaitIdle(mRenderResources->getDevice());
 
+    //  the cached sets point to the color and depth images that are about to be destroyed
+    mDescriptorCache.clear(mRenderResources->getDevice());
+
     destroyDepthResource();
     destroyColorResources();
     destroySwapChain();
@@ -368,6 +728,22 @@ BunnyResult VulkanGraphicsRenderer::recreateSwapChain()
 
 void VulkanGraphicsRenderer::destroySwapChain()
 {
+    if (mIsHeadless)
+    {
+        for (AllocatedImage& image : mOffscreenImages)
+        {
+            mRenderResources->destroyImage(image);
+        }
+        for (FrameRenderObject& frame : mFrameResources)
+        {
+            mRenderResources->destroyBuffer(frame.mReadbackBuffer);
+        }
+        mOffscreenImages.clear();
+        mSwapChainImages.clear();
+        mSwapChainImageViews.clear();
+        return;
+    }
+
     for (auto imageView : mSwapChainImageViews)
     {
         vkDestroyImageView(mRenderResources->getDevice(), imageView, nullptr);
@@ -380,11 +756,11 @@ BunnyResult VulkanGraphicsRenderer::createColorResources()
     for (FrameRenderObject& frame : mFrameResources)
     {
         frame.mMultiSampledColorImage =
-            mRenderResources->createImage({mSwapChainExtent.width, mSwapChainExtent.height, 1}, mSwapChainImageFormat,
+            mRenderResources->createImage({mRenderExtent.width, mRenderExtent.height, 1}, mSwapChainImageFormat,
                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1, mRenderMultiSampleCount);
 
-        frame.mColorImageResolved = mRenderResources->createImage({mSwapChainExtent.width, mSwapChainExtent.height, 1},
+        frame.mColorImageResolved = mRenderResources->createImage({mRenderExtent.width, mRenderExtent.height, 1},
             mSwapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_IMAGE_ASPECT_COLOR_BIT, false, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
     }
@@ -413,12 +789,12 @@ BunnyResult VulkanGraphicsRenderer::createDepthResource()
 
     for (FrameRenderObject& frame : mFrameResources)
     {
-        frame.mDepthImage = mRenderResources->createImage({mSwapChainExtent.width, mSwapChainExtent.height, 1},
+        frame.mDepthImage = mRenderResources->createImage({mRenderExtent.width, mRenderExtent.height, 1},
             depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, false,
             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, mRenderMultiSampleCount);
 
         //  add usage sampled for depth image for creating hierarchical-z map for occlusion culling
-        frame.mDepthImageResolved = mRenderResources->createImage({mSwapChainExtent.width, mSwapChainExtent.height, 1},
+        frame.mDepthImageResolved = mRenderResources->createImage({mRenderExtent.width, mRenderExtent.height, 1},
             depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_IMAGE_ASPECT_DEPTH_BIT, false, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
     }
@@ -437,6 +813,11 @@ void VulkanGraphicsRenderer::destroyDepthResource()
 
 void VulkanGraphicsRenderer::beginImguiFrame()
 {
+    if (mIsHeadless)
+    {
+        return;
+    }
+
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
 
@@ -445,8 +826,28 @@ void VulkanGraphicsRenderer::beginImguiFrame()
 
 void VulkanGraphicsRenderer::finishImguiFrame()
 {
+    if (mIsHeadless)
+    {
+        return;
+    }
+
     VkCommandBuffer cmdBuf = getCurrentCommandBuffer();
+    mGpuProfiler.beginZone(cmdBuf, "imgui", false);
     finishImguiFrame(cmdBuf, mSwapChainImageViews[mSwapchainImageIndex]);
+    mGpuProfiler.endZone(cmdBuf);
+}
+
+void VulkanGraphicsRenderer::beginGpuZone(std::string_view name)
+{
+    //  slot command buffers are always on the graphics queue
+    bool isOnAsyncCompute =
+        msSlotCommandBuffer == VK_NULL_HANDLE && mFrameResources[mCurrentFrameId].mIsRecordingCompute;
+    mGpuProfiler.beginZone(getCurrentCommandBuffer(), name, isOnAsyncCompute);
+}
+
+void VulkanGraphicsRenderer::endGpuZone()
+{
+    mGpuProfiler.endZone(getCurrentCommandBuffer());
 }
 
 void VulkanGraphicsRenderer::finishImguiFrame(VkCommandBuffer commandBuffer, VkImageView targetImageView)
@@ -579,7 +980,8 @@ VkFormat Bunny::Render::VulkanGraphicsRenderer::findDepthFormat() const
 
 VulkanGraphicsRenderer::RenderHelper::RenderHelper(
     const VulkanGraphicsRenderer* renderer, Base::BunnyGuard<VulkanGraphicsRenderer> guard)
-    : mRenderer(renderer)
+    : mRenderArea(renderer->mRenderExtent),
+      mRenderer(renderer)
 {
 }
 
@@ -610,10 +1012,12 @@ VulkanGraphicsRenderer::RenderHelper& VulkanGraphicsRenderer::RenderHelper::begi
                 VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, mClearDepth ? &mDepthClearValue : nullptr);
     }
 
-    VkRenderingInfo renderInfo = makeRenderingInfo(mRenderer->mSwapChainExtent, mColorAttachments.size(),
-        mColorAttachments.data(), mDepthTest ? &depthAttachment : nullptr);
+    VkRenderingInfo renderInfo = makeRenderingInfo(
+        mRenderArea, mColorAttachments.size(), mColorAttachments.data(), mDepthTest ? &depthAttachment : nullptr);
 
-    vkCmdBeginRendering(mRenderer->getCurrentCommandBuffer(), &renderInfo);
+    VkCommandBuffer cmdBuf = mRenderer->getCurrentCommandBuffer();
+    vkCmdBeginRendering(cmdBuf, &renderInfo);
+    setViewportAndScissor(cmdBuf, mRenderArea);
 
     mRenderBeginned = true;
     return *this;
@@ -641,6 +1045,7 @@ VulkanGraphicsRenderer::RenderHelper& VulkanGraphicsRenderer::RenderHelper::addD
 {
     mColorAttachments.emplace_back(makeAttachmentInfo(mRenderer->mSwapChainImageViews[mRenderer->mSwapchainImageIndex],
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, shouldClear ? &clearValue : nullptr));
+    mRenderArea = mRenderer->mSwapChainExtent;
     return *this;
 }
 
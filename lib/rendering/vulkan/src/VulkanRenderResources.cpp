@@ -4,16 +4,59 @@
 #include "ErrorCheck.h"
 #include "Window.h"
 #include "Helper.h"
+#include "HashHelpers.h"
+#include "ShaderModuleCache.h"
 
 #include <VkBootstrap.h>
+#include <fmt/core.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 namespace Bunny::Render
 {
+namespace
+{
+//  header written in front of the pipeline cache data on disk
+//  the data is only handed to the driver when it was produced by the same device and driver
+struct PipelineCacheFileHeader
+{
+    uint32_t mMagic;
+    uint32_t mHeaderVersion;
+    uint32_t mVendorId;
+    uint32_t mDeviceId;
+    uint32_t mDriverVersion;
+    uint8_t mPipelineCacheUuid[VK_UUID_SIZE];
+    uint8_t mDriverUuid[VK_UUID_SIZE];
+    uint64_t mDataSize;
+    uint64_t mDataHash;
+};
+
+constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x48435042; //  "BPCH"
+constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+PipelineCacheFileHeader makePipelineCacheFileHeader(
+    const VkPhysicalDeviceProperties& deviceProperties, const VkPhysicalDeviceIDProperties& idProperties)
+{
+    PipelineCacheFileHeader header{};
+    header.mMagic = PIPELINE_CACHE_FILE_MAGIC;
+    header.mHeaderVersion = PIPELINE_CACHE_FILE_VERSION;
+    header.mVendorId = deviceProperties.vendorID;
+    header.mDeviceId = deviceProperties.deviceID;
+    header.mDriverVersion = deviceProperties.driverVersion;
+    memcpy(header.mPipelineCacheUuid, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+    memcpy(header.mDriverUuid, idProperties.driverUUID, VK_UUID_SIZE);
+    return header;
+}
+} // namespace
+
 BunnyResult VulkanRenderResources::initialize(Base::Window* window)
 {
-    assert(window != nullptr);
     mWindow = window;
+    mIsHeadless = window == nullptr;
 
     //  initialize volk first
     VK_CHECK_OR_RETURN_BUNNY_SAD(volkInitialize())
@@ -24,6 +67,7 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     //  make the vulkan instance, with basic debug features
     auto instanceBuildResult = builder.set_app_name("BunnyEngine")
                                    .require_api_version(1, 3, 0)
+                                   .set_headless(mIsHeadless)
 #ifdef _DEBUG
                                    .use_default_debug_messenger()
 #endif
@@ -54,15 +98,18 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     });
 #endif
 
-    //  creat VkSurface
-    if (!BUNNY_SUCCESS(window->createSurface(mInstance, nullptr, &mSurface)))
+    //  creat VkSurface, headless rendering has nothing to present to
+    if (!mIsHeadless)
     {
-        PRINT_AND_RETURN_VALUE("failed to create window surface!", BUNNY_SAD)
+        if (!BUNNY_SUCCESS(window->createSurface(mInstance, nullptr, &mSurface)))
+        {
+            PRINT_AND_RETURN_VALUE("failed to create window surface!", BUNNY_SAD)
+        }
+        mDeletionStack.AddFunction([this]() {
+            vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+            mSurface = VK_NULL_HANDLE;
+        });
     }
-    mDeletionStack.AddFunction([this]() {
-        vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
-        mSurface = VK_NULL_HANDLE;
-    });
 
     //  Select VkPhysicalDevice
     //  Note: might review these features in detail later and maybe make them configurable
@@ -75,8 +122,12 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     features12.descriptorIndexing = true;
     features12.descriptorBindingPartiallyBound = true;
     features12.descriptorBindingVariableDescriptorCount = true;
+    features12.descriptorBindingSampledImageUpdateAfterBind = true;
+    features12.descriptorBindingUpdateUnusedWhilePending = true;
     features12.runtimeDescriptorArray = true;
     features12.samplerFilterMinmax = true;
+    //  gpu profiler resets its queries on the host after reading them
+    features12.hostQueryReset = true;
 
     //  enable usage of std430 uniform buffer
     //  https://docs.vulkan.org/guide/latest/shader_memory_layout.html#VK_KHR_uniform_buffer_standard_layout
@@ -88,6 +139,8 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     featureBasic.multiDrawIndirect = true;
     //  needed for having different format of color attachments for gbuffer
     featureBasic.independentBlend = true;
+    //  needed for the rg8 and r8 storage images of the generated cloud noise
+    featureBasic.shaderStorageImageExtendedFormats = true;
 
     VkPhysicalDeviceAccelerationStructureFeaturesKHR featureAccel{
         VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR};
@@ -117,6 +170,7 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
             .add_required_extension_features(featureRayQuery)
             .add_required_extension(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME) //  required by ray tracing pipeline
             .add_desired_extension(VK_EXT_MESH_SHADER_EXTENSION_NAME)
+            .add_desired_extension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)
             .set_required_features_13(features13)
             .set_required_features_12(features12)
             .set_required_features(featureBasic)
@@ -132,6 +186,12 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     mSupportMeshShader =
         mSupportMeshShader && vkbPhysicalDevice.enable_extension_features_if_present(featureMeshShader);
 
+    mSupportPushDescriptor = vkbPhysicalDevice.enable_extension_if_present(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+    VkPhysicalDeviceFeatures featureStatistics{};
+    featureStatistics.pipelineStatisticsQuery = true;
+    mSupportPipelineStatistics = vkbPhysicalDevice.enable_features_if_present(featureStatistics);
+
     mPhysicalDevice = vkbPhysicalDevice.physical_device;
 
     //  create logical VkDevice
@@ -156,7 +216,7 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     {
         PRINT_AND_RETURN_VALUE("Fail to get graphics queue.", BUNNY_SAD);
     }
-    if (!BUNNY_SUCCESS(getQueueFromDevice(mPresentQueue, vkbDevice, vkb::QueueType::present)))
+    if (!mIsHeadless && !BUNNY_SUCCESS(getQueueFromDevice(mPresentQueue, vkbDevice, vkb::QueueType::present)))
     {
         PRINT_AND_RETURN_VALUE("Fail to get present queue.", BUNNY_SAD);
     }
@@ -189,6 +249,15 @@ BunnyResult VulkanRenderResources::initialize(Base::Window* window)
     //  create immedate command
     createImmediateCommand();
 
+    if (!BUNNY_SUCCESS(createPipelineCache()))
+    {
+        PRINT_WARNING("Fail to create pipeline cache, pipelines will be compiled from scratch.")
+    }
+
+    mShaderModuleCache = std::make_unique<ShaderModuleCache>();
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mShaderModuleCache->initialize(mDevice, mShaderBundleFilePath))
+    mDeletionStack.AddFunction([this]() { mShaderModuleCache->cleanup(); });
+
     return BUNNY_HAPPY;
 }
 
@@ -235,10 +304,13 @@ BunnyResult VulkanRenderResources::createBufferWithData(const void* data, VkDevi
 
 BunnyResult VulkanRenderResources::createImageWithData(void* data, VkDeviceSize dataSize, VkExtent3D imageExtent,
     VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags, VkImageLayout layout,
-    AllocatedImage& outImage, bool is3d) const
+    AllocatedImage& outImage, bool is3d, uint32_t arrayLayers, std::span<const VkDeviceSize> mipOffsets) const
 {
+    const uint32_t mipCount = mipOffsets.empty() ? 1 : static_cast<uint32_t>(mipOffsets.size());
+
     //  create image
-    outImage = createImage(imageExtent, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, aspectFlags, is3d);
+    outImage = createImage(imageExtent, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, aspectFlags, is3d,
+        VK_IMAGE_LAYOUT_UNDEFINED, mipCount, VK_SAMPLE_COUNT_1_BIT, arrayLayers);
 
     //  create staging buffer
     AllocatedBuffer stagingBuffer = createBuffer(dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -253,28 +325,32 @@ BunnyResult VulkanRenderResources::createImageWithData(void* data, VkDeviceSize
         return BUNNY_SAD;
     }
 
-    VkImageSubresourceLayers imageSubresource{
-        .aspectMask = aspectFlags, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1};
-
-    VkBufferImageCopy bufImgCopy{
-        .bufferOffset = 0,
-        .bufferRowLength = 0, //  image data is tightly packed
-        .bufferImageHeight = 0, //  image data is tightly packed
-        .imageSubresource = imageSubresource,
-        .imageOffset = {0, 0, 0},
-        .imageExtent = imageExtent
-    };
+    std::vector<VkBufferImageCopy> bufImgCopies(mipCount);
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        bufImgCopies[mip] = VkBufferImageCopy{
+            .bufferOffset = mipOffsets.empty() ? 0 : mipOffsets[mip],
+            .bufferRowLength = 0, //  image data is tightly packed
+            .bufferImageHeight = 0, //  image data is tightly packed, layer after layer
+            .imageSubresource = {.aspectMask = aspectFlags, .mipLevel = mip, .baseArrayLayer = 0,
+                .layerCount = arrayLayers},
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {(std::max)(imageExtent.width >> mip, 1u), (std::max)(imageExtent.height >> mip, 1u),
+                (std::max)(imageExtent.depth >> mip, 1u)},
+        };
+    }
 
     //  transition image layout to be transfer destination
-    transitionImageLayout(
-        cmdBuf, outImage.mImage, outImage.mFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    transitionImageLayout(cmdBuf, outImage.mImage, outImage.mFormat, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipCount);
 
     //  copy the image data into the image
-    vkCmdCopyBufferToImage(
-        cmdBuf, stagingBuffer.mBuffer, outImage.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufImgCopy);
+    vkCmdCopyBufferToImage(cmdBuf, stagingBuffer.mBuffer, outImage.mImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        mipCount, bufImgCopies.data());
 
     //  transition the image layout to the desired layout
-    transitionImageLayout(cmdBuf, outImage.mImage, outImage.mFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
+    transitionImageLayout(
+        cmdBuf, outImage.mImage, outImage.mFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, mipCount);
 
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(endAndSubmitImmediateCommand(CommandQueueType::Graphics))
 
@@ -318,7 +394,7 @@ AllocatedBuffer VulkanRenderResources::createBuffer(VkDeviceSize size, VkBufferU
 
 AllocatedImage VulkanRenderResources::createImage(VkExtent3D size, VkFormat format, VkImageUsageFlags usage,
     VkImageAspectFlags aspectFlags, bool is3d, VkImageLayout layout, uint32_t mipCount,
-    VkSampleCountFlagBits sampleCount) const
+    VkSampleCountFlagBits sampleCount, uint32_t arrayLayers) const
 {
     AllocatedImage newImage;
     newImage.mFormat = format;
@@ -328,7 +404,7 @@ AllocatedImage VulkanRenderResources::createImage(VkExtent3D size, VkFormat form
     imgCreateInfo.imageType = is3d ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
     imgCreateInfo.extent = size;
     imgCreateInfo.mipLevels = mipCount;
-    imgCreateInfo.arrayLayers = 1;
+    imgCreateInfo.arrayLayers = arrayLayers;
     imgCreateInfo.format = format;
     imgCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -346,13 +422,14 @@ AllocatedImage VulkanRenderResources::createImage(VkExtent3D size, VkFormat form
 
     VkImageViewCreateInfo viewCreateInfo = {.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
     viewCreateInfo.pNext = nullptr;
-    viewCreateInfo.viewType = is3d ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+    viewCreateInfo.viewType =
+        is3d ? VK_IMAGE_VIEW_TYPE_3D : (arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D);
     viewCreateInfo.image = newImage.mImage;
     viewCreateInfo.format = format;
     viewCreateInfo.subresourceRange.baseMipLevel = 0;
     viewCreateInfo.subresourceRange.levelCount = mipCount;
     viewCreateInfo.subresourceRange.baseArrayLayer = 0;
-    viewCreateInfo.subresourceRange.layerCount = 1;
+    viewCreateInfo.subresourceRange.layerCount = arrayLayers;
     viewCreateInfo.subresourceRange.aspectMask = aspectFlags;
 
     VK_HARD_CHECK(vkCreateImageView(mDevice, &viewCreateInfo, nullptr, &newImage.mImageView));
@@ -367,6 +444,11 @@ AllocatedImage VulkanRenderResources::createImage(VkExtent3D size, VkFormat form
     return newImage;
 }
 
+void VulkanRenderResources::invalidateMappedBuffer(const AllocatedBuffer& buffer) const
+{
+    vmaInvalidateAllocation(mAllocator, buffer.mAllocation, 0, VK_WHOLE_SIZE);
+}
+
 void VulkanRenderResources::destroyBuffer(AllocatedBuffer& buffer) const
 {
     if (buffer.mBuffer == nullptr)
@@ -392,6 +474,37 @@ void VulkanRenderResources::destroyImage(AllocatedImage& image) const
     image.mAllocation = nullptr;
 }
 
+BunnyResult VulkanRenderResources::allocateMemory(
+    const VkMemoryRequirements& requirements, VmaAllocation& outAllocation) const
+{
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    allocCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    allocCreateInfo.priority = 1;
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(
+        vmaAllocateMemory(mAllocator, &requirements, &allocCreateInfo, &outAllocation, nullptr))
+
+    return BUNNY_HAPPY;
+}
+
+BunnyResult VulkanRenderResources::bindImageMemory(VkImage image, VmaAllocation allocation, VkDeviceSize offset) const
+{
+    VK_CHECK_OR_RETURN_BUNNY_SAD(vmaBindImageMemory2(mAllocator, allocation, offset, image, nullptr))
+
+    return BUNNY_HAPPY;
+}
+
+void VulkanRenderResources::freeMemory(VmaAllocation& allocation) const
+{
+    if (allocation == nullptr)
+    {
+        return;
+    }
+    vmaFreeMemory(mAllocator, allocation);
+    allocation = nullptr;
+}
+
 void VulkanRenderResources::copyBuffer(
     VkCommandBuffer cmd, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) const
 {
@@ -425,7 +538,7 @@ void VulkanRenderResources::transitionImageLayout(VkCommandBuffer commandBuffer,
         .baseMipLevel = 0,
         .levelCount = mipLevels,
         .baseArrayLayer = 0,
-        .layerCount = 1,
+        .layerCount = VK_REMAINING_ARRAY_LAYERS,
     };
     if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
     {
@@ -517,6 +630,55 @@ VkPhysicalDeviceProperties VulkanRenderResources::getPhysicalDeviceProperties(vo
     return physicalDeviceProp2.properties;
 }
 
+BunnyResult VulkanRenderResources::savePipelineCache() const
+{
+    if (mPipelineCache == VK_NULL_HANDLE)
+    {
+        return BUNNY_SAD;
+    }
+
+    size_t dataSize = 0;
+    VK_CHECK_OR_RETURN_BUNNY_SAD(vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, nullptr))
+    std::vector<std::byte> data(dataSize);
+    VK_CHECK_OR_RETURN_BUNNY_SAD(vkGetPipelineCacheData(mDevice, mPipelineCache, &dataSize, data.data()))
+
+    VkPhysicalDeviceIDProperties idProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+    VkPhysicalDeviceProperties deviceProperties = getPhysicalDeviceProperties(&idProperties);
+
+    PipelineCacheFileHeader header = makePipelineCacheFileHeader(deviceProperties, idProperties);
+    header.mDataSize = dataSize;
+    header.mDataHash = Base::fnv1aHash(data.data(), dataSize);
+
+    //  write to a temp file first so that a crash while saving does not leave a broken cache behind
+    std::string tempFilePath = mPipelineCacheFilePath + ".tmp";
+    {
+        std::ofstream cacheFile(tempFilePath, std::ios::binary | std::ios::trunc);
+        if (!cacheFile.is_open())
+        {
+            std::string errMsg = fmt::format("Can not open {} to save pipeline cache.", tempFilePath);
+            PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+        }
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(PipelineCacheFileHeader));
+        cacheFile.write(reinterpret_cast<const char*>(data.data()), dataSize);
+        if (!cacheFile.good())
+        {
+            std::string errMsg = fmt::format("Fail to write pipeline cache to {}.", tempFilePath);
+            PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+        }
+    }
+
+    std::error_code renameError;
+    std::filesystem::rename(tempFilePath, mPipelineCacheFilePath, renameError);
+    if (renameError)
+    {
+        std::string errMsg = fmt::format("Fail to save pipeline cache to {}: {}", mPipelineCacheFilePath,
+            renameError.message());
+        PRINT_AND_RETURN_VALUE(errMsg, BUNNY_SAD)
+    }
+
+    return BUNNY_HAPPY;
+}
+
 VulkanRenderResources::~VulkanRenderResources()
 {
     cleanup();
@@ -635,4 +797,78 @@ BunnyResult VulkanRenderResources::endAndSubmitImmediateCommand(CommandQueueType
     return BUNNY_HAPPY;
 }
 
+BunnyResult VulkanRenderResources::createPipelineCache()
+{
+    //  an empty or rejected cache file is not an error, the cache just starts cold
+    std::vector<std::byte> initialData;
+    loadPipelineCacheData(initialData);
+
+    VkPipelineCacheCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    VK_CHECK_OR_RETURN_BUNNY_SAD(vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mPipelineCache))
+
+    mDeletionStack.AddFunction([this]() {
+        //  all pipelines have been created by now, persist the cache for the next launch
+        savePipelineCache();
+        vkDestroyPipelineCache(mDevice, mPipelineCache, nullptr);
+        mPipelineCache = VK_NULL_HANDLE;
+    });
+
+    return BUNNY_HAPPY;
+}
+
+bool VulkanRenderResources::loadPipelineCacheData(std::vector<std::byte>& outData) const
+{
+    outData.clear();
+
+    std::ifstream cacheFile(mPipelineCacheFilePath, std::ios::binary | std::ios::ate);
+    if (!cacheFile.is_open())
+    {
+        return false;
+    }
+    const std::streamoff fileSize = cacheFile.tellg();
+    cacheFile.seekg(0);
+
+    PipelineCacheFileHeader header;
+    if (!cacheFile.read(reinterpret_cast<char*>(&header), sizeof(PipelineCacheFileHeader)))
+    {
+        PRINT_WARNING("Pipeline cache file is truncated, ignore it.")
+        return false;
+    }
+
+    VkPhysicalDeviceIDProperties idProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+    VkPhysicalDeviceProperties deviceProperties = getPhysicalDeviceProperties(&idProperties);
+    PipelineCacheFileHeader expected = makePipelineCacheFileHeader(deviceProperties, idProperties);
+
+    if (header.mMagic != expected.mMagic || header.mHeaderVersion != expected.mHeaderVersion ||
+        header.mVendorId != expected.mVendorId || header.mDeviceId != expected.mDeviceId ||
+        header.mDriverVersion != expected.mDriverVersion ||
+        memcmp(header.mPipelineCacheUuid, expected.mPipelineCacheUuid, VK_UUID_SIZE) != 0 ||
+        memcmp(header.mDriverUuid, expected.mDriverUuid, VK_UUID_SIZE) != 0)
+    {
+        PRINT_WARNING("Pipeline cache file was created by a different device or driver, ignore it.")
+        return false;
+    }
+
+    //  the size comes from the file, check it before allocating so a broken file can not ask for gigabytes
+    if (fileSize < 0 || header.mDataSize != static_cast<uint64_t>(fileSize) - sizeof(PipelineCacheFileHeader))
+    {
+        PRINT_WARNING("Pipeline cache file size does not match its header, ignore it.")
+        return false;
+    }
+
+    outData.resize(header.mDataSize);
+    if (!cacheFile.read(reinterpret_cast<char*>(outData.data()), header.mDataSize) ||
+        Base::fnv1aHash(outData.data(), outData.size()) != header.mDataHash)
+    {
+        PRINT_WARNING("Pipeline cache file is corrupted, ignore it.")
+        outData.clear();
+        return false;
+    }
+
+    return true;
+}
+
 } // namespace Bunny::Render
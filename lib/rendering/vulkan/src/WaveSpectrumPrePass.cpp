@@ -13,7 +13,6 @@
 
 #include <array>
 #include <vector>
-#include <random>
 
 namespace Bunny::Render
 {
@@ -36,13 +35,10 @@ void WaveSpectrumPrePass::draw() const
     constexpr static uint32_t computeSizeX = 16;
     constexpr static uint32_t computeSizeY = 16;
 
-    VkImageMemoryBarrier spectrumImagePreBarrier =
-        makeImageMemoryBarrier(mSpectrumImage.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &spectrumImagePreBarrier);
+    //  the spectrum image is transitioned to general by the frame graph
 
-    vkCmdDispatch(cmd, mWaveSpectrumData.N / computeSizeX, mWaveSpectrumData.N / computeSizeY, 1);
+    //  one layer per cascade
+    vkCmdDispatch(cmd, mWaveSpectrumData.N / computeSizeX, mWaveSpectrumData.N / computeSizeY, WAVE_CASCADE_COUNT);
 
     // VkImageMemoryBarrier spectrumImagePostBarrier =
     //     makeImageMemoryBarrier(mSpectrumImage.mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
@@ -62,6 +58,16 @@ void WaveSpectrumPrePass::prepareSpectrumImageForView()
         VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &spectrumImagePostBarrier);
 }
 
+std::array<float, WAVE_CASCADE_COUNT> WaveSpectrumPrePass::getCascadeWidths() const
+{
+    std::array<float, WAVE_CASCADE_COUNT> widths;
+    for (uint32_t idx = 0; idx < WAVE_CASCADE_COUNT; idx++)
+    {
+        widths[idx] = CASCADE_PARAMS[idx].mAreaWidth;
+    }
+    return widths;
+}
+
 BunnyResult WaveSpectrumPrePass::initPipeline()
 {
     std::vector<VkDescriptorSetLayout> descLayouts{mImageDescLayout, mSpectrumDescLayout};
@@ -92,21 +98,27 @@ BunnyResult WaveSpectrumPrePass::initDescriptors()
 
 BunnyResult WaveSpectrumPrePass::initDataAndResources()
 {
-    //  create spectrum data and buffer
-    mWaveSpectrumData.wind = glm::vec2(5.0f, 3.0f);
-    mWaveSpectrumData.width = AREA_WIDTH;
+    //  create spectrum data and buffer, the cascades only differ in their area and band
+    mWaveSpectrumData.wind = CASCADE_PARAMS[0].mWind;
     mWaveSpectrumData.N = GRID_N;
-    mWaveSpectrumData.A = 0.02f;
+    mWaveSpectrumData.A = CASCADE_PARAMS[0].mAmplitude;
+    for (uint32_t idx = 0; idx < WAVE_CASCADE_COUNT; idx++)
+    {
+        const Physics::OceanSpectrumParams& params = CASCADE_PARAMS[idx];
+        mWaveSpectrumData.cascades[idx] = CascadeData{.width = params.mAreaWidth,
+            .minWavenumber = params.mMinWavenumber,
+            .maxWavenumber = params.mMaxWavenumber};
+    }
 
     mVulkanResources->createBufferWithData(&mWaveSpectrumData, sizeof(WaveSpectrumData),
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
         VMA_MEMORY_USAGE_AUTO, mWaveSpectrumBuffer);
 
-    //  create spectrum image
+    //  create spectrum image, one layer per cascade
     mSpectrumImage = mVulkanResources->createImage({GRID_N, GRID_N, 1}, VK_FORMAT_R32G32B32A32_SFLOAT,
         VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
-        VK_IMAGE_LAYOUT_GENERAL);
+        VK_IMAGE_LAYOUT_GENERAL, 1, VK_SAMPLE_COUNT_1_BIT, WAVE_CASCADE_COUNT);
 
     mDeletionStack.AddFunction([this]() {
         mVulkanResources->destroyBuffer(mWaveSpectrumBuffer);
@@ -159,24 +171,21 @@ BunnyResult WaveSpectrumPrePass::initDescriptorLayouts()
 
 BunnyResult WaveSpectrumPrePass::createRandomValueImage()
 {
-    //  create random value image data
-    size_t size = GRID_N * GRID_N;
+    //  create random value image data, seeded so the cpu ocean simulation draws the same values
+    //  one layer per cascade, each with its own seed so the cascades do not repeat each other
     std::vector<glm::vec4> dataVec;
-    dataVec.reserve(size);
-
-    std::random_device rd{};
-    std::mt19937 gen(rd());
-    std::normal_distribution<float> stdNormal(0, 1);
-
-    for (size_t i = 0; i < size; i++)
+    dataVec.reserve(static_cast<size_t>(GRID_N) * GRID_N * WAVE_CASCADE_COUNT);
+    for (const Physics::OceanSpectrumParams& params : CASCADE_PARAMS)
     {
-        dataVec.emplace_back(stdNormal(gen), stdNormal(gen), stdNormal(gen), stdNormal(gen));
+        std::vector<glm::vec4> cascadeValues = Physics::generateOceanRandomValues(params);
+        dataVec.insert(dataVec.end(), cascadeValues.begin(), cascadeValues.end());
     }
 
     //  create image
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mVulkanResources->createImageWithData(dataVec.data(),
         getContainerDataSize(dataVec), VkExtent3D{GRID_N, GRID_N, 1}, VK_FORMAT_R32G32B32A32_SFLOAT,
-        VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, mStdNormalDistImage))
+        VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, mStdNormalDistImage, false,
+        WAVE_CASCADE_COUNT))
 
     //  clean up
     mDeletionStack.AddFunction([this]() { mVulkanResources->destroyImage(mStdNormalDistImage); });
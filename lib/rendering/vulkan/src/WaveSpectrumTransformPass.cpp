@@ -6,6 +6,14 @@
 #include "ImguiHelper.h"
 
 #include <imgui.h>
+#include <fmt/core.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/common.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <vector>
 
 namespace Bunny::Render
@@ -13,42 +21,45 @@ namespace Bunny::Render
 
 static constexpr uint32_t DIRECTION_ROW = 0;
 static constexpr uint32_t DIRECTION_COLUMN = 1;
+//  of the largest displacement of a cascade, the sin and cos of the gpu are less precise for the large phases
+static constexpr float VALIDATION_TOLERANCE = 0.01f;
 
 Render::WaveSpectrumTransformPass::WaveSpectrumTransformPass(const VulkanRenderResources* vulkanResources,
-    const VulkanGraphicsRenderer* renderer, uint32_t size, float width, std::string_view spectrumShaderPath,
-    std::string_view bitReverseShaderPath, std::string_view fftPingPongShaderPath,
-    std::string_view waveConstructShaderPath)
+    const VulkanGraphicsRenderer* renderer, uint32_t size, std::span<const float, WAVE_CASCADE_COUNT> widths,
+    std::string_view spectrumShaderPath,
+    std::string_view fftShaderPath, std::string_view waveConstructShaderPath)
     : super(vulkanResources, renderer, nullptr, nullptr),
       mTimedSpectrumShaderPath(spectrumShaderPath),
-      mBitReverseShaderPath(bitReverseShaderPath),
-      mFftShaderPath(fftPingPongShaderPath),
+      mFftShaderPath(fftShaderPath),
       mWaveConstructShaderPath(waveConstructShaderPath)
 {
-    updateWidth(size, width);
+    updateWidth(size, widths);
 }
 
 void Render::WaveSpectrumTransformPass::draw() const
 {
-    FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
+    const uint32_t currentFrameIdx = mRenderer->getCurrentFrameIdx();
+    FrameData& frame = mFrameData[currentFrameIdx];
 
-    frame.mDescriptorAllocator.clearPools(device);
+    //  the frame fence has been waited for, so the readback of this frame index from last time is complete
+    if (mValidationSimulation.has_value())
+    {
+        validateWaveDisplacement(currentFrameIdx);
+    }
 
     //  add time to the wave spectrum
     computeTimedSpectrum();
 
-    //  transform the spectrums to get the actual values
-    //  should not matter, but only one is setting the frame.mIsOutputToImagePong
-    fastFourierTransform(
-        frame.mTimedSpectrumPing, frame.mTimedSpectrumPong, mFFTParams.mN, true, frame.mIsOutputToImagePong);
-    bool dummyBool1, dummyBool2, dummyBool3;
-    fastFourierTransform(frame.mSlopeSpectrumPing, frame.mSlopeSpectrumPong, mFFTParams.mN, true, dummyBool1);
-    fastFourierTransform(frame.mDisplaceSpectrumPing, frame.mDisplaceSpectrumPong, mFFTParams.mN, true, dummyBool2);
-    fastFourierTransform(
-        frame.mDisplaceSlopeSpectrumPing, frame.mDisplaceSlopeSpectrumPong, mFFTParams.mN, true, dummyBool3);
-
-    ////  use the inverse FFT result to construct the actual wave vertex displacement and normal
+    //  transform the spectrums to get the actual values, all of them at once in place
+    fastFourierTransform(*frame.mTimedSpectrumImages, true);
+
+    ////  use the inverse FFT result to construct the actual wave vertex displacement and slope
     constructWave();
+
+    if (mValidationSimulation.has_value())
+    {
+        readBackWaveDisplacement();
+    }
 }
 
 void Render::WaveSpectrumTransformPass::updateWaveTime(float time)
@@ -59,11 +70,12 @@ void Render::WaveSpectrumTransformPass::updateWaveTime(float time)
     }
 }
 
-void Render::WaveSpectrumTransformPass::updateWidth(uint32_t size, float width)
+void Render::WaveSpectrumTransformPass::updateWidth(uint32_t size, std::span<const float, WAVE_CASCADE_COUNT> widths)
 {
     mTimedSpectrumParams.mN = size;
-    mTimedSpectrumParams.mWidth = width;
+    std::copy(widths.begin(), widths.end(), mTimedSpectrumParams.mWidths);
     mFFTParams.mN = size;
+    mFFTParams.mLog2N = std::bit_width(size) - 1;
 }
 
 void Render::WaveSpectrumTransformPass::updateSpectrumImage(const AllocatedImage* spectrumImage)
@@ -77,51 +89,36 @@ void Render::WaveSpectrumTransformPass::updateSpectrumImage(const AllocatedImage
     }
 }
 
-void WaveSpectrumTransformPass::prepareCurrentFrameImagesForView()
+void WaveSpectrumTransformPass::linkSpectrumImage(uint32_t frameIdx, const AllocatedImage* spectrumImages)
 {
-    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
-    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-
-    VkImageMemoryBarrier heightImageBarrier = makeImageMemoryBarrier(
-        frame.mIsOutputToImagePong ? frame.mTimedSpectrumPong.mImage : frame.mTimedSpectrumPing.mImage,
-        VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
-    VkImageMemoryBarrier barriers[]{heightImageBarrier};
-    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, barriers);
+    mFrameData[frameIdx].mTimedSpectrumImages = spectrumImages;
 }
 
-const AllocatedImage& WaveSpectrumTransformPass::getHeightImage() const
+const AllocatedImage& WaveSpectrumTransformPass::getWaveDisplacementImage() const
 {
-    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    return frame.mIsOutputToImagePong ? frame.mTimedSpectrumPong : frame.mTimedSpectrumPing;
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mWaveDisplacementImage;
 }
 
-const AllocatedImage& WaveSpectrumTransformPass::getWaveDisplacementImage() const
+const AllocatedImage& WaveSpectrumTransformPass::getWaveSlopeImage() const
 {
-    return mFrameData[mRenderer->getCurrentFrameIdx()].mWaveDisplacementImage;
+    return mFrameData[mRenderer->getCurrentFrameIdx()].mWaveSlopeImage;
 }
 
-const AllocatedImage& WaveSpectrumTransformPass::getWaveNormalImage() const
+void WaveSpectrumTransformPass::enableValidation(std::span<const Physics::OceanSpectrumParams> cascades)
 {
-    return mFrameData[mRenderer->getCurrentFrameIdx()].mWaveNormalImage;
+    mValidationSimulation.emplace(cascades);
 }
 
 BunnyResult Render::WaveSpectrumTransformPass::initPipeline()
 {
-    std::vector<VkDescriptorSetLayout> descLayouts{mImageDescLayout};
+    std::vector<VkDescriptorSetLayout> descLayouts{mFftDescLayout};
     std::vector<VkPushConstantRange> pushConsts;
     VkPushConstantRange& pushConst = pushConsts.emplace_back();
     pushConst.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     pushConst.offset = 0;
 
-    //  fft pipelines
-    //  bit reverse
+    //  fft pipeline
     pushConst.size = sizeof(FFTParams);
-    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(buildComputePipeline(
-        mBitReverseShaderPath, &descLayouts, &pushConsts, &mBitReversePipelineLayout, &mBitReversePipeline))
-
-    //  pingpong
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(
         buildComputePipeline(mFftShaderPath, &descLayouts, &pushConsts, &mPipelineLayout, &mPipeline))
 
@@ -144,80 +141,48 @@ BunnyResult Render::WaveSpectrumTransformPass::initDescriptors()
 {
     BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(initDescriptorLayouts())
 
-    VkDevice device = mVulkanResources->getDevice();
-
-    DescriptorAllocator::PoolSize poolSizes[] = {
-        {.mType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .mRatio = 20},
-    };
-
-    for (FrameData& frame : mFrameData)
-    {
-        frame.mDescriptorAllocator.init(device, 30, poolSizes);
-    }
-
-    //  all desc sets will be allocated and written to when drawing every frame
-
-    mDeletionStack.AddFunction([this]() {
-        for (FrameData& frame : mFrameData)
-        {
-            frame.mDescriptorAllocator.destroyPools(mVulkanResources->getDevice());
-        }
-    });
+    //  the timed spectrum, fft and wave construct sets come from the descriptor cache of the renderer when drawing
 
     return BUNNY_HAPPY;
 }
 
 BunnyResult Render::WaveSpectrumTransformPass::initDataAndResources()
 {
-    //  create image for fft result
-    for (FrameData& frame : mFrameData)
+    if (!std::has_single_bit(mFFTParams.mN) || mFFTParams.mN > MAX_FFT_SIZE)
     {
-        frame.mTimedSpectrumPing =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mTimedSpectrumPong =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mSlopeSpectrumPing =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mSlopeSpectrumPong =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mDisplaceSpectrumPing =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mDisplaceSpectrumPong =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mDisplaceSlopeSpectrumPing =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mDisplaceSlopeSpectrumPong =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+        PRINT_WARNING("The wave grid size must be a power of 2 no larger than the max fft size")
+        return BUNNY_SAD;
+    }
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(createTwiddleImage())
 
+    //  create images for the wave result, the spectrum images are linked from the frame graph
+    //  one layer per cascade
+    for (FrameData& frame : mFrameData)
+    {
         frame.mWaveDisplacementImage =
             mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R32G32B32A32_SFLOAT,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
-        frame.mWaveNormalImage =
-            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R8G8B8A8_UNORM,
-                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
+                VK_IMAGE_LAYOUT_UNDEFINED, 1, VK_SAMPLE_COUNT_1_BIT, WAVE_CASCADE_COUNT);
+        frame.mWaveSlopeImage =
+            mVulkanResources->createImage(VkExtent3D{mFFTParams.mN, mFFTParams.mN, 1}, VK_FORMAT_R16G16_SFLOAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false,
+                VK_IMAGE_LAYOUT_UNDEFINED, 1, VK_SAMPLE_COUNT_1_BIT, WAVE_CASCADE_COUNT);
     }
 
     mDeletionStack.AddFunction([this]() {
         for (FrameData& frame : mFrameData)
         {
-            mVulkanResources->destroyImage(frame.mTimedSpectrumPing);
-            mVulkanResources->destroyImage(frame.mTimedSpectrumPong);
-            mVulkanResources->destroyImage(frame.mSlopeSpectrumPing);
-            mVulkanResources->destroyImage(frame.mSlopeSpectrumPong);
-            mVulkanResources->destroyImage(frame.mDisplaceSpectrumPing);
-            mVulkanResources->destroyImage(frame.mDisplaceSpectrumPong);
-            mVulkanResources->destroyImage(frame.mDisplaceSlopeSpectrumPing);
-            mVulkanResources->destroyImage(frame.mDisplaceSlopeSpectrumPong);
             mVulkanResources->destroyImage(frame.mWaveDisplacementImage);
-            mVulkanResources->destroyImage(frame.mWaveNormalImage);
+            mVulkanResources->destroyImage(frame.mWaveSlopeImage);
+        }
+        //  only created when validating
+        for (ValidationFrame& validation : mValidationFrames)
+        {
+            if (validation.mReadbackBuffer.mBuffer != nullptr)
+            {
+                mVulkanResources->destroyBuffer(validation.mReadbackBuffer);
+                validation.mReadbackBuffer.mBuffer = nullptr;
+            }
         }
     });
 
@@ -239,13 +204,7 @@ BunnyResult Render::WaveSpectrumTransformPass::initDescriptorLayouts()
 
     builder.addBinding(descBinding); //  input spectrum
     descBinding.binding = 1;
-    builder.addBinding(descBinding); //  timed spectrum
-    descBinding.binding = 2;
-    builder.addBinding(descBinding); //  slope spectrum
-    descBinding.binding = 3;
-    builder.addBinding(descBinding); //  displacement spectrum
-    descBinding.binding = 4;
-    builder.addBinding(descBinding); //  displacement slope spectrum
+    builder.addBinding(descBinding); //  timed, slope, displacement and displacement slope spectrum
     mTimedSpectrumDescLayout = builder.build(mVulkanResources->getDevice());
 
     mDeletionStack.AddFunction(
@@ -253,27 +212,21 @@ BunnyResult Render::WaveSpectrumTransformPass::initDescriptorLayouts()
 
     builder.clear();
     descBinding.binding = 0;
-    builder.addBinding(descBinding);
+    builder.addBinding(descBinding); //  spectra
     descBinding.binding = 1;
-    builder.addBinding(descBinding);
-    mImageDescLayout = builder.build(mVulkanResources->getDevice());
+    builder.addBinding(descBinding); //  twiddle factors
+    mFftDescLayout = builder.build(mVulkanResources->getDevice());
 
     mDeletionStack.AddFunction(
-        [this]() { vkDestroyDescriptorSetLayout(mVulkanResources->getDevice(), mImageDescLayout, nullptr); });
+        [this]() { vkDestroyDescriptorSetLayout(mVulkanResources->getDevice(), mFftDescLayout, nullptr); });
 
     builder.clear();
     descBinding.binding = 0;
-    builder.addBinding(descBinding); //  height
+    builder.addBinding(descBinding); //  height, slope, displacement xz and displacement xz slope
     descBinding.binding = 1;
-    builder.addBinding(descBinding); //  slope
-    descBinding.binding = 2;
-    builder.addBinding(descBinding); //  displacement xz
-    descBinding.binding = 3;
-    builder.addBinding(descBinding); //  displacement xz slope
-    descBinding.binding = 4;
     builder.addBinding(descBinding); //  wave displacement
-    descBinding.binding = 5;
-    builder.addBinding(descBinding); //  wave normal
+    descBinding.binding = 2;
+    builder.addBinding(descBinding); //  wave slope
     mWaveConstructDescLayout = builder.build(mVulkanResources->getDevice());
 
     mDeletionStack.AddFunction(
@@ -286,226 +239,215 @@ void WaveSpectrumTransformPass::computeTimedSpectrum() const
 {
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mSpectrumPipeline);
 
-    VkDescriptorSet spectrumDescSet;
-    frame.mDescriptorAllocator.allocate(device, &mTimedSpectrumDescLayout, &spectrumDescSet, 1);
+    //  the images only change with the frame in flight, so the cached sets are written once per frame in flight
     DescriptorWriter writer;
     writer.writeImage(
         0, frame.mSpectrumImage->mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
     writer.writeImage(
-        1, frame.mTimedSpectrumPing.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.writeImage(
-        2, frame.mSlopeSpectrumPing.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.writeImage(3, frame.mDisplaceSlopeSpectrumPing.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
-        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.writeImage(4, frame.mDisplaceSlopeSpectrumPing.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL,
-        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.updateSet(device, spectrumDescSet);
+        1, frame.mTimedSpectrumImages->mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    VkDescriptorSet spectrumDescSet = mRenderer->getCachedDescriptorSet(mTimedSpectrumDescLayout, writer);
 
+    //  the spectrum images are transitioned to general by the frame graph
     constexpr static uint32_t spectrumComputeSizeX = 16;
     constexpr static uint32_t spectrumComputeSizeY = 16;
-    {
-        VkImageMemoryBarrier spectrumImageBarrier =
-            makeImageMemoryBarrier(frame.mSpectrumImage->mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier timedSpectrumImageBarrier = makeImageMemoryBarrier(frame.mTimedSpectrumPing.mImage,
-            VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier slopeSpectrumImageBarrier = makeImageMemoryBarrier(frame.mSlopeSpectrumPing.mImage,
-            VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier displacementSpectrumImageBarrier = makeImageMemoryBarrier(
-            frame.mDisplaceSpectrumPing.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier displacementSlopeSpectrumImageBarrier = makeImageMemoryBarrier(
-            frame.mDisplaceSlopeSpectrumPing.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier barriers[]{spectrumImageBarrier, timedSpectrumImageBarrier, slopeSpectrumImageBarrier,
-            displacementSpectrumImageBarrier, displacementSlopeSpectrumImageBarrier};
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 5, barriers);
-    }
-
     vkCmdBindDescriptorSets(
         cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mSpectrumPipelineLayout, 0, 1, &spectrumDescSet, 0, nullptr);
     vkCmdPushConstants(cmd, mSpectrumPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TimedSpectrumParams),
         &mTimedSpectrumParams);
-    vkCmdDispatch(
-        cmd, mTimedSpectrumParams.mN / spectrumComputeSizeX, mTimedSpectrumParams.mN / spectrumComputeSizeY, 1);
+    vkCmdDispatch(cmd, mTimedSpectrumParams.mN / spectrumComputeSizeX, mTimedSpectrumParams.mN / spectrumComputeSizeY,
+        WAVE_CASCADE_COUNT);
 }
 
-void Render::WaveSpectrumTransformPass::fastFourierTransform(const AllocatedImage& inputImage,
-    const AllocatedImage& bufferImage, uint32_t N, bool isInverse, bool& isOutputToBuffer) const
+void Render::WaveSpectrumTransformPass::fastFourierTransform(const AllocatedImage& spectrumImages, bool isInverse) const
 {
-    fastFourierTransformOneDir(inputImage, bufferImage, N, DIRECTION_COLUMN, isInverse, isOutputToBuffer);
-    if (isOutputToBuffer)
-    {
-        fastFourierTransformOneDir(bufferImage, inputImage, N, DIRECTION_ROW, isInverse, isOutputToBuffer);
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    DescriptorWriter writer;
+    writer.writeImage(
+        0, spectrumImages.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    writer.writeImage(
+        1, mTwiddleImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    VkDescriptorSet fftDescSet = mRenderer->getCachedDescriptorSet(mFftDescLayout, writer);
 
-        //  tricky here! because the "buffer" in this call to OneDir is actually the inputImage,
-        //  so when passing the value out the bool should be inverted
-        isOutputToBuffer = !isOutputToBuffer;
-    }
-    else
-    {
-        fastFourierTransformOneDir(inputImage, bufferImage, N, DIRECTION_ROW, isInverse, isOutputToBuffer);
-    }
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+
+    //  every work group reads and writes back its own line, the barriers are only needed between the directions
+    VkImageMemoryBarrier spectrumBarrier =
+        makeImageMemoryBarrier(spectrumImages.mImage, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_ASPECT_COLOR_BIT);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &spectrumBarrier);
+    fastFourierTransformOneDir(fftDescSet, DIRECTION_COLUMN, isInverse);
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &spectrumBarrier);
+    fastFourierTransformOneDir(fftDescSet, DIRECTION_ROW, isInverse);
 }
 
-void Render::WaveSpectrumTransformPass::fastFourierTransformOneDir(const AllocatedImage& inputImage,
-    const AllocatedImage& bufferImage, uint32_t N, uint32_t direction, bool isInverse, bool& isOutputToBuffer) const
+void Render::WaveSpectrumTransformPass::fastFourierTransformOneDir(
+    VkDescriptorSet fftDescSet, uint32_t direction, bool isInverse) const
 {
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
-    const FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
 
     FFTParams fftParams = mFFTParams;
     fftParams.mIsInverse = isInverse ? 1 : 0;
-    fftParams.mN = N;
-
-    uint32_t maxIteration = std::log2<uint32_t>(N);
-
-    //  bind bit reverse permutation pipeline
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mBitReversePipeline);
-
-    constexpr static uint32_t bitReverseSizeX = 16;
-    constexpr static uint32_t bitReverseSizeY = 16;
-
-    //  allocate descriptor sets and write images to them
-    VkDescriptorSet inputToBufferDescSet;
-    VkDescriptorSet bufferToInputDescSet;
-    frame.mDescriptorAllocator.allocate(device, &mImageDescLayout, &inputToBufferDescSet, 1);
-    frame.mDescriptorAllocator.allocate(device, &mImageDescLayout, &bufferToInputDescSet, 1);
-    {
-        DescriptorWriter descWriter;
-        descWriter.writeImage(
-            0, inputImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        descWriter.writeImage(
-            1, bufferImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        descWriter.updateSet(device, inputToBufferDescSet);
-        descWriter.clear();
-        descWriter.writeImage(
-            0, bufferImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        descWriter.writeImage(
-            1, inputImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-        descWriter.updateSet(device, bufferToInputDescSet);
-    }
-
-    {
-        VkImageMemoryBarrier inputImageBarrier = makeImageMemoryBarrier(inputImage.mImage, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier outputImageBarrier = makeImageMemoryBarrier(bufferImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier barriers[]{inputImageBarrier, outputImageBarrier};
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-    }
-
-    //  need to use correct layout!!
-    vkCmdBindDescriptorSets(
-        cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mBitReversePipelineLayout, 0, 1, &inputToBufferDescSet, 0, nullptr);
     fftParams.mDirection = direction;
-    vkCmdPushConstants(cmd, mBitReversePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FFTParams), &fftParams);
-    vkCmdDispatch(cmd, mFFTParams.mN / bitReverseSizeX, mFFTParams.mN / bitReverseSizeY, 1);
 
-    constexpr static uint32_t fftSizeX = 64;
-    constexpr static uint32_t fftSizeY = 1;
-
-    //  bind fft pipeline
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &fftDescSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FFTParams), &fftParams);
+    //  one work group per line and spectrum layer of every cascade
+    vkCmdDispatch(cmd, mFFTParams.mN, 1, CASCADE_SPECTRUM_LAYER_COUNT);
+}
 
-    isOutputToBuffer = true;
-    fftParams.iteration = 1;
-    while (fftParams.iteration <= maxIteration)
+BunnyResult WaveSpectrumTransformPass::createTwiddleImage()
+{
+    const uint32_t N = mFFTParams.mN;
+    std::vector<glm::vec2> twiddles(N);
+    for (uint32_t t = 0; t < N; t++)
     {
-        isOutputToBuffer = !isOutputToBuffer;
+        const double angle = -2.0 * glm::pi<double>() * t / N;
+        twiddles[t] = glm::vec2(std::cos(angle), std::sin(angle));
+    }
 
-        {
-            VkImageMemoryBarrier inputImageBarrier = makeImageMemoryBarrier(
-                isOutputToBuffer ? inputImage.mImage : bufferImage.mImage, VK_ACCESS_SHADER_WRITE_BIT,
-                VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-            VkImageMemoryBarrier outputImageBarrier =
-                makeImageMemoryBarrier(isOutputToBuffer ? bufferImage.mImage : inputImage.mImage,
-                    VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
-                    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-            VkImageMemoryBarrier barriers[]{inputImageBarrier, outputImageBarrier};
-            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 2, barriers);
-        }
-        //  need to use correct pipeline layout!!!
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1,
-            isOutputToBuffer ? &inputToBufferDescSet : &bufferToInputDescSet, 0, nullptr);
-        vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FFTParams), &fftParams);
-        vkCmdDispatch(cmd, mFFTParams.mN / fftSizeX, mFFTParams.mN / fftSizeY, 1);
+    BUNNY_CHECK_SUCCESS_OR_RETURN_RESULT(mVulkanResources->createImageWithData(twiddles.data(),
+        twiddles.size() * sizeof(glm::vec2), VkExtent3D{N, 1, 1}, VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, mTwiddleImage))
+    mDeletionStack.AddFunction([this]() { mVulkanResources->destroyImage(mTwiddleImage); });
 
-        fftParams.iteration++;
-    }
+    return BUNNY_HAPPY;
 }
 
 void WaveSpectrumTransformPass::constructWave() const
 {
     VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
     FrameData& frame = mFrameData[mRenderer->getCurrentFrameIdx()];
-    VkDevice device = mVulkanResources->getDevice();
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mWaveConstructPipeline);
 
-    const AllocatedImage& heightImage =
-        frame.mIsOutputToImagePong ? frame.mTimedSpectrumPong : frame.mTimedSpectrumPing;
-    const AllocatedImage& slopeImage = frame.mIsOutputToImagePong ? frame.mSlopeSpectrumPong : frame.mSlopeSpectrumPing;
-    const AllocatedImage& displaceXZImage =
-        frame.mIsOutputToImagePong ? frame.mDisplaceSpectrumPong : frame.mDisplaceSpectrumPing;
-    const AllocatedImage& displaceSlopeXZImage =
-        frame.mIsOutputToImagePong ? frame.mDisplaceSlopeSpectrumPong : frame.mDisplaceSlopeSpectrumPing;
+    const AllocatedImage& transformedImages = *frame.mTimedSpectrumImages;
 
-    VkDescriptorSet waveConstructDescSet;
-    frame.mDescriptorAllocator.allocate(device, &mWaveConstructDescLayout, &waveConstructDescSet, 1);
     DescriptorWriter writer;
-    writer.writeImage(0, heightImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.writeImage(1, slopeImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.writeImage(
-        2, displaceXZImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
     writer.writeImage(
-        3, displaceSlopeXZImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        0, transformedImages.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
     writer.writeImage(
-        4, frame.mWaveDisplacementImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        1, frame.mWaveDisplacementImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
     writer.writeImage(
-        5, frame.mWaveNormalImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-    writer.updateSet(device, waveConstructDescSet);
+        2, frame.mWaveSlopeImage.mImageView, nullptr, VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    VkDescriptorSet waveConstructDescSet = mRenderer->getCachedDescriptorSet(mWaveConstructDescLayout, writer);
 
     constexpr static uint32_t waveComputeSizeX = 16;
     constexpr static uint32_t waveComputeSizeY = 16;
     {
-        VkImageMemoryBarrier heightImageBarrier = makeImageMemoryBarrier(heightImage.mImage, VK_ACCESS_SHADER_WRITE_BIT,
-            VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier slopeImageBarrier = makeImageMemoryBarrier(slopeImage.mImage, VK_ACCESS_SHADER_READ_BIT,
-            VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier displaceImageBarrier =
-            makeImageMemoryBarrier(displaceXZImage.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier displaceSlopeImageBarrier =
-            makeImageMemoryBarrier(displaceSlopeXZImage.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier waveDisplacementImageBarrier = makeImageMemoryBarrier(frame.mWaveDisplacementImage.mImage,
-            VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-            VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier waveNormalImageBarrier =
-            makeImageMemoryBarrier(frame.mWaveNormalImage.mImage, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
-        VkImageMemoryBarrier barriers[]{heightImageBarrier, slopeImageBarrier, displaceImageBarrier,
-            displaceSlopeImageBarrier, waveDisplacementImageBarrier, waveNormalImageBarrier};
+        //  wait for the fft results, the wave images are transitioned to general by the frame graph
+        VkImageMemoryBarrier transformedImageBarrier =
+            makeImageMemoryBarrier(transformedImages.mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
         vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 6, barriers);
+            VK_DEPENDENCY_BY_REGION_BIT, 0, nullptr, 0, nullptr, 1, &transformedImageBarrier);
     }
 
     vkCmdBindDescriptorSets(
         cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mWaveConstructPipelineLayout, 0, 1, &waveConstructDescSet, 0, nullptr);
     vkCmdPushConstants(
         cmd, mWaveConstructPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(WaveParams), &mWaveParams);
-    vkCmdDispatch(cmd, mTimedSpectrumParams.mN / waveComputeSizeX, mTimedSpectrumParams.mN / waveComputeSizeY, 1);
+    vkCmdDispatch(cmd, mTimedSpectrumParams.mN / waveComputeSizeX, mTimedSpectrumParams.mN / waveComputeSizeY,
+        WAVE_CASCADE_COUNT);
+}
+
+void WaveSpectrumTransformPass::readBackWaveDisplacement() const
+{
+    VkCommandBuffer cmd = mRenderer->getCurrentCommandBuffer();
+    const uint32_t currentFrameIdx = mRenderer->getCurrentFrameIdx();
+    const AllocatedImage& displacementImage = mFrameData[currentFrameIdx].mWaveDisplacementImage;
+    ValidationFrame& validation = mValidationFrames[currentFrameIdx];
+
+    const uint32_t N = mFFTParams.mN;
+    if (validation.mReadbackBuffer.mBuffer == nullptr)
+    {
+        validation.mReadbackBuffer =
+            mVulkanResources->createBuffer(sizeof(glm::vec4) * N * N * WAVE_CASCADE_COUNT,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, VMA_MEMORY_USAGE_AUTO);
+    }
+
+    //  the image stays in general, the frame graph transitions it for the ocean pass after this pass
+    VkImageMemoryBarrier displacementBarrier =
+        makeImageMemoryBarrier(displacementImage.mImage, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT);
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &displacementBarrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = WAVE_CASCADE_COUNT;
+    region.imageExtent = {N, N, 1};
+    vkCmdCopyImageToBuffer(
+        cmd, displacementImage.mImage, VK_IMAGE_LAYOUT_GENERAL, validation.mReadbackBuffer.mBuffer, 1, &region);
+
+    mVulkanResources->transitionBufferAccess(cmd, validation.mReadbackBuffer.mBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    //  the barrier of the frame graph after this pass only waits for the compute shader stage,
+    //  chain the copy into it so the next layout transition of the image does not overwrite it while it is read
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+        nullptr, 0, nullptr);
+
+    validation.mTime = mTimedSpectrumParams.mTime;
+    validation.mDisplacementScale = mWaveParams.mU;
+    validation.mHasResult = true;
+}
+
+void WaveSpectrumTransformPass::validateWaveDisplacement(uint32_t frameIdx) const
+{
+    ValidationFrame& validation = mValidationFrames[frameIdx];
+    if (!validation.mHasResult)
+    {
+        return;
+    }
+    validation.mHasResult = false;
+
+    mVulkanResources->invalidateMappedBuffer(validation.mReadbackBuffer);
+    const auto* gpuDisplacements =
+        static_cast<const glm::vec4*>(validation.mReadbackBuffer.mAllocationInfo.pMappedData);
+    mValidationSimulation->update(validation.mTime);
+
+    const size_t texelCount = static_cast<size_t>(mFFTParams.mN) * mFFTParams.mN;
+    const float scale = validation.mDisplacementScale;
+    for (uint32_t cascade = 0; cascade < mValidationSimulation->getCascadeCount(); cascade++)
+    {
+        //  same as waveConstruct.comp
+        std::span<const glm::vec3> cpuGrid = mValidationSimulation->getDisplacementGrid(cascade);
+        std::span<const glm::vec4> gpuGrid(gpuDisplacements + cascade * texelCount, texelCount);
+        auto getCpuDisplacement = [&cpuGrid, scale](size_t idx) {
+            return glm::vec3(-scale * cpuGrid[idx].x, cpuGrid[idx].y, -scale * cpuGrid[idx].z);
+        };
+
+        float maxValue = 0;
+        for (size_t idx = 0; idx < texelCount; idx++)
+        {
+            glm::vec3 value = glm::abs(getCpuDisplacement(idx));
+            maxValue = std::max({maxValue, value.x, value.y, value.z});
+        }
+
+        uint32_t mismatchCount = 0;
+        float maxError = 0;
+        for (size_t idx = 0; idx < texelCount; idx++)
+        {
+            glm::vec3 error = glm::abs(glm::vec3(gpuGrid[idx]) - getCpuDisplacement(idx));
+            float texelError = std::max({error.x, error.y, error.z});
+            maxError = std::max(maxError, texelError);
+            mismatchCount += texelError > VALIDATION_TOLERANCE * maxValue ? 1 : 0;
+        }
+
+        if (mismatchCount > 0)
+        {
+            PRINT_WARNING(fmt::format("{} of {} wave displacement texels of cascade {} do not match the cpu ocean at "
+                                      "time {:.2f}, max error {:.3e} m of {:.3f} m.",
+                mismatchCount, texelCount, cascade, validation.mTime, maxError, maxValue))
+        }
+    }
 }
 
 void WaveSpectrumTransformPass::showImguiControlPanel()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 
 namespace Bunny::Utils
 {
@@ -26,8 +27,25 @@ class BaseTask : public ITask
     virtual TaskState GetState() const override;
     virtual void Stop() override;
 
+    //  block the calling thread until the task is completed
+    void Wait() const;
+
   protected:
+    void SetState(TaskState state);
+
     std::atomic<TaskState> mState{TaskState::Pending};
 };
 
+//  task that runs a callable once
+class FunctionTask : public BaseTask
+{
+  public:
+    explicit FunctionTask(std::function<void()> function);
+
+    virtual void Run() override;
+
+  private:
+    std::function<void()> mFunction;
+};
+
 } // namespace Bunny::Utils
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
 
 namespace Bunny::Utils
 {
@@ -39,12 +41,13 @@ class TaskRunner
 class TaskDispatcher
 {
   public:
-    void StartRunners();
+    //  create one runner per hardware thread when threadCount is 0
+    void StartRunners(unsigned int threadCount = 0);
     bool ScheduleTask(std::shared_ptr<ITask> task);
     void Shutdown();
 
   private:
-    void CreateRunners();
+    void CreateRunners(unsigned int threadCount);
 
     std::vector<std::unique_ptr<TaskRunner>> mRunners;
     std::vector<std::thread> mRunnerThreads;
@@ -4,7 +4,7 @@ namespace Bunny::Utils
 {
 void BaseTask::Run()
 {
-    mState = TaskState::Completed;
+    SetState(TaskState::Completed);
 }
 TaskState BaseTask::GetState() const
 {
@@ -13,4 +13,34 @@ TaskState BaseTask::GetState() const
 void BaseTask::Stop()
 {
 }
+
+void BaseTask::Wait() const
+{
+    TaskState state = mState.load();
+    while (state != TaskState::Completed)
+    {
+        mState.wait(state);
+        state = mState.load();
+    }
+}
+
+void BaseTask::SetState(TaskState state)
+{
+    mState = state;
+    mState.notify_all();
+}
+
+FunctionTask::FunctionTask(std::function<void()> function) : mFunction(std::move(function))
+{
+}
+
+void FunctionTask::Run()
+{
+    SetState(TaskState::Running);
+    if (mFunction)
+    {
+        mFunction();
+    }
+    SetState(TaskState::Completed);
+}
 } // namespace Bunny::Utils
\ No newline at end of file
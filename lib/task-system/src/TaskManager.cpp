@@ -13,9 +13,9 @@ TaskRunner::TaskRunner() : mIsRunning(true), mPendingTaskCount(0)
 
 bool TaskRunner::TryAddTask(std::shared_ptr<ITask> task)
 {
-    std::unique_lock lock(mMutex);
+    std::unique_lock lock(mMutex, std::try_to_lock);
 
-    if (!lock.try_lock())
+    if (!lock.owns_lock())
     {
         return false;
     }
@@ -32,7 +32,6 @@ bool TaskRunner::TryAddTask(std::shared_ptr<ITask> task)
 void TaskRunner::AddTask(std::shared_ptr<ITask> task)
 {
     std::unique_lock lock(mMutex);
-    lock.lock();
 
     mTaskQueue.emplace(task);
     mPendingTaskCount = mTaskQueue.size();
@@ -45,33 +44,25 @@ void TaskRunner::Run()
 {
     while (mIsRunning)
     {
-        if (mActiveTask != nullptr)
         {
-            if (mActiveTask->GetState() == TaskState::Pending)
-            {
-                mActiveTask->Run();
-            }
-
-            if (mActiveTask->GetState() == TaskState::Completed)
+            //  sleep until there is a task to run or the runner is shut down
+            std::unique_lock lock(mMutex);
+            mConditionVar.wait(lock, [this]() { return !mTaskQueue.empty() || !mIsRunning; });
+            if (!mIsRunning)
             {
-                mActiveTask.reset();
+                break;
             }
-        }
 
-        if (!mTaskQueue.empty())
-        {
-            std::lock_guard lock(mMutex);
             mActiveTask = mTaskQueue.front();
             mTaskQueue.pop();
             mPendingTaskCount = mTaskQueue.size();
         }
 
-        if (mActiveTask == nullptr && mTaskQueue.empty())
+        if (mActiveTask->GetState() == TaskState::Pending)
         {
-            std::unique_lock lock(mMutex);
-            mConditionVar.wait(lock, [this]() { return !mTaskQueue.empty(); });
-            lock.unlock();
+            mActiveTask->Run();
         }
+        mActiveTask.reset();
     }
 
     //  shutdown
@@ -83,7 +74,11 @@ void TaskRunner::Run()
 
 void TaskRunner::Shutdown()
 {
-    mIsRunning = false;
+    {
+        std::lock_guard lock(mMutex);
+        mIsRunning = false;
+    }
+    mConditionVar.notify_all();
 }
 
 size_t TaskRunner::GetPendingTaskCount() const
@@ -91,14 +86,14 @@ size_t TaskRunner::GetPendingTaskCount() const
     return mPendingTaskCount;
 }
 
-void TaskDispatcher::StartRunners()
+void TaskDispatcher::StartRunners(unsigned int threadCount)
 {
     //  only start if it's not started yet
     assert(mRunnerThreads.empty());
 
     if (mRunners.empty())
     {
-        return;
+        CreateRunners(threadCount);
     }
 
     mRunnerThreads.reserve(mRunners.size());
@@ -141,9 +136,13 @@ void TaskDispatcher::Shutdown()
     mRunnerThreads.clear();
 }
 
-void TaskDispatcher::CreateRunners()
+void TaskDispatcher::CreateRunners(unsigned int threadCount)
 {
-    const unsigned int threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+    {
+        //  hardware_concurrency() may return 0 when it can not be detected
+        threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
     mRunners.reserve(threadCount);
 
     for (int i = 0; i < threadCount; i++)
@@ -1,68 +1,439 @@
+#include "DdsTexture.h"
+#include "Task.h"
+#include "TaskManager.h"
+
 #include <FastNoise/FastNoise.h>
+#include <stb_image.h>
 #include <stb_image_write.h>
 
-#include <array>
-#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_GENERATOR_SSE2
+#endif
+
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Bunny::Base::DdsFormat;
+using Bunny::Base::DdsTexture;
+
+namespace
+{
+//  the frequencies of the settings are for this resolution
+//  they are scaled with the resolution, so a larger volume has the same features with more detail
+constexpr uint32_t REFERENCE_RESOLUTION = 128;
+
+struct NoiseChannel
+{
+    std::string mNodeTree;
+    int mSeed;
+};
+
+struct VolumeSettings
+{
+    std::string mOutputPath;
+    uint32_t mResolution;
+    float mFrequency;
+    //  one channel writes a R8 volume, two channels a R8G8 volume
+    std::vector<NoiseChannel> mChannels;
+};
+
+struct WeatherSettings
+{
+    std::string mOutputPath;
+    uint32_t mResolution;
+    float mFrequency;
+    NoiseChannel mChannel;
+};
+
+//  map noise in [-1, 1] to [0, 255], values out of the range are clamped
+void remapToUnorm8(const float* input, uint8_t* output, size_t count)
+{
+    size_t idx = 0;
+#ifdef NOISE_GENERATOR_SSE2
+    const __m128 scale = _mm_set1_ps(127.5f);
+    for (; idx + 16 <= count; idx += 16)
+    {
+        //  x * 127.5 + 127.5, truncated like the scalar path
+        __m128i v0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + idx), scale), scale));
+        __m128i v1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + idx + 4), scale), scale));
+        __m128i v2 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + idx + 8), scale), scale));
+        __m128i v3 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(input + idx + 12), scale), scale));
+        //  the saturating packs do the clamping
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + idx), packed);
+    }
+#endif
+    for (; idx < count; idx++)
+    {
+        output[idx] = static_cast<uint8_t>(std::clamp(input[idx] * 127.5f + 127.5f, 0.0f, 255.0f));
+    }
+}
+
+//  weight of the noise at the position inside the tile when it is blended with the noise one tile further
+float getBlendWeight(uint32_t position, uint32_t blendWidth)
+{
+    if (position >= blendWidth)
+    {
+        return 1.0f;
+    }
+    float t = (position + 0.5f) / blendWidth;
+    return t * t * (3.0f - 2.0f * t);
+}
 
-template <typename OutT, float IMin, float IMax, float OMin, float OMax>
-constexpr OutT remap(float input)
+//  generate the slices [zStart, zStart + zCount) of one channel of a tiling volume
+//  the noise is made periodic by cross fading the start of the tile with the noise one tile further on every axis
+//  so the last texel of an axis continues into the first one
+//  the output is written to one channel of the interleaved volume
+void generateTilingSlab(const FastNoise::SmartNode<>& node, const VolumeSettings& settings, uint32_t channelIdx,
+    uint32_t zStart, uint32_t zCount, uint8_t* volume)
 {
-    static_assert(IMin != IMax);
-    static_assert(OMin != OMax);
+    const NoiseChannel& channel = settings.mChannels[channelIdx];
+    const uint32_t size = settings.mResolution;
+    const uint32_t blendWidth = (std::max)(size / 8, 1u);
+    const uint32_t extended = size + blendWidth;
+    const size_t planeSize = size_t(extended) * extended;
+    const float frequency = settings.mFrequency * REFERENCE_RESOLUTION / size;
+
+    std::vector<float> slab(planeSize * zCount);
+    node->GenUniformGrid3D(slab.data(), 0, 0, static_cast<int>(zStart), static_cast<int>(extended),
+        static_cast<int>(extended), static_cast<int>(zCount), frequency, channel.mSeed);
+
+    //  the slices blended on z also need the noise one tile further
+    std::vector<float> wrappedSlab;
+    const uint32_t wrappedCount = zStart < blendWidth ? (std::min)(zCount, blendWidth - zStart) : 0;
+    if (wrappedCount > 0)
+    {
+        wrappedSlab.resize(planeSize * wrappedCount);
+        node->GenUniformGrid3D(wrappedSlab.data(), 0, 0, static_cast<int>(zStart + size), static_cast<int>(extended),
+            static_cast<int>(extended), static_cast<int>(wrappedCount), frequency, channel.mSeed);
+    }
+
+    const size_t channelCount = settings.mChannels.size();
+    std::vector<float> plane(planeSize);
+    std::vector<float> row(size);
+    std::vector<uint8_t> remappedRow(size);
+    for (uint32_t z = 0; z < zCount; z++)
+    {
+        const float* slice = slab.data() + planeSize * z;
+        const float weightZ = getBlendWeight(zStart + z, blendWidth);
+        for (size_t idx = 0; idx < planeSize; idx++)
+        {
+            const float value = slice[idx];
+            plane[idx] = z < wrappedCount ? std::lerp(wrappedSlab[planeSize * z + idx], value, weightZ) : value;
+        }
+
+        for (uint32_t y = 0; y < size; y++)
+        {
+            const float* current = plane.data() + size_t(y) * extended;
+            const float* wrapped = plane.data() + size_t(y + size) * extended;
+            const float weightY = getBlendWeight(y, blendWidth);
+            for (uint32_t x = 0; x < size; x++)
+            {
+                float valueX = y < blendWidth ? std::lerp(wrapped[x], current[x], weightY) : current[x];
+                if (x < blendWidth)
+                {
+                    float wrappedX =
+                        y < blendWidth ? std::lerp(wrapped[x + size], current[x + size], weightY) : current[x + size];
+                    valueX = std::lerp(wrappedX, valueX, getBlendWeight(x, blendWidth));
+                }
+                row[x] = valueX;
+            }
 
-    return (input - IMin) / (IMax - IMin) * (OMax - OMin) + OMin;
+            remapToUnorm8(row.data(), remappedRow.data(), size);
+            uint8_t* output = volume + ((size_t(zStart + z) * size + y) * size) * channelCount + channelIdx;
+            for (uint32_t x = 0; x < size; x++)
+            {
+                output[x * channelCount] = remappedRow[x];
+            }
+        }
+    }
 }
 
-#define remapImage remap<uint8_t, -1.0f, 1.0f, 0.0f, 255.0f>
+//  channels with the same node tree and seed are generated once and copied
+uint32_t getSourceChannel(const VolumeSettings& settings, uint32_t channelIdx)
+{
+    for (uint32_t idx = 0; idx < channelIdx; idx++)
+    {
+        if (settings.mChannels[idx].mNodeTree == settings.mChannels[channelIdx].mNodeTree &&
+            settings.mChannels[idx].mSeed == settings.mChannels[channelIdx].mSeed)
+        {
+            return idx;
+        }
+    }
+    return channelIdx;
+}
 
-int main()
+//  generate a tiling volume with every channel split in slabs of z slices that are generated in parallel
+bool generateVolume(Bunny::Utils::TaskDispatcher& dispatcher, unsigned int threadCount, const VolumeSettings& settings)
 {
-    auto mainNoise = FastNoise::NewFromEncodedNodeTree(
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const uint32_t size = settings.mResolution;
+    const size_t channelCount = settings.mChannels.size();
+    std::vector<uint8_t> volume(size_t(size) * size * size * channelCount);
+
+    std::vector<FastNoise::SmartNode<>> nodes;
+    for (const NoiseChannel& channel : settings.mChannels)
+    {
+        nodes.push_back(FastNoise::NewFromEncodedNodeTree(channel.mNodeTree.c_str()));
+        if (!nodes.back())
+        {
+            std::printf("Can not decode the node tree %s\n", channel.mNodeTree.c_str());
+            return false;
+        }
+    }
+
+    //  a few slabs per thread to even out the work between the runners
+    const uint32_t slabDepth = (std::max)(size / (threadCount * 4), 1u);
+    std::vector<std::shared_ptr<Bunny::Utils::FunctionTask>> tasks;
+    for (uint32_t channelIdx = 0; channelIdx < channelCount; channelIdx++)
+    {
+        if (getSourceChannel(settings, channelIdx) != channelIdx)
+        {
+            continue;
+        }
+        for (uint32_t zStart = 0; zStart < size; zStart += slabDepth)
+        {
+            const uint32_t zCount = (std::min)(slabDepth, size - zStart);
+            auto task = std::make_shared<Bunny::Utils::FunctionTask>(
+                [&node = nodes[channelIdx], &settings, channelIdx, zStart, zCount, data = volume.data()]() {
+                    generateTilingSlab(node, settings, channelIdx, zStart, zCount, data);
+                });
+            dispatcher.ScheduleTask(task);
+            tasks.push_back(std::move(task));
+        }
+    }
+    for (const auto& task : tasks)
+    {
+        task->Wait();
+    }
+    for (uint32_t channelIdx = 0; channelIdx < channelCount; channelIdx++)
+    {
+        const uint32_t sourceChannel = getSourceChannel(settings, channelIdx);
+        for (size_t texel = 0; sourceChannel != channelIdx && texel < volume.size(); texel += channelCount)
+        {
+            volume[texel + channelIdx] = volume[texel + sourceChannel];
+        }
+    }
+
+    DdsTexture texture;
+    texture.mFormat = channelCount == 2 ? DdsFormat::R8G8Unorm : DdsFormat::R8Unorm;
+    texture.mWidth = size;
+    texture.mHeight = size;
+    texture.mDepth = size;
+    texture.mData = std::move(volume);
+    texture.generateMips(Bunny::Base::getFullMipCount(size, size, size));
+
+    if (!Bunny::Base::writeDdsTexture(settings.mOutputPath, texture))
+    {
+        std::printf("Can not write %s\n", settings.mOutputPath.c_str());
+        return false;
+    }
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    std::printf("%s: %u^3, %zu channel(s), %lld ms\n", settings.mOutputPath.c_str(), size, channelCount,
+        static_cast<long long>(elapsed.count()));
+    return true;
+}
+
+bool generateWeather(const WeatherSettings& settings)
+{
+    auto node = FastNoise::NewFromEncodedNodeTree(settings.mChannel.mNodeTree.c_str());
+    if (!node)
+    {
+        std::printf("Can not decode the node tree %s\n", settings.mChannel.mNodeTree.c_str());
+        return false;
+    }
+
+    const uint32_t size = settings.mResolution;
+    std::vector<float> noiseOutput(size_t(size) * size);
+    std::vector<uint8_t> imageData(size_t(size) * size);
+    node->GenUniformGrid2D(noiseOutput.data(), 0, 0, static_cast<int>(size), static_cast<int>(size),
+        settings.mFrequency, settings.mChannel.mSeed);
+    remapToUnorm8(noiseOutput.data(), imageData.data(), imageData.size());
+
+    if (stbi_write_png(settings.mOutputPath.c_str(), static_cast<int>(size), static_cast<int>(size), 1,
+            imageData.data(), sizeof(uint8_t) * size) == 0)
+    {
+        std::printf("Can not write %s\n", settings.mOutputPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+//  convert a volume saved the old way, a 2D png where every row is a layer, to a 3d dds texture with mips
+//  the channels of the png are kept, only 1 or 2 channel images can be converted
+int convertLayeredPng(const char* pngPath, const char* ddsPath)
+{
+    int width;
+    int height;
+    int channels;
+    stbi_uc* data = stbi_load(pngPath, &width, &height, &channels, 0);
+    if (data == nullptr)
+    {
+        std::printf("Can not load %s: %s\n", pngPath, stbi_failure_reason());
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t dimension = static_cast<uint32_t>(height);
+    if (channels > 2 || static_cast<uint32_t>(width) != dimension * dimension)
+    {
+        std::printf("%s is not a layered volume of 1 or 2 channels\n", pngPath);
+        stbi_image_free(data);
+        return EXIT_FAILURE;
+    }
+
+    DdsTexture texture;
+    texture.mFormat = channels == 2 ? DdsFormat::R8G8Unorm : DdsFormat::R8Unorm;
+    texture.mWidth = dimension;
+    texture.mHeight = dimension;
+    texture.mDepth = dimension;
+    texture.mData.assign(data, data + size_t(width) * height * channels);
+    stbi_image_free(data);
+    texture.generateMips(Bunny::Base::getFullMipCount(dimension, dimension, dimension));
+
+    if (!Bunny::Base::writeDdsTexture(ddsPath, texture))
+    {
+        std::printf("Can not write %s\n", ddsPath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void printUsage()
+{
+    std::printf("usage: NoiseGenerator [options]\n"
+                "       NoiseGenerator --convert <layered png> <dds>\n"
+                "  --threads <count>          generation threads, all hardware threads by default\n"
+                "  --main-resolution <size>   size of the main cloud noise volume\n"
+                "  --main-seed <seed>         seed of the lower shape channel, and of the upper one\n"
+                "                             unless --main-upper-seed is given\n"
+                "  --main-tree <tree>         encoded node tree of the lower shape channel, and of the upper one\n"
+                "                             unless --main-upper-tree is given\n"
+                "  --main-upper-seed <seed>   seed of the upper shape channel\n"
+                "  --main-upper-tree <tree>   encoded node tree of the upper shape channel\n"
+                "  --detail-resolution <size> size of the detail cloud noise volume\n"
+                "  --detail-seed <seed>\n"
+                "  --detail-tree <tree>\n"
+                "  --weather-resolution <size>\n"
+                "  --weather-seed <seed>\n"
+                "  --weather-tree <tree>\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && std::strcmp(argv[1], "--convert") == 0)
+    {
+        return convertLayeredPng(argv[2], argv[3]);
+    }
+
+    constexpr const char* mainNodeTree =
         "FwAAAAAApHC9PwAAAAAAAIA/GQAZABkADQAFAAAAAAAAQCkAAM3MzD4AAAAAPwEbABcAAAAAAAAAgD8AAIA/"
-        "AACAvwsAAQAAAAAAAAABAAAAAAAAAAAAAIA/AClcjz4BGwATABSuB0D//wMAAI/C9T0BGwATAHsUjkD//wMAAArXoz0=");
-    auto detailNoise = FastNoise::NewFromEncodedNodeTree(
-        "DQAEAAAAAAAAQBcAAAAAAAAAgD8AAIA/AACAvwsAAQAAAAAAAAAAAAAAAAAAAAAAAIA/AAAAAD8AAADAPw==");
-    auto weatherNoise = FastNoise::NewFromEncodedNodeTree("DQACAAAAKVzPPykAAAAAAD8AAAAAAA==");
-
-    //  main cloud noise
-    //  generate 3D grid and save as 2D png
-    //  every row is a layer of 2D image
-    {
-        constexpr unsigned int noiseDimension3D = 128;
-        std::vector<float> noiseOutput(noiseDimension3D * noiseDimension3D * noiseDimension3D);
-        std::vector<uint8_t> imageData(noiseDimension3D * noiseDimension3D * noiseDimension3D);
-        mainNoise->GenUniformGrid3D(
-            noiseOutput.data(), 0, 0, 0, noiseDimension3D, noiseDimension3D, noiseDimension3D, 0.025, 114514);
-        std::transform(noiseOutput.begin(), noiseOutput.end(), imageData.begin(),
-            [](const float noise) { return remapImage(noise); });
-        stbi_write_png("main_cloud_noise.png", noiseDimension3D * noiseDimension3D, noiseDimension3D, 1,
-            imageData.data(), sizeof(uint8_t) * noiseDimension3D * noiseDimension3D);
-    }
-
-    //  detail cloud noise
-    {
-        constexpr unsigned int noiseDimension3D = 32;
-        std::vector<float> noiseOutput(noiseDimension3D * noiseDimension3D * noiseDimension3D);
-        std::vector<uint8_t> imageData(noiseDimension3D * noiseDimension3D * noiseDimension3D);
-        detailNoise->GenUniformGrid3D(
-            noiseOutput.data(), 0, 0, 0, noiseDimension3D, noiseDimension3D, noiseDimension3D, 0.05, 394056);
-        std::transform(noiseOutput.begin(), noiseOutput.end(), imageData.begin(),
-            [](const float noise) { return remapImage(noise); });
-        stbi_write_png("detail_cloud_noise.png", noiseDimension3D * noiseDimension3D, noiseDimension3D, 1,
-            imageData.data(), sizeof(uint8_t) * noiseDimension3D * noiseDimension3D);
-    }
-
-    //  weather
-    {
-        constexpr unsigned int noiseDimension = 256;
-        std::vector<float> noiseOutput(noiseDimension * noiseDimension);
-        std::vector<uint8_t> imageData(noiseDimension * noiseDimension);
-        weatherNoise->GenUniformGrid2D(noiseOutput.data(), 0, 0, noiseDimension, noiseDimension, 0.002f, 8451);
-        std::transform(noiseOutput.begin(), noiseOutput.end(), imageData.begin(),
-            [](const float noise) { return remapImage(noise); });
-
-        stbi_write_png(
-            "weather.png", noiseDimension, noiseDimension, 1, imageData.data(), sizeof(uint8_t) * noiseDimension);
+        "AACAvwsAAQAAAAAAAAABAAAAAAAAAAAAAIA/AClcjz4BGwATABSuB0D//wMAAI/C9T0BGwATAHsUjkD//wMAAArXoz0=";
+
+    //  the sky pass blends two shape channels over the height of the clouds
+    //  without an upper shape tree both channels hold the same noise
+    VolumeSettings mainSettings{"main_cloud_noise.dds", 128, 0.025f, {{mainNodeTree, 114514}, {mainNodeTree, 114514}}};
+    VolumeSettings detailSettings{"detail_cloud_noise.dds", 32, 0.05f,
+        {{"DQAEAAAAAAAAQBcAAAAAAAAAgD8AAIA/AACAvwsAAQAAAAAAAAAAAAAAAAAAAAAAAIA/AAAAAD8AAADAPw==", 394056}}};
+    WeatherSettings weatherSettings{"weather.png", 256, 0.002f, {"DQACAAAAKVzPPykAAAAAAD8AAAAAAA==", 8451}};
+    unsigned int threadCount = 0;
+    //  the upper shape channel follows the lower one unless it is given on its own
+    std::optional<int> mainUpperSeed;
+    std::optional<std::string> mainUpperTree;
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        std::string_view arg(argv[idx]);
+        const bool hasValue = idx + 1 < argc;
+        if (arg == "--threads" && hasValue)
+        {
+            threadCount = static_cast<unsigned int>(std::atoi(argv[++idx]));
+        }
+        else if (arg == "--main-resolution" && hasValue)
+        {
+            mainSettings.mResolution = static_cast<uint32_t>(std::atoi(argv[++idx]));
+        }
+        else if (arg == "--main-seed" && hasValue)
+        {
+            mainSettings.mChannels[0].mSeed = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--main-tree" && hasValue)
+        {
+            mainSettings.mChannels[0].mNodeTree = argv[++idx];
+        }
+        else if (arg == "--main-upper-seed" && hasValue)
+        {
+            mainUpperSeed = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--main-upper-tree" && hasValue)
+        {
+            mainUpperTree = argv[++idx];
+        }
+        else if (arg == "--detail-resolution" && hasValue)
+        {
+            detailSettings.mResolution = static_cast<uint32_t>(std::atoi(argv[++idx]));
+        }
+        else if (arg == "--detail-seed" && hasValue)
+        {
+            detailSettings.mChannels[0].mSeed = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--detail-tree" && hasValue)
+        {
+            detailSettings.mChannels[0].mNodeTree = argv[++idx];
+        }
+        else if (arg == "--weather-resolution" && hasValue)
+        {
+            weatherSettings.mResolution = static_cast<uint32_t>(std::atoi(argv[++idx]));
+        }
+        else if (arg == "--weather-seed" && hasValue)
+        {
+            weatherSettings.mChannel.mSeed = std::atoi(argv[++idx]);
+        }
+        else if (arg == "--weather-tree" && hasValue)
+        {
+            weatherSettings.mChannel.mNodeTree = argv[++idx];
+        }
+        else
+        {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    mainSettings.mChannels[1].mSeed = mainUpperSeed.value_or(mainSettings.mChannels[0].mSeed);
+    mainSettings.mChannels[1].mNodeTree = mainUpperTree.value_or(mainSettings.mChannels[0].mNodeTree);
+
+    if (mainSettings.mResolution == 0 || detailSettings.mResolution == 0 || weatherSettings.mResolution == 0)
+    {
+        std::printf("The resolutions must be larger than 0\n");
+        return EXIT_FAILURE;
     }
+
+    if (threadCount == 0)
+    {
+        threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+    Bunny::Utils::TaskDispatcher dispatcher;
+    dispatcher.StartRunners(threadCount);
+
+    bool isSuccessful = generateVolume(dispatcher, threadCount, mainSettings) &&
+                        generateVolume(dispatcher, threadCount, detailSettings) && generateWeather(weatherSettings);
+
+    dispatcher.Shutdown();
+    return isSuccessful ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,154 @@
+#include "OceanSimulation.h"
+#include "Timer.h"
+
+#include <fmt/core.h>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string_view>
+#include <vector>
+
+using Bunny::Base::Clock;
+using Bunny::Physics::OceanSimulation;
+using Bunny::Physics::OceanSpectrumParams;
+
+//  measures the cpu ocean simulation, how long an update of the displacement grid takes
+//  and how many height and displacement queries per second it answers for different batch sizes
+//  with --validate it instead checks the fft of the simulation against a direct dft of the same spectrum
+
+static constexpr uint32_t UPDATE_COUNT = 100;
+static constexpr uint32_t QUERIES_PER_RUN = 1 << 20;
+static constexpr uint32_t VALIDATION_POINT_COUNT = 64;
+//  of the largest displacement of the grid, the fft is in float and the reference in double
+static constexpr float VALIDATION_TOLERANCE = 1e-4f;
+
+//  returns the number of grid points that do not match
+static uint32_t validateTransform(OceanSimulation& simulation, float time)
+{
+    simulation.update(time);
+
+    const int N = simulation.getGridN();
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> coord(0, N - 1);
+    uint32_t mismatchCount = 0;
+
+    for (uint32_t cascade = 0; cascade < simulation.getCascadeCount(); cascade++)
+    {
+        std::span<const glm::vec3> grid = simulation.getDisplacementGrid(cascade);
+        float maxValue = 0;
+        for (const glm::vec3& displacement : grid)
+        {
+            maxValue = std::max({maxValue, std::abs(displacement.x), std::abs(displacement.y),
+                std::abs(displacement.z)});
+        }
+
+        float maxError = 0;
+        for (uint32_t idx = 0; idx < VALIDATION_POINT_COUNT; idx++)
+        {
+            //  the first point is the origin, where every wave adds up without a phase
+            int x = idx == 0 ? 0 : coord(random);
+            int y = idx == 0 ? 0 : coord(random);
+            glm::vec3 reference = simulation.computeReferenceDisplacement(cascade, x, y, time);
+            glm::vec3 error = glm::abs(grid[y * N + x] - reference);
+            float pointError = std::max({error.x, error.y, error.z});
+            maxError = std::max(maxError, pointError);
+            mismatchCount += pointError > VALIDATION_TOLERANCE * maxValue ? 1 : 0;
+        }
+
+        fmt::print("time {:>6.2f}, cascade {}: max error {:.3e} m, largest displacement {:.3f} m\n", time, cascade,
+            maxError, maxValue);
+    }
+
+    return mismatchCount;
+}
+
+static int runValidation()
+{
+    //  a second, smaller cascade with its own seed to check that the cascades do not mix
+    const OceanSpectrumParams cascades[] = {
+        OceanSpectrumParams{}, OceanSpectrumParams{.mAreaWidth = 24.0f, .mSeed = 1}};
+    OceanSimulation simulation(cascades);
+
+    fmt::print("Cpu ocean validation, fft against a direct dft at {} points per cascade\n", VALIDATION_POINT_COUNT);
+    uint32_t mismatchCount = 0;
+    for (float time : {0.0f, 1.7f, 63.25f})
+    {
+        mismatchCount += validateTransform(simulation, time);
+    }
+
+    if (mismatchCount > 0)
+    {
+        fmt::print("Validation failed, {} points differ by more than {} of the largest displacement.\n",
+            mismatchCount, VALIDATION_TOLERANCE);
+        return 1;
+    }
+    fmt::print("Validation passed.\n");
+    return 0;
+}
+
+static double runQueries(const OceanSimulation& simulation, const std::vector<glm::vec2>& positions,
+    size_t batchSize, bool isHeightQuery)
+{
+    std::vector<float> heights(batchSize);
+    std::vector<glm::vec3> displacements(batchSize);
+
+    uint64_t startTime = Clock::now();
+    for (size_t first = 0; first + batchSize <= positions.size(); first += batchSize)
+    {
+        std::span<const glm::vec2> batch(positions.data() + first, batchSize);
+        if (isHeightQuery)
+        {
+            simulation.sampleHeight(batch, heights);
+        }
+        else
+        {
+            simulation.sampleDisplacement(batch, displacements);
+        }
+    }
+    uint64_t endTime = Clock::now();
+
+    //  million queries per second
+    return static_cast<double>(positions.size()) / static_cast<double>(endTime - startTime) * 1e3;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string_view(argv[1]) == "--validate")
+    {
+        return runValidation();
+    }
+
+    OceanSpectrumParams params;
+    OceanSimulation simulation(params);
+
+    fmt::print("Cpu ocean benchmark, {} x {} grid\n", params.mGridN, params.mGridN);
+
+    uint64_t startTime = Clock::now();
+    for (uint32_t idx = 0; idx < UPDATE_COUNT; idx++)
+    {
+        simulation.update(static_cast<float>(idx) / 60.0f);
+    }
+    uint64_t endTime = Clock::now();
+    fmt::print("update: {:.3f} ms\n\n", static_cast<double>(endTime - startTime) / 1e6 / UPDATE_COUNT);
+
+    //  positions spread over a few tiles of the wave area, like objects around the camera
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> coord(-2 * params.mAreaWidth, 2 * params.mAreaWidth);
+    std::vector<glm::vec2> positions(QUERIES_PER_RUN);
+    for (glm::vec2& position : positions)
+    {
+        position = glm::vec2(coord(random), coord(random));
+    }
+
+    fmt::print("{:>10} {:>22} {:>22}\n", "batch", "displacement (M/s)", "height (M/s)");
+    for (size_t batchSize : {1, 16, 256, 4096, 65536})
+    {
+        double displacementRate = runQueries(simulation, positions, batchSize, false);
+        double heightRate = runQueries(simulation, positions, batchSize, true);
+        fmt::print("{:>10} {:>22.2f} {:>22.2f}\n", batchSize, displacementRate, heightRate);
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "Timer.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Bunny::Base::Clock;
+using Bunny::Base::FramePacer;
+
+//  measures how evenly frames start when the frame rate is limited
+//  every frame does a random amount of busy work, then waits for the next frame either
+//  with a plain sleep for the remaining time or with the frame pacer
+
+static constexpr uint32_t FRAME_COUNT = 600;
+
+struct JitterResult
+{
+    double mAverageMs = 0;
+    double mDeviationMs = 0;
+    double mMaxErrorMs = 0; //  largest difference of a frame time from the target
+};
+
+static void busyWork(uint64_t nanoseconds)
+{
+    uint64_t endTime = Clock::now() + nanoseconds;
+    while (Clock::now() < endTime)
+    {
+    }
+}
+
+static JitterResult measure(const std::vector<uint64_t>& frameStartTimes, double targetMs)
+{
+    JitterResult result;
+    std::vector<double> frameTimes;
+    for (size_t idx = 1; idx < frameStartTimes.size(); idx++)
+    {
+        frameTimes.push_back(static_cast<double>(frameStartTimes[idx] - frameStartTimes[idx - 1]) / 1e6);
+    }
+
+    for (double frameTime : frameTimes)
+    {
+        result.mAverageMs += frameTime;
+        result.mMaxErrorMs = std::max(result.mMaxErrorMs, std::abs(frameTime - targetMs));
+    }
+    result.mAverageMs /= frameTimes.size();
+
+    for (double frameTime : frameTimes)
+    {
+        result.mDeviationMs += (frameTime - result.mAverageMs) * (frameTime - result.mAverageMs);
+    }
+    result.mDeviationMs = std::sqrt(result.mDeviationMs / (frameTimes.size() - 1));
+
+    return result;
+}
+
+static JitterResult runSleepOnly(double frameRate, const std::vector<uint64_t>& workTimes)
+{
+    uint64_t frameInterval = static_cast<uint64_t>(1e9 / frameRate);
+    std::vector<uint64_t> frameStartTimes;
+    uint64_t nextFrameTime = Clock::now();
+
+    for (uint64_t workTime : workTimes)
+    {
+        uint64_t currentTime = Clock::now();
+        if (currentTime < nextFrameTime)
+        {
+            Clock::sleepFor(nextFrameTime - currentTime);
+        }
+        frameStartTimes.push_back(Clock::now());
+        nextFrameTime += frameInterval;
+
+        busyWork(workTime);
+    }
+
+    return measure(frameStartTimes, 1000.0 / frameRate);
+}
+
+static JitterResult runFramePacer(double frameRate, const std::vector<uint64_t>& workTimes)
+{
+    FramePacer pacer;
+    pacer.setTargetFrameRate(frameRate);
+    std::vector<uint64_t> frameStartTimes;
+
+    for (uint64_t workTime : workTimes)
+    {
+        pacer.waitForNextFrame();
+        frameStartTimes.push_back(Clock::now());
+
+        busyWork(workTime);
+    }
+
+    return measure(frameStartTimes, 1000.0 / frameRate);
+}
+
+int main()
+{
+    fmt::print("Frame pacing jitter benchmark, {} frames per run\n", FRAME_COUNT);
+    fmt::print("{:>8} {:>12} {:>12} {:>14} {:>14}\n", "fps", "method", "avg (ms)", "std dev (ms)", "max err (ms)");
+
+    for (double frameRate : {30.0, 60.0, 144.0, 240.0})
+    {
+        //  the same work for both methods, up to 60% of the frame
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<double> workFraction(0.1, 0.6);
+        std::vector<uint64_t> workTimes(FRAME_COUNT);
+        for (uint64_t& workTime : workTimes)
+        {
+            workTime = static_cast<uint64_t>(workFraction(random) * 1e9 / frameRate);
+        }
+
+        JitterResult sleepResult = runSleepOnly(frameRate, workTimes);
+        JitterResult pacerResult = runFramePacer(frameRate, workTimes);
+
+        fmt::print("{:>8.0f} {:>12} {:>12.3f} {:>14.3f} {:>14.3f}\n", frameRate, "sleep", sleepResult.mAverageMs,
+            sleepResult.mDeviationMs, sleepResult.mMaxErrorMs);
+        fmt::print("{:>8.0f} {:>12} {:>12.3f} {:>14.3f} {:>14.3f}\n", frameRate, "pacer", pacerResult.mAverageMs,
+            pacerResult.mDeviationMs, pacerResult.mMaxErrorMs);
+    }
+
+    return 0;
+}